@@ -0,0 +1,111 @@
+//! Benchmarks rendering kernels on given frames
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Each color mapping mode is run for both channels, along with the per-pixel
+//! std::function path the viewer used to take as a baseline. Tiled rendering
+//! runs on a pool of --threads workers. Preview renders thumbnails of
+//! --preview_size, and is measured in source pixels.
+#include <functional>
+#include <scanlib/render/colorizer.hpp>
+#include <scanlib/render/preview_renderer.hpp>
+#include <scanlib/render/tile_renderer.hpp>
+#include <scanlib/utility/thread_pool.hpp>
+#include "dpta-tool.hpp"
+
+using namespace std;
+using namespace std::chrono;
+
+DEFINE_int32( iterations, 20, "Number of iterations per benchmark case" );
+
+//! Runs Fn for configured iterations; returns processed megapixels per second.
+template <typename Fn_>
+static double Measure( size_t NumPixels, Fn_&& Fn )
+{
+    Fn(); // Warm up; builds lookup tables
+    auto const Begin = steady_clock::now();
+    for ( int i = 0; i < FLAGS_iterations; i++ )
+        Fn();
+    auto const Sec = duration<double>( steady_clock::now() - Begin ).count();
+    return Sec > 0 ? NumPixels * (double)FLAGS_iterations / Sec * 1e-6 : 0.0;
+}
+
+//! Mimics the previous renderer; three indirect calls per pixel.
+static void RenderPerPixel( FDptaFrame const& F, FColorizeParam const& P, uint32_t* Dst )
+{
+    function<float( FPxlData )> calc_H;
+    if ( P.Source == EColorSource::AMPLITUDE )
+        calc_H = []( FPxlData d ) { return d.AMP / (float)( UQ12_4_ONE_INT * ( 1 << 12 ) ); };
+    else
+        calc_H = [&P]( FPxlData d ) {
+            return ( d.Distance / (float)Q9_22_ONE_INT - P.MinDistance ) / ( P.MaxDistance - P.MinDistance );
+        };
+
+    function<uint32_t( float )>            calc_col  = [&P]( float H ) { return FColorizer::MapColor( P.Mode, H ); };
+    function<void( int, int, uint32_t )> set_pixel = [Dst, W = F.Width()]( int x, int y, uint32_t c ) { Dst[y * W + x] = c; };
+
+    auto Head = F.Pixels;
+    for ( int i = 0; i < F.Height(); i++ )
+        for ( int j = 0; j < F.Width(); j++ )
+            set_pixel( j, i, calc_col( calc_H( *Head++ ) ) );
+}
+
+int RunBench( std::vector<std::string> const& Inputs )
+{
+    static EColorMappingMode const Modes[] = {
+      EColorMappingMode::GREYSCALE, EColorMappingMode::BGR, EColorMappingMode::WTOK, EColorMappingMode::RAINBOW };
+    static EColorSource const Sources[] = { EColorSource::DISTANCE, EColorSource::AMPLITUDE };
+
+    FThreadPool      Pool( FLAGS_threads );
+    FTileRenderer    Tiled( &Pool );
+    FPreviewRenderer Preview;
+    vector<uint32_t> Dst;
+    printf( "file,mode,source,lut_mpx_s,tiled_mpx_s,per_pixel_mpx_s,preview_mpx_s\n" );
+    for ( auto& Input : Inputs )
+    {
+        FDptaFrame F;
+        if ( !F.Load( Input ) )
+        {
+            fprintf( stderr, "failed: %s\n", Input.c_str() );
+            continue;
+        }
+
+        auto const N = (size_t)F.Width() * F.Height();
+        Dst.resize( N );
+
+        int PW, PH;
+        FPreviewRenderer::FitSize( F.Width(), F.Height(), F.Header.ASPECT_RATIO, FLAGS_preview_size, PW, PH );
+
+        for ( auto Mode : Modes )
+        {
+            for ( auto Source : Sources )
+            {
+                FColorizeParam P;
+                P.Mode        = Mode;
+                P.Source      = Source;
+                P.MinDistance = 0.f;
+                P.MaxDistance = 10.f;
+
+                FColorizer const C( P );
+                auto const       Lut  = Measure( N, [&]() { C.Render( F.Pixels, F.Width(), F.Height(), Dst.data() ); } );
+                auto const       Tile = Measure( N, [&]() { Tiled.Render( C, F.Pixels, F.Width(), F.Height() ); } );
+                auto const       Ref  = Measure( N, [&]() { RenderPerPixel( F, P, Dst.data() ); } );
+                auto const       Prv  = Measure( N, [&]() { Preview.Render( C, F.Pixels, F.Width(), F.Height(), Dst.data(), PW, PH ); } );
+
+                printf(
+                  "\"%s\",%s,%s,%.1f,%.1f,%.1f,%.1f\n",
+                  Input.c_str(),
+                  ColorModeName( Mode ),
+                  Source == EColorSource::DISTANCE ? "distance" : "amplitude",
+                  Lut,
+                  Tile,
+                  Ref,
+                  Prv );
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+//! Stacks dpta frames of same width vertically into single file
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Inputs are streamed one by one from their mappings; memory usage doesn't
+//! grow with the number of frames.
+#include "dpta-tool.hpp"
+
+using namespace std;
+
+int RunConcat( std::vector<std::string> const& Inputs )
+{
+    if ( FLAGS_output.empty() )
+    {
+        fprintf( stderr, "concat requires --output\n" );
+        return 1;
+    }
+
+    // Headers are validated up front, so that no partial file is written.
+    uint32_t Width = 0, Height = 0;
+    float    AngularWidth = 0;
+    for ( auto& Input : Inputs )
+    {
+        FDptaFrame F;
+        if ( !F.Load( Input ) )
+        {
+            fprintf( stderr, "failed: %s\n", Input.c_str() );
+            return 2;
+        }
+
+        if ( Width == 0 )
+        {
+            Width        = F.Header.WIDTH;
+            AngularWidth = F.Header.ASPECT_RATIO * F.Header.HEIGHT;
+        }
+        else if ( Width != F.Header.WIDTH )
+        {
+            fprintf( stderr, "width mismatch: %s (%u, expected %u)\n", Input.c_str(), F.Header.WIDTH, Width );
+            return 2;
+        }
+        Height += F.Header.HEIGHT;
+    }
+
+    FILE* fp = fopen( FLAGS_output.c_str(), "wb" );
+    if ( fp == nullptr )
+    {
+        fprintf( stderr, "can't open %s\n", FLAGS_output.c_str() );
+        return 2;
+    }
+
+    // Rows keep the angular pitch of the first frame.
+    ScanDataHeaderType h;
+    ScanDataMakeHeader( &h, Width, Height, Height ? AngularWidth / Height : 0.f );
+    bool bOk = fwrite( &h, 1, sizeof h, fp ) == sizeof h;
+
+    FThroughput Stat;
+    for ( size_t i = 0; bOk && i < Inputs.size(); i++ )
+    {
+        FDptaFrame F;
+        bOk = F.Load( Inputs[i] );
+        bOk = bOk && fwrite( F.Pixels, 1, F.Header.DATA_SIZE, fp ) == F.Header.DATA_SIZE;
+        Stat.Add( F.File.Size() );
+    }
+
+    bOk = fclose( fp ) == 0 && bOk;
+    if ( !bOk )
+    {
+        fprintf( stderr, "failed to write %s\n", FLAGS_output.c_str() );
+        remove( FLAGS_output.c_str() );
+        return 2;
+    }
+
+    fprintf( stderr, "concat: %u x %u -> %s\n", Width, Height, FLAGS_output.c_str() );
+    Stat.Report( "concat" );
+    return 0;
+}
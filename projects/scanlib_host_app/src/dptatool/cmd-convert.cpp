@@ -0,0 +1,246 @@
+//! Converts dpta files into PNG, npy, point clouds and preview thumbnails
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include <algorithm>
+#include <fstream>
+#include <scanlib/core/point_cloud.hpp>
+#include <scanlib/core/scan_histogram.hpp>
+#include <scanlib/render/preview_renderer.hpp>
+#include <scanlib/utility/png_writer.hpp>
+#include <scanlib/utility/thread_pool.hpp>
+#include <sstream>
+#include "dpta-tool.hpp"
+
+using namespace std;
+
+enum EOutputBit
+{
+    OUTPUT_PNG = 1,
+    OUTPUT_NPY = 2,
+    OUTPUT_PLY = 4,
+    OUTPUT_XYZ = 8,
+    OUTPUT_PREVIEW = 16,
+};
+
+static int ParseFormats( string const& Formats )
+{
+    int           Bits = 0;
+    istringstream ss( Formats );
+    for ( string Token; getline( ss, Token, ',' ); )
+    {
+        if ( Token == "png" )
+            Bits |= OUTPUT_PNG;
+        else if ( Token == "npy" )
+            Bits |= OUTPUT_NPY;
+        else if ( Token == "ply" )
+            Bits |= OUTPUT_PLY;
+        else if ( Token == "xyz" )
+            Bits |= OUTPUT_XYZ;
+        else if ( Token == "preview" )
+            Bits |= OUTPUT_PREVIEW;
+        else
+        {
+            fprintf( stderr, "unknown format '%s'\n", Token.c_str() );
+            return 0;
+        }
+    }
+    return Bits;
+}
+
+//! dpta files don't carry scan geometry, thus it is restored from the FOV
+//! flags. Frame is centered at zero angle; with two steps per pixel the offset
+//! of -(W - 1) steps lands exactly on the center for any width.
+static FDeviceStat MakeGeometry( ScanDataHeaderType const& H )
+{
+    FDeviceStat S = {};
+    S.SizeX       = H.WIDTH;
+    S.SizeY       = H.HEIGHT;
+    S.StepPerPxlX = 2;
+    S.StepPerPxlY = 2;
+    S.OfstX       = (uint32_t)-int32_t( H.WIDTH - 1 );
+    S.OfstY       = (uint32_t)-int32_t( H.HEIGHT - 1 );
+
+    double FovX = FLAGS_fov_x;
+    double FovY = FLAGS_fov_y;
+    if ( FovY <= 0 )
+        FovY = H.ASPECT_RATIO > 0 ? FovX / H.ASPECT_RATIO : FovX * H.HEIGHT / max<uint32_t>( 1, H.WIDTH );
+
+    S.DegreePerStepX = H.WIDTH > 1 ? float( FovX / ( 2.0 * ( H.WIDTH - 1 ) ) ) : 0.f;
+    S.DegreePerStepY = H.HEIGHT > 1 ? float( FovY / ( 2.0 * ( H.HEIGHT - 1 ) ) ) : 0.f;
+    return S;
+}
+
+static bool WritePng( FDptaFrame const& F )
+{
+    // Output buffers are kept per worker; no allocation after warm up.
+    thread_local vector<uint16_t> Plane;
+    thread_local vector<uint8_t>  Encoded;
+
+    auto const N     = (size_t)F.Width() * F.Height();
+    auto const Scale = FLAGS_depth_scale / Q9_22_ONE_INT;
+    Plane.resize( N );
+
+    for ( size_t i = 0; i < N; i++ )
+    {
+        auto const v = F.Pixels[i].Distance * Scale;
+        Plane[i]     = uint16_t( v <= 0 ? 0 : v >= 65535.0 ? 65535 : v + 0.5 );
+    }
+    scanlib::PngEncode( Encoded, Plane.data(), F.Width(), F.Height(), scanlib::EPngFormat::GRAY16 );
+    if ( !scanlib::PngWriteFile( MakeOutputPath( F.Path, ".depth.png" ).c_str(), Encoded ) )
+        return false;
+
+    // Amplitude is stored as raw UQ12.4 value
+    for ( size_t i = 0; i < N; i++ )
+        Plane[i] = F.Pixels[i].AMP;
+    scanlib::PngEncode( Encoded, Plane.data(), F.Width(), F.Height(), scanlib::EPngFormat::GRAY16 );
+    return scanlib::PngWriteFile( MakeOutputPath( F.Path, ".amp.png" ).c_str(), Encoded );
+}
+
+//! Colorized thumbnail. Color range spans 2nd to 98th percentile of the
+//! frame, so that a few outliers don't wash out the rest.
+static bool WritePreview( FDptaFrame const& F, EColorMappingMode Mode )
+{
+    thread_local FScanHistogram   Hist;
+    thread_local FPreviewRenderer Renderer;
+    thread_local vector<uint32_t> Pixels;
+    thread_local vector<uint8_t>  Encoded;
+
+    Hist.Build( F.Pixels, (size_t)F.Width() * F.Height() );
+
+    FColorizeParam Param;
+    Param.Mode = Mode;
+    if ( FLAGS_preview_amp )
+    {
+        Param.Source       = EColorSource::AMPLITUDE;
+        Param.MinAmplitude = Hist.AmplitudePercentile( 0.02 );
+        Param.MaxAmplitude = max( Hist.AmplitudePercentile( 0.98 ), Param.MinAmplitude + 1.f );
+    }
+    else
+    {
+        Param.MinDistance = Hist.DistancePercentile( 0.02 );
+        Param.MaxDistance = max( Hist.DistancePercentile( 0.98 ), Param.MinDistance + Hist.DistanceBinWidth() );
+    }
+
+    int W, H;
+    FPreviewRenderer::FitSize( F.Width(), F.Height(), F.Header.ASPECT_RATIO, FLAGS_preview_size, W, H );
+    Pixels.resize( (size_t)W * H );
+    if ( !Renderer.Render( FColorizer( Param ), F.Pixels, F.Width(), F.Height(), Pixels.data(), W, H ) )
+        return false;
+
+    scanlib::PngEncode( Encoded, Pixels.data(), W, H, scanlib::EPngFormat::RGBA8 );
+    return scanlib::PngWriteFile( MakeOutputPath( F.Path, ".preview.png" ).c_str(), Encoded );
+}
+
+//! Writes float32 array of shape (H, W, 2); [..., 0] is distance in meters,
+//! [..., 1] is amplitude.
+static bool WriteNpy( FDptaFrame const& F )
+{
+    thread_local vector<float> Data;
+
+    auto const N = (size_t)F.Width() * F.Height();
+    Data.resize( N * 2 );
+    for ( size_t i = 0; i < N; i++ )
+    {
+        Data[i * 2 + 0] = F.Pixels[i].Distance * ( 1.0f / Q9_22_ONE_INT );
+        Data[i * 2 + 1] = F.Pixels[i].AMP * ( 1.0f / UQ12_4_ONE_INT );
+    }
+
+    char Dict[128];
+    int  DictLen = snprintf(
+      Dict, sizeof Dict, "{'descr': '<f4', 'fortran_order': False, 'shape': (%d, %d, 2), }", F.Height(), F.Width() );
+
+    // Header length is padded so that data begins at 64 byte boundary.
+    string Header = "\x93NUMPY\x01";
+    Header.push_back( 0 );
+    auto const Total = ( 10 + DictLen + 1 + 63 ) / 64 * 64;
+    auto const HLen  = uint16_t( Total - 10 );
+    Header.push_back( char( HLen & 0xff ) );
+    Header.push_back( char( HLen >> 8 ) );
+    Header.append( Dict, DictLen );
+    Header.append( Total - Header.size() - 1, ' ' );
+    Header.push_back( '\n' );
+
+    FILE* fp = fopen( MakeOutputPath( F.Path, ".npy" ).c_str(), "wb" );
+    if ( fp == nullptr )
+        return false;
+
+    bool bOk = fwrite( Header.data(), 1, Header.size(), fp ) == Header.size();
+    bOk      = bOk && fwrite( Data.data(), sizeof( float ), Data.size(), fp ) == Data.size();
+    return fclose( fp ) == 0 && bOk;
+}
+
+static bool WritePointCloud( FDptaFrame const& F, int Outputs )
+{
+    // Builder caches trig tables, which are shared by frames of same size.
+    thread_local FPointCloudBuilder Builder;
+    thread_local FPointCloud        Cloud;
+
+    FScanImageDesc Image( F.Pixels );
+    Image.Width       = F.Width();
+    Image.Height      = F.Height();
+    Image.AspectRatio = F.Header.ASPECT_RATIO;
+
+    // Files are already spread over the pool.
+    FPointCloudParam Param;
+    Param.NumThreads = 1;
+    if ( !Builder.Build( Image, MakeGeometry( F.Header ), Cloud, Param ) )
+        return false;
+
+    bool bOk = true;
+    if ( Outputs & OUTPUT_PLY )
+    {
+        ofstream fs( MakeOutputPath( F.Path, ".ply" ), ios::binary );
+        bOk = bOk && scanlib::PointCloudWriteTo( fs, Cloud, scanlib::EPointCloudFormat::PLY_BINARY );
+    }
+    if ( Outputs & OUTPUT_XYZ )
+    {
+        ofstream fs( MakeOutputPath( F.Path, ".xyz" ) );
+        bOk = bOk && scanlib::PointCloudWriteTo( fs, Cloud, scanlib::EPointCloudFormat::XYZ );
+    }
+    return bOk;
+}
+
+int RunConvert( std::vector<std::string> const& Inputs )
+{
+    auto const Outputs = ParseFormats( FLAGS_format );
+    if ( Outputs == 0 )
+        return 1;
+
+    EColorMappingMode PreviewMode;
+    if ( !ParseColorMode( FLAGS_preview_mode, PreviewMode ) )
+    {
+        fprintf( stderr, "unknown preview mode '%s'\n", FLAGS_preview_mode.c_str() );
+        return 1;
+    }
+
+    FThreadPool Pool( max( 0, FLAGS_threads ) );
+    FThroughput Stat;
+    atomic_int  NumFailed = 0;
+
+    for ( auto& Input : Inputs )
+    {
+        Pool.Enqueue( [&]() {
+            FDptaFrame F;
+            bool       bOk = F.Load( Input );
+            bOk            = bOk && ( !( Outputs & OUTPUT_PNG ) || WritePng( F ) );
+            bOk            = bOk && ( !( Outputs & OUTPUT_NPY ) || WriteNpy( F ) );
+            bOk            = bOk && ( !( Outputs & OUTPUT_PREVIEW ) || WritePreview( F, PreviewMode ) );
+            bOk            = bOk && ( !( Outputs & ( OUTPUT_PLY | OUTPUT_XYZ ) ) || WritePointCloud( F, Outputs ) );
+
+            if ( !bOk )
+            {
+                fprintf( stderr, "failed: %s\n", Input.c_str() );
+                NumFailed++;
+                return;
+            }
+            Stat.Add( F.File.Size() );
+        } );
+    }
+
+    Pool.WaitIdle();
+    Stat.Report( "convert" );
+    return NumFailed ? 2 : 0;
+}
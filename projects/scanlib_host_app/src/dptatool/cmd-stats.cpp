@@ -0,0 +1,117 @@
+//! Prints per-file statistics of dpta files
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Output is CSV on stdout, in input order.
+#include <algorithm>
+#include <scanlib/core/scan_histogram.hpp>
+#include <scanlib/utility/thread_pool.hpp>
+#include "dpta-tool.hpp"
+
+using namespace std;
+
+struct FFrameStats
+{
+    bool     bLoaded  = false;
+    uint32_t Width    = 0;
+    uint32_t Height   = 0;
+    size_t   NumValid = 0;
+    double   MinDist  = 0;
+    double   MaxDist  = 0;
+    double   MeanDist = 0;
+    double   MeanAmp  = 0;
+    double   P02Dist  = 0;
+    double   P50Dist  = 0;
+    double   P98Dist  = 0;
+};
+
+static void Measure( FDptaFrame const& F, FFrameStats& S )
+{
+    auto const N      = (size_t)F.Width() * F.Height();
+    q9_22_t    MinD   = INT32_MAX;
+    q9_22_t    MaxD   = 0;
+    int64_t    SumD   = 0;
+    uint64_t   SumA   = 0;
+    size_t     NValid = 0;
+
+    for ( size_t i = 0; i < N; i++ )
+    {
+        auto const V = F.Pixels[i];
+        SumA += V.AMP;
+        if ( V.Distance <= 0 )
+            continue;
+
+        MinD = min( MinD, V.Distance );
+        MaxD = max( MaxD, V.Distance );
+        SumD += V.Distance;
+        NValid++;
+    }
+
+    S.Width    = F.Header.WIDTH;
+    S.Height   = F.Header.HEIGHT;
+    S.NumValid = NValid;
+    S.MinDist  = NValid ? (double)MinD / Q9_22_ONE_INT : 0;
+    S.MaxDist  = NValid ? (double)MaxD / Q9_22_ONE_INT : 0;
+    S.MeanDist = NValid ? (double)SumD / NValid / Q9_22_ONE_INT : 0;
+    S.MeanAmp  = N ? (double)SumA / N / UQ12_4_ONE_INT : 0;
+
+    // Bins are reused by every file the worker handles.
+    thread_local FScanHistogram Hist;
+    Hist.Build( F.Pixels, N );
+    S.P02Dist = Hist.DistancePercentile( 0.02 );
+    S.P50Dist = Hist.DistancePercentile( 0.50 );
+    S.P98Dist = Hist.DistancePercentile( 0.98 );
+}
+
+int RunStats( std::vector<std::string> const& Inputs )
+{
+    vector<FFrameStats> Results( Inputs.size() );
+    FThreadPool         Pool( max( 0, FLAGS_threads ) );
+    FThroughput         Stat;
+
+    for ( size_t i = 0; i < Inputs.size(); i++ )
+    {
+        Pool.Enqueue( [&, i]() {
+            FDptaFrame F;
+            if ( !F.Load( Inputs[i] ) )
+                return;
+
+            Measure( F, Results[i] );
+            Results[i].bLoaded = true;
+            Stat.Add( F.File.Size() );
+        } );
+    }
+    Pool.WaitIdle();
+
+    int NumFailed = 0;
+    printf( "path,width,height,valid,min_m,max_m,mean_m,mean_amp,p02_m,p50_m,p98_m\n" );
+    for ( size_t i = 0; i < Inputs.size(); i++ )
+    {
+        auto& S = Results[i];
+        if ( !S.bLoaded )
+        {
+            fprintf( stderr, "failed: %s\n", Inputs[i].c_str() );
+            NumFailed++;
+            continue;
+        }
+
+        printf(
+          "\"%s\",%u,%u,%zu,%.4f,%.4f,%.4f,%.2f,%.4f,%.4f,%.4f\n",
+          Inputs[i].c_str(),
+          S.Width,
+          S.Height,
+          S.NumValid,
+          S.MinDist,
+          S.MaxDist,
+          S.MeanDist,
+          S.MeanAmp,
+          S.P02Dist,
+          S.P50Dist,
+          S.P98Dist );
+    }
+
+    Stat.Report( "stats" );
+    return NumFailed ? 2 : 0;
+}
@@ -0,0 +1,174 @@
+//! Entry point of headless dpta batch tool
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Usage: dpta-tool <convert|stats|concat|bench> [flags] <file|directory>...
+//!
+//! Directories are searched for .dpta files. Files are processed in parallel
+//! on a work-stealing pool; every input is mapped into memory rather than
+//! read.
+#include "dpta-tool.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+//
+// Flag definitions
+//
+DEFINE_string( out_dir, "", "Output directory. Outputs are placed next to inputs if empty" );
+DEFINE_string( format, "png", "Comma separated convert outputs: png, npy, ply, xyz, preview" );
+DEFINE_string( output, "", "Output file of concat" );
+DEFINE_int32( threads, 0, "Number of worker threads. 0 to use hardware concurrency" );
+DEFINE_bool( recursive, false, "Search input directories recursively" );
+DEFINE_double( depth_scale, 1000.0, "Depth PNG units per meter; 1000 stores millimeters" );
+DEFINE_double( fov_x, 60.0, "Horizontal FOV of frames in degree, for point cloud output" );
+DEFINE_double( fov_y, 0.0, "Vertical FOV of frames in degree. 0 to derive from aspect ratio" );
+DEFINE_int32( preview_size, 256, "Longer edge of preview thumbnails in pixels" );
+DEFINE_string( preview_mode, "rainbow", "Color mapping of previews: bgr, greyscale, wtok, rainbow" );
+DEFINE_bool( preview_amp, false, "Colorize previews by amplitude instead of distance" );
+
+bool FDptaFrame::Load( std::string const& FilePath )
+{
+    Path = FilePath;
+    if ( !File.Open( FilePath.c_str() ) )
+        return false;
+
+    ScanDataPixelType const* Data;
+    if ( !ScanDataParse( File.Data(), File.Size(), &Data, &Header ) )
+        return false;
+
+    Pixels = reinterpret_cast<FPxlData const*>( Data );
+    return true;
+}
+
+void FThroughput::Report( char const* What ) const
+{
+    using namespace chrono;
+    auto const Sec   = duration<double>( steady_clock::now() - mBegin ).count();
+    auto const Files = (double)mNumFiles;
+    auto const MB    = mNumBytes / ( 1024.0 * 1024.0 );
+
+    fprintf(
+      stderr,
+      "%s: %zu files, %.1f MB in %.3f s (%.1f files/s, %.1f MB/s)\n",
+      What,
+      (size_t)mNumFiles,
+      MB,
+      Sec,
+      Sec > 0 ? Files / Sec : 0.0,
+      Sec > 0 ? MB / Sec : 0.0 );
+}
+
+std::string MakeOutputPath( std::string const& Input, char const* Suffix )
+{
+    fs::path Path = Input;
+    if ( !FLAGS_out_dir.empty() )
+        Path = fs::path( FLAGS_out_dir ) / Path.filename();
+
+    Path.replace_extension();
+    return Path.string() + Suffix;
+}
+
+char const* ColorModeName( EColorMappingMode Mode )
+{
+    switch ( Mode )
+    {
+    case EColorMappingMode::BGR: return "bgr";
+    case EColorMappingMode::GREYSCALE: return "greyscale";
+    case EColorMappingMode::WTOK: return "wtok";
+    case EColorMappingMode::RAINBOW: return "rainbow";
+    default: return "none";
+    }
+}
+
+bool ParseColorMode( std::string const& Name, EColorMappingMode& Out )
+{
+    for ( auto Mode : { EColorMappingMode::BGR, EColorMappingMode::GREYSCALE, EColorMappingMode::WTOK, EColorMappingMode::RAINBOW } )
+    {
+        if ( Name == ColorModeName( Mode ) )
+        {
+            Out = Mode;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void CollectInputs( int argc, char** argv, vector<string>& Out )
+{
+    auto const IsDpta = []( fs::path const& p ) {
+        return p.extension() == "." SCAN_DATA_FORMAT_EXTENSION;
+    };
+
+    for ( int i = 0; i < argc; i++ )
+    {
+        error_code ec;
+        fs::path   Path = argv[i];
+        if ( !fs::is_directory( Path, ec ) )
+        {
+            Out.emplace_back( Path.string() );
+            continue;
+        }
+
+        if ( FLAGS_recursive )
+        {
+            for ( auto& e : fs::recursive_directory_iterator( Path, ec ) )
+                if ( e.is_regular_file() && IsDpta( e.path() ) )
+                    Out.emplace_back( e.path().string() );
+        }
+        else
+        {
+            for ( auto& e : fs::directory_iterator( Path, ec ) )
+                if ( e.is_regular_file() && IsDpta( e.path() ) )
+                    Out.emplace_back( e.path().string() );
+        }
+    }
+
+    // Keep output order deterministic regardless of directory listing
+    sort( Out.begin(), Out.end() );
+}
+
+int main( int argc, char** argv )
+{
+    gflags::SetUsageMessage( "<convert|stats|concat|bench> [flags] <file|directory>..." );
+    gflags::ParseCommandLineFlags( &argc, &argv, true );
+
+    if ( argc < 3 )
+    {
+        gflags::ShowUsageWithFlagsRestrict( argv[0], "dpta-tool" );
+        return 1;
+    }
+
+    vector<string> Inputs;
+    CollectInputs( argc - 2, argv + 2, Inputs );
+    if ( Inputs.empty() )
+    {
+        fprintf( stderr, "no input files\n" );
+        return 1;
+    }
+
+    if ( !FLAGS_out_dir.empty() )
+    {
+        error_code ec;
+        fs::create_directories( FLAGS_out_dir, ec );
+    }
+
+    auto const Cmd = argv[1];
+    if ( strcmp( Cmd, "convert" ) == 0 )
+        return RunConvert( Inputs );
+    if ( strcmp( Cmd, "stats" ) == 0 )
+        return RunStats( Inputs );
+    if ( strcmp( Cmd, "concat" ) == 0 )
+        return RunConcat( Inputs );
+    if ( strcmp( Cmd, "bench" ) == 0 )
+        return RunBench( Inputs );
+
+    fprintf( stderr, "unknown command '%s'\n", Cmd );
+    return 1;
+}
@@ -0,0 +1,74 @@
+//! Shared definitions of dpta batch tool
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <gflags/gflags.h>
+#include <scanlib/render/colorizer.hpp>
+#include <scanlib/core/scanner_utils.h>
+#include <scanlib/utility/mapped_file.hpp>
+#include <string>
+#include <vector>
+
+DECLARE_string( out_dir );
+DECLARE_string( format );
+DECLARE_string( output );
+DECLARE_int32( threads );
+DECLARE_double( depth_scale );
+DECLARE_double( fov_x );
+DECLARE_double( fov_y );
+DECLARE_int32( preview_size );
+DECLARE_string( preview_mode );
+DECLARE_bool( preview_amp );
+
+//! Mapped dpta file. Pixels point into the mapping directly.
+struct FDptaFrame
+{
+    std::string        Path;
+    FMappedFile        File;
+    ScanDataHeaderType Header = {};
+    FPxlData const*    Pixels = {};
+
+    int Width() const noexcept { return (int)Header.WIDTH; }
+    int Height() const noexcept { return (int)Header.HEIGHT; }
+
+    //! @returns    false if file can't be mapped or isn't a valid dpta.
+    bool Load( std::string const& FilePath );
+};
+
+//! Accumulates processed amount and prints throughput.
+class FThroughput
+{
+public:
+    FThroughput() : mBegin( std::chrono::steady_clock::now() ) { }
+
+    void Add( size_t Bytes ) noexcept
+    {
+        mNumFiles++;
+        mNumBytes += Bytes;
+    }
+
+    void Report( char const* What ) const;
+
+private:
+    std::chrono::steady_clock::time_point mBegin;
+    std::atomic_size_t                    mNumFiles = 0;
+    std::atomic_size_t                    mNumBytes = 0;
+};
+
+//! Output path of given input with replaced extension, placed under out_dir if
+//! specified.
+std::string MakeOutputPath( std::string const& Input, char const* Suffix );
+
+//! Color mapping mode names as used by flags and reports.
+char const* ColorModeName( EColorMappingMode Mode );
+bool        ParseColorMode( std::string const& Name, EColorMappingMode& Out );
+
+int RunConvert( std::vector<std::string> const& Inputs );
+int RunStats( std::vector<std::string> const& Inputs );
+int RunConcat( std::vector<std::string> const& Inputs );
+int RunBench( std::vector<std::string> const& Inputs );
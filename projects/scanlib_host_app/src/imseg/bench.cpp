@@ -0,0 +1,264 @@
+//! @file       bench.cpp
+//! @brief      Superpixel backend benchmark
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//!             Images are scaled to --desired_pixel_cnt as camera frames are.
+//!             Ground truth boundary of "name.ext" is read from
+//!             "name_gt.png"(nonzero on boundary), as BSDS boundary maps are
+//!             exported; recall is left empty if it doesn't exist.
+//!
+//!             Completion benchmark reads reference depth of "name-rgb.png"
+//!             from "name-depth.png", gray levels over DEPTH_PER_LEVEL meters
+//!             as imseg displays them. Reference is sampled at superpixel
+//!             centroids, filled per label, then completed by each method.
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <scanlib/segment/slic.hpp>
+#include <scanlib/segment/superpixel_stats.hpp>
+#include <sstream>
+#include <string.h>
+#include "imseg.hpp"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+DEFINE_string( bench, "", "Comma separated images to benchmark superpixel backends on, instead of running capture" );
+DEFINE_int32( bench_iterations, 5, "Number of segmentations per benchmark case" );
+DEFINE_string( bench_superpixel_cnts, "", "Comma separated superpixel counts to sweep. Empty to use desired_superpixel_cnt" );
+DEFINE_string( bench_pixel_cnts, "", "Comma separated pixel counts to sweep. Empty to use desired_pixel_cnt" );
+DEFINE_string( bench_completion, "", "Comma separated RGB images to benchmark depth completion on, instead of running capture" );
+
+#define DEPTH_PER_LEVEL ( 5.0f / 255 )
+
+static vector<string> Split( string const& List )
+{
+    vector<string> Out;
+    istringstream  ss( List );
+    for ( string Token; getline( ss, Token, ',' ); )
+    {
+        if ( !Token.empty() )
+        {
+            Out.emplace_back( std::move( Token ) );
+        }
+    }
+    return Out;
+}
+
+static vector<int> SplitInts( string const& List, int Default )
+{
+    vector<int> Out;
+    for ( auto& Token : Split( List ) )
+    {
+        Out.push_back( int( stod( Token ) ) );
+    }
+    if ( Out.empty() )
+    {
+        Out.push_back( Default );
+    }
+    return Out;
+}
+
+int RunSuperpixelBenchmark()
+{
+    auto const Images      = Split( FLAGS_bench );
+    auto const PixelCnts   = SplitInts( FLAGS_bench_pixel_cnts, FLAGS_desired_pixel_cnt );
+    auto const SpixelCnts  = SplitInts( FLAGS_bench_superpixel_cnts, FLAGS_desired_superpixel_cnt );
+    auto const Iterations  = max( 1, FLAGS_bench_iterations );
+    char const* Backends[] = { "cpu", "cpu-slic-zero", "cuda" };
+
+    FSuperpixelStats Stats;
+    printf( "image,backend,pixels,desired_superpixels,superpixels,ms_per_frame,boundary_recall\n" );
+    for ( auto& Path : Images )
+    {
+        auto const Source = cv::imread( Path, cv::IMREAD_COLOR );
+        if ( Source.empty() )
+        {
+            fprintf( stderr, "failed: %s\n", Path.c_str() );
+            continue;
+        }
+
+        fs::path GtPath = Path;
+        GtPath.replace_filename( GtPath.stem().string() + "_gt.png" );
+        auto const GtSource = cv::imread( GtPath.string(), cv::IMREAD_GRAYSCALE );
+
+        for ( auto Pixels : PixelCnts )
+        {
+            // Area filter keeps thin boundary lines alive on downscale.
+            auto const Scale = sqrt( double( Pixels ) / Source.total() );
+            auto const Size  = cv::Size( max( 1, int( Source.cols * Scale ) ), max( 1, int( Source.rows * Scale ) ) );
+            cv::Mat    Frame, Gt;
+            cv::resize( Source, Frame, Size, 0, 0, cv::INTER_AREA );
+            if ( !GtSource.empty() )
+            {
+                cv::resize( GtSource, Gt, Size, 0, 0, cv::INTER_AREA );
+            }
+
+            for ( auto Spixels : SpixelCnts )
+            {
+                for ( auto BackendName : Backends )
+                {
+                    auto Param           = MakeSuperpixelParam();
+                    Param.NumSuperpixels = Spixels;
+                    Param.bSlicZero      = strcmp( BackendName, "cpu-slic-zero" ) == 0;
+
+                    auto Backend = ISuperpixelBackend::Create( Param.bSlicZero ? "cpu" : BackendName, Param );
+                    if ( Backend == nullptr )
+                    {
+                        continue;
+                    }
+
+                    // First run allocates buffers and uploads tables.
+                    cv::Mat Labels;
+                    bool    bOk   = Backend->Segment( Frame, Labels );
+                    auto    Begin = chrono::steady_clock::now();
+                    for ( int i = 0; i < Iterations && bOk; i++ )
+                    {
+                        bOk = Backend->Segment( Frame, Labels );
+                    }
+                    auto const Ms       = chrono::duration<double, milli>( chrono::steady_clock::now() - Begin ).count() / Iterations;
+                    auto const NumSpxls = bOk ? Stats.Compute( Labels.ptr<int32_t>(), Labels.step1(), Labels.cols, Labels.rows ) : 0;
+
+                    string Recall;
+                    if ( !Gt.empty() && NumSpxls )
+                    {
+                        Recall = to_string( SuperpixelBoundaryRecall( Labels.ptr<int32_t>(), Gt.ptr<uint8_t>(), Frame.cols, Frame.rows ) );
+                    }
+
+                    printf(
+                      "\"%s\",%s,%d,%d,%d,%.2f,%s\n",
+                      Path.c_str(),
+                      BackendName,
+                      int( Frame.total() ),
+                      Spixels,
+                      NumSpxls,
+                      Ms,
+                      Recall.c_str() );
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+int RunCompletionBenchmark()
+{
+    auto const Images     = Split( FLAGS_bench_completion );
+    auto const PixelCnts  = SplitInts( FLAGS_bench_pixel_cnts, FLAGS_desired_pixel_cnt );
+    auto const Iterations = max( 1, FLAGS_bench_iterations );
+    char const* Methods[] = { "fill", "bilateral", "guided" };
+
+    auto Backend = ISuperpixelBackend::Create( "cpu", MakeSuperpixelParam() );
+    if ( Backend == nullptr )
+    {
+        return -1;
+    }
+
+    FSuperpixelStats Stats;
+    printf( "image,method,pixels,superpixels,ms_per_frame,mae,rmse\n" );
+    for ( auto& Path : Images )
+    {
+        fs::path RefPath = Path;
+        auto     Stem    = RefPath.stem().string();
+        if ( auto Pos = Stem.rfind( "rgb" ); Pos != string::npos )
+        {
+            Stem.replace( Pos, 3, "depth" );
+        }
+        RefPath.replace_filename( Stem + RefPath.extension().string() );
+
+        auto const Source    = cv::imread( Path, cv::IMREAD_COLOR );
+        auto const RefSource = cv::imread( RefPath.string(), cv::IMREAD_GRAYSCALE );
+        if ( Source.empty() || RefSource.empty() || Source.size() != RefSource.size() )
+        {
+            fprintf( stderr, "failed: %s\n", Path.c_str() );
+            continue;
+        }
+
+        for ( auto Pixels : PixelCnts )
+        {
+            auto const Scale = sqrt( double( Pixels ) / Source.total() );
+            auto const Size  = cv::Size( max( 1, int( Source.cols * Scale ) ), max( 1, int( Source.rows * Scale ) ) );
+            cv::Mat    Frame, Ref, Labels;
+            cv::resize( Source, Frame, Size, 0, 0, cv::INTER_LINEAR );
+            cv::resize( RefSource, Ref, Size, 0, 0, cv::INTER_NEAREST );
+            Ref.convertTo( Ref, CV_32F, DEPTH_PER_LEVEL );
+
+            if ( Backend->Segment( Frame, Labels ) == false )
+            {
+                fprintf( stderr, "failed to segment: %s\n", Path.c_str() );
+                continue;
+            }
+            auto const NumSpxls = Stats.Compute( Labels.ptr<int32_t>(), Labels.step1(), Labels.cols, Labels.rows );
+
+            // One sample per superpixel, as taken by the scanner
+            vector<float> Samples( NumSpxls );
+            for ( int i = 0; i < NumSpxls; i++ )
+            {
+                auto const x = min( Frame.cols - 1, max( 0, int( Stats[i].CenterX ) ) );
+                auto const y = min( Frame.rows - 1, max( 0, int( Stats[i].CenterY ) ) );
+                Samples[i]   = Ref.at<float>( y, x );
+            }
+
+            cv::Mat Fill( Frame.size(), CV_32F );
+            for ( int y = 0; y < Fill.rows; y++ )
+            {
+                auto const LabelRow = Labels.ptr<int32_t>( y );
+                auto const FillRow  = Fill.ptr<float>( y );
+                for ( int x = 0; x < Fill.cols; x++ )
+                {
+                    FillRow[x] = Samples[LabelRow[x]];
+                }
+            }
+
+            for ( auto Method : Methods )
+            {
+                bool const bFill = strcmp( Method, "fill" ) == 0;
+                cv::Mat    Out   = bFill ? Fill : CompleteDepth( Method, Frame, Fill, {} );
+                auto       Begin = chrono::steady_clock::now();
+                for ( int i = 0; i < Iterations && !bFill; i++ )
+                {
+                    Out = CompleteDepth( Method, Frame, Fill, {} );
+                }
+                auto const Ms = bFill ? 0.0 : chrono::duration<double, milli>( chrono::steady_clock::now() - Begin ).count() / Iterations;
+
+                // Error over pixels the reference has depth on
+                double AbsSum = 0, SqSum = 0;
+                size_t Count  = 0;
+                for ( int y = 0; y < Ref.rows; y++ )
+                {
+                    auto const RefRow = Ref.ptr<float>( y );
+                    auto const OutRow = Out.ptr<float>( y );
+                    for ( int x = 0; x < Ref.cols; x++ )
+                    {
+                        if ( RefRow[x] > 0 )
+                        {
+                            auto const e = double( OutRow[x] ) - RefRow[x];
+                            AbsSum += fabs( e );
+                            SqSum += e * e;
+                            Count++;
+                        }
+                    }
+                }
+                Count = max<size_t>( 1, Count );
+
+                printf(
+                  "\"%s\",%s,%d,%d,%.2f,%.4f,%.4f\n",
+                  Path.c_str(),
+                  Method,
+                  int( Frame.total() ),
+                  NumSpxls,
+                  Ms,
+                  AbsSum / Count,
+                  sqrt( SqSum / Count ) );
+            }
+        }
+    }
+
+    return 0;
+}
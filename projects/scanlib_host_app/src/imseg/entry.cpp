@@ -11,6 +11,7 @@
 //! @todo
 #include <chrono>
 #include <cstdarg>
+#include <filesystem>
 #include <future>
 #include <gflags/gflags.h>
 #include <iostream>
@@ -22,14 +23,29 @@
 #include <opencv2/ximgproc/slic.hpp>
 #include <optional>
 #include <scanlib/arch/utility.hpp>
+#include <scanlib/core/sample_path.hpp>
 #include <scanlib/core/scanner_protocol_handler.hpp>
 #include <scanlib/core/scanner_utils.h>
+#include <scanlib/segment/angular_projection.hpp>
+#include <scanlib/segment/depth_propagation.hpp>
+#include <scanlib/segment/guided_filter.hpp>
+#include <scanlib/segment/label_convert.hpp>
+#include <scanlib/segment/sample_allocator.hpp>
+#include <scanlib/segment/sample_cache.hpp>
+#include <scanlib/segment/spectral_cluster.hpp>
+#include <scanlib/segment/superpixel_graph.hpp>
+#include <scanlib/segment/superpixel_stats.hpp>
+#include <scanlib/utility/pipeline.hpp>
+#include <scanlib/utility/thread_pool.hpp>
+#include <scanlib/utility/trace.hpp>
+#include "grabber.hpp"
+#include "imseg.hpp"
+#include "replay.hpp"
+#include "sampler.hpp"
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 
-#include <SlicCudaHost.h>
-
 using namespace std;
 using namespace std::chrono;
 using namespace std::chrono_literals;
@@ -40,45 +56,146 @@ DEFINE_int32( cam_index, 1, "Specify camera index to use" );
 DEFINE_int32( desired_pixel_cnt, int( 2e6 ), "Number of intended pixels" );
 DEFINE_double( slic_compactness, 65.f, "Pixel compactness" );
 DEFINE_int32( desired_superpixel_cnt, int( 3e3 ), "Number of desired super pixels" );
+DEFINE_string( superpixel_backend, "", "Superpixel backend: cpu, cuda. Empty to use cuda if built with it" );
+DEFINE_int32( slic_iterations, 10, "Number of SLIC iterations of cpu backend" );
+DEFINE_bool( slic_zero, false, "Use SLIC-zero on cpu backend; adapts compactness per superpixel" );
 DEFINE_double( vertical_fov, 49.0, "Camera vertical FOV in degree" );
 DEFINE_double( horizontal_fov, 78.0, "Camera horizontal FOV in degree" );
 DEFINE_int32( ocl_dev_idx, 0, "Specify open-cl device index" );
 DEFINE_double( sensor_offset_x, 15e-3, "Distance sensor x axis offset in meters" );
 DEFINE_double( sensor_offset_y, 15e-3, "Distance sensor y axis offset in meters" );
+DEFINE_double( sensor_reference_distance, 0.0, "Distance in meters sensor offset parallax is corrected at. 0 to ignore" );
+DEFINE_double( sensor_angle_offset_x, 0.0, "Calibrated sensor mount angle offset of x axis in degrees" );
+DEFINE_double( sensor_angle_offset_y, 0.0, "Calibrated sensor mount angle offset of y axis in degrees" );
 
 DEFINE_double(
-  path_x_tolerance,
-  0.04f,
-  "X axis movement tolerance of Depscan" );
+  path_plan_budget_ms,
+  50.0,
+  "Time allowed to improve sampling path, in milliseconds" );
+DEFINE_int32( device_drive_clock, 52400, "Stepper motor drive clock in Hz" );
 DEFINE_int32( device_x_accel, 32400, "Stepper motor acceleration in Hz/s" );
 DEFINE_int32( device_y_accel, 544800, "Stepper motor acceleration in Hz/s" );
 DEFINE_int32(
   device_sample_delay,
   6000,
   "Distance sensor delay in microseconds" );
+DEFINE_double(
+  sample_time_budget,
+  0.0,
+  "Sampling time per frame in seconds. 0 to take one sample per superpixel" );
+DEFINE_int32( max_samples_per_superpixel, 4, "Upper bound of samples in a superpixel" );
+DEFINE_int32(
+  sample_max_age,
+  8,
+  "Frames a depth sample may be reused for unchanged superpixels. 0 to measure every frame" );
+DEFINE_double(
+  sample_color_tolerance,
+  12.0,
+  "Mean color distance allowed to reuse depth sample of a superpixel" );
+DEFINE_double(
+  sample_shift_tolerance,
+  0.5,
+  "Centroid shift allowed to reuse depth sample, relative to superpixel spacing" );
+DEFINE_bool( depth_propagation, true, "Propagate depth to superpixels left without sample over adjacent ones" );
+DEFINE_double( propagation_smoothness, 0.05, "Weight of depth propagation between adjacent superpixels, over a sample" );
+DEFINE_double(
+  cross_segment_weight,
+  0.2,
+  "Scale of depth propagation between superpixels of different segments" );
+DEFINE_int32( spectral_clusters, 8, "Number of segments superpixels are clustered into. 0 to disable" );
+DEFINE_double( spectral_time_budget, 20.0, "Time allowed for spectral clustering per frame in milliseconds" );
+DEFINE_double(
+  segment_boundary_weight,
+  1.0,
+  "Extra sampling weight of superpixels on a segment boundary" );
+DEFINE_string( depth_completion, "guided", "Depth completion method: guided, bilateral" );
+DEFINE_int32( guided_radius, 16, "Window radius of guided depth completion in pixels" );
+DEFINE_double( guided_epsilon, 1e-3, "Regularization of guided depth completion; lower keeps more color edges" );
+DEFINE_int32( guided_subsample, 4, "Subsampling of guided depth completion coefficients" );
+DEFINE_bool( write_dpta, true, "Write raw and filtered depth of every frame as dpta files" );
+DEFINE_string(
+  replay_frames,
+  "",
+  "Comma separated images, image directories or videos to run on instead of the camera. Runs headless" );
+DEFINE_string(
+  replay_depth,
+  "",
+  "Comma separated dpta files or directories answering depth requests on replay, frame by frame" );
+DEFINE_double( replay_degree_per_step, 0.1125, "Motor resolution assumed on replay, in degrees" );
+DEFINE_string(
+  trace_dir,
+  "",
+  "Directory to write Chrome trace JSON of frames into. Empty to disable tracing" );
+DEFINE_int32( trace_frame_interval, 1, "Write trace of every n-th frame" );
+DEFINE_int32(
+  pipeline_queue_size,
+  1,
+  "Number of frames allowed to wait between pipeline stages" );
 /////////////////////////////////////////////////////////////////////////////
 // Static types
-using depth_t = struct
+using depth_t = FDepthSample;
+
+//! A camera frame travelling through the pipeline.
+struct FFrameJob
 {
-    float Amp, Range;
+    size_t                       Index = 0;
+    system_clock::time_point     TimeBegin;
+    int64_t                      TraceBegin = 0; //!< Of tracer clock
+    cv::Mat                      Frame;
+    FFrameGrabber::FLease        FrameLease; //!< Camera slot Frame shares, if live
+    cv::Mat                      Contour; //!< CV_32S superpixel labels
+    std::vector<FSuperpixelStat> Stats;
+    FSuperpixelGraph             Graph;    //!< Adjacency of superpixels
+    std::vector<uint32_t>        Segments; //!< Segment of each superpixel; empty if not clustered
+    std::vector<uint8_t>         SegmentBoundary;
+    std::vector<FSamplePoint>    Points;       //!< Grouped by superpixel
+    std::vector<uint32_t>        PointOffsets; //!< Of each superpixel in Points
+    std::vector<float>           StepX, StepY; //!< Motor step of each point
+    std::vector<FPointReq>       Requests;     //!< Rounded steps of each point
+    std::vector<uint32_t>        CapturePath;  //!< Sampling order of points
+    double                       PredictedTime = 0;
+    std::vector<depth_t>         PointDepths;
+    std::vector<depth_t>         Depths; //!< Measured or reused from earlier frames
+    cv::Mat                      Depth;  //!< Filtered depth map
+    cv::Mat                      RgbGrid, DepthGrid;
 };
+using frame_job_t = std::unique_ptr<FFrameJob>;
 
 /////////////////////////////////////////////////////////////////////////////
 // Static method declares
-static void
-FindCenters( cv::Mat Contour, std::vector<cv::Point2f>& Out, size_t NumSpxls );
-
-static bool InitializeMeasurementDevice();
+static size_t ComputeStats( FFrameJob& Job );
+
+static bool                      OpenCamera( cv::VideoCapture& Video );
+static FMotionModel              MakeMotionModel();
+static FAngularProjection const& ConfigureProjection( int Width, int Height );
+static void                      ClusterSuperpixels( FFrameJob& Job );
+static void                      AllocateSamples( FFrameJob& Job, depth_t const* Priors );
+static void                      ProjectSamples( FFrameJob& Job );
+static void                      PlanSamplePath( FFrameJob& Job );
+static void                      PropagateDepths( FFrameJob& Job );
+static void                      ExportTrace( FFrameJob const& Job );
 static bool MeasureSampleDepths(
-  std::vector<cv::Point2f> const& Points,
-  std::vector<depth_t>*           Depths,
-  std::chrono::milliseconds       DeviceTimeout );
+  FFrameJob&                Job,
+  std::chrono::milliseconds DeviceTimeout );
 
-static std::optional<cv::Mat> CaptureDepthImage( cv::Mat* FrameData );
+// Stages of the pipeline
+static bool SegmentFrame( FFrameJob& Job );
+static bool SampleFrame( FFrameJob& Job );
+static bool CompleteFrame( FFrameJob& Job );
 
 /////////////////////////////////////////////////////////////////////////////
 // Logging utility
-static std::string stringf( char const* fmt, ... );
+FSuperpixelParam MakeSuperpixelParam()
+{
+    FSuperpixelParam Param;
+    Param.NumSuperpixels = FLAGS_desired_superpixel_cnt;
+    Param.Compactness    = float( FLAGS_slic_compactness );
+    Param.NumIterations  = FLAGS_slic_iterations;
+    Param.bSlicZero      = FLAGS_slic_zero;
+    return Param;
+}
+
+std::string stringf( char const* fmt, ... );
 #define LOG_INFO( fmt, ... ) CV_LOG_INFO( nullptr, stringf( fmt, __VA_ARGS__ ) )
 #define LOG_VERBOSE( fmt, ... ) \
     CV_LOG_VERBOSE( nullptr, stringf( fmt, __VA_ARGS__ ) )
@@ -97,12 +214,14 @@ FScannerProtocolHandler gScan;
 /////////////////////////////////////////////////////////////////////////////
 // Static Declares / Data
 
-static std::vector<cv::Point2f> Centers;
-static std::vector<depth_t>     Depths;
-static size_t                   NumSpxls;
+static FSuperpixelStats         SpxlStats; //!< Used by segment stage only
+static FSampleCache             SampleCache; //!< Looked up by segment stage, stored by sample stage
+static FLabelDepthConverter     Converter; //!< Used by complete stage only
+static cv::Mat                  LastDepth; //!< Of latest completed frame
+static mutex                    LastDepthLock;
 static float                    AspectRatio;
-static SlicCuda                 GpuSLIC;
-static bool                     bScannerValid;
+static std::unique_ptr<ISuperpixelBackend> Superpixel;
+static std::unique_ptr<IDepthSampler>      DepthSampler;
 static atomic_bool              bTerminate = false;
 
 /////////////////////////////////////////////////////////////////////////////
@@ -112,145 +231,260 @@ int main( int argc, char* argv[] )
     cv::VideoCapture Video;
     cv::Mat          FrameData;
 
-    std::future<std::optional<cv::Mat>> FrameTask;
-
     gflags::ParseCommandLineFlags( &argc, &argv, true );
-    Video.open( FLAGS_cam_index + cv::CAP_DSHOW );
-
-    cv::ocl::setUseOpenCL( true );
+    if ( !FLAGS_bench.empty() )
+    {
+        return RunSuperpixelBenchmark();
+    }
+    if ( !FLAGS_bench_completion.empty() )
+    {
+        return RunCompletionBenchmark();
+    }
 
-    // Enumerate GPU devices
+    // Frames come from the camera, or from recorded ones on replay
+    FFrameSequence Sequence;
+    bool const     bReplay = !FLAGS_replay_frames.empty();
+    if ( bReplay )
     {
-        cv::ocl::Context context;
-        if ( !context.create( cv::ocl::Device::TYPE_GPU ) )
+        if ( Sequence.Open( FLAGS_replay_frames ) == false || Sequence.Read( FrameData ) == false )
         {
-            cout << "Failed creating the context..." << endl;
-            // return;
+            LOG_ERROR( "Failed to read replay frames from '%s'", FLAGS_replay_frames.c_str() );
+            return -1;
         }
-
-        cout << context.ndevices() << " GPU devices are detected."
-             << endl; // This bit provides an overview of the OpenCL devices you
-                      // have in your computer
-        for ( int i = 0; i < context.ndevices(); i++ )
+        AspectRatio = float( FrameData.cols ) / FrameData.rows;
+        LOG_INFO( "Replaying %zu sources at %d %d", Sequence.Paths().size(), FrameData.cols, FrameData.rows );
+    }
+    else
+    {
+        if ( OpenCamera( Video ) == false )
         {
-            cv::ocl::Device device = context.device( i );
-            cout << "name:              " << device.name() << endl;
-            cout << "available:         " << device.available() << endl;
-            cout << "imageSupport:      " << device.imageSupport() << endl;
-            cout << "OpenCL_C_Version:  " << device.OpenCL_C_Version() << endl;
-            cout << endl;
+            return -1;
         }
 
-        cv::ocl::Device( context.device( 1 ) );
+        Video >> FrameData; // Dummy frame to load meta data
+        if ( FrameData.empty() )
+        {
+            LOG_ERROR( "Failed to capture first frame from Video \n" );
+            return -1;
+        }
     }
 
-    if ( Video.isOpened() == false )
+    // Create Super pixel object
     {
-        CV_LOG_ERROR( nullptr, "Failed to open camera" );
-        return -1;
+        auto Name = FLAGS_superpixel_backend.empty() ? ISuperpixelBackend::DefaultName() : FLAGS_superpixel_backend;
+        Superpixel = ISuperpixelBackend::Create( Name, MakeSuperpixelParam() );
+        if ( Superpixel == nullptr )
+        {
+            LOG_ERROR( "Unknown or unavailable superpixel backend '%s'", Name.c_str() );
+            return -1;
+        }
+        LOG_INFO( "Using %s superpixel backend", Superpixel->Name() );
     }
 
-    // Configure video resolution ... Set pixel count as the desired
-    // configuration
+    // Depth is measured by the device, or looked up in recorded depth on replay
+    if ( bReplay )
     {
-        //// Query the camera's maximum pixel count
-        Video.set( cv::CAP_PROP_FRAME_WIDTH, 1e6 );
-        Video.set( cv::CAP_PROP_FRAME_HEIGHT, 1e6 );
-        auto w = Video.get( cv::CAP_PROP_FRAME_WIDTH );
-        auto h = Video.get( cv::CAP_PROP_FRAME_HEIGHT );
-
-        //// Calculate required reduction ratio
-        auto DesiredImageScale = sqrt( FLAGS_desired_pixel_cnt / ( w * h ) );
-        w *= DesiredImageScale;
-        h *= DesiredImageScale;
-
-        Video.set( cv::CAP_PROP_FRAME_WIDTH, w );
-        Video.set( cv::CAP_PROP_FRAME_HEIGHT, h );
-        w = Video.get( cv::CAP_PROP_FRAME_WIDTH );
-        h = Video.get( cv::CAP_PROP_FRAME_HEIGHT );
-        LOG_INFO( "Video resolution is set to %.0f %.0f", w, h );
+        FReplaySamplerParam Param;
+        Param.Files         = ExpandPathList( FLAGS_replay_depth, { ".dpta" } );
+        Param.HorizontalFov = float( FLAGS_horizontal_fov );
+        Param.VerticalFov   = float( FLAGS_vertical_fov );
+        Param.DegreePerStep = float( FLAGS_replay_degree_per_step );
+        DepthSampler        = IDepthSampler::CreateReplay( Param );
+        if ( DepthSampler->Open() == false )
+        {
+            LOG_ERROR( "Failed to load replay depth from '%s'", FLAGS_replay_depth.c_str() );
+            return -1;
+        }
+    }
+    else
+    {
+        FScannerSamplerParam Param;
+        Param.XAccel        = FLAGS_device_x_accel;
+        Param.YAccel        = FLAGS_device_y_accel;
+        Param.DriveClock    = FLAGS_device_drive_clock;
+        Param.SampleDelayUs = FLAGS_device_sample_delay;
+        DepthSampler        = IDepthSampler::CreateScanner( gScan, Param );
+
+        // Open named window
+        cv::namedWindow( "depth-grid" );
+
+        // Reset device's origin point
+        while ( DepthSampler->Open() == false )
+        {
+            LOG_INFO(
+              "Device connection failed. Retrying ... (Press any key to abort)" );
+            if ( cv::waitKey( 500 ) != -1 )
+            {
+                return -1;
+            }
+        }
+        LOG_INFO( "Successfully connected to DepScan device.\n" );
+    }
+    DepthSampler->Home();
 
-        AspectRatio = w / h;
+    // Spans are recorded from here on; each frame is written out as it
+    // leaves the pipeline.
+    if ( !FLAGS_trace_dir.empty() )
+    {
+        error_code ec;
+        filesystem::create_directories( FLAGS_trace_dir, ec );
+        FTracer::NameThread( "main" );
+        FTracer::Enable( true );
     }
 
-    // Create Super pixel object
-    Video >> FrameData; // Dummy frame to load meta data
-    if ( FrameData.empty() )
+    // Frames flow through bounded queues, one thread per stage. Next frame is
+    // segmented and its path planned while the scanner samples current one;
+    // completion of the previous frame runs at the same time.
+    auto const QueueSize = size_t( max( 1, FLAGS_pipeline_queue_size ) );
+
+    // Camera is read on its own thread into a ring; each job holds the slot
+    // of its frame until it leaves the pipeline, thus the grabber outlives
+    // the queues. Frames in flight are at most one per queue entry and
+    // stage, plus the one on display.
+    FFrameGrabber Grabber;
+    if ( !bReplay && Grabber.Start( Video, 4 * QueueSize + 4 + 2 ) == false )
     {
-        LOG_ERROR( "Failed to capture first frame from Video \n" );
+        LOG_ERROR( "Failed to start capture of camera %d", FLAGS_cam_index );
         return -1;
     }
-    GpuSLIC.initialize(
-      FrameData,
-      FLAGS_desired_superpixel_cnt,
-      SlicCuda::SLIC_NSPX,
-      FLAGS_slic_compactness );
-
-    // Open named window
-    cv::namedWindow( "depth-grid" );
 
-    // Reset device's origin point
-    while ( InitializeMeasurementDevice() == false )
-    {
-        LOG_INFO(
-          "Device connection failed. Retrying ... (Press any key to abort)" );
-        if ( cv::waitKey( 500 ) != -1 )
+    TBoundedQueue<frame_job_t> SegmentQueue( QueueSize );
+    TBoundedQueue<frame_job_t> SampleQueue( QueueSize );
+    TBoundedQueue<frame_job_t> CompleteQueue( QueueSize );
+    TBoundedQueue<frame_job_t> DisplayQueue( QueueSize );
+    FPipelineStage             SegmentStage( "segment" );
+    FPipelineStage             SampleStage( "sample" );
+    FPipelineStage             CompleteStage( "complete" );
+
+    auto RunStage = []( FPipelineStage& Stage, TBoundedQueue<frame_job_t>& In, TBoundedQueue<frame_job_t>& Out, bool ( *Fn )( FFrameJob& ) ) {
+        FTracer::NameThread( Stage.Name() );
+        frame_job_t Job;
+        for ( ;; )
         {
-            return -1;
+            Stage.Enter( EStageState::Starved );
+            if ( In.Pop( Job ) == false )
+                break;
+
+            Stage.Enter( EStageState::Busy );
+            if ( Fn( *Job ) == false )
+                continue;
+
+            Stage.Enter( EStageState::Blocked );
+            if ( Out.Push( std::move( Job ) ) == false )
+                break;
         }
-    }
-    LOG_INFO( "Successfully connected to DepScan device.\n" );
-    gScan.QueuePoint( 0, 0, 0 );
+        Stage.Enter( EStageState::Starved );
+        Out.Close();
+    };
 
-    // Initialize super-pixel object
-    for ( ;; )
+    thread Stages[] = {
+        thread( [&]() { RunStage( SegmentStage, SegmentQueue, SampleQueue, SegmentFrame ); } ),
+        thread( [&]() { RunStage( SampleStage, SampleQueue, CompleteQueue, SampleFrame ); } ),
+        thread( [&]() { RunStage( CompleteStage, CompleteQueue, DisplayQueue, CompleteFrame ); } ),
+    };
+    FPipelineStage const* StageList[] = { &SegmentStage, &SampleStage, &CompleteStage };
+
+    size_t NumFrames = 0;
+    if ( bReplay )
     {
-        if ( auto key = cv::waitKey( 33 ); key == -1 )
-        {
-            Video >> FrameData;
-            imshow( "active", FrameData );
-            continue;
-        }
-        else if ( key == 27 )
+        // Headless; frames are fed as fast as the pipeline takes them, thus
+        // the slowest stage sets the pace.
+        auto const TimeBegin = system_clock::now();
+        thread     Feeder( [&]() {
+            size_t Index = 0;
+            do
+            {
+                auto Job        = make_unique<FFrameJob>();
+                Job->Index      = Index++;
+                Job->TimeBegin  = system_clock::now();
+                Job->TraceBegin = FTracer::Now();
+                Job->Frame      = FrameData;
+                if ( SegmentQueue.Push( std::move( Job ) ) == false )
+                    break;
+            } while ( Sequence.Read( FrameData ) );
+            SegmentQueue.Close();
+        } );
+
+        for ( frame_job_t Job; DisplayQueue.Pop( Job ); ++NumFrames )
         {
-            goto TERMINATE;
+            LOG_INFO(
+              "Frame %zu done in %.2fs",
+              Job->Index,
+              duration_cast<milliseconds>( system_clock::now() - Job->TimeBegin ).count() * 1e-3 );
+            ExportTrace( *Job );
         }
+        Feeder.join();
 
-        cv::imshow( "rgb", FrameData );
+        auto const Elapsed = duration_cast<microseconds>( system_clock::now() - TimeBegin ).count() * 1e-6;
+        printf( "replay: %zu frames in %.3fs, %.2f fps\n", NumFrames, Elapsed, NumFrames / max( Elapsed, 1e-6 ) );
+        for ( auto Stage : StageList )
+            printf( "  %s\n", Stage->Format().c_str() );
+    }
+    else
+    {
+        // Any key toggles continuous capture; ESC quits.
+        bool bCapturing = false;
         for ( ;; )
         {
-            if ( cv::waitKey( 33 ) == 27 )
+            if ( auto key = cv::waitKey( 1 ); key == 27 )
             {
-                Video >> FrameData;
-                imshow( "active", FrameData );
-                goto TERMINATE;
+                break;
             }
-
-            if ( FrameTask.valid() == false )
+            else if ( key != -1 )
             {
-                FrameTask = async( CaptureDepthImage, &FrameData );
-                continue;
+                bCapturing = !bCapturing;
+                LOG_INFO( "%s capturing depth images", bCapturing ? "Started" : "Stopped" );
             }
 
-            if ( auto WaitResult = FrameTask.wait_for( 0ms );
-                 WaitResult != future_status::ready )
+            // Latest frame is shown, and fed whenever segment stage can take
+            // it; its slot is then held by the job instead of being copied.
+            if ( auto Lease = Grabber.WaitLatest( 33ms ) )
             {
-                continue;
+                imshow( "active", Lease->Image );
+
+                if ( bCapturing && SegmentQueue.Size() < SegmentQueue.Capacity() )
+                {
+                    auto Job        = make_unique<FFrameJob>();
+                    Job->Index      = NumFrames++;
+                    Job->TimeBegin  = system_clock::now();
+                    Job->TraceBegin = FTracer::Now();
+                    Job->Frame      = Lease->Image;
+                    Job->FrameLease = std::move( Lease );
+                    SegmentQueue.TryPush( Job );
+                }
             }
 
-            if ( auto Depth = FrameTask.get(); Depth )
+            // HighGUI is driven from this thread only.
+            if ( frame_job_t Job; DisplayQueue.TryPop( Job ) )
             {
-                cv::imshow( "rgb-grid", FrameData );
-                cv::imshow( "depth", Depth.value() / DEBUG_MAX_DIST );
-                gScan.QueuePoint( 0, 0, 0 );
+                cv::imshow( "rgb-grid", Job->RgbGrid );
+                cv::imshow( "depth-grid", Job->DepthGrid / DEBUG_MAX_DIST );
+                cv::imshow( "depth", Job->Depth / DEBUG_MAX_DIST );
+
+                LOG_INFO(
+                  "Frame %zu done in %.2fs",
+                  Job->Index,
+                  duration_cast<milliseconds>( system_clock::now() - Job->TimeBegin ).count() * 1e-3 );
+                for ( auto Stage : StageList )
+                    LOG_INFO( "  %s", Stage->Format().c_str() );
+                LOG_INFO( "  %s", Grabber.Format().c_str() );
+                ExportTrace( *Job );
             }
-            break;
         }
     }
 
-TERMINATE:;
+    // Stages finish the frame in hand, then quit as the queues are closed.
     bTerminate = true;
-    FrameTask.wait();
+    for ( auto Queue : { &SegmentQueue, &SampleQueue, &CompleteQueue, &DisplayQueue } )
+        Queue->Close();
+    for ( auto& Stage : Stages )
+        Stage.join();
+    Grabber.Stop();
+
+    for ( auto Stage : StageList )
+        LOG_INFO( "%s", Stage->Format().c_str() );
+    if ( !bReplay )
+        LOG_INFO( "%s", Grabber.Format().c_str() );
     CV_LOG_INFO( nullptr, "Shutting down ... " );
     return 0;
 }
@@ -258,167 +492,203 @@ TERMINATE:;
 /////////////////////////////////////////////////////////////////////////////
 // Logics
 
-static std::optional<cv::Mat> CaptureDepthImage( cv::Mat* FrameData )
+bool SegmentFrame( FFrameJob& Job )
 {
-    // Scale image for optimization
-    // cv::resize( Frame, Frame, DesiredImageSize );
-    cv::Mat Out;
-    auto&   Frame = *FrameData;
-
-    CV_LOG_INFO( nullptr, "-- START OF NEW FRAME --" );
-
-    // Transfer it into actual data - UMat
-    auto GpuFrame  = Frame.getUMat( cv::ACCESS_READ );
+    LOG_INFO( "-- START OF FRAME %zu --", Job.Index );
     auto TimeBegin = system_clock::now();
 
     // Apply SLIC algorithms
-    GpuSLIC.segment( Frame );
-    GpuSLIC.enforceConnectivity();
+    {
+        SCANLIB_TRACE_SCOPE( "superpixel", double( Job.Index ) );
+        if ( Superpixel->Segment( Job.Frame, Job.Contour ) == false )
+        {
+            LOG_WARNING( "Segmentation failed. Discarding current frame." );
+            return false;
+        }
+    }
     auto TimeIterDone = system_clock::now();
 
     LOG_INFO(
-      "Time consumed to iterate: %ul",
-      duration_cast<milliseconds>( TimeIterDone - TimeBegin ).count() );
-
-    cv::Mat Contour = GpuSLIC.getLabels().clone();
-    Contour.convertTo( Contour, CV_32S );
+      "Time consumed to iterate: %.1f ms",
+      duration_cast<microseconds>( TimeIterDone - TimeBegin ).count() * 1e-3 );
 
-    auto TimeContourDone = system_clock::now();
-    LOG_INFO(
-      "Time Consumed to Extract Contour: %lu",
-      duration_cast<milliseconds>( TimeContourDone - TimeIterDone ).count() );
-
-    // Get number of super pixels
+    // Distribute samples over superpixels, then plan the order to take them
+    ComputeStats( Job );
+    if ( FLAGS_depth_propagation || FLAGS_spectral_clusters > 0 )
+    {
+        auto const& Contour = Job.Contour;
+        Job.Graph.Build( Contour.ptr<int32_t>(), Contour.step1(), Contour.cols, Contour.rows, Job.Stats.size() );
+    }
+    if ( FLAGS_spectral_clusters > 0 )
     {
-        double Max;
-        cv::minMaxLoc( Contour, nullptr, &Max );
-        NumSpxls = static_cast<size_t>( Max + 1.5 );
+        ClusterSuperpixels( Job );
     }
 
-    // Find center of each super pixels
-    FindCenters( Contour, Centers, NumSpxls );
-    auto TimeCenterLookupDone = system_clock::now();
+    // Superpixels that look the same as in the latest frame sampled reuse its
+    // samples; samples are distributed with them in account, thus the path is
+    // planned only once, here.
+    size_t NumReused;
+    {
+        FSampleCacheParam Param;
+        Param.MaxAge           = FLAGS_sample_max_age;
+        Param.MaxColorDistance = float( FLAGS_sample_color_tolerance );
+        Param.MaxCenterShift   = float( FLAGS_sample_shift_tolerance );
+
+        vector<uint32_t> ToMeasure;
+        NumReused = SampleCache.Lookup(
+          Param,
+          Job.Stats.data(),
+          Job.Stats.size(),
+          Job.Contour.cols,
+          Job.Contour.rows,
+          Job.Depths,
+          ToMeasure );
+        if ( NumReused > 0 )
+        {
+            LOG_INFO( "Reusing %zu of %zu samples", NumReused, Job.Stats.size() );
+        }
+    }
+    AllocateSamples( Job, NumReused > 0 ? Job.Depths.data() : nullptr );
+    ProjectSamples( Job );
+    PlanSamplePath( Job );
     LOG_INFO(
-      "Time Consumed to Calculate Centers: %lu",
-      duration_cast<milliseconds>( TimeCenterLookupDone - TimeContourDone )
-        .count() );
+      "Time Consumed to Allocate Samples and Path: %.1f ms",
+      duration_cast<microseconds>( system_clock::now() - TimeIterDone ).count() * 1e-3 );
+    return true;
+}
 
-    //! @todo Implement operations below.
+bool SampleFrame( FFrameJob& Job )
+{
+    auto TimeBegin = system_clock::now();
 
-    // Transforms collected centers into the motor's step dimension, then
-    // performs measurement for all central pixels
-    if ( MeasureSampleDepths( Centers, &Depths, 1000ms ) == false )
+    // Performs measurement for the allocated points
+    if ( MeasureSampleDepths( Job, 1000ms ) == false )
     {
         LOG_WARNING( "Sampling failed. Discarding current frame." );
-        return {};
+        SampleCache.Reset();
+        return false;
     }
-    auto TimeDepthSamplingDone = system_clock::now();
     LOG_INFO(
-      "Time Consumed to Sample Depths: %lu",
-      duration_cast<milliseconds>(
-        TimeDepthSamplingDone - TimeCenterLookupDone )
-        .count() );
+      "Time Consumed to Sample Depths: %.1f ms",
+      duration_cast<microseconds>( system_clock::now() - TimeBegin ).count() * 1e-3 );
 
-    // Fill depth map with initial values
-    auto    NumRows = Contour.rows;
-    auto    NumCols = Contour.cols;
-    int     Sizes[] = { NumRows, NumCols };
-    cv::Mat DepthMap{ 2, Sizes, CV_32F };
+    SampleCache.Store( Job.Stats.data(), Job.Depths.data(), Job.Stats.size(), Job.Contour.cols, Job.Contour.rows );
+    return true;
+}
 
+bool CompleteFrame( FFrameJob& Job )
+{
+    auto&       Pool    = FThreadPool::Shared();
+    auto const& Contour = Job.Contour;
+    auto const& Depths  = Job.Depths;
+    auto const  NumRows = Contour.rows;
+    auto const  NumCols = Contour.cols;
+
+    // Superpixels left without sample take depth from adjacent superpixels of
+    // alike color.
+    if ( FLAGS_depth_propagation )
     {
-        for ( size_t i = 0; i < NumRows; i++ )
-        {
-            auto LabelRow = Contour.ptr<int>( i );
-            auto DepthRow = DepthMap.ptr<float>( i );
-            for ( size_t j = 0; j < NumCols; j++ )
-            {
-                auto dpxl   = Depths[LabelRow[j]];
-                DepthRow[j] = dpxl.Range;
-            }
-        }
+        PropagateDepths( Job );
     }
 
-#if 0
-    {
-        Out = DepthMap.clone();
-        Out = 1.0f - ( Out / 5.0f );
-    }
-#endif
-    // Apply Gaussian blurring on gradient contour.
+    // Fill depth map with initial values. Superpixels sampled more than once
+    // take the nearest of their samples. Confidence of samples weighs them on
+    // completion. Maps are of the converter, and kept across frames.
+    Converter.Fill(
+      Contour.ptr<int32_t>(),
+      Contour.step1(),
+      NumCols,
+      NumRows,
+      Depths.data(),
+      Job.Points.data(),
+      Job.PointOffsets.data(),
+      Job.PointDepths.data() );
+    cv::Mat const DepthMap( NumRows, NumCols, CV_32F, const_cast<float*>( Converter.Depth() ) );
+    cv::Mat const WeightMap( NumRows, NumCols, CV_32F, const_cast<float*>( Converter.Weight() ) );
+
     // Superpixels that have a close relationship should be interpolated
     // smoothly. On the other hand, the cliff, which indicates a large
     // difference between Superpixels, should not be interpolated.
+    cv::Mat BlurImage = CompleteDepth( FLAGS_depth_completion, Job.Frame, DepthMap, WeightMap );
+    Job.Depth         = BlurImage;
     {
-        cv::Mat BlurImage;
-        cv::bilateralFilter( DepthMap, BlurImage, 0, 0.16, 14.0 );
-        BlurImage.copyTo( Out );
-
-        vector<ScanDataPixelType> Raw, Blurred;
-        Raw.resize( size_t( NumRows ) * NumCols );
-        Blurred.resize( size_t( NumRows ) * NumCols );
-
-        for ( size_t i = 0; i < NumRows; i++ )
-        {
-            auto BlurredRow = BlurImage.ptr<float>( i );
-            auto LabelRow   = Contour.ptr<int>( i );
-            for ( size_t j = 0; j < NumCols; j++ )
-            {
-                auto dpxl                            = Depths[LabelRow[j]];
-                Blurred[i * NumCols + j].Q9_22_DEPTH = q9_22_t( BlurredRow[j] * Q9_22_ONE_INT );
-                Blurred[i * NumCols + j].UQ_12_4_AMP = dpxl.Amp;
-                Raw[i * NumCols + j].Q9_22_DEPTH     = q9_22_t( dpxl.Range * Q9_22_ONE_INT );
-                Raw[i * NumCols + j].UQ_12_4_AMP     = dpxl.Amp;
-            }
-        }
+        lock_guard<mutex> lk( LastDepthLock );
+        LastDepth = BlurImage;
+    }
 
-        // Save as *.dpta file
-        for ( size_t i = 0; i < 2; i++ )
-        {
-            void* const Data[] = { Raw.data(), Blurred.data() };
-
-            auto fp = fopen(
-              ( to_string( system_clock::now().time_since_epoch().count() )
-                + ( i == 0 ? "_raw.dpta" : "_filtered.dpta" ) )
-                .c_str(),
-              "wb" );
-            if ( fp )
+    // Encode both depth maps and find superpixel contour in a single pass.
+    // Completed depth escapes this stage, thus it is the only map allocated
+    // per frame.
+    Converter.Convert(
+      Contour.ptr<int32_t>(),
+      Contour.step1(),
+      Depths.data(),
+      BlurImage.ptr<float>(),
+      BlurImage.step1(),
+      true );
+    auto const& Raw     = Converter.Raw();
+    auto const& Blurred = Converter.Filtered();
+
+    // Save as *.dpta file. Writing doesn't hold the pipeline.
+    auto const Stamp = to_string( system_clock::now().time_since_epoch().count() );
+    for ( size_t i = 0; i < 2 && FLAGS_write_dpta; i++ )
+    {
+        Pool.Enqueue( [Data = i == 0 ? Raw : Blurred, Path = Stamp + ( i == 0 ? "_raw.dpta" : "_filtered.dpta" ), NumCols, NumRows]() {
+            if ( auto fp = fopen( Path.c_str(), "wb" ) )
             {
-                ScanDataWriteTo( fp, Data[i], NumCols, NumRows, AspectRatio );
+                ScanDataWriteTo( fp, Data->data(), NumCols, NumRows, AspectRatio );
                 fclose( fp );
             }
-        }
-#if 1 // Debug display ...
-        {
-            cv::UMat GpuContour;
-            Contour.copyTo( GpuContour );
-            cv::Laplacian( GpuContour, GpuContour, -1 );
-            cv::compare( GpuContour, 0, GpuContour, cv::CMP_NE );
-
-            // Contour for RGB img
-            {
-                auto RgbContour = GpuContour.clone();
-                cv::cvtColor( RgbContour, RgbContour, cv::COLOR_GRAY2BGR );
-                // GpuContour.convertTo( RgbContour, CV_8UC3 );
-                cv::add( RgbContour, GpuFrame, Frame );
-            }
+        } );
+    }
 
-            // Contour for depth img
-            {
-                cv::multiply( GpuContour, 1e3, GpuContour );
-                GpuContour.convertTo( GpuContour, CV_32FC1 );
-                cv::Mat GridDepth;
-                cv::add( GpuContour, BlurImage, GridDepth );
-                cv::imshow( "depth-grid", GridDepth / DEBUG_MAX_DIST );
-            }
-        }
-#endif
+#if 1 // Debug display ...
+    {
+        cv::Mat const ContourMask( NumRows, NumCols, CV_8U, const_cast<uint8_t*>( Converter.Contour().data() ) );
+        Job.Frame.copyTo( Job.RgbGrid );
+        Job.RgbGrid.setTo( cv::Scalar::all( 255 ), ContourMask );
+        BlurImage.copyTo( Job.DepthGrid );
+        Job.DepthGrid.setTo( 255e3, ContourMask );
     }
+#endif
 
-    // Calculates the distance between each super-pixels then create a
-    // distance matrix to select nearby super-pixels to evaluate.
+    return true;
+}
 
-    // Apply blurring operation to depth image based on the relationship
-    // between super-pixels.
+cv::Mat CompleteDepth( std::string const& Method, cv::Mat const& Frame, cv::Mat const& Depth, cv::Mat const& Weight )
+{
+    CV_Assert( Depth.type() == CV_32F && Frame.depth() == CV_8U && Frame.channels() >= 3 );
+    CV_Assert( Depth.size() == Frame.size() );
+    cv::Mat Out;
+
+    if ( Method == "bilateral" )
+    {
+        // Smooths depth alone; blurs over color edges.
+        cv::bilateralFilter( Depth, Out, 0, 0.16, 14.0 );
+    }
+    else
+    {
+        FGuidedFilterParam Param;
+        Param.Radius    = FLAGS_guided_radius;
+        Param.Epsilon   = float( FLAGS_guided_epsilon );
+        Param.Subsample = FLAGS_guided_subsample;
+
+        static thread_local FGuidedDepthFilter Filter;
+        Out.create( Depth.size(), CV_32F );
+        Filter.Filter(
+          Param,
+          Frame.ptr<uint8_t>(),
+          Frame.channels(),
+          Frame.step,
+          Depth.ptr<float>(),
+          Depth.step1(),
+          Weight.empty() ? nullptr : Weight.ptr<float>(),
+          Weight.empty() ? 0 : Weight.step1(),
+          Depth.cols,
+          Depth.rows,
+          Out.ptr<float>(),
+          Out.step1() );
+    }
 
     return Out;
 }
@@ -441,238 +711,502 @@ std::string stringf( char const* fmt, ... )
 /////////////////////////////////////////////////////////////////////////////
 // Helpers
 
-static void
-FindCenters( cv::Mat Contour, std::vector<cv::Point2f>& Out, size_t NumSpxls )
+void ExportTrace( FFrameJob const& Job )
 {
-    Out.clear();
-    auto             NumRows = Contour.rows;
-    auto             NumCols = Contour.cols;
-    std::vector<int> NumPxls; // Number of pixels for each super pixel
-    size_t           ArrayLen = NumSpxls;
-
-    // Prepare for output data array
-    Out.resize( ArrayLen, {} );
-    NumPxls.resize( ArrayLen, 0 );
-    LOG_INFO( "Number of label: %d", Out.size() );
-    CV_Assert( Contour.channels() == 1 );
-
-    // For each rows ...
-    for ( decltype( NumRows ) i = 0; i < NumRows; i++ )
-    {
-        auto RowPtr = Contour.ptr<int>( i );
-        for ( decltype( NumCols ) k = 0; k < NumCols; k++ )
+    // Frames leave the pipeline in order, thus events that ended before this
+    // one began are of no later frame either.
+    static FTraceCollector Collector;
+    if ( FTracer::Enabled() == false )
+        return;
+
+    Collector.Collect();
+    if ( FLAGS_trace_frame_interval <= 1 || Job.Index % FLAGS_trace_frame_interval == 0 )
+    {
+        // Events of frames overlapping this one are written as well, which is
+        // what shows how stages run side by side.
+        string     Json;
+        auto const NumEvents = Collector.Export( Job.TraceBegin, FTracer::Now(), Json );
+        auto const Path      = ( filesystem::path( FLAGS_trace_dir ) / ( "frame_" + to_string( Job.Index ) + ".json" ) ).string();
+        if ( auto fp = fopen( Path.c_str(), "wb" ) )
+        {
+            fwrite( Json.data(), 1, Json.size(), fp );
+            fclose( fp );
+            LOG_INFO( "Wrote %zu trace events to %s", NumEvents, Path.c_str() );
+        }
+        else
         {
-            Out[RowPtr[k]] += cv::Point2f{ float( k ), float( i ) };
-            NumPxls[RowPtr[k]]++;
+            LOG_WARNING( "Failed to write trace to %s", Path.c_str() );
         }
     }
+    Collector.Trim( Job.TraceBegin );
 
-    for ( size_t i = 0; i < ArrayLen; i++ )
+    // Rings fill up if frames take long and trace heavily.
+    static size_t NumDropped = 0;
+    if ( auto const Num = FTracer::NumDropped(); Num > NumDropped )
     {
-        auto& pt  = Out[i];
-        auto  num = NumPxls[i];
-
-        auto& x = pt.x;
-        auto& y = pt.y;
-
-        // Calculates mean center position.
-        // Output value will be normalized by aspect ratio.
-        // x [0, AspectRatio), y [0, 1)
-        x /= num * NumRows;
-        y /= num * NumRows;
+        LOG_WARNING( "%zu trace events dropped", Num - NumDropped );
+        NumDropped = Num;
     }
+}
 
-    // done.
+static size_t ComputeStats( FFrameJob& Job )
+{
+    auto const& Frame   = Job.Frame;
+    auto const& Contour = Job.Contour;
+    CV_Assert( Contour.type() == CV_32S && Frame.depth() == CV_8U );
+
+    // Counts labels along with centroids, box and color of each superpixel.
+    size_t const NumSpxls = SpxlStats.Compute(
+      Contour.ptr<int32_t>(),
+      Contour.step1(),
+      Contour.cols,
+      Contour.rows,
+      Frame.ptr<uint8_t>(),
+      Frame.channels(),
+      Frame.step );
+    LOG_INFO( "Number of label: %zu", NumSpxls );
+
+    Job.Stats = SpxlStats.Stats();
+    return NumSpxls;
 }
 
-bool InitializeMeasurementDevice()
+bool OpenCamera( cv::VideoCapture& Video )
 {
-    bScannerValid = false;
-    gScan.Logger  = []( auto str ) { std::cout << str; };
+#ifdef _WIN32
+    Video.open( FLAGS_cam_index + cv::CAP_DSHOW );
+#else
+    Video.open( FLAGS_cam_index + cv::CAP_ANY );
+#endif
+
+    cv::ocl::setUseOpenCL( true );
 
-    if ( API_RefreshScannerControl( gScan ) == false )
+    // Enumerate GPU devices
     {
-        LOG_WARNING( "No DepScan device found" );
-        return false;
+        cv::ocl::Context context;
+        if ( !context.create( cv::ocl::Device::TYPE_GPU ) )
+        {
+            cout << "Failed creating the context..." << endl;
+            // return;
+        }
+
+        cout << context.ndevices() << " GPU devices are detected."
+             << endl; // This bit provides an overview of the OpenCL devices you
+                      // have in your computer
+        for ( int i = 0; i < context.ndevices(); i++ )
+        {
+            cv::ocl::Device device = context.device( i );
+            cout << "name:              " << device.name() << endl;
+            cout << "available:         " << device.available() << endl;
+            cout << "imageSupport:      " << device.imageSupport() << endl;
+            cout << "OpenCL_C_Version:  " << device.OpenCL_C_Version() << endl;
+            cout << endl;
+        }
+
+        cv::ocl::Device( context.device( 1 ) );
     }
 
-    LOG_INFO( "Successful connected to DepScan device" );
-    if ( gScan.Report( 1000 ) == false )
+    if ( Video.isOpened() == false )
     {
-        CV_LOG_ERROR( nullptr, "Report failed" );
-        gScan.Shutdown();
+        CV_LOG_ERROR( nullptr, "Failed to open camera" );
         return false;
     }
 
-    LOG_INFO( "Successfully received report." );
-    gScan.StopCapture();
-    gScan.SetMotorAcceleration( FLAGS_device_x_accel, FLAGS_device_y_accel );
-    gScan.SetMotorDriveClockSpeed( 52400 );
-    gScan.ConfigSensorDelay( FLAGS_device_sample_delay );
-    gScan.ConfigSensorDistMode( false );
-    gScan.InitPointMode();
-    gScan.QueuePoint( 0, 0, 0 );
+    // Configure video resolution ... Set pixel count as the desired
+    // configuration
+    {
+        //// Query the camera's maximum pixel count
+        Video.set( cv::CAP_PROP_FRAME_WIDTH, 1e6 );
+        Video.set( cv::CAP_PROP_FRAME_HEIGHT, 1e6 );
+        auto w = Video.get( cv::CAP_PROP_FRAME_WIDTH );
+        auto h = Video.get( cv::CAP_PROP_FRAME_HEIGHT );
+
+        //// Calculate required reduction ratio
+        auto DesiredImageScale = sqrt( FLAGS_desired_pixel_cnt / ( w * h ) );
+        w *= DesiredImageScale;
+        h *= DesiredImageScale;
+
+        Video.set( cv::CAP_PROP_FRAME_WIDTH, w );
+        Video.set( cv::CAP_PROP_FRAME_HEIGHT, h );
+        w = Video.get( cv::CAP_PROP_FRAME_WIDTH );
+        h = Video.get( cv::CAP_PROP_FRAME_HEIGHT );
+        LOG_INFO( "Video resolution is set to %.0f %.0f", w, h );
 
-    LOG_INFO( "Successfully initialized point mode." );
-    bScannerValid = true;
+        AspectRatio = float( w / h );
+    }
     return true;
 }
 
-bool MeasureSampleDepths(
-  std::vector<cv::Point2f> const& Points,
-  std::vector<depth_t>*           pDepths,
-  std::chrono::milliseconds       DeviceTimeout )
+FMotionModel MakeMotionModel()
+{
+    FMotionModel Motion;
+    Motion.MaxSpeed[0] = Motion.MaxSpeed[1] = float( FLAGS_device_drive_clock );
+    Motion.Accel[0]                         = float( FLAGS_device_x_accel );
+    Motion.Accel[1]                         = float( FLAGS_device_y_accel );
+    Motion.DwellSec                         = FLAGS_device_sample_delay * 1e-6f;
+    return Motion;
+}
+
+FAngularProjection const& ConfigureProjection( int Width, int Height )
+{
+    // Tables are rebuilt only when any of these changes. One per stage thread.
+    FAngularProjectionParam Param;
+    Param.Fov[0]            = float( FLAGS_horizontal_fov );
+    Param.Fov[1]            = float( FLAGS_vertical_fov );
+    Param.SensorOffset[0]   = float( FLAGS_sensor_offset_x );
+    Param.SensorOffset[1]   = float( FLAGS_sensor_offset_y );
+    Param.ReferenceDistance = float( FLAGS_sensor_reference_distance );
+    Param.AngleOffset[0]    = float( FLAGS_sensor_angle_offset_x );
+    Param.AngleOffset[1]    = float( FLAGS_sensor_angle_offset_y );
+    DepthSampler->DegreePerStep( Param.DegreePerStep[0], Param.DegreePerStep[1] );
+
+    static thread_local FAngularProjection Projection;
+    if ( Projection.Configure( Param, Width, Height ) )
+    {
+        LOG_INFO( "Rebuilt projection tables for %d %d", Width, Height );
+    }
+    return Projection;
+}
+
+void ClusterSuperpixels( FFrameJob& Job )
 {
-    if ( !gScan.IsConnected() || bScannerValid == false )
+    using namespace std;
+    auto const& Contour = Job.Contour;
+    auto const  NumSpxl = Job.Stats.size();
+    auto const  Begin   = system_clock::now();
+
+    // Depth of the latest map at centroids tells apart surfaces of alike
+    // color.
+    vector<float> Prior;
     {
-        if ( InitializeMeasurementDevice() == false )
+        lock_guard<mutex> lk( LastDepthLock );
+        if ( LastDepth.rows == Contour.rows && LastDepth.cols == Contour.cols )
         {
-            return false;
+            Prior.resize( NumSpxl );
+            for ( size_t i = 0; i < NumSpxl; i++ )
+            {
+                auto const& s = Job.Stats[i];
+                Prior[i]      = s.NumPixels ? LastDepth.at<float>( int( s.CenterY ), int( s.CenterX ) ) : 0.f;
+            }
         }
     }
 
-    //
+    FSpectralClusterParam Param;
+    Param.NumClusters  = FLAGS_spectral_clusters;
+    Param.TimeBudgetMs = FLAGS_spectral_time_budget;
+
+    // Clusterer carries the previous frame over, thus lives in segment stage.
+    static FSpectralClusterer Clusterer;
+    auto const                NumIter = Clusterer.Cluster(
+      Param,
+      Job.Graph,
+      Job.Stats.data(),
+      Prior.empty() ? nullptr : Prior.data(),
+      Contour.cols,
+      Contour.rows );
+    if ( NumIter < 0 )
+    {
+        Job.Segments.clear();
+        Job.SegmentBoundary.clear();
+        return;
+    }
+    Job.Segments        = Clusterer.Segments();
+    Job.SegmentBoundary = Clusterer.Boundary();
+
+    LOG_INFO(
+      "Clustered %zu superpixels into %d segments; %d iterations in %.2f ms",
+      NumSpxl,
+      Param.NumClusters,
+      NumIter,
+      duration_cast<microseconds>( system_clock::now() - Begin ).count() * 1e-3 );
+}
+
+void AllocateSamples( FFrameJob& Job, depth_t const* Priors )
+{
     using namespace std;
-    using req_id_t    = size_t;
-    using path_node_t = pair<req_id_t, cv::Point2f>;
-    vector<path_node_t>              CapturePath;
-    chrono::time_point<system_clock> TimeoutPivot;
-
-    // Reserve enough space
-    auto const NumSpxl = Points.size();
-    auto&      Depths  = *pDepths;
-    Depths.resize( NumSpxl );
-
-    // Callback to check timeout
-    auto TimeoutChecker
-      = [&]() { return system_clock::now() - TimeoutPivot > DeviceTimeout; };
-
-    // Copy points into capture path
-    CapturePath.resize( NumSpxl );
-    for ( size_t i = 0; i < NumSpxl; i++ )
+    auto const& Contour    = Job.Contour;
+    auto const& Projection = ConfigureProjection( Contour.cols, Contour.rows );
+
+    // Motor steps per pixel around the image center
+    FSampleAllocParam Param;
+    Param.Motion           = MakeMotionModel();
+    Param.StepPerPixel[0]  = Projection.StepPerPixel( 0 );
+    Param.StepPerPixel[1]  = Projection.StepPerPixel( 1 );
+    Param.TimeBudget       = FLAGS_sample_time_budget;
+    Param.MaxPerSuperpixel = FLAGS_max_samples_per_superpixel;
+    Param.BoundaryWeight   = float( FLAGS_segment_boundary_weight );
+
+    // Discontinuities are looked up on the latest depth map available, which
+    // is a frame or two behind.
+    cv::Mat Depth;
+    {
+        lock_guard<mutex> lk( LastDepthLock );
+        Depth = LastDepth;
+    }
+    if ( Depth.rows != Contour.rows || Depth.cols != Contour.cols )
+        Depth = {};
+
+    static thread_local FSampleAllocator Allocator;
+    auto const                           Predicted = Allocator.Allocate(
+      Param,
+      Job.Stats.data(),
+      Job.Stats.size(),
+      Contour.ptr<int32_t>(),
+      Contour.step1(),
+      Contour.cols,
+      Contour.rows,
+      Depth.empty() ? nullptr : Depth.ptr<float>(),
+      Depth.empty() ? 0 : Depth.step1(),
+      Priors,
+      Job.SegmentBoundary.empty() ? nullptr : Job.SegmentBoundary.data(),
+      Job.Points );
+    Job.PointOffsets = Allocator.Offsets();
+
+    LOG_INFO(
+      "Allocated %zu samples over %zu superpixels; estimated %.2fs",
+      Job.Points.size(),
+      Job.Stats.size(),
+      Predicted );
+}
+
+void ProjectSamples( FFrameJob& Job )
+{
+    auto const& Points  = Job.Points;
+    auto const  NumSpxl = Points.size();
+
+    // Pixel to motor step goes through per-axis tables of the projection; see
+    // angular_projection.hpp for the model. Continuous steps feed the path
+    // planner, rounded ones are sent to the device as they are.
+    auto const& Projection = ConfigureProjection( Job.Contour.cols, Job.Contour.rows );
+    Job.StepX.resize( NumSpxl );
+    Job.StepY.resize( NumSpxl );
+    Job.Requests.resize( NumSpxl );
+    Projection.Project( Points.data(), NumSpxl, Job.StepX.data(), Job.StepY.data(), Job.Requests.data() );
+}
+
+void PlanSamplePath( FFrameJob& Job )
+{
+    using namespace std;
+    auto const NumSpxl = Job.StepX.size();
+
+    // Plan capture path.
+    // Motor travel dominates sampling time, and two axes accelerate very
+    // differently; the path is planned on predicted travel time of the motors.
+    // Head rests on the origin between frames.
     {
-        CapturePath[i].first  = i;
-        CapturePath[i].second = Points[i];
+        FSamplePathParam Param;
+        Param.Motion       = MakeMotionModel();
+        Param.TimeBudgetMs = FLAGS_path_plan_budget_ms;
+
+        // Only segment stage plans paths.
+        static thread_local FSamplePathPlanner Planner;
+        auto                                   PlanBegin = system_clock::now();
+        Job.PredictedTime = Planner.Plan( Param, Job.StepX.data(), Job.StepY.data(), NumSpxl, 0, 0, Job.CapturePath );
+        LOG_INFO(
+          "Planned path of %zu samples in %.1f ms; predicted %.2fs",
+          NumSpxl,
+          duration_cast<microseconds>( system_clock::now() - PlanBegin ).count() * 1e-3,
+          Job.PredictedTime );
     }
+}
 
-    // Sort capture paths.
-    // The capture path array will be sorted with higher X position
-    // priority, to reduce the mechanical load of the DepScan device.
+void PropagateDepths( FFrameJob& Job )
+{
+    using namespace std;
+    auto const& Contour  = Job.Contour;
+    auto const& Graph    = Job.Graph;
+    auto&       Depths   = Job.Depths;
+    auto const  NumSpxl  = Job.Stats.size();
+    auto const  NumEdges = Graph.Edges().size() / 2;
+    auto const  Begin    = system_clock::now();
+
+    // Graph was built on segment stage, along with stats.
+    static thread_local FDepthPropagator Propagator;
+
+    // Starts from the latest depth map, which barely changes between frames.
+    // Superpixels it doesn't cover start from the mean of samples.
+    vector<float> Solution( NumSpxl );
     {
-        auto CapturePathSortPred
-          = []( path_node_t const& a, path_node_t const& b ) -> int {
-            auto tolerance = FLAGS_path_x_tolerance * 0.5f;
+        double Sum = 0;
+        size_t Num = 0;
+        for ( auto& d : Depths )
+        {
+            if ( d.Confidence > 0 )
+                Sum += d.Range, Num++;
+        }
+        fill( Solution.begin(), Solution.end(), Num ? float( Sum / Num ) : 0.f );
+
+        lock_guard<mutex> lk( LastDepthLock );
+        if ( LastDepth.rows == Contour.rows && LastDepth.cols == Contour.cols )
+        {
+            for ( size_t i = 0; i < NumSpxl; i++ )
+            {
+                auto const& s = Job.Stats[i];
+                auto const  d = LastDepth.at<float>( int( s.CenterY ), int( s.CenterX ) );
+                if ( s.NumPixels && d > 0 )
+                    Solution[i] = d;
+            }
+        }
+    }
 
-            auto& pa = a.second;
-            auto& pb = b.second;
+    FDepthPropagationParam Param;
+    Param.Smoothness   = float( FLAGS_propagation_smoothness );
+    Param.CrossSegment = float( FLAGS_cross_segment_weight );
+
+    auto const NumIter = Propagator.Solve(
+      Param,
+      Graph,
+      Job.Stats.data(),
+      Depths.data(),
+      Job.Segments.empty() ? nullptr : Job.Segments.data(),
+      Solution.data() );
+    if ( NumIter < 0 )
+        return;
+
+    // Propagated depth is trusted less than any sample, thus completion leans
+    // on measured ones.
+    size_t NumFilled = 0;
+    for ( size_t i = 0; i < NumSpxl; i++ )
+    {
+        if ( !( Depths[i].Confidence > 0 ) && Job.Stats[i].NumPixels )
+        {
+            Depths[i].Range      = Solution[i];
+            Depths[i].Confidence = 0.1f;
+            NumFilled++;
+        }
+    }
 
-            return std::abs( pa.x - pb.x ) < tolerance ? pa.y < pb.y
-                                                       : pa.x < pb.x;
-        };
+    LOG_INFO(
+      "Propagated depth to %zu superpixels over %zu edges; %d iterations in %.2f ms",
+      NumFilled,
+      NumEdges,
+      NumIter,
+      duration_cast<microseconds>( system_clock::now() - Begin ).count() * 1e-3 );
+}
 
-        sort( CapturePath.begin(), CapturePath.end(), CapturePathSortPred );
+bool MeasureSampleDepths(
+  FFrameJob&                Job,
+  std::chrono::milliseconds DeviceTimeout )
+{
+    if ( DepthSampler->IsOpen() == false && DepthSampler->Open() == false )
+    {
+        return false;
     }
+    DepthSampler->BeginFrame( Job.Index );
+
+    //
+    using namespace std;
+
+    // Request ID of each point is its index.
+    auto const& CapturePath = Job.CapturePath;
+    auto const  NumSpxl     = CapturePath.size();
+    auto&       Depths      = Job.PointDepths;
+    Depths.assign( Job.Points.size(), {} );
 
     //! @todo Calibrate physical offset between camera and DepScan
 
-    // Configure gScan device
-    gScan.OnPointRecv = [&]( FPointData const& pd ) {
+    // Configure sampler. Callback refers to this job; it must be cleared
+    // before returning. Callback runs on the receiving thread; the sampler
+    // synchronizes it with the waits below, thus Depths are safe to read
+    // once every request is answered. Time between answers, which is mostly
+    // motor travel, is traced as a span per sample.
+    int64_t LastAnswer = FTracer::Now();
+    DepthSampler->SetCallback( [&]( FPointData const& pd ) {
+        // IDs index points of this frame; a late answer of an earlier,
+        // larger frame may be out of range.
+        if ( pd.ID >= Depths.size() )
+        {
+            return;
+        }
+        if ( FTracer::Enabled() )
+        {
+            auto const Now = FTracer::Now();
+            FTracer::Span( "sample", LastAnswer, Now, double( pd.ID ) );
+            LastAnswer = Now;
+        }
+
         auto Range          = pd.V.Distance / (float)Q9_22_ONE_INT;
-        Depths[pd.ID].Range = std::max( 0.f, Range );
-        Depths[pd.ID].Amp   = pd.V.AMP / (float)UQ12_4_ONE_INT;
-        TimeoutPivot        = system_clock::now();
-    };
+        auto& Sample        = Depths[pd.ID];
+        Sample.Range        = std::max( 0.f, Range );
+        Sample.Amp          = pd.V.AMP / (float)UQ12_4_ONE_INT;
+        Sample.Age          = 0;
+        Sample.Confidence   = 1.f;
+    } );
 
     auto ElapsedTimeBegin = system_clock::now();
-    auto IntervalPivot    = ElapsedTimeBegin;
     // Capture all samples through path
     for ( size_t i = 0; i < NumSpxl; i++ )
     {
         if ( bTerminate )
         {
-            while ( gScan.QueuePoint( 0, 0, 0 ) == false )
-            {
-            }
-            gScan.OnPointRecv = {};
+            DepthSampler->WaitAll( DeviceTimeout );
+            DepthSampler->SetCallback( {} );
+            DepthSampler->Home();
             return false;
         }
 
-        // Translate normalized point into angular dimension
-        auto const& pt = CapturePath[i];
-
-        // Map normalized projection coordinate to the spherical coordinate of motor axis. Assumes projection plane is on the distance of the sensor offset r. The projection coordinate x', y' can be calculated from phi, theta by the following equation:
-        //      x' = r * tan(theta).
-        // Since we got normalized projection coordinate x, y currently, firstly this value should be converted to actual value x', y'.
-        // x' can be calculated from x' by the following equation:
-        //      x' = r * tan(xfov) * x
-        // To get theta, we use the following equation:
-        //      theta = atan(x'/r)
-
-        constexpr float DTOR   = float( M_PI / 180.0 );
-        constexpr float RTOD   = float( 180.0 / M_PI );
-        float           xfov   = DTOR * FLAGS_horizontal_fov;
-        float           yfov   = DTOR * FLAGS_vertical_fov;
-        auto const      aspect = AspectRatio;
-
-        using fc = float const;
-        fc rx    = FLAGS_sensor_offset_x;
-        fc ry    = FLAGS_sensor_offset_y;
-        fc xo    = pt.second.x / aspect - 0.5f;
-        fc yo    = pt.second.y - 0.5f;
-        // Since xo and yo varies between -0.5~ 0.5, should multiply 2 on them.
-        fc xc = rx * tanf( xfov * 0.5f ) * xo * 2.f;
-        fc yc = ry * tanf( yfov * 0.5f ) * yo * 2.f;
-
-        fc theta = atanf( xc / rx ), phi = atanf( yc / ry );
-        fc x = theta * RTOD, y = phi * RTOD;
-        // fc x = xfov * xo * RTOD;
-        // fc y = yfov * yo * RTOD;
-
-        // Queue point capture
-        TimeoutPivot = system_clock::now();
-        while ( gScan.QueuePointAngular( pt.first, x, y ) == false )
+        // Queue point capture. Sleeps while the device queue is full; timeout
+        // is from the latest answer.
+        auto const Index = CapturePath[i];
+        if ( DepthSampler->Queue( Job.Requests[Index], DeviceTimeout ) == false )
         {
-            if ( TimeoutChecker() )
-            {
-                bScannerValid = false;
-                CV_LOG_ERROR( nullptr, "DepScan device timeout occurred !" );
-                return false;
-            }
-
-            // Yield thread if point queue is full.
-            this_thread::sleep_for( 5ms );
+            DepthSampler->Close();
+            DepthSampler->SetCallback( {} );
+            LOG_ERROR( "DepScan device timeout occurred at %zu / %zu", i, NumSpxl );
+            return false;
         }
 
-        if ( auto now = system_clock::now(); now - IntervalPivot > 500ms )
-        {
-            IntervalPivot = now;
-            auto speed
-              = duration_cast<microseconds>( now - ElapsedTimeBegin ).count()
-                / ( i + 1.0 ) * 1e-3;
-            LOG_INFO(
-              "%lu / %lu ... %.3f ms/smpl %.2fs left",
-              i,
-              NumSpxl,
-              speed,
-              ( ( NumSpxl - i - 1 ) * speed ) * 1e-3 );
-        }
+        // Progress shows on the trace rather than in the log.
+        FTracer::Counter( "pending samples", double( DepthSampler->NumPending() ) );
     }
 
     // Wait until all pending point request finished.
-    // Timeout is from latest point request
-    while ( gScan.GetPendingPointRequestCount() )
+    if ( DepthSampler->WaitAll( DeviceTimeout ) == false )
     {
-        if ( TimeoutChecker() )
-        {
-            bScannerValid = false;
-            LOG_ERROR( "DepScan device timeout occurred !" );
-            return false;
-        }
+        DepthSampler->Close();
+        DepthSampler->SetCallback( {} );
+        LOG_ERROR( "DepScan device timeout occurred with %zu pending", DepthSampler->NumPending() );
+        return false;
     }
 
     // Clear callback to prevent local data corruption
-    gScan.OnPointRecv = {};
-    gScan.QueuePoint( 0, 0, 0 );
+    DepthSampler->SetCallback( {} );
+    DepthSampler->Home();
+
+    auto const ActualTime = duration_cast<microseconds>( system_clock::now() - ElapsedTimeBegin ).count() * 1e-6;
+    LOG_INFO( "Sampling took %.2fs; predicted %.2fs", ActualTime, Job.PredictedTime );
+
+    // Superpixel depth is the mean of its valid points. The ones left without
+    // any keep what was reused, if any.
+    size_t NumUnsampled = 0;
+    Job.Depths.resize( Job.Stats.size() );
+    for ( size_t i = 0; i < Job.Stats.size(); i++ )
+    {
+        depth_t Sum;
+        int     Num = 0;
+        for ( auto k = Job.PointOffsets[i]; k < Job.PointOffsets[i + 1]; k++ )
+        {
+            if ( Depths[k].Confidence > 0 )
+            {
+                Sum.Range += Depths[k].Range;
+                Sum.Amp += Depths[k].Amp;
+                Num++;
+            }
+        }
+
+        if ( Num )
+        {
+            Sum.Range /= Num;
+            Sum.Amp /= Num;
+            Sum.Confidence = 1.f;
+            Job.Depths[i]  = Sum;
+        }
+        else if ( !( Job.Depths[i].Confidence > 0 ) )
+        {
+            NumUnsampled++;
+        }
+    }
+    LOG_INFO( "%zu of %zu superpixels left without sample", NumUnsampled, Job.Stats.size() );
 
     // done.
+    return true;
 }
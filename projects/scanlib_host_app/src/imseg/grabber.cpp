@@ -0,0 +1,250 @@
+//! @file       grabber.cpp
+//! @brief      Camera acquisition thread of imseg
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "grabber.hpp"
+#include <algorithm>
+#include <scanlib/utility/trace.hpp>
+#include <stdio.h>
+
+using namespace std;
+using namespace std::chrono;
+
+FFrameGrabber::FLease& FFrameGrabber::FLease::operator=( FLease&& o ) noexcept
+{
+    if ( this != &o )
+    {
+        Release();
+        mOwner   = o.mOwner;
+        mFrame   = o.mFrame;
+        mSlot    = o.mSlot;
+        o.mOwner = nullptr;
+        o.mFrame = nullptr;
+    }
+    return *this;
+}
+
+void FFrameGrabber::FLease::Release() noexcept
+{
+    if ( mOwner )
+    {
+        mOwner->release( mSlot );
+        mOwner = nullptr;
+        mFrame = nullptr;
+    }
+}
+
+bool FFrameGrabber::Start( cv::VideoCapture& Video, size_t NumSlots )
+{
+    Stop();
+    if ( Video.isOpened() == false )
+    {
+        return false;
+    }
+
+    // Slots are never resized while running, thus leases may point into them.
+    lock_guard<mutex> lk( mLock );
+    mVideo = &Video;
+    mFrames.assign( max<size_t>( NumSlots, 2 ), {} );
+    mStates.assign( mFrames.size(), ESlot::Free );
+    mNumGrabbed = mNumTaken = mNumDropped = 0;
+    mReadSeconds = mLatencySeconds = mMaxLatency = 0;
+
+    bStop   = false;
+    mThread = thread( &FFrameGrabber::captureThread, this );
+    return true;
+}
+
+void FFrameGrabber::Stop()
+{
+    {
+        lock_guard<mutex> lk( mLock );
+        bStop = true;
+    }
+    mFilled.notify_all();
+
+    if ( mThread.joinable() )
+    {
+        mThread.join();
+    }
+}
+
+void FFrameGrabber::captureThread() noexcept
+{
+    FTracer::NameThread( "capture" );
+    while ( bStop == false )
+    {
+        // Free slot first. Otherwise the oldest frame nobody took yet is
+        // overwritten, but never the only one; a consumer about to wake up
+        // would find nothing. If there's no such slot, the frame is read and
+        // thrown away, so that the camera doesn't queue up stale ones.
+        size_t Slot = mFrames.size();
+        {
+            lock_guard<mutex> lk( mLock );
+            size_t            NumFilled = 0;
+            for ( size_t i = 0; i < mStates.size(); i++ )
+            {
+                if ( mStates[i] == ESlot::Free )
+                {
+                    Slot = i;
+                    break;
+                }
+                if ( mStates[i] == ESlot::Filled )
+                {
+                    NumFilled++;
+                    if ( Slot == mFrames.size() || mFrames[i].Sequence < mFrames[Slot].Sequence )
+                        Slot = i;
+                }
+            }
+
+            if ( Slot < mFrames.size() && mStates[Slot] == ESlot::Filled && NumFilled < 2 )
+            {
+                Slot = mFrames.size();
+            }
+            else if ( Slot < mFrames.size() )
+            {
+                mNumDropped += mStates[Slot] == ESlot::Filled;
+                mStates[Slot] = ESlot::Writing;
+            }
+        }
+
+        if ( Slot == mFrames.size() )
+        {
+            auto const Begin = steady_clock::now();
+            bool       bGrab;
+            {
+                SCANLIB_TRACE_SCOPE( "grab" );
+                bGrab = mVideo->grab();
+            }
+
+            lock_guard<mutex> lk( mLock );
+            if ( bGrab )
+            {
+                mNumGrabbed++;
+                mNumDropped++;
+                mReadSeconds += duration<double>( steady_clock::now() - Begin ).count();
+            }
+            continue;
+        }
+
+        // A consumer may have kept a copy of the header past its lease; the
+        // buffer is then left to it rather than overwritten.
+        auto& Frame = mFrames[Slot];
+        if ( Frame.Image.u && Frame.Image.u->refcount > 1 )
+        {
+            Frame.Image.release();
+        }
+
+        auto const Begin = steady_clock::now();
+        bool       bRead;
+        {
+            SCANLIB_TRACE_SCOPE( "grab" );
+            bRead = mVideo->read( Frame.Image ) && !Frame.Image.empty();
+        }
+        auto const End = steady_clock::now();
+
+        {
+            lock_guard<mutex> lk( mLock );
+            if ( bRead )
+            {
+                Frame.Time     = End;
+                Frame.Sequence = mNumGrabbed++;
+                mStates[Slot]  = ESlot::Filled;
+                mReadSeconds += duration<double>( End - Begin ).count();
+            }
+            else
+            {
+                mStates[Slot] = ESlot::Free;
+            }
+        }
+
+        if ( bRead )
+        {
+            mFilled.notify_all();
+        }
+        else
+        {
+            // Camera is gone or not ready yet; don't spin on it.
+            this_thread::sleep_for( 10ms );
+        }
+    }
+}
+
+FFrameGrabber::FLease FFrameGrabber::WaitLatest( milliseconds Timeout )
+{
+    auto const Filled = [this]() { return find( mStates.begin(), mStates.end(), ESlot::Filled ) != mStates.end(); };
+
+    FLease             Lease;
+    unique_lock<mutex> lk( mLock );
+    if ( mFilled.wait_for( lk, Timeout, [&]() { return bStop || Filled(); } ) == false || bStop )
+    {
+        return Lease;
+    }
+
+    // Newest one is leased; older ones are not worth taking anymore.
+    size_t Newest = mFrames.size();
+    for ( size_t i = 0; i < mStates.size(); i++ )
+    {
+        if ( mStates[i] == ESlot::Filled && ( Newest == mFrames.size() || mFrames[i].Sequence > mFrames[Newest].Sequence ) )
+        {
+            Newest = i;
+        }
+    }
+    for ( size_t i = 0; i < mStates.size(); i++ )
+    {
+        if ( i != Newest && mStates[i] == ESlot::Filled )
+        {
+            mStates[i] = ESlot::Free;
+            mNumDropped++;
+        }
+    }
+
+    auto const Latency = duration<double>( steady_clock::now() - mFrames[Newest].Time ).count();
+    mLatencySeconds += Latency;
+    mMaxLatency = max( mMaxLatency, Latency );
+    mNumTaken++;
+
+    mStates[Newest] = ESlot::Leased;
+    Lease.mOwner    = this;
+    Lease.mFrame    = &mFrames[Newest];
+    Lease.mSlot     = Newest;
+    return Lease;
+}
+
+void FFrameGrabber::release( size_t Slot ) noexcept
+{
+    lock_guard<mutex> lk( mLock );
+    mStates[Slot] = ESlot::Free;
+}
+
+FGrabberStat FFrameGrabber::Stat() const
+{
+    lock_guard<mutex> lk( mLock );
+    FGrabberStat      Out;
+    Out.NumGrabbed    = mNumGrabbed;
+    Out.NumTaken      = mNumTaken;
+    Out.NumDropped    = mNumDropped;
+    Out.MeanReadMs    = mNumGrabbed ? mReadSeconds * 1e3 / mNumGrabbed : 0;
+    Out.MeanLatencyMs = mNumTaken ? mLatencySeconds * 1e3 / mNumTaken : 0;
+    Out.MaxLatencyMs  = mMaxLatency * 1e3;
+    return Out;
+}
+
+string FFrameGrabber::Format() const
+{
+    auto const S = Stat();
+    char       Buf[160];
+    snprintf(
+      Buf,
+      sizeof Buf,
+      "capture: %llu grabbed, %llu dropped, read %.1f ms, latency %.1f ms (max %.1f ms)",
+      (unsigned long long)S.NumGrabbed,
+      (unsigned long long)S.NumDropped,
+      S.MeanReadMs,
+      S.MeanLatencyMs,
+      S.MaxLatencyMs );
+    return Buf;
+}
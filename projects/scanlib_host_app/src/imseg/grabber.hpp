@@ -0,0 +1,114 @@
+//! @file       grabber.hpp
+//! @brief      Camera acquisition thread of imseg
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//!             A thread reads the camera as fast as it delivers into a ring
+//!             of preallocated slots, each stamped with the time its read
+//!             finished. Consumers lease the newest slot; the lease shares
+//!             the slot's buffer without copy and keeps the thread off it
+//!             until released. Frames overwritten or skipped before anyone
+//!             took them count as dropped. Leases must be released before
+//!             the grabber is destroyed.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FGrabbedFrame
+{
+    cv::Mat                               Image;
+    std::chrono::steady_clock::time_point Time;     //!< When read finished
+    uint64_t                              Sequence; //!< Of frames read
+};
+
+struct FGrabberStat
+{
+    uint64_t NumGrabbed    = 0;
+    uint64_t NumTaken      = 0;
+    uint64_t NumDropped    = 0; //!< Read but never taken
+    double   MeanReadMs    = 0; //!< Time a read blocks on the camera
+    double   MeanLatencyMs = 0; //!< From read finish to lease
+    double   MaxLatencyMs  = 0;
+};
+
+class FFrameGrabber
+{
+public:
+    //! Move-only hold on a slot. Released on destruction.
+    class FLease
+    {
+    public:
+        FLease() noexcept = default;
+        FLease( FLease&& o ) noexcept { *this = std::move( o ); }
+        FLease& operator=( FLease&& o ) noexcept;
+        ~FLease() { Release(); }
+
+        void Release() noexcept;
+
+        explicit             operator bool() const noexcept { return mOwner != nullptr; }
+        FGrabbedFrame const& operator*() const noexcept { return *mFrame; }
+        FGrabbedFrame const* operator->() const noexcept { return mFrame; }
+
+    private:
+        friend class FFrameGrabber;
+        FFrameGrabber*       mOwner = nullptr;
+        FGrabbedFrame const* mFrame = nullptr;
+        size_t               mSlot  = 0;
+    };
+
+public:
+    ~FFrameGrabber() { Stop(); }
+
+    //! @brief      Start reading. Video must stay open until Stop().
+    //! @param      NumSlots: Frames held by consumers at once, plus two for
+    //!             the thread to write into.
+    bool Start( cv::VideoCapture& Video, size_t NumSlots );
+
+    //! @brief      Stop reading. Leases stay valid.
+    void Stop();
+
+    //! @brief      Lease newest frame not taken yet. Older ones are dropped.
+    //! @returns    Empty lease if there's no new frame within Timeout, or the
+    //!             grabber is stopped.
+    FLease WaitLatest( std::chrono::milliseconds Timeout );
+
+    FGrabberStat Stat() const;
+
+    //! @brief      e.g. "capture: 302 grabbed, 4 dropped, read 31.2 ms,
+    //!             latency 1.4 ms (max 12.0 ms)"
+    std::string Format() const;
+
+private:
+    enum class ESlot
+    {
+        Free,
+        Writing,
+        Filled,
+        Leased
+    };
+
+    void captureThread() noexcept;
+    void release( size_t Slot ) noexcept;
+
+private:
+    cv::VideoCapture*          mVideo = nullptr;
+    std::thread                mThread;
+    std::atomic_bool           bStop = false;
+    mutable std::mutex         mLock;
+    std::condition_variable    mFilled;
+    std::vector<FGrabbedFrame> mFrames; //!< Written by the thread only while Writing
+    std::vector<ESlot>         mStates;
+    uint64_t                   mNumGrabbed = 0, mNumTaken = 0, mNumDropped = 0;
+    double                     mReadSeconds = 0, mLatencySeconds = 0, mMaxLatency = 0;
+};
@@ -0,0 +1,35 @@
+//! @file       imseg.hpp
+//! @brief      Shared declarations of imseg
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#pragma once
+#include <gflags/gflags.h>
+#include "superpixel.hpp"
+
+DECLARE_int32( desired_pixel_cnt );
+DECLARE_double( slic_compactness );
+DECLARE_int32( desired_superpixel_cnt );
+DECLARE_string( superpixel_backend );
+DECLARE_int32( slic_iterations );
+DECLARE_bool( slic_zero );
+DECLARE_string( bench );
+DECLARE_string( bench_completion );
+
+//! @brief      Superpixel parameters from flags.
+FSuperpixelParam MakeSuperpixelParam();
+
+//! @brief      Runs every built-in backend over the images listed in
+//!             --bench, then prints CSV of timing and boundary recall.
+int RunSuperpixelBenchmark();
+
+//! @brief      Completes label filled depth map along the color frame.
+//! @param      Method: "guided" or "bilateral", as --depth_completion.
+//! @param      Weight: CV_32F confidence of Depth. Empty to weigh equally.
+cv::Mat CompleteDepth( std::string const& Method, cv::Mat const& Frame, cv::Mat const& Depth, cv::Mat const& Weight );
+
+//! @brief      Compares depth completion methods over the images listed in
+//!             --bench_completion, then prints CSV of timing and error.
+int RunCompletionBenchmark();
@@ -0,0 +1,103 @@
+//! @file       replay.cpp
+//! @brief      Recorded camera frames for offline runs
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "replay.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <sstream>
+#include "imseg.hpp"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static string LowerExtension( fs::path const& Path )
+{
+    auto Ext = Path.extension().string();
+    transform( Ext.begin(), Ext.end(), Ext.begin(), []( unsigned char c ) { return char( tolower( c ) ); } );
+    return Ext;
+}
+
+vector<string> ExpandPathList( string const& List, vector<string> const& Extensions )
+{
+    vector<string> Out;
+    istringstream  ss( List );
+    for ( string Token; getline( ss, Token, ',' ); )
+    {
+        if ( Token.empty() )
+        {
+            continue;
+        }
+
+        error_code ec;
+        if ( !fs::is_directory( Token, ec ) )
+        {
+            Out.emplace_back( std::move( Token ) );
+            continue;
+        }
+
+        vector<string> Files;
+        for ( auto& Entry : fs::directory_iterator( Token, ec ) )
+        {
+            auto const Ext = LowerExtension( Entry.path() );
+            if ( Entry.is_regular_file() && find( Extensions.begin(), Extensions.end(), Ext ) != Extensions.end() )
+            {
+                Files.push_back( Entry.path().string() );
+            }
+        }
+        sort( Files.begin(), Files.end() );
+        Out.insert( Out.end(), Files.begin(), Files.end() );
+    }
+    return Out;
+}
+
+bool FFrameSequence::Open( string const& Source )
+{
+    mPaths = ExpandPathList( Source, { ".png", ".jpg", ".jpeg", ".bmp", ".tif", ".tiff", ".avi", ".mp4", ".mkv", ".mov" } );
+    mNext  = 0;
+    mVideo.release();
+    return !mPaths.empty();
+}
+
+bool FFrameSequence::Read( cv::Mat& Out )
+{
+    cv::Mat Raw;
+    while ( Raw.empty() )
+    {
+        // Continue current video, if any
+        if ( mVideo.isOpened() && mVideo.read( Raw ) )
+        {
+            break;
+        }
+        mVideo.release();
+
+        if ( mNext >= mPaths.size() )
+        {
+            return false;
+        }
+
+        auto const& Path = mPaths[mNext++];
+        if ( cv::haveImageReader( Path ) )
+        {
+            Raw = cv::imread( Path, cv::IMREAD_COLOR );
+        }
+        else
+        {
+            mVideo.open( Path );
+        }
+    }
+
+    // Scaled into a new buffer; VideoCapture reuses the one it decoded into.
+    auto const Scale = sqrt( double( FLAGS_desired_pixel_cnt ) / Raw.total() );
+    auto const Size  = cv::Size( max( 1, int( Raw.cols * Scale ) ), max( 1, int( Raw.rows * Scale ) ) );
+    cv::Mat    Scaled;
+    cv::resize( Raw, Scaled, Size, 0, 0, Scale < 1 ? cv::INTER_AREA : cv::INTER_LINEAR );
+    Out = Scaled;
+    return true;
+}
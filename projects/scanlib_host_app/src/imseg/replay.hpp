@@ -0,0 +1,40 @@
+//! @file       replay.hpp
+//! @brief      Recorded camera frames for offline runs
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//!             A source is a comma separated list of images, directories of
+//!             images(read in name order) and video files. Frames are scaled
+//!             to --desired_pixel_cnt as camera frames are.
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <string>
+#include <vector>
+
+class FFrameSequence
+{
+public:
+    //! @returns    false if nothing readable is listed.
+    bool Open( std::string const& Source );
+
+    //! @brief      Next frame. Out always gets its own buffer, thus frames
+    //!             read earlier may be kept.
+    //! @returns    false at the end of the sequence.
+    bool Read( cv::Mat& Out );
+
+    //! @brief      Paths listed, directories expanded
+    std::vector<std::string> const& Paths() const noexcept { return mPaths; }
+
+private:
+    std::vector<std::string> mPaths;
+    size_t                   mNext = 0;
+    cv::VideoCapture         mVideo; //!< Opened while a video is being read
+};
+
+//! @brief      Expand comma separated list of files and directories.
+//! @param      Extensions: Lower case, with dot. Files of directories not
+//!             matching any are skipped; listed files are always taken.
+std::vector<std::string> ExpandPathList( std::string const& List, std::vector<std::string> const& Extensions );
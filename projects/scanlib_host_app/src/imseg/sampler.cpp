@@ -0,0 +1,199 @@
+//! @file       sampler.cpp
+//! @brief      Depth point sources of imseg
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//!             Replay maps motor steps back to pixels of the recorded frame
+//!             through the pinhole model of an ideally mounted sensor; sensor
+//!             calibration of the projection is not undone.
+#include "sampler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <opencv2/core/utils/logger.hpp>
+#include <scanlib/arch/utility.hpp>
+#include <scanlib/core/scanner_protocol_handler.hpp>
+#include <scanlib/core/scanner_utils.h>
+#include <scanlib/utility/mapped_file.hpp>
+
+using namespace std;
+
+/////////////////////////////////////////////////////////////////////////////
+// DepScan device
+class FScannerSampler : public IDepthSampler
+{
+public:
+    FScannerSampler( FScannerProtocolHandler& Scan, FScannerSamplerParam const& Param )
+        : mScan( Scan )
+        , mParam( Param )
+    {
+    }
+
+    char const* Name() const noexcept override { return "scanner"; }
+
+    bool Open() override
+    {
+        bValid       = false;
+        mScan.Logger = []( auto str ) { std::cout << str; };
+
+        if ( API_RefreshScannerControl( mScan ) == false )
+        {
+            CV_LOG_WARNING( nullptr, "No DepScan device found" );
+            return false;
+        }
+
+        CV_LOG_INFO( nullptr, "Successful connected to DepScan device" );
+        if ( mScan.Report( 1000 ) == false )
+        {
+            CV_LOG_ERROR( nullptr, "Report failed" );
+            mScan.Shutdown();
+            return false;
+        }
+
+        CV_LOG_INFO( nullptr, "Successfully received report." );
+        mScan.StopCapture();
+        mScan.SetMotorAcceleration( mParam.XAccel, mParam.YAccel );
+        mScan.SetMotorDriveClockSpeed( mParam.DriveClock );
+        mScan.ConfigSensorDelay( mParam.SampleDelayUs );
+        mScan.ConfigSensorDistMode( false );
+        mScan.InitPointMode();
+        mScan.QueuePoint( 0, 0, 0 );
+
+        CV_LOG_INFO( nullptr, "Successfully initialized point mode." );
+        bValid = true;
+        return true;
+    }
+
+    bool IsOpen() const noexcept override { return bValid && mScan.IsConnected(); }
+    void Close() noexcept override { bValid = false; }
+
+    void DegreePerStep( float& X, float& Y ) const noexcept override
+    {
+        auto const Stat = mScan.GetDeviceStatus();
+        X               = Stat.DegreePerStepX;
+        Y               = Stat.DegreePerStepY;
+    }
+
+    void SetCallback( callback_type Callback ) override { mScan.SetPointCallback( std::move( Callback ) ); }
+    bool Queue( FPointReq const& Req, std::chrono::milliseconds Timeout ) override
+    {
+        return mScan.QueuePoint( Req.ID, Req.X, Req.Y, Timeout );
+    }
+    size_t NumPending() const noexcept override { return mScan.GetPendingPointRequestCount(); }
+    bool   WaitAll( std::chrono::milliseconds Timeout ) override { return mScan.WaitPointRequests( Timeout ); }
+    bool   Home() override { return mScan.QueuePoint( 0, 0, 0, HOME_TIMEOUT ); }
+
+private:
+    static constexpr std::chrono::milliseconds HOME_TIMEOUT { 1000 };
+
+    FScannerProtocolHandler& mScan;
+    FScannerSamplerParam     mParam;
+    bool                     bValid = false;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Recorded dpta frames
+class FReplaySampler : public IDepthSampler
+{
+public:
+    FReplaySampler( FReplaySamplerParam const& Param )
+        : mParam( Param )
+    {
+    }
+
+    char const* Name() const noexcept override { return "replay"; }
+
+    bool Open() override
+    {
+        mFrames.clear();
+        for ( auto& Path : mParam.Files )
+        {
+            FFrame Frame;
+            if ( Frame.File.Open( Path.c_str() ) == false
+                 || ScanDataParse( Frame.File.Data(), Frame.File.Size(), &Frame.Pixels, &Frame.Header ) == false )
+            {
+                CV_LOG_ERROR( nullptr, "Failed to load replay depth " << Path );
+                mFrames.clear();
+                return false;
+            }
+            mFrames.emplace_back( std::move( Frame ) );
+        }
+        mCurrent = 0;
+        return !mFrames.empty();
+    }
+
+    bool IsOpen() const noexcept override { return !mFrames.empty(); }
+    void Close() noexcept override { }
+
+    void BeginFrame( size_t FrameIndex ) override
+    {
+        mCurrent = mFrames.empty() ? 0 : FrameIndex % mFrames.size();
+    }
+
+    void DegreePerStep( float& X, float& Y ) const noexcept override
+    {
+        X = Y = mParam.DegreePerStep;
+    }
+
+    void SetCallback( callback_type Callback ) override { mCallback = std::move( Callback ); }
+
+    // Answers right away; there's no device to wait for.
+    bool Queue( FPointReq const& Req, std::chrono::milliseconds ) override
+    {
+        constexpr float DTOR   = 3.14159265f / 180.f;
+        auto const      AngleX = Req.X * mParam.DegreePerStep;
+        auto const      AngleY = Req.Y * mParam.DegreePerStep;
+        FPointData      Point {};
+        Point.ID = Req.ID;
+
+        auto const& Frame = mFrames[mCurrent];
+        auto const  W = int( Frame.Header.WIDTH ), H = int( Frame.Header.HEIGHT );
+        auto const  xo = tanf( AngleX * DTOR ) / ( 2.f * tanf( mParam.HorizontalFov * DTOR * 0.5f ) );
+        auto const  yo = tanf( AngleY * DTOR ) / ( 2.f * tanf( mParam.VerticalFov * DTOR * 0.5f ) );
+        auto const  x = int( floorf( ( xo + 0.5f ) * W ) ), y = int( floorf( ( yo + 0.5f ) * H ) );
+        if ( x >= 0 && x < W && y >= 0 && y < H )
+        {
+            auto const& Pixel = Frame.Pixels[size_t( y ) * W + x];
+            Point.V.Distance  = Pixel.Q9_22_DEPTH;
+            Point.V.AMP       = Pixel.UQ_12_4_AMP;
+        }
+
+        if ( mCallback )
+        {
+            mCallback( Point );
+        }
+        return true;
+    }
+
+    size_t NumPending() const noexcept override { return 0; }
+    bool   WaitAll( std::chrono::milliseconds ) override { return true; }
+    bool   Home() override { return true; }
+
+private:
+    struct FFrame
+    {
+        FMappedFile              File;
+        ScanDataPixelType const* Pixels = {};
+        ScanDataHeaderType       Header = {};
+    };
+
+private:
+    FReplaySamplerParam mParam;
+    vector<FFrame>      mFrames;
+    size_t              mCurrent = 0;
+    callback_type       mCallback;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// Factory
+std::unique_ptr<IDepthSampler> IDepthSampler::CreateScanner( FScannerProtocolHandler& Scan, FScannerSamplerParam const& Param )
+{
+    return make_unique<FScannerSampler>( Scan, Param );
+}
+
+std::unique_ptr<IDepthSampler> IDepthSampler::CreateReplay( FReplaySamplerParam const& Param )
+{
+    return make_unique<FReplaySampler>( Param );
+}
@@ -0,0 +1,82 @@
+//! @file       sampler.hpp
+//! @brief      Depth point sources of imseg
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//!             Sampling stage only sees IDepthSampler. The scanner sampler
+//!             drives a DepScan device; the replay sampler answers the same
+//!             requests from recorded dpta frames, thus the pipeline runs
+//!             without any device attached.
+#pragma once
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <scanlib/common/scanner_protocol.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class FScannerProtocolHandler;
+
+struct FScannerSamplerParam
+{
+    int XAccel        = 32400;  //!< Hz/s
+    int YAccel        = 544800; //!< Hz/s
+    int DriveClock    = 52400;  //!< Hz
+    int SampleDelayUs = 6000;
+};
+
+struct FReplaySamplerParam
+{
+    std::vector<std::string> Files;                   //!< dpta frames; frame i answers from Files[i % size]
+    float                    HorizontalFov = 78.f;    //!< Degrees the frames cover
+    float                    VerticalFov   = 49.f;
+    float                    DegreePerStep = 0.1125f; //!< Reported for path planning
+};
+
+class IDepthSampler
+{
+public:
+    using callback_type = std::function<void( FPointData const& )>;
+
+public:
+    virtual ~IDepthSampler() = default;
+
+    virtual char const* Name() const noexcept = 0;
+
+    //! @brief      Connect and configure. Called again after Close().
+    virtual bool Open()                  = 0;
+    virtual bool IsOpen() const noexcept = 0;
+    virtual void Close() noexcept        = 0;
+
+    //! @brief      Frame the following requests belong to.
+    virtual void BeginFrame( size_t FrameIndex ) { }
+
+    //! @brief      Degrees per motor step of each axis.
+    virtual void DegreePerStep( float& X, float& Y ) const noexcept = 0;
+
+    //! @brief      Callback of each result. May be called from another thread,
+    //!             or from within Queue().
+    virtual void SetCallback( callback_type Callback ) = 0;
+
+    //! @brief      Request depth at motor step. Blocks while the device has no
+    //!             room for more requests.
+    //! @param      Timeout: Gives up once no request has been answered for
+    //!             this long.
+    //! @returns    false on timeout or lost device.
+    virtual bool   Queue( FPointReq const& Req, std::chrono::milliseconds Timeout ) = 0;
+    virtual size_t NumPending() const noexcept                                      = 0;
+
+    //! @brief      Block until every queued request is answered.
+    //! @returns    false on timeout or lost device.
+    virtual bool WaitAll( std::chrono::milliseconds Timeout ) = 0;
+
+    //! @brief      Move sensor back to origin.
+    virtual bool Home() = 0;
+
+    static std::unique_ptr<IDepthSampler> CreateScanner( FScannerProtocolHandler& Scan, FScannerSamplerParam const& Param );
+    static std::unique_ptr<IDepthSampler> CreateReplay( FReplaySamplerParam const& Param );
+};
@@ -0,0 +1,118 @@
+//! @file       superpixel.cpp
+//! @brief      Superpixel segmentation backends of imseg
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//!             Iteration count and SLIC-zero only apply to CPU backend;
+//!             SlicCuda has its own.
+#include "superpixel.hpp"
+#include <scanlib/segment/slic.hpp>
+
+#ifdef IMSEG_WITH_CUDA
+#include <SlicCudaHost.h>
+#endif
+
+using namespace std;
+
+/////////////////////////////////////////////////////////////////////////////
+// CPU backend
+class FCpuSlicBackend : public ISuperpixelBackend
+{
+public:
+    FCpuSlicBackend( FSuperpixelParam const& Param )
+    {
+        mParam.NumSuperpixels = Param.NumSuperpixels;
+        mParam.Compactness    = Param.Compactness;
+        mParam.NumIterations  = Param.NumIterations;
+        mParam.bSlicZero      = Param.bSlicZero;
+    }
+
+    char const* Name() const noexcept override { return "cpu"; }
+
+    bool Segment( cv::Mat const& Frame, cv::Mat& Labels ) override
+    {
+        if ( Frame.empty() || Frame.depth() != CV_8U )
+        {
+            return false;
+        }
+
+        Labels.create( Frame.rows, Frame.cols, CV_32S );
+        return mSlic.Segment(
+          mParam,
+          Frame.ptr<uint8_t>(),
+          Frame.cols,
+          Frame.rows,
+          Frame.channels(),
+          Frame.step,
+          Labels.ptr<int32_t>() ) > 0;
+    }
+
+private:
+    FSlicParam     mParam;
+    FSlicSegmenter mSlic;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// CUDA backend
+#ifdef IMSEG_WITH_CUDA
+class FCudaSlicBackend : public ISuperpixelBackend
+{
+public:
+    FCudaSlicBackend( FSuperpixelParam const& Param ) : mParam( Param ) { }
+
+    char const* Name() const noexcept override { return "cuda"; }
+
+    bool Segment( cv::Mat const& Frame, cv::Mat& Labels ) override
+    {
+        if ( Frame.empty() )
+        {
+            return false;
+        }
+
+        // Device buffers are sized on initialization.
+        if ( Frame.size() != mFrameSize )
+        {
+            mSlic.initialize( Frame, mParam.NumSuperpixels, SlicCuda::SLIC_NSPX, mParam.Compactness );
+            mFrameSize = Frame.size();
+        }
+
+        mSlic.segment( Frame );
+        mSlic.enforceConnectivity();
+        mSlic.getLabels().convertTo( Labels, CV_32S );
+        return true;
+    }
+
+private:
+    FSuperpixelParam mParam;
+    SlicCuda         mSlic;
+    cv::Size         mFrameSize;
+};
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+// Factory
+std::unique_ptr<ISuperpixelBackend> ISuperpixelBackend::Create( std::string const& Name, FSuperpixelParam const& Param )
+{
+    if ( Name == "cpu" )
+    {
+        return make_unique<FCpuSlicBackend>( Param );
+    }
+#ifdef IMSEG_WITH_CUDA
+    if ( Name == "cuda" )
+    {
+        return make_unique<FCudaSlicBackend>( Param );
+    }
+#endif
+    return nullptr;
+}
+
+char const* ISuperpixelBackend::DefaultName() noexcept
+{
+#ifdef IMSEG_WITH_CUDA
+    return "cuda";
+#else
+    return "cpu";
+#endif
+}
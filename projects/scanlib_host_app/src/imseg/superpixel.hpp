@@ -0,0 +1,45 @@
+//! @file       superpixel.hpp
+//! @brief      Superpixel segmentation backends of imseg
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//!             CaptureDepthImage only sees ISuperpixelBackend. CPU backend is
+//!             always available; CUDA backend is compiled in only when
+//!             configured with CUDA(IMSEG_WITH_CUDA).
+#pragma once
+#include <memory>
+#include <opencv2/core.hpp>
+#include <string>
+
+struct FSuperpixelParam
+{
+    int   NumSuperpixels = 3000;
+    float Compactness    = 65.f;
+    int   NumIterations  = 10;
+    bool  bSlicZero      = false; //!< CPU only. Adapts compactness per superpixel
+};
+
+class ISuperpixelBackend
+{
+public:
+    virtual ~ISuperpixelBackend() = default;
+
+    virtual char const* Name() const noexcept = 0;
+
+    //! @brief      Segment a BGR frame.
+    //! @param      Labels: CV_32S labels, contiguous from 0. Every superpixel
+    //!             is connected.
+    //!             Labels are counted by FSuperpixelStats, which needs a
+    //!             sweep over the image anyway.
+    //! @returns    false on failure.
+    virtual bool Segment( cv::Mat const& Frame, cv::Mat& Labels ) = 0;
+
+    //! @brief      Create backend by name; "cpu" or "cuda".
+    //! @returns    nullptr if the backend is unknown or not built in.
+    static std::unique_ptr<ISuperpixelBackend> Create( std::string const& Name, FSuperpixelParam const& Param );
+
+    //! @brief      Backend used when nothing is specified.
+    static char const* DefaultName() noexcept;
+};
@@ -19,6 +19,7 @@ using namespace std;
 DEFINE_bool( no_gui, false, "Disables GUI mode" );
 DEFINE_bool( show_console, false, "Hide console window printing log" );
 DEFINE_string( config_path, "", "Specify configuration path" );
+DEFINE_int32( history_budget_mb, 256, "Memory budget of compressed capture history in megabytes" );
 
 int gui_app( int argc, char** argv );
 int gui_view_app( int argc, char** argv );
@@ -21,12 +21,12 @@ void InitConsoleApp()
               "%20.17f\n", args.CData()[i].Distance / double( Q9_22_ONE_INT ) );
         }
     };
-    scan.OnPointRecv = []( const FPointData& data ) {
+    scan.SetPointCallback( []( const FPointData& data ) {
         printf(
           ":: RECV POINT DATA [ %08x ] :: %20.17f\n",
           data.ID,
           data.V.Distance / double( Q9_22_ONE_INT ) );
-    };
+    } );
     scan.OnReport = []( const FDeviceStat& Stat ) {
         char buf[2048];
         double progress = !Stat.bIsIdle * 100.0 * ( ( Stat.CurMotorStepY - Stat.OfstY ) / (double) ( Stat.SizeY * Stat.StepPerPxlY ) );
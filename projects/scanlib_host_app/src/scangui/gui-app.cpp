@@ -9,11 +9,16 @@
 #include <cmath>
 #include <filesystem>
 #include <fstream>
+#include <gflags/gflags.h>
 #include <nana/gui.hpp>
 #include <nana/gui/widgets/button.hpp>
 #include <nana/gui/widgets/label.hpp>
 #include <scanlib/core/scanner_utils.h>
+#include <scanlib/render/preview_renderer.hpp>
+#include <scanlib/utility/png_writer.hpp>
+#include <scanlib/utility/thread_pool.hpp>
 #include <sstream>#include <strstream>
+#include <string.h>
 
 using cbool = bool const;
 using namespace nana;
@@ -26,10 +31,13 @@ constexpr size_t countof( arg_ ( & )[n_] )
     return n_;
 }
 
+DECLARE_int32( history_budget_mb );
+
 int gui_app( int argc, char** argv )
 {
     FScannerProtocolHandler Scanner;
     ScannerMainForm         fm( &Scanner );
+    fm.HistoryBudget( size_t( max( 1, FLAGS_history_budget_mb ) ) << 20 );
     fm.show();
     exec();
     return 0;
@@ -52,6 +60,10 @@ int gui_view_app( int argc, char** argv )
             auto& fm   = *forms.emplace_back( make_unique<form>() );
             auto  desc = FScanImageDesc( f.WIDTH, f.HEIGHT, f.ASPECT_RATIO, (FPxlData*)p );
             auto& vp   = *widgets.emplace_back( make_unique<ScannerViewerWidget>( fm, std::move( desc ) ) );
+            if ( FScanPyramid pyr; pyr.ReadFrom( fs ) )
+            {
+                vp.AdoptPyramid( std::move( pyr ) );
+            }
             fm.div( "vert margin=10<weight=10><<weight=10><ALL><weight=10>><weight=10>" );
             fm["ALL"] << vp;
             fm.caption( argv[i] );
@@ -71,6 +83,7 @@ int gui_view_app( int argc, char** argv )
 
 ScannerMainForm::ScannerMainForm( FScannerProtocolHandler* Scanner, std::string const& fontName )
     : form( API::make_center( 1024, 1024 ) )
+    , bFileSavePyramid( false )
     , bEnableAutoRestart( false )
     , bInStartMode( false )
 
@@ -277,11 +290,14 @@ ScannerMainForm::ScannerMainForm( FScannerProtocolHandler* Scanner, std::string
         ops.append( "Send test signal", [this]( auto proxy ) { mScan->Test(); } );
 
         file.append( "Save Complete Image As...", [this]( auto ) { OpenSaveAs(); } );
+        file.append( "Export Colorized Image As...", [this]( auto ) { OpenExportPreview(); } );
         file.append( "Open Depth Map File ...", [this]( auto ) { OpenDepthMapFile(); } );
         file.append_splitter();
         file.append( "Set autosave path...", [this]( auto ) { SetAutosavePath(); } );
         file.append( "Auto save when capture done", [this]( auto proxy ) { bFileEnableAutosave = proxy.checked(); } )
           .check_style( menu::checks::highlight );
+        file.append( "Store pyramid with saved image", [this]( auto proxy ) { bFileSavePyramid = proxy.checked(); } )
+          .check_style( menu::checks::highlight );
         file.append_splitter();
         file.append( "Exit", [this]( auto proxy ) { this->close(); } );
     }
@@ -297,7 +313,14 @@ ScannerMainForm::ScannerMainForm( FScannerProtocolHandler* Scanner, std::string
         case SCANLIB_ASCIIVAL_ENTER:
         {
             auto cmd = mMenualCommand.text();
-            mScan->SendString( cmd.c_str() );
+            if ( cmd.size() && cmd[0] == ':' )
+            {
+                RunConsoleCommand( cmd );
+            }
+            else
+            {
+                mScan->SendString( cmd.c_str() );
+            }
             mMenualCommand.reset();
             if ( mCommandHistory.size() >= NumMaxCommandHistory )
             {
@@ -362,33 +385,13 @@ void ScannerMainForm::BindScanner( FScannerProtocolHandler* scanRef )
 {
     //! @todo.
     mScan                = scanRef;
+    mScan->bBuildPyramid = true;
+    mScan->bBuildHistogram = true;
     mScan->OnReport      = [this]( auto rep ) { this->OnUpdateReport( rep ); };
-    mScan->OnReceiveLine = [this]( auto rep ) { this->OnUpdateImage( rep ); };
+    mScan->OnReceiveLine = [this]( auto& rep, auto& line ) { this->OnUpdateImage( rep, line ); };
     mScan->OnFinishScan  = [this]( auto rep ) { this->OnScannerCaptureDone( rep ); };
-    mScan->Logger        = [this]( auto str ) {
-        enum
-        {
-            LINE_CLEAR_THRESHOLD = 150,
-            LINE_LEFT_DIVIDER    = 2
-        };
-        if ( mReport.text_line_count() > LINE_CLEAR_THRESHOLD )
-        {
-            auto   cpy      = mReport.text();
-            size_t inv_ofst = cpy.size();
-            auto   riter    = cpy.crbegin();
-            for ( size_t i = 0, length = LINE_CLEAR_THRESHOLD / 4;
-                  i < length;
-                  ++riter, --inv_ofst )
-            {
-                if ( *riter == '\n' )
-                {
-                    ++i;
-                }
-            }
-            mReport.reset( cpy.substr( cpy.size() - inv_ofst ) );
-        }
-        mReport.append( str, true );
-    };
+    // Called from any thread, including protocol reader; must not touch GUI.
+    mScan->Logger = [this]( auto str ) { mLogRing.Push( str ); };
 }
 void ScannerMainForm::UpdateImageHistoryBox( size_t newval )
 {
@@ -399,11 +402,8 @@ void ScannerMainForm::UpdateImageHistoryBox( size_t newval )
 
 FScanImageDesc const& ScannerMainForm::GetViewingImage() const
 {
-    if ( mCapturedImage.empty() )
-    {
-        return {};
-    }
-    return *( mCapturedImage.end() - std::max( size_t( 1 ), mViewImgIndex ) );
+    static FScanImageDesc const empty;
+    return mViewingFrame ? *mViewingFrame : empty;
 }
 
 void ScannerMainForm::OnScannerCaptureDone( FScanImageDesc const& desc )
@@ -413,12 +413,8 @@ void ScannerMainForm::OnScannerCaptureDone( FScanImageDesc const& desc )
         return;
     }
 
-    if ( mCapturedImage.size() >= mNumMaxImageHistory )
-    {
-        mCapturedImage.pop_front();
-    }
-    mCapturedImage.emplace_back( desc.Clone() );
-    UpdateImageHistoryBox( std::min( mCapturedImage.size(), mNumMaxImageHistory ) );
+    mHistory.Push( desc );
+    UpdateImageHistoryBox( mHistory.Size() );
 
     // Write images to auto save path
     // File name is yyyy-mm-dd-hh-mm-ss-s.dpta
@@ -442,8 +438,9 @@ void ScannerMainForm::OnScannerCaptureDone( FScanImageDesc const& desc )
         ws << std::setfill( L'0' ) << std::setw( 2 ) << t.tm_sec;
         ws << '.' << SCAN_DATA_FORMAT_EXTENSION;
 
+        // Pyramid built while scanning is written as is.
         print( "Saving file as %S ... \n", ws.str().c_str() );
-        SaveCurrentImage( desc, ws.str().c_str() );
+        SaveCurrentImage( desc, ws.str().c_str(), mScan->GetCompletePyramid().get() );
     }
 
     // Update image for case not viewing scanning image
@@ -500,176 +497,127 @@ void ScannerMainForm::OnUpdateReport( FDeviceStat const& Stat )
     mStatusText = buf;
 }
 
-void ScannerMainForm::OnUpdateImage( FScanImageDesc const& desc )
+void ScannerMainForm::OnUpdateImage( FScanImageDesc const& desc, FLineDesc const& line )
 {
     //! Update GUI
-    if ( mViewImgIndex && !mCapturedImage.empty() )
+    if ( mViewImgIndex && mHistory.Size() )
     {
         return;
     }
 
-    mViewport.ReplaceDesc( desc );
+    mViewport.UpdateLine( desc, line, mScan->GetScanningPyramid(), mScan->GetScanningHistogram().get() );
 }
 
-static void Internal_RenderImage(
-  FScanImageDesc const&                      desc,
-  function<float( FPxlData )>                calc_H,
-  function<void( float H, color& out )>      calc_col,
-  function<void( int i, int j, color& out )> set_pixel,
-  int                                        HorizontalCalib );
-
-void ScannerViewerWidget::RenderImage(
-  FScanImageDesc const&  desc,
-  nana::paint::graphics& gp,
-  bool                   bRenderAmp,
-  float                  MaxDistance,
-  float                  MinDistance,
-  int                    HorizontalCalib,
-  ColorMappingMode       ColorMode,
-  void*                  CacheBuff )
+static bool IsSameParam( FColorizeParam const& a, FColorizeParam const& b )
+{
+    return a.Mode == b.Mode
+           && a.Source == b.Source
+           && a.MinDistance == b.MinDistance
+           && a.MaxDistance == b.MaxDistance
+           && a.HorizontalCalib == b.HorizontalCalib
+           && a.MinAmplitude == b.MinAmplitude
+           && a.MaxAmplitude == b.MaxAmplitude;
+}
+
+bool ScannerViewerWidget::UploadImage(
+  uint32_t*              Argb,
+  int                    Width,
+  int                    Height,
+  int                    RowBegin,
+  int                    RowEnd,
+  int                    ColBegin,
+  int                    ColEnd,
+  nana::paint::graphics& gp )
 {
     //! Reserve buffer if size is not sufficient
-    if ( desc.Width == 0 || desc.Height == 0 )
+    if ( Width == 0 || Height == 0 )
     {
-        return;
+        return false;
     }
-    if ( gp.size().width != desc.Width || gp.size().height != desc.Height )
+    bool bWhole = false;
+    if ( gp.size().width != (uint32_t)Width || gp.size().height != (uint32_t)Height )
     {
-        gp.resize( { (uint32_t)desc.Width, (uint32_t)desc.Height } );
+        gp.resize( { (uint32_t)Width, (uint32_t)Height } );
+        RowBegin = ColBegin = 0;
+        RowEnd              = Height;
+        ColEnd              = Width;
+        bWhole              = true;
     }
 
-    // Setup callbacks
-    function<float( FPxlData )> calc_H;
-    if ( bRenderAmp == false )
+    RowBegin = max( 0, RowBegin );
+    RowEnd   = min( Height, RowEnd );
+    ColBegin = max( 0, ColBegin );
+    ColEnd   = min( Width, ColEnd );
+    if ( RowBegin >= RowEnd || ColBegin >= ColEnd )
     {
-        calc_H = [MaxDistance, MinDistance, desc]( FPxlData d ) {
-            return (float)( d.Distance / (float)(Q9_22_ONE_INT)-MinDistance ) / ( MaxDistance - MinDistance );
-        };
-    }
-    else
-    {
-        calc_H = []( FPxlData d ) {
-            return d.AMP / (float)( UQ12_4_ONE_INT * ( 1 << 12 ) );
-        };
+        return false;
     }
-    function<void( float H, color& out )> calc_col;
 
-    switch ( ColorMode )
+    // Bitmap is replaced as a whole; pixels never colorized are out of view.
+    if ( API_MappToRGB( (intptr_t)gp.context(), []( void* ) {}, Argb ) )
     {
-    case ScannerViewerWidget::ColorMappingMode::WTOK:
-        calc_col =
-          []( float H, color& out ) {
-              H          = clamp( H, 0.f, 1.f );
-              auto ratio = H * 3.f;
-              auto b     = unsigned( clamp( 255.f * ( 1.f - ratio ), 0.f, 255.5f ) );
-              auto g     = unsigned( clamp( 255.f * ( 1.f - ratio / 2.f ), 0.f, 255.5f ) );
-              auto r     = unsigned( clamp( 255.f * ( 1.f - ratio / 3.f ), 0.f, 255.5f ) );
-              out.from_rgb( r, g, b );
-          };
-        break;
-    case ScannerViewerWidget::ColorMappingMode::RAINBOW:
-        calc_col =
-          []( float H, color& out ) {
-              H          = clamp( H, 0.f, 1.f );
-              auto ratio = H * 3.f;
-
-              auto h = clamp( 1.f - ratio / 2.f, 0.f, 1.f );
-              auto s = clamp( 1.f - ratio / 3.f, 0.f, 1.f );
-              auto l = clamp( 1.f - ratio / 3.f, 0.f, 1.f );
-
-              out.from_hsl( ( h * 360.f ) - 240.f, s, l );
-          };
-        break;
-    case ScannerViewerWidget::ColorMappingMode::BGR:
-        calc_col =
-          []( float H, color& out ) {
-              H           = clamp( H, 0.f, 1.f );
-              float ratio = 2 * H;
-              auto  b     = unsigned( max( 0.f, 255.f * ( 1.f - ratio ) ) );
-              auto  r     = unsigned( max( 0.f, 255.f * ( ratio - 1.f ) ) );
-              auto  g     = 255u - b - r;
-
-              out.from_rgb( r, g, b );
-          };
-        break;
-    case ScannerViewerWidget::ColorMappingMode::GREYSCALE:
-    default:
-        calc_col = []( float H, color& out ) { H = 1.0f - clamp(H, 0.0f, 1.0f); out.from_rgb((int) ( H * 255 ), (int) ( H * 255 ), (int) ( H * 255 )); };
-        break;
+        gp.flush();
+        return true;
     }
 
-    auto data = desc.Data();
-    if ( CacheBuff && API_MappToRGB( (intptr_t)gp.context(),
-
-                                     [&]( void* data ) {
-                                         Internal_RenderImage(
-                                           desc,
-                                           calc_H,
-                                           calc_col,
-                                           [data, w = desc.Width, h = desc.Height]( int x, int y, color const& c ) {
-                                               uint32_t* ptr  = (uint32_t*)data;
-                                               ptr[y * w + x] = c.argb().value;
-                                           },
-                                           HorizontalCalib );
-                                     },
-                                     CacheBuff ) )
+    // No direct bitmap access; blit updated region at once.
+    paint::pixel_buffer pxbuf( ColEnd - ColBegin, RowEnd - RowBegin );
+    for ( int i = RowBegin; i < RowEnd; i++ )
     {
-        gp.flush();
-        return;
+        memcpy( pxbuf.raw_ptr( i - RowBegin ), Argb + (size_t)i * Width + ColBegin, sizeof( uint32_t ) * ( ColEnd - ColBegin ) );
     }
-
-    Internal_RenderImage(
-      desc,
-      calc_H,
-      calc_col,
-      [&gp]( int x, int y, color const& c ) { gp.set_pixel( x, y, c ); },
-      HorizontalCalib );
+    pxbuf.paste( gp.handle(), { ColBegin, RowBegin } );
 
     gp.flush();
+    return bWhole;
 }
 
-static void Internal_RenderImage(
-  FScanImageDesc const&                      desc,
-  function<float( FPxlData )>                calc_H,
-  function<void( float H, color& out )>      calc_col,
-  function<void( int x, int y, color& out )> set_pixel,
-  int                                        HorizontalCalib )
+void ScannerMainForm::AutoUpdateImage()
 {
-    //! Render image in mapped BGR format
-    color col;
-    auto  head = desc.Data();
-    for ( size_t i = 0; i < desc.Height; i++ )
+    FScanImageDesc desc;
+    if ( mViewImgIndex == 0 && mScan->GetScanningImage( desc ) )
+    {
+        mViewport.ReplaceDesc( desc, false, mScan->GetScanningPyramid(), mScan->GetScanningHistogram().get() );
+    }
+    else if ( mViewImgIndex && mHistory.Size() )
     {
-        for ( size_t j = 0; j < desc.Width; j++ )
+        // Decoding may take a while; timer shows the image once it's done.
+        mFetchingIndex = mViewImgIndex;
+        mFetchingFrame = mHistory.Fetch( mViewImgIndex - 1 );
+        ShowFetchedImage();
+
+        // Neighbours are likely to be viewed next
+        mHistory.Fetch( mViewImgIndex );
+        if ( mViewImgIndex > 1 )
         {
-            auto  pxl = *head++;
-            float H   = calc_H( pxl );
-            calc_col( H, col );
-
-            size_t jnew = j + ( bool( i & 1 ) * (int64_t)HorizontalCalib );
-            jnew        = clamp( jnew, size_t( 0 ), size_t( desc.Width - 1 ) );
-            if ( j < HorizontalCalib || j > desc.Width - HorizontalCalib )
-            {
-                set_pixel( j, i, col );
-            }
-            set_pixel( jnew, i, col );
+            mHistory.Fetch( mViewImgIndex - 2 );
         }
     }
 }
 
-void ScannerMainForm::AutoUpdateImage()
+void ScannerMainForm::ShowFetchedImage()
 {
-    FScanImageDesc desc;
-    if ( ( mViewImgIndex == 0 && mScan->GetScanningImage( desc ) ) || ( mViewImgIndex && mCapturedImage.size() && ( desc = GetViewingImage() ).CData() ) )
+    if ( !mFetchingFrame.valid() || mFetchingFrame.wait_for( 0ms ) != future_status::ready )
+    {
+        return;
+    }
+
+    auto frame = mFetchingFrame.get();
+    mFetchingFrame = {};
+    if ( frame == nullptr || frame->CData() == nullptr || mFetchingIndex != mViewImgIndex )
     {
-        mViewport.ReplaceDesc( desc );
+        return;
     }
+
+    // Viewer shares the frame's buffer without copy.
+    mViewingFrame = frame;
+    mViewport.ReplaceDesc( std::move( frame ) );
 }
 
 void ScannerMainForm::OpenSaveAs()
 {
     // Check whether there's data to save
-    if ( mCapturedImage.empty() )
+    if ( mViewingFrame == nullptr )
     {
         return;
     }
@@ -689,6 +637,40 @@ void ScannerMainForm::OpenSaveAs()
     }
 }
 
+void ScannerMainForm::OpenExportPreview()
+{
+    auto& desc = GetViewingImage();
+    if ( desc.CData() == nullptr )
+    {
+        return;
+    }
+
+    nana::filebox fb{ *this, false };
+    fb.allow_multi_select( false );
+    fb.add_filter( "PNG image (*.png)", "*.png" );
+
+    auto path = fb();
+    if ( path.empty() )
+    {
+        return;
+    }
+
+    // Same colors as the viewport, at image resolution with aspect ratio
+    // applied.
+    int w, h;
+    FPreviewRenderer::FitSize( desc.Width, desc.Height, desc.AspectRatio, max( desc.Width, desc.Height ), w, h );
+
+    FPreviewRenderer renderer;
+    vector<uint32_t> pixels( (size_t)w * h );
+    vector<uint8_t>  encoded;
+    renderer.Render( FColorizer( mViewport.ColorizeParam() ), desc.CData(), desc.Width, desc.Height, pixels.data(), w, h );
+    scanlib::PngEncode( encoded, pixels.data(), w, h, scanlib::EPngFormat::RGBA8 );
+    if ( !scanlib::PngWriteFile( path.front().string().c_str(), encoded ) )
+    {
+        print( "error: failed to write %s\n", path.front().string().c_str() );
+    }
+}
+
 void ScannerMainForm::SetAutosavePath()
 {
     nana::filebox fb{ *this, false };
@@ -742,6 +724,10 @@ void ScannerMainForm::OpenDepthMapFile()
             // New image form
             auto& frm     = *mUnnamedForms.emplace_back( make_unique<form>( *this ) );
             auto& view    = static_cast<ScannerViewerWidget&>( *mUnnamedRefs.emplace_back( make_unique<ScannerViewerWidget>( frm, desc ) ) );
+            if ( FScanPyramid pyr; pyr.ReadFrom( fs ) )
+            {
+                view.AdoptPyramid( std::move( pyr ) );
+            }
             auto  pathstr = path.string();
             frm.div( "ALL margin=15" );
             frm.size( { 800, 600 } );
@@ -754,7 +740,7 @@ void ScannerMainForm::OpenDepthMapFile()
     }
 }
 
-void ScannerMainForm::SaveCurrentImage( FScanImageDesc const& desc, wchar_t const* PATH )
+void ScannerMainForm::SaveCurrentImage( FScanImageDesc const& desc, wchar_t const* PATH, FScanPyramid const* Pyramid )
 {
     wprintf( L"Trying save file into %s...\n", PATH );
 
@@ -768,6 +754,18 @@ void ScannerMainForm::SaveCurrentImage( FScanImageDesc const& desc, wchar_t cons
 
     ScanDataWriteTo( fp, desc.CData(), desc.Width, desc.Height, desc.AspectRatio );
 
+    // Pyramid chunk follows the image, which is ignored by legacy readers.
+    if ( bFileSavePyramid )
+    {
+        FScanPyramid pyr;
+        if ( Pyramid == nullptr || Pyramid->LevelWidth( 0 ) != desc.Width || Pyramid->LevelHeight( 0 ) != desc.Height )
+        {
+            pyr.Build( desc.CData(), desc.Width, desc.Height );
+            Pyramid = &pyr;
+        }
+        Pyramid->WriteTo( fp );
+    }
+
     fclose( fp );
 }
 
@@ -862,10 +860,141 @@ void ScannerMainForm::OpenMotorDrvClkSettingDialog()
 
 void ScannerMainForm::UpdateReportText()
 {
+    mLogDrainBuf.clear();
+    if ( auto dropped = mLogRing.NumDropped(); dropped != mLogDropped )
+    {
+        mLogDrainBuf += "... " + to_string( dropped - mLogDropped ) + " log messages dropped\n";
+        mLogDropped = dropped;
+    }
+    mLogRing.Drain( mLogDrainBuf, NumMaxDrainBytes );
+    if ( mLogDrainBuf.empty() )
+    {
+        return;
+    }
+
+    // Only newly completed lines are appended to the view
+    auto const numNew   = mLogHistory.Append( mLogDrainBuf );
+    auto const numLines = mLogHistory.NumLines();
+    string     text;
+    for ( auto i = numLines - numNew; i < numLines; i++ )
+    {
+        auto& line = mLogHistory.Line( i );
+        if ( FLogHistory::Matches( line, mLogFilter ) )
+        {
+            text.append( line ).push_back( '\n' );
+            mReportLines++;
+        }
+    }
+
+    // Trim view in batches; rebuild reads bounded history only.
+    if ( mReportLines > NumMaxReportLines + NumMaxReportLines / 4 )
+    {
+        RebuildReportText();
+    }
+    else if ( text.size() )
+    {
+        mReport.append( text, false );
+        if ( mFindCursor == SIZE_MAX )
+        {
+            mReport.caret_pos( { 0, (unsigned)mReportLines } );
+        }
+    }
+}
+
+void ScannerMainForm::RebuildReportText()
+{
+    // Find first of last lines passing the filter
+    size_t begin = mLogHistory.NumLines();
+    size_t count = 0;
+    while ( begin > 0 && count < NumMaxReportLines )
+    {
+        if ( FLogHistory::Matches( mLogHistory.Line( --begin ), mLogFilter ) )
+        {
+            count++;
+        }
+    }
+
+    string text;
+    for ( auto i = begin; i < mLogHistory.NumLines(); i++ )
+    {
+        auto& line = mLogHistory.Line( i );
+        if ( FLogHistory::Matches( line, mLogFilter ) )
+        {
+            text.append( line ).push_back( '\n' );
+        }
+    }
+
+    mReportLines = count;
+    mFindCursor  = SIZE_MAX;
+    mReport.reset( text );
+    mReport.caret_pos( { 0, (unsigned)mReportLines } );
+}
+
+void ScannerMainForm::RunConsoleCommand( std::string const& cmd )
+{
+    //! Console commands:
+    //!     :filter [text]  Show lines containing text only. Empty to show all.
+    //!     :find [text]    Move to previous line containing text. Empty to
+    //!                     follow the tail again.
+    //!     :clear          Clear console.
+    auto const sep  = cmd.find( ' ' );
+    auto const name = cmd.substr( 0, sep );
+    auto const arg  = sep == string::npos ? string() : cmd.substr( sep + 1 );
+
+    if ( name == ":filter" )
+    {
+        mLogFilter = arg;
+        RebuildReportText();
+    }
+    else if ( name == ":find" )
+    {
+        auto const numLines = mLogHistory.NumLines();
+        if ( arg.empty() )
+        {
+            mFindCursor = SIZE_MAX;
+            mReport.caret_pos( { 0, (unsigned)mReportLines } );
+            return;
+        }
+
+        // Continue from last hit, wrapping around the tail.
+        auto hit = mLogHistory.FindLast( arg, min( mFindCursor, numLines ), mLogFilter );
+        if ( hit == numLines )
+        {
+            hit = mLogHistory.FindLast( arg, numLines, mLogFilter );
+        }
+
+        // View holds the last mReportLines lines passing the filter.
+        size_t after = 0;
+        for ( auto i = hit + 1; i < numLines; i++ )
+        {
+            after += FLogHistory::Matches( mLogHistory.Line( i ), mLogFilter );
+        }
+        if ( hit == numLines || after >= mReportLines )
+        {
+            print( "no match: %s\n", arg.c_str() );
+            return;
+        }
+
+        mFindCursor = hit;
+        auto col    = mLogHistory.Line( hit ).find( arg );
+        mReport.caret_pos( { (unsigned)col, unsigned( mReportLines - after - 1 ) } );
+    }
+    else if ( name == ":clear" )
+    {
+        mLogHistory.Clear();
+        RebuildReportText();
+    }
+    else
+    {
+        print( "unknown console command: %s\n", name.c_str() );
+    }
 }
 
 void ScannerMainForm::UpdateTimerEventHandler()
 {
+    UpdateReportText();
+    ShowFetchedImage();
+
     // Retry connect
     cbool         bIsConnect          = mScan->IsConnected();
     future_status wait_result         = {};
@@ -917,6 +1046,10 @@ void ScannerMainForm::UpdateTimerEventHandler()
     }
 }
 
+//! Viewer builds its own pyramid for images of at least this many pixels,
+//! when none is given along with the image.
+static constexpr size_t PYRAMID_BUILD_THRESHOLD = 1 << 20;
+
 static constexpr char* divtxt =
   R"(
 vert<margin=10><<><settings margin=10 weight = 560><> weight=160>
@@ -930,13 +1063,207 @@ ScannerViewerWidget::ScannerViewerWidget( nana::form& w, FScanImageDesc const& d
 
 ScannerViewerWidget::~ScannerViewerWidget()
 {
-    mAsyncDraw.wait();
+    if ( mAsyncDraw.valid() )
+    {
+        mAsyncDraw.wait();
+    }
+}
+
+void ScannerViewerWidget::ReplaceDesc(
+  FScanImageDesc const&               desc,
+  bool                                bShouldClone,
+  std::shared_ptr<FScanPyramid const> Pyramid,
+  FScanHistogram const*               Histogram )
+{
+    // Clone is owned the same way as a frame; drawer may still be reading
+    // the previous one.
+    FFrameHistory::FFramePtr Frame;
+    if ( bShouldClone )
+    {
+        Frame = make_shared<FScanImageDesc const>( desc.Clone() );
+    }
+    replaceImage( desc, std::move( Frame ), std::move( Pyramid ), Histogram );
+}
+
+void ScannerViewerWidget::ReplaceDesc(
+  FFrameHistory::FFramePtr            Frame,
+  std::shared_ptr<FScanPyramid const> Pyramid,
+  FScanHistogram const*               Histogram )
+{
+    if ( Frame == nullptr )
+    {
+        return;
+    }
+    replaceImage( *Frame, std::move( Frame ), std::move( Pyramid ), Histogram );
+}
+
+void ScannerViewerWidget::replaceImage(
+  FScanImageDesc const&               desc,
+  FFrameHistory::FFramePtr            Frame,
+  std::shared_ptr<FScanPyramid const> Pyramid,
+  FScanHistogram const*               Histogram )
+{
+    // Drawer which still sees previous frame renders from it, holding its own
+    // reference; otherwise it reads mImgDesc, which is thus written first.
+    mImgDesc = Frame ? *Frame : desc;
+    atomic_store( &mImgFrame, std::move( Frame ) );
+    updatePyramid( std::move( Pyramid ) );
+    if ( bAutoRange && Histogram == nullptr && mImgDesc.CData() )
+    {
+        mOwnHistogram.Build( mImgDesc.CData(), (size_t)mImgDesc.Width * mImgDesc.Height );
+        Histogram = &mOwnHistogram;
+    }
+    if ( bAutoRange && Histogram )
+    {
+        updateAutoRange( *Histogram, true );
+    }
+    bFullRender = true;
+    rerenderBuf();
+}
+
+void ScannerViewerWidget::UpdateLine(
+  FScanImageDesc const&               desc,
+  FLineDesc const&                    Line,
+  std::shared_ptr<FScanPyramid const> Pyramid,
+  FScanHistogram const*               Histogram )
+{
+    // Image buffer has been relocated; nothing can be reused.
+    if ( desc.CData() != mImgDesc.CData() || desc.Width != mImgDesc.Width || desc.Height != mImgDesc.Height )
+    {
+        ReplaceDesc( desc, false, std::move( Pyramid ), Histogram );
+        return;
+    }
+
+    // Range change is picked up by renderFrame() as a parameter change.
+    if ( bAutoRange && Histogram )
+    {
+        updateAutoRange( *Histogram, false );
+    }
+
+    mImgDesc = desc;
+    if ( Pyramid )
+    {
+        atomic_store( &mPyramid, std::move( Pyramid ) );
+    }
+    else if ( auto Own = atomic_load( &mOwnPyramid ); Own && Own == atomic_load( &mPyramid ) )
+    {
+        // Updated in place; drawer picks the tiles up by their generation.
+        Own->UpdateLine( Line );
+    }
+
+    {
+        lock_guard<mutex> lock( mDirtyLock );
+        FDirtySpan        span = { (int)Line.LineIdx, (int)Line.OfstX, (int)( Line.OfstX + Line.NumPxls ) };
+
+        // Lines usually arrive in pieces of the same row.
+        if ( mDirtySpans.size() && mDirtySpans.back().Row == span.Row )
+        {
+            auto& last    = mDirtySpans.back();
+            last.ColBegin = min( last.ColBegin, span.ColBegin );
+            last.ColEnd   = max( last.ColEnd, span.ColEnd );
+        }
+        else
+        {
+            mDirtySpans.push_back( span );
+        }
+    }
+
+    rerenderBuf();
+}
+
+void ScannerViewerWidget::AdoptPyramid( FScanPyramid&& Pyramid )
+{
+    if ( Pyramid.LevelWidth( 0 ) != mImgDesc.Width || Pyramid.LevelHeight( 0 ) != mImgDesc.Height )
+    {
+        return;
+    }
+
+    auto Own = make_shared<FScanPyramid>( std::move( Pyramid ) );
+    Own->Attach( mImgDesc.CData() );
+    atomic_store( &mOwnPyramid, Own );
+    atomic_store( &mPyramid, shared_ptr<FScanPyramid const>( std::move( Own ) ) );
+    bFullRender = true;
+    rerenderBuf();
+}
+
+void ScannerViewerWidget::updatePyramid( std::shared_ptr<FScanPyramid const> Pyramid )
+{
+    // Own one is dropped once unused, so that a buffer freed and allocated
+    // again at the same address never matches it below.
+    if ( Pyramid )
+    {
+        atomic_store( &mOwnPyramid, shared_ptr<FScanPyramid>{} );
+        atomic_store( &mPyramid, std::move( Pyramid ) );
+        return;
+    }
+    if ( mImgDesc.CData() == nullptr || (size_t)mImgDesc.Width * mImgDesc.Height < PYRAMID_BUILD_THRESHOLD )
+    {
+        atomic_store( &mOwnPyramid, shared_ptr<FScanPyramid>{} );
+        atomic_store( &mPyramid, shared_ptr<FScanPyramid const>{} );
+        return;
+    }
+
+    // Same buffer is kept up to date by UpdateLine(); build only for a new one.
+    // Drawer may still render the old one, which is thus never rebuilt in place.
+    auto Own = atomic_load( &mOwnPyramid );
+    if ( Own == nullptr
+         || Own->LevelData( 0 ) != mImgDesc.CData()
+         || Own->LevelWidth( 0 ) != mImgDesc.Width
+         || Own->LevelHeight( 0 ) != mImgDesc.Height )
+    {
+        Own = make_shared<FScanPyramid>();
+        Own->Build( mImgDesc.CData(), mImgDesc.Width, mImgDesc.Height );
+        atomic_store( &mOwnPyramid, Own );
+    }
+    atomic_store( &mPyramid, shared_ptr<FScanPyramid const>( std::move( Own ) ) );
+}
+
+int ScannerViewerWidget::selectRenderLevel( FScanPyramid const* Pyramid ) const
+{
+    if ( Pyramid == nullptr || mImgDesc.Width == 0 || mImgDesc.Height == 0 )
+    {
+        return 0;
+    }
+
+    // Screen pixels per image pixel; see TranslateInto() for the relationship.
+    double zoom   = mConfZoom.to_double() / 100.0;
+    double larger = max( mImgDesc.Width, mImgDesc.Height );
+    double scale  = zoom * larger * min( 1.0 / mImgDesc.Height, mImgDesc.AspectRatio / mImgDesc.Width );
+    return Pyramid->SelectLevel( scale );
+}
+
+void ScannerViewerWidget::visibleTiles( FScanPyramid const& Pyramid, int Level, int ( &Out )[4] ) const
+{
+    // Inverse of the placement in TranslateInto(), in level 0 pixels.
+    auto const   dst    = mViewport.size();
+    double const zoom   = mConfZoom.to_double() / 100.0;
+    double const larger = max( mImgDesc.Width, mImgDesc.Height );
+    double const w      = max( 1.0, larger * zoom * mImgDesc.AspectRatio );
+    double const h      = max( 1.0, larger * zoom );
+    double const dx     = min( (double)dst.width, mConfXPos.to_double() * zoom + dst.width / 2.0 - w / 2 );
+    double const dy     = min( (double)dst.height, mConfYPos.to_double() * zoom + dst.height / 2.0 - h / 2 );
+
+    // One tile of margin; small pans don't have to wait for the drawer.
+    double const tile = (double)Pyramid.TileSize() * ( 1 << Level );
+    double const x0   = -dx / w * mImgDesc.Width / tile - 1;
+    double const y0   = -dy / h * mImgDesc.Height / tile - 1;
+    double const x1   = ( dst.width - dx ) / w * mImgDesc.Width / tile + 1;
+    double const y1   = ( dst.height - dy ) / h * mImgDesc.Height / tile + 1;
+
+    Out[0] = (int)max( 0.0, floor( x0 ) );
+    Out[1] = (int)max( 0.0, floor( y0 ) );
+    Out[2] = (int)min<double>( Pyramid.NumTilesX( Level ), ceil( x1 ) );
+    Out[3] = (int)min<double>( Pyramid.NumTilesY( Level ), ceil( y1 ) );
 }
 
 void ScannerViewerWidget::init( FScanImageDesc const& desc )
 {
     if ( desc.CData() )
-        mImgDesc = desc.Clone();
+    {
+        mImgFrame = make_shared<FScanImageDesc const>( desc.Clone() );
+        mImgDesc  = *mImgFrame;
+        updatePyramid( nullptr );
+    }
 
     mLayout.bind( *this );
     mLayout.div( divtxt );
@@ -975,6 +1302,11 @@ void ScannerViewerWidget::init( FScanImageDesc const& desc )
         prv = arg.pos;
     } );
 
+    mViewport.events().resized( [this]( auto& ) {
+        if ( atomic_load( &mPyramid ) )
+            rerenderBuf();
+    } );
+
     mViewportDraw
       = make_unique<drawing>( mViewport );
     mViewportDraw->draw( [this]( paint::graphics& graph ) {
@@ -1020,8 +1352,10 @@ void ScannerViewerWidget::init( FScanImageDesc const& desc )
         bx.value( to_string( init_min_max_step[i][0] ) );
         bx.bgcolor( color().from_rgb( 215, 215, 215 ) );
 
+        // With pyramid, only visible tiles are rendered; view change may
+        // reveal more of them, or pick another level.
         if ( i >= 2 && i != 5 )
-            bx.events().text_changed( [this]( auto& ) { refreshScreen(); } );
+            bx.events().text_changed( [this]( auto& ) { refreshScreen(); if ( atomic_load( &mPyramid ) ) rerenderBuf(); } );
         else
             bx.events().text_changed( [this]( auto& ) { rerenderBuf(); } );
     }
@@ -1060,6 +1394,17 @@ void ScannerViewerWidget::init( FScanImageDesc const& desc )
     cmod.append( "Grayscale", [this]( auto ) { mColorMode = ColorMappingMode::GREYSCALE; rerenderBuf(); } );
     cmod.append( "Rainbow", [this]( auto ) { mColorMode = ColorMappingMode::RAINBOW; rerenderBuf(); } );
     cmod.append( "WTOK Slide", [this]( auto ) { mColorMode = ColorMappingMode::WTOK; rerenderBuf(); } );
+    cmod.append_splitter();
+    cmod.append( "Auto Range", [this]( auto proxy ) {
+            bAutoRange = proxy.checked();
+            if ( bAutoRange && mImgDesc.CData() )
+            {
+                // Single pass over current image; live scan keeps it updated.
+                mOwnHistogram.Build( mImgDesc.CData(), (size_t)mImgDesc.Width * mImgDesc.Height );
+                updateAutoRange( mOwnHistogram, true );
+            }
+            rerenderBuf(); } )
+      .check_style( menu::checks::highlight );
 
     rerenderBuf();
 }
@@ -1067,30 +1412,305 @@ void ScannerViewerWidget::init( FScanImageDesc const& desc )
 void ScannerViewerWidget::rerenderBuf()
 {
     bPendingRender = true;
-    if ( mAsyncDraw.valid() && mAsyncDraw.wait_for( 0ms ) != future_status::ready )
+    if ( bDrawing.exchange( true ) )
     {
+        // Running drawer picks the request up. Every request arrived during a
+        // frame is merged into the next one.
         return;
     }
 
-    mAsyncDraw = async( launch::async, [this]( void ) {
-        while ( bPendingRender.exchange( false ) )
+    mAsyncDraw = FThreadPool::Shared().Submit( [this]() {
+        do
         {
-            auto required = mImgDesc.Width * mImgDesc.Height;
-            if ( mTmpBufSz < required )
+            while ( bPendingRender.exchange( false ) )
             {
-                mTmpBuf   = make_unique<uint32_t[]>( required );
-                mTmpBufSz = required;
+                renderFrame();
             }
 
-            RenderImage(
-              mImgDesc, mViewportBuf[!mFwd], mConfRenderAmp.checked(), mConfMaxDist.to_double(), mConfMinDist.to_double(), mConfCalib.to_int(), mColorMode, mTmpBuf.get() );
+            bDrawing = false;
 
-            mFwd = !mFwd;
-            refreshScreen( true );
-        }
+            // Request may have arrived right before releasing the drawer.
+        } while ( bPendingRender && !bDrawing.exchange( true ) );
     } );
 }
 
+void ScannerViewerWidget::renderFrame()
+{
+    auto const frameBegin = chrono::steady_clock::now();
+
+    // Pyramid may be replaced any time; the frame renders from a reference of
+    // its own. One not matching the image yet is picked up by next frame.
+    auto           Frame   = atomic_load( &mImgFrame );
+    auto           Pyramid = atomic_load( &mPyramid );
+    FScanImageDesc Src     = Frame ? *Frame : mImgDesc;
+    if ( Pyramid && ( Pyramid->LevelWidth( 0 ) != Src.Width || Pyramid->LevelHeight( 0 ) != Src.Height ) )
+    {
+        Pyramid = nullptr;
+    }
+
+    // Zoomed-out view of large image is rendered from coarser level.
+    int Level = selectRenderLevel( Pyramid.get() );
+    if ( Level > 0 )
+    {
+        Src        = FScanImageDesc( Pyramid->LevelData( Level ) );
+        Src.Width  = Pyramid->LevelWidth( Level );
+        Src.Height = Pyramid->LevelHeight( Level );
+    }
+    if ( Src.CData() == nullptr || Src.Width == 0 || Src.Height == 0 )
+    {
+        return;
+    }
+
+    // Any change of settings invalidates every colorized pixel.
+    auto const param = makeColorizeParam( Level );
+    bool       bFull = bFullRender.exchange( false )
+                 || Level != mRenderLevel
+                 || Src.Width != mRenderW
+                 || Src.Height != mRenderH
+                 || Pyramid != mRenderPyramid
+                 || !IsSameParam( param, mRenderParam );
+    if ( mRenderer.Reserve( Src.Width, Src.Height ) )
+    {
+        bFull = true;
+    }
+
+    mRenderLevel   = Level;
+    mRenderW       = Src.Width;
+    mRenderH       = Src.Height;
+    mRenderParam   = param;
+    mRenderPyramid = Pyramid;
+
+    FColorizer const colorizer( param );
+    bool const       bUploaded = Pyramid ? renderTiles( colorizer, *Pyramid, Src, Level, bFull )
+                                         : renderRows( colorizer, Src, Level, bFull );
+    if ( bUploaded == false )
+    {
+        return;
+    }
+
+    mFwd     = !mFwd;
+    mFrameMs = chrono::duration<double, milli>( chrono::steady_clock::now() - frameBegin ).count();
+    refreshScreen( true );
+}
+
+bool ScannerViewerWidget::renderRows( FColorizer const& Colorizer, FScanImageDesc const& Src, int Level, bool bFull )
+{
+    vector<FDirtySpan> spans;
+    {
+        lock_guard<mutex> lock( mDirtyLock );
+        spans.swap( mDirtySpans );
+    }
+
+    auto const argb     = mRenderer.Buffer();
+    int        rowBegin = Src.Height;
+    int        rowEnd   = 0;
+    if ( bFull )
+    {
+        // Tiles are colorized on the shared pool.
+        mRenderer.Render( Colorizer, Src.Data(), Src.Width, Src.Height );
+        rowBegin = 0;
+        rowEnd   = Src.Height;
+    }
+    else
+    {
+        for ( auto& span : spans )
+        {
+            // Covers every pixel of the level the span contributes to.
+            int row = span.Row >> Level;
+            int c0  = span.ColBegin >> Level;
+            int c1  = ( span.ColEnd + ( 1 << Level ) - 1 ) >> Level;
+            if ( row < 0 || row >= Src.Height )
+            {
+                continue;
+            }
+
+            auto ofst = (size_t)row * Src.Width;
+            Colorizer.RenderSpan( Src.Data() + ofst, Src.Width, row, c0, c1, argb + ofst );
+            rowBegin = min( rowBegin, row );
+            rowEnd   = max( rowEnd, row + 1 );
+        }
+    }
+
+    // Back buffer also lacks the rows updated on the other one last frame.
+    int uploadBegin = rowBegin;
+    int uploadEnd   = rowEnd;
+    if ( mStaleRows[0] < mStaleRows[1] )
+    {
+        uploadBegin = min( uploadBegin, mStaleRows[0] );
+        uploadEnd   = max( uploadEnd, mStaleRows[1] );
+    }
+    if ( uploadBegin >= uploadEnd )
+    {
+        return false;
+    }
+
+    UploadImage( argb, Src.Width, Src.Height, uploadBegin, uploadEnd, 0, Src.Width, mViewportBuf[!mFwd] );
+    mStaleRows[0] = rowBegin;
+    mStaleRows[1] = rowEnd;
+    return true;
+}
+
+bool ScannerViewerWidget::renderTiles(
+  FColorizer const&     Colorizer,
+  FScanPyramid const&   Pyramid,
+  FScanImageDesc const& Src,
+  int                   Level,
+  bool                  bFull )
+{
+    // Tile generations tell what has been updated; spans are not needed.
+    {
+        lock_guard<mutex> lock( mDirtyLock );
+        mDirtySpans.clear();
+    }
+
+    auto const numTilesX = Pyramid.NumTilesX( Level );
+    auto const numTiles  = (size_t)numTilesX * Pyramid.NumTilesY( Level );
+    auto&      uploaded  = mUploadedStamps[!mFwd];
+    if ( bFull )
+    {
+        // Stamps of previous epochs never match; every tile is due again.
+        mRenderEpoch++;
+    }
+    for ( auto stamps : { &mColorizedStamps, &mUploadedStamps[0], &mUploadedStamps[1] } )
+    {
+        if ( stamps->size() != numTiles )
+            stamps->assign( numTiles, ~0ull );
+    }
+
+    // Generation is read before colorizing, and checked again after it below.
+    int              rect[4];
+    int              dirty[4] = { numTilesX, Pyramid.NumTilesY( Level ), 0, 0 };
+    vector<uint32_t> tiles;
+    visibleTiles( Pyramid, Level, rect );
+    for ( int ty = rect[1]; ty < rect[3]; ty++ )
+    {
+        for ( int tx = rect[0]; tx < rect[2]; tx++ )
+        {
+            auto const index = (size_t)ty * numTilesX + tx;
+            auto const stamp = (uint64_t)mRenderEpoch << 32 | Pyramid.TileGeneration( Level, tx, ty );
+            if ( mColorizedStamps[index] != stamp )
+            {
+                mColorizedStamps[index] = stamp;
+                tiles.push_back( (uint32_t)index );
+            }
+            if ( uploaded[index] != stamp )
+            {
+                dirty[0] = min( dirty[0], tx );
+                dirty[1] = min( dirty[1], ty );
+                dirty[2] = max( dirty[2], tx + 1 );
+                dirty[3] = max( dirty[3], ty + 1 );
+            }
+        }
+    }
+
+    auto const tileSize = Pyramid.TileSize();
+    mRenderer.RenderTiles( Colorizer, Src.Data(), Src.Width, Src.Height, tileSize, tiles.data(), tiles.size() );
+
+    // Tile updated while being colorized may have been read half way; its
+    // stamp is forgotten so that the next frame colorizes it again.
+    for ( auto index : tiles )
+    {
+        auto const generation = Pyramid.TileGeneration( Level, int( index % numTilesX ), int( index / numTilesX ) );
+        if ( (uint32_t)mColorizedStamps[index] != generation )
+        {
+            mColorizedStamps[index] = ~0ull;
+        }
+    }
+
+    if ( dirty[0] >= dirty[2] || dirty[1] >= dirty[3] )
+    {
+        return false;
+    }
+
+    // Back buffer now holds whatever has been colorized in uploaded region.
+    bool const bWhole = UploadImage(
+      mRenderer.Buffer(),
+      Src.Width,
+      Src.Height,
+      dirty[1] * tileSize,
+      min( Src.Height, dirty[3] * tileSize ),
+      dirty[0] * tileSize,
+      min( Src.Width, dirty[2] * tileSize ),
+      mViewportBuf[!mFwd] );
+    if ( bWhole )
+    {
+        uploaded = mColorizedStamps;
+        return true;
+    }
+    for ( int ty = dirty[1]; ty < dirty[3]; ty++ )
+    {
+        auto const row = (size_t)ty * numTilesX;
+        copy( mColorizedStamps.begin() + row + dirty[0], mColorizedStamps.begin() + row + dirty[2], uploaded.begin() + row + dirty[0] );
+    }
+    return true;
+}
+
+FColorizeParam ScannerViewerWidget::makeColorizeParam( int Level ) const
+{
+    FColorizeParam param;
+    param.Mode            = mColorMode;
+    param.Source          = mConfRenderAmp.checked() ? EColorSource::AMPLITUDE : EColorSource::DISTANCE;
+    param.MaxDistance     = (float)mConfMaxDist.to_double();
+    param.MinDistance     = (float)mConfMinDist.to_double();
+    param.HorizontalCalib = mConfCalib.to_int() / ( 1 << Level );
+
+    lock_guard<mutex> lock( mRangeLock );
+    if ( bAutoRange && bHasAutoRange )
+    {
+        param.MinDistance  = mAutoDist[0];
+        param.MaxDistance  = mAutoDist[1];
+        param.MinAmplitude = mAutoAmp[0];
+        param.MaxAmplitude = mAutoAmp[1];
+    }
+    return param;
+}
+
+void ScannerViewerWidget::updateAutoRange( FScanHistogram const& Histogram, bool bForce )
+{
+    // Percentiles barely move line by line; recheck once a sizable portion
+    // of the frame has been updated.
+    auto const Gen      = Histogram.Generation();
+    auto const Interval = max<uint64_t>( 4096, Histogram.NumValid() / 32 );
+    {
+        lock_guard<mutex> lock( mRangeLock );
+        if ( !bForce && bHasAutoRange && Gen >= mRangeGeneration && Gen - mRangeGeneration < Interval )
+        {
+            return;
+        }
+        mRangeGeneration = Gen;
+    }
+
+    if ( Histogram.NumValid() == 0 )
+    {
+        return;
+    }
+
+    float dist[2] = { Histogram.DistancePercentile( 0.02 ), Histogram.DistancePercentile( 0.98 ) };
+    float amp[2]  = { Histogram.AmplitudePercentile( 0.02 ), Histogram.AmplitudePercentile( 0.98 ) };
+    dist[1]       = max( dist[1], dist[0] + Histogram.DistanceBinWidth() );
+    amp[1]        = max( amp[1], amp[0] + 1.f );
+
+    // Every range change colorizes the whole frame again. Small drifts are
+    // ignored to keep live scan on dirty-row updates.
+    auto const IsDrifted = []( float const( &Cur )[2], float const( &New )[2] ) {
+        auto const Tolerance = ( Cur[1] - Cur[0] ) * 0.05f;
+        return fabs( New[0] - Cur[0] ) > Tolerance || fabs( New[1] - Cur[1] ) > Tolerance;
+    };
+
+    lock_guard<mutex> lock( mRangeLock );
+    if ( !bHasAutoRange || IsDrifted( mAutoDist, dist ) )
+    {
+        mAutoDist[0] = dist[0];
+        mAutoDist[1] = dist[1];
+    }
+    if ( !bHasAutoRange || IsDrifted( mAutoAmp, amp ) )
+    {
+        mAutoAmp[0] = amp[0];
+        mAutoAmp[1] = amp[1];
+    }
+    bHasAutoRange = true;
+}
+
 void ScannerViewerWidget::refreshScreen( bool bTry )
 {
     mViewportDraw->update();
@@ -1105,6 +1725,23 @@ void ScannerViewerWidget::viewportDraw( nana::paint::graphics& gr )
 
     // Translate image into buffer
     TranslateInto( gr, mViewportBuf[mFwd], mImgDesc.AspectRatio, mConfXPos.to_double(), mConfYPos.to_double(), mConfZoom.to_double() );
+
+    // Time spent on last frame
+    char buf[64];
+    snprintf( buf, sizeof buf, "frame %.2f ms, L%d", mFrameMs.load(), mRenderLevel.load() );
+    auto old_face = gr.typeface();
+    gr.typeface( mConsolas );
+    gr.string( { 4, 4 }, buf, nana::color( 200, 200, 200 ) );
+    if ( bAutoRange )
+    {
+        lock_guard<mutex> lock( mRangeLock );
+        if ( mConfRenderAmp.checked() )
+            snprintf( buf, sizeof buf, "auto [%.0f, %.0f]", mAutoAmp[0], mAutoAmp[1] );
+        else
+            snprintf( buf, sizeof buf, "auto [%.2f, %.2f] m", mAutoDist[0], mAutoDist[1] );
+        gr.string( { 4, 20 }, buf, nana::color( 200, 200, 200 ) );
+    }
+    gr.typeface( old_face );
 }
 
 void ScannerViewerWidget::TranslateInto(
@@ -1118,7 +1755,8 @@ void ScannerViewerWidget::TranslateInto(
     double zoom   = zoom_percent / 100.0;
     auto   dstw   = dst.width();
     auto   dsth   = dst.height();
-    auto   larger = max( src.width(), src.height() );
+    // Source may be rendered from a pyramid level; keep the scale of the image.
+    auto   larger = mImgDesc.CData() ? (unsigned)max( mImgDesc.Width, mImgDesc.Height ) : max( src.width(), src.height() );
     auto   w      = static_cast<unsigned int>( larger * zoom * aspect );
     auto   h      = static_cast<unsigned int>( larger * zoom );
     auto   dx     = (int)std::min( (double)dstw, x * zoom + dstw / 2 - w / 2 );
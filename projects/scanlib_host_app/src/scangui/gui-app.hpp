@@ -7,6 +7,7 @@
 #pragma once
 #include <deque>
 #include <memory>
+#include <mutex>
 #include <nana/gui.hpp>
 #include <nana/gui/drawing.hpp>
 #include <nana/gui/filebox.hpp>
@@ -27,7 +28,12 @@
 #include <nana/paint/image.hpp>
 #include <string>
 #include <utility>
+#include <vector>
 #include <optional>
+#include <scanlib/core/frame_history.hpp>
+#include <scanlib/render/colorizer.hpp>
+#include <scanlib/render/tile_renderer.hpp>
+#include <scanlib/utility/log_ring.hpp>
 #include "app.hpp"
 
 class ScannerViewerWidget : public nana::picture
@@ -39,24 +45,73 @@ public:
 
     void init( FScanImageDesc const& desc );
 
-    void ReplaceDesc( FScanImageDesc const& desc, bool bShouldClone = false )
-    {
-        mImgDesc = bShouldClone ? desc.Clone() : desc;
-        rerenderBuf();
-    }
+    //! @param      Pyramid: Pyramid of given image, if exists. Otherwise the
+    //!             viewer builds its own one for large images. Must not be
+    //!             resized by its owner; replace it instead.
+    //! @param      Histogram: Histogram of given image, if exists. Otherwise
+    //!             the viewer builds its own one when auto range is on.
+    void ReplaceDesc(
+      FScanImageDesc const&               desc,
+      bool                                bShouldClone = false,
+      std::shared_ptr<FScanPyramid const> Pyramid      = {},
+      FScanHistogram const*               Histogram    = nullptr );
+
+    //! @brief      Show a frame, which the viewer keeps alive until another
+    //!             image replaces it and the drawer has moved on.
+    void ReplaceDesc(
+      FFrameHistory::FFramePtr            Frame,
+      std::shared_ptr<FScanPyramid const> Pyramid   = {},
+      FScanHistogram const*               Histogram = nullptr );
+
+    //! Color mapping currently applied to level 0.
+    FColorizeParam ColorizeParam() const { return makeColorizeParam( 0 ); }
+
+    //! Takes ownership of pyramid loaded alongside the image.
+    void AdoptPyramid( FScanPyramid&& Pyramid );
+
+    //! @brief      Notify a line of currently viewing image has been updated.
+    //!             Only the pixels of the line are colorized again, unless
+    //!             the image itself has been replaced.
+    void UpdateLine(
+      FScanImageDesc const&               desc,
+      FLineDesc const&                    Line,
+      std::shared_ptr<FScanPyramid const> Pyramid   = {},
+      FScanHistogram const*               Histogram = nullptr );
 
 private:
-    enum class ColorMappingMode
+    using ColorMappingMode = EColorMappingMode;
+
+    //! Pixels of level 0 row to be colorized again.
+    struct FDirtySpan
     {
-        NONE,
-        BGR,
-        GREYSCALE,
-        WTOK,
-        RAINBOW,
+        int Row;
+        int ColBegin;
+        int ColEnd;
     };
 
 private:
+    void replaceImage(
+      FScanImageDesc const&               desc,
+      FFrameHistory::FFramePtr            Frame,
+      std::shared_ptr<FScanPyramid const> Pyramid,
+      FScanHistogram const*               Histogram );
     void rerenderBuf();
+    void renderFrame();
+    //! Colorizes dirty rows of the whole level. Returns false if nothing has
+    //! been uploaded.
+    bool renderRows( FColorizer const& Colorizer, FScanImageDesc const& Src, int Level, bool bFull );
+    //! Colorizes visible tiles whose generation has changed since uploaded
+    //! into the back buffer. Returns false if nothing has been uploaded.
+    bool renderTiles( FColorizer const& Colorizer, FScanPyramid const& Pyramid, FScanImageDesc const& Src, int Level, bool bFull );
+    //! Tiles of the level inside viewport, as [TX0, TY0, TX1, TY1).
+    void visibleTiles( FScanPyramid const& Pyramid, int Level, int ( &Out )[4] ) const;
+    int  selectRenderLevel( FScanPyramid const* Pyramid ) const;
+
+    FColorizeParam makeColorizeParam( int Level ) const;
+    //! Picks color range from percentiles of histogram. Recomputed only after
+    //! enough pixels have arrived, unless forced.
+    void updateAutoRange( FScanHistogram const& Histogram, bool bForce );
+    void updatePyramid( std::shared_ptr<FScanPyramid const> Pyramid );
     void refreshScreen( bool bTryLock = false );
     void viewportDraw( nana::paint::graphics& gr );
     void TranslateInto(
@@ -66,15 +121,18 @@ private:
       double                 x,
       double                 y,
       double                 zoom_percent );
-    static void RenderImage(
-      FScanImageDesc const&,
-      nana::paint::graphics& To,
-      bool                   bRenderAmp,
-      float                  MaxDistance     = 10.0f,
-      float                  MinDistance     = 0.0f,
-      int                    HorizontalCalib = 0,
-      ColorMappingMode       ColorMode       = {},
-      void*                  CacheBuff       = NULL );
+    //! Copies rows [RowBegin, RowEnd) and columns [ColBegin, ColEnd) of
+    //! colorized image into graphics. Returns true if whole image has been
+    //! copied instead, which happens if graphics has to be resized.
+    static bool UploadImage(
+      uint32_t*              Argb,
+      int                    Width,
+      int                    Height,
+      int                    RowBegin,
+      int                    RowEnd,
+      int                    ColBegin,
+      int                    ColEnd,
+      nana::paint::graphics& To );
 
 private:
     nana::place   mLayout = {};
@@ -96,15 +154,53 @@ private:
     nana::spinbox  mConfCalib     = {};
     nana::checkbox mConfRenderAmp = {};
 
-    FScanImageDesc mImgDesc = {};
-
-    //! Async drawer thread
-    std::future<void> mAsyncDraw     = {};
-    std::atomic_bool  bPendingRender = false;
-    ColorMappingMode  mColorMode     = {};
-
-    std::unique_ptr<uint32_t[]> mTmpBuf   = {};
-    size_t                      mTmpBufSz = 0;
+    //! Image being shown. Drawer reads the frame instead if the viewer owns
+    //! one; it's accessed atomically, and always stored after mImgDesc.
+    FScanImageDesc           mImgDesc  = {};
+    FFrameHistory::FFramePtr mImgFrame = {};
+
+    //! Pyramid to render zoomed-out view from coarser level. Shared with the
+    //! drawer, thus only replaced as a whole; accessed atomically.
+    std::shared_ptr<FScanPyramid>       mOwnPyramid  = {};
+    std::shared_ptr<FScanPyramid const> mPyramid     = {};
+    std::atomic_int                     mRenderLevel = 0;
+
+    //! Color range from percentiles, replacing configured one when enabled.
+    FScanHistogram     mOwnHistogram    = {};
+    std::atomic_bool   bAutoRange       = false;
+    mutable std::mutex mRangeLock       = {};
+    bool               bHasAutoRange    = false;
+    float              mAutoDist[2]     = {}; //!< [min, max] in meter
+    float              mAutoAmp[2]      = {}; //!< [min, max] in integer units
+    uint64_t           mRangeGeneration = 0;
+
+    //! Drawer task on shared pool. Only one runs at a time.
+    std::future<void>   mAsyncDraw     = {};
+    std::atomic_bool    bPendingRender = false;
+    std::atomic_bool    bDrawing       = false;
+    std::atomic<double> mFrameMs       = 0.0; //!< Wall time of last frame
+    ColorMappingMode    mColorMode     = {};
+
+    //! Holds colorized image across frames so that only dirty spans need to
+    //! be colorized again. Accessed by drawer only.
+    FTileRenderer mRenderer;
+
+    //! Spans updated since last frame. Full render discards them.
+    std::mutex              mDirtyLock    = {};
+    std::vector<FDirtySpan> mDirtySpans   = {};
+    std::atomic_bool        bFullRender   = true;
+    FColorizeParam          mRenderParam  = {}; //!< Parameter mTmpBuf was colorized with
+    int                     mRenderW      = 0;
+    int                     mRenderH      = 0;
+    int                     mStaleRows[2] = {}; //!< Rows back buffer missed on last frame
+
+    //! Pyramid of last frame, kept alive until the next one. Tiles of it are
+    //! stamped with render epoch in upper half and tile generation in lower
+    //! half; a full render starts a new epoch.
+    std::shared_ptr<FScanPyramid const> mRenderPyramid     = {};
+    uint32_t                            mRenderEpoch       = 0;
+    std::vector<uint64_t>               mColorizedStamps   = {};
+    std::vector<uint64_t>               mUploadedStamps[2] = {}; //!< Per viewport buffer
 
     std::optional<nana::point> mViewportCursorPos = {};
     nana::paint::font          mConsolas{ "consolas", 11 };
@@ -155,31 +251,46 @@ public:
 
 public:
     size_t                    NumMaxCommandHistory = 512;
+    size_t                    NumMaxReportLines    = 1000;    //!< Lines kept in console view
+    size_t                    NumMaxDrainBytes     = 1 << 16; //!< Log bytes moved into console per tick
     std::chrono::milliseconds UpdatePeriod{ 100 };
     std::chrono::milliseconds ReportPeriod{ 100 };
 
-    size_t NumMaxImageHistory() const { return mNumMaxImageHistory; }
+    size_t NumMaxImageHistory() const { return mHistory.MaxFrames(); }
     void   NumMaxImageHistory( size_t val )
     {
-        mNumMaxImageHistory = val;
-        UpdateImageHistoryBox( val );
+        mHistory.SetBudget( mHistory.BudgetBytes(), val );
+        UpdateImageHistoryBox( mHistory.Size() );
+    }
+
+    //! Memory budget of compressed capture history
+    size_t HistoryBudget() const { return mHistory.BudgetBytes(); }
+    void   HistoryBudget( size_t bytes )
+    {
+        mHistory.SetBudget( bytes, mHistory.MaxFrames() );
+        UpdateImageHistoryBox( mHistory.Size() );
     }
 
 private:
     void OnScannerCaptureDone( FScanImageDesc const& );
     void OnUpdateReport( FDeviceStat const& );
-    void OnUpdateImage( FScanImageDesc const& );
+    void OnUpdateImage( FScanImageDesc const&, FLineDesc const& );
     void StartCapture();
     void StopCapture();
     void AutoUpdateImage();
-    void SaveCurrentImage( FScanImageDesc const& desc, wchar_t const* PATH );
+    void ShowFetchedImage();
+    //! Pyramid of the image is stored if given, otherwise built on demand.
+    void SaveCurrentImage( FScanImageDesc const& desc, wchar_t const* PATH, FScanPyramid const* Pyramid = nullptr );
     void OpenSaveAs();
+    void OpenExportPreview();
     void SetAutosavePath();
     void OpenDepthMapFile();
     void RequestMotorMovement();
     void OpenStepPerAngleSettingDialog();
     void OpenMotorDrvClkSettingDialog();
     void UpdateReportText();
+    void RebuildReportText();
+    void RunConsoleCommand( std::string const& cmd );
     void UpdateTimerEventHandler();
     void UpdateImageHistoryBox( size_t newval );
 
@@ -223,6 +334,7 @@ private:
     bool         bFileEnableAutosave : 1;
     bool         bFileSaveDepthMapRgb : 1;
     bool         bFileSaveAmpMapRgb : 1;
+    bool         bFileSavePyramid : 1;
     bool         bEnableAutoRestart : 1;
     bool         bInStartMode : 1;
     uint8_t      mRetriggerCnt = 0;
@@ -261,15 +373,30 @@ private:
     ScannerViewerWidget        mViewport          = {};
     nana::spinbox              mViewIndexInput    = {};
     nana::label                mViewIndexLabel    = {};
-    std::deque<FScanImageDesc> mCapturedImage     = {};
     size_t                     mViewImgIndex      = {};
 
+    //! Captured images; viewed ones are decoded in background.
+    FFrameHistory               mHistory;
+    FFrameHistory::FFramePtr    mViewingFrame  = {};
+    FFrameHistory::FFrameFuture mFetchingFrame = {};
+    size_t                      mFetchingIndex = {};
+
     nana::group             mReportGroup    = { *this };
     nana::textbox           mReport         = {};
     nana::textbox           mMenualCommand  = {};
     std::deque<std::string> mCommandHistory = {};
     size_t                  mCommandCursor  = {};
 
+    //! Console model. Logger only pushes into the ring; timer moves the text
+    //! into history and the view in batches.
+    FLogRing    mLogRing;
+    FLogHistory mLogHistory;
+    std::string mLogDrainBuf = {};
+    std::string mLogFilter   = {};
+    size_t      mLogDropped  = 0;
+    size_t      mReportLines = 0;        //!< Lines currently in mReport
+    size_t      mFindCursor  = SIZE_MAX; //!< History index of last hit; SIZE_MAX to follow tail
+
     std::atomic_bool bShouldRerender = false;
 
     std::vector<std::unique_ptr<nana::widget>> mUnnamedRefs;
@@ -278,6 +405,4 @@ private:
     std::future<bool> mComSearchTask = {};
 
     nana::paint::font mFormatFont = {};
-
-    size_t mNumMaxImageHistory = 100;
 };
@@ -0,0 +1,11 @@
+#ifndef _WIN32
+#    include "../utility.hpp"
+
+// Serial port discovery of the device is only implemented on win32; here
+// the device is never found, and applications fall back to what they can do
+// without it.
+bool API_RefreshScannerControl( FScannerProtocolHandler& )
+{
+    return false;
+}
+#endif
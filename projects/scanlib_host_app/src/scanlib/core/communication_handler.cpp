@@ -1,6 +1,7 @@
 #include "communication_handler.hpp"
 #include <assert.h>
 #include <memory>
+#include <string.h>
 #include <scanlib/common/utility.hxx>
 
 using namespace std;
@@ -148,7 +149,7 @@ void ICommunicationHandlerBase::InitializeStream(
 {
     assert( strm && recvSz );
     m_strmbuf  = std::move( strm );
-    m_os       = make_unique<ostream>( m_strmbuf.get(), false );
+    m_os       = make_unique<ostream>( m_strmbuf.get() );
     m_buff     = make_unique<char[]>( recvSz );
     m_buffSize = recvSz;
 }
\ No newline at end of file
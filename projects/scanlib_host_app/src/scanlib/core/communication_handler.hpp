@@ -30,7 +30,8 @@ public:
         PACKET_ERROR_DISCONNECTED   = -1,
         PACKET_ERROR_TIMEOUT        = -2,
         PACKET_ERROR_INVALID_HEADER = -3,
-    } ProcessSinglePacket( size_t TimeoutMs );
+    };
+    EPacketProcessResult ProcessSinglePacket( size_t TimeoutMs );
 
     //! Sends binary to device synchronously.
     //! @returns false if stream is not readied yet.
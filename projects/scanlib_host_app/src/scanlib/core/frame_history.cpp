@@ -0,0 +1,153 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "frame_history.hpp"
+#include <algorithm>
+#include "../utility/depth_codec.hpp"
+#include "../utility/thread_pool.hpp"
+
+using namespace std;
+
+FFrameHistory::FFrameHistory( size_t BudgetBytes, size_t MaxFrames, size_t NumCached )
+    : mBudgetBytes( BudgetBytes )
+    , mMaxFrames( max<size_t>( 1, MaxFrames ) )
+    , mNumCached( max<size_t>( 1, NumCached ) )
+{
+}
+
+FFrameHistory::~FFrameHistory()
+{
+    // Decoding jobs refer to this instance until they finish.
+    unique_lock<mutex> lk( mLock );
+    mIdleCv.wait( lk, [this]() { return mNumInFlight == 0; } );
+}
+
+void FFrameHistory::SetBudget( size_t BudgetBytes, size_t MaxFrames )
+{
+    lock_guard<mutex> lk( mLock );
+    mBudgetBytes = BudgetBytes;
+    mMaxFrames   = max<size_t>( 1, MaxFrames );
+    evictLocked();
+}
+
+void FFrameHistory::Push( FScanImageDesc const& Frame )
+{
+    if ( Frame.CData() == nullptr )
+        return;
+
+    // Encode outside of the lock; may take a while on large frames.
+    auto Data = make_shared<vector<uint8_t>>();
+    scanlib::DepthEncode( *Data, Frame.CData(), Frame.Width, Frame.Height );
+    Data->shrink_to_fit();
+
+    promise<FFramePtr> Decoded;
+    Decoded.set_value( make_shared<FScanImageDesc>( Frame.Clone() ) );
+
+    lock_guard<mutex> lk( mLock );
+    auto const        Id = mNextId++;
+    mNumBytes += Data->size();
+    mEntries.push_back( { Id, Frame.Width, Frame.Height, Frame.AspectRatio, move( Data ) } );
+    mCache.insert( mCache.begin(), { Id, Decoded.get_future().share() } );
+    evictLocked();
+}
+
+void FFrameHistory::Clear()
+{
+    lock_guard<mutex> lk( mLock );
+    mEntries.clear();
+    mCache.clear();
+    mNumBytes = 0;
+}
+
+size_t FFrameHistory::Size() const
+{
+    lock_guard<mutex> lk( mLock );
+    return mEntries.size();
+}
+
+size_t FFrameHistory::NumBytes() const
+{
+    lock_guard<mutex> lk( mLock );
+    return mNumBytes;
+}
+
+void FFrameHistory::evictLocked()
+{
+    // Latest frame is kept regardless of budget.
+    while ( mEntries.size() > 1 && ( mEntries.size() > mMaxFrames || mNumBytes > mBudgetBytes ) )
+    {
+        auto const Id = mEntries.front().Id;
+        mNumBytes -= mEntries.front().Data->size();
+        mEntries.pop_front();
+
+        mCache.erase(
+          remove_if( mCache.begin(), mCache.end(), [Id]( auto& c ) { return c.Id == Id; } ),
+          mCache.end() );
+    }
+
+    if ( mCache.size() > mNumCached )
+        mCache.resize( mNumCached );
+}
+
+void FFrameHistory::touchLocked( size_t CacheIndex )
+{
+    rotate( mCache.begin(), mCache.begin() + CacheIndex, mCache.begin() + CacheIndex + 1 );
+}
+
+FFrameHistory::FFrameFuture* FFrameHistory::findLocked( uint64_t Id )
+{
+    for ( size_t i = 0; i < mCache.size(); i++ )
+    {
+        if ( mCache[i].Id == Id )
+        {
+            touchLocked( i );
+            return &mCache.front().Frame;
+        }
+    }
+    return nullptr;
+}
+
+FFrameHistory::FFramePtr FFrameHistory::Find( size_t Index )
+{
+    lock_guard<mutex> lk( mLock );
+    if ( Index >= mEntries.size() )
+        return nullptr;
+
+    auto Frame = findLocked( mEntries[mEntries.size() - 1 - Index].Id );
+    if ( Frame && Frame->wait_for( 0s ) == future_status::ready )
+        return Frame->get();
+    return nullptr;
+}
+
+FFrameHistory::FFrameFuture FFrameHistory::Fetch( size_t Index )
+{
+    lock_guard<mutex> lk( mLock );
+    if ( Index >= mEntries.size() )
+    {
+        promise<FFramePtr> None;
+        None.set_value( nullptr );
+        return None.get_future().share();
+    }
+
+    auto const& Entry = mEntries[mEntries.size() - 1 - Index];
+    if ( auto Frame = findLocked( Entry.Id ) )
+        return *Frame;
+
+    mNumInFlight++;
+    auto Job = FThreadPool::Shared().Submit( [this, Entry]() -> FFramePtr {
+        auto Frame = make_shared<FScanImageDesc>( Entry.Width, Entry.Height, Entry.AspectRatio );
+        bool bOk   = scanlib::DepthDecode( Entry.Data->data(), Entry.Data->size(), Frame->Data() );
+
+        lock_guard<mutex> lk( mLock );
+        if ( --mNumInFlight == 0 )
+            mIdleCv.notify_all();
+        return bOk ? Frame : nullptr;
+    } );
+
+    mCache.insert( mCache.begin(), { Entry.Id, Job.share() } );
+    evictLocked();
+    return mCache.front().Frame;
+}
@@ -0,0 +1,89 @@
+//! Compressed history of captured frames.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Frames are kept encoded with the lossless depth codec, within a memory
+//! budget and a frame count; oldest ones are discarded first. A few recently
+//! used frames are kept decoded. Frames not in the cache are decoded on the
+//! shared thread pool, thus browsing the history never blocks the caller.
+//!
+//! All methods are thread safe.
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+#include "scanner_protocol_handler.hpp"
+
+class FFrameHistory
+{
+public:
+    using FFramePtr    = std::shared_ptr<FScanImageDesc const>;
+    using FFrameFuture = std::shared_future<FFramePtr>;
+
+public:
+    explicit FFrameHistory( size_t BudgetBytes = 256 << 20, size_t MaxFrames = 100, size_t NumCached = 4 );
+    ~FFrameHistory();
+
+    //! @brief      Change limits. Excess frames are discarded immediately.
+    void   SetBudget( size_t BudgetBytes, size_t MaxFrames );
+    size_t BudgetBytes() const noexcept { return mBudgetBytes; }
+    size_t MaxFrames() const noexcept { return mMaxFrames; }
+
+    //! @brief      Compress and store a frame. Frame is also placed into the
+    //!             decoded cache, as it is likely to be viewed next.
+    void Push( FScanImageDesc const& Frame );
+    void Clear();
+
+    size_t Size() const;
+    size_t NumBytes() const; //!< Total size of encoded frames
+
+    //! @brief      Get decoded frame if it is cached.
+    //! @param      Index: 0 is the latest frame.
+    //! @returns    nullptr if the frame isn't decoded yet.
+    FFramePtr Find( size_t Index );
+
+    //! @brief      Get decoded frame. Unless cached, decoding starts in
+    //!             background; requests of a frame being decoded share the
+    //!             same job.
+    //! @returns    Future of the frame. nullptr on invalid index or corrupted
+    //!             data.
+    FFrameFuture Fetch( size_t Index );
+
+private:
+    struct FEntry
+    {
+        uint64_t                                    Id;
+        int                                         Width;
+        int                                         Height;
+        float                                       AspectRatio;
+        std::shared_ptr<std::vector<uint8_t> const> Data;
+    };
+
+    struct FDecoded
+    {
+        uint64_t     Id;
+        FFrameFuture Frame;
+    };
+
+    void          evictLocked();
+    void          touchLocked( size_t CacheIndex );
+    FFrameFuture* findLocked( uint64_t Id );
+
+private:
+    mutable std::mutex      mLock;
+    std::condition_variable mIdleCv;
+    std::deque<FEntry>      mEntries;
+    std::vector<FDecoded>   mCache; //!< Most recently used first; includes jobs in flight
+    uint64_t                mNextId      = 0;
+    size_t                  mNumBytes    = 0;
+    size_t                  mNumInFlight = 0;
+    size_t                  mBudgetBytes;
+    size_t                  mMaxFrames;
+    size_t                  mNumCached;
+};
@@ -0,0 +1,336 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "point_cloud.hpp"
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <ostream>
+#include <stdio.h>
+#include <string.h>
+#include <unordered_map>
+#include "../utility/thread_pool.hpp"
+
+using namespace std;
+
+static constexpr float DTOR = 3.14159265358979f / 180.f;
+
+void FPointCloud::Resize( size_t NumPoints )
+{
+    X.resize( NumPoints );
+    Y.resize( NumPoints );
+    Z.resize( NumPoints );
+    Amp.resize( NumPoints );
+}
+
+void FPointCloud::Clear() noexcept
+{
+    X.clear();
+    Y.clear();
+    Z.clear();
+    Amp.clear();
+}
+
+FPointCloudBuilder::FPointCloudBuilder( FThreadPool* Pool ) noexcept
+    : mPool( Pool ? Pool : &FThreadPool::Shared() )
+{
+}
+
+void FPointCloudBuilder::Configure(
+  FDeviceStat const& Stat,
+  int                Width,
+  int                Height,
+  int                HorizontalCalib )
+{
+    auto& G = mGeometry;
+    if ( bConfigured
+         && mWidth == Width && mHeight == Height && mCalib == HorizontalCalib
+         && G.OfstX == Stat.OfstX && G.OfstY == Stat.OfstY
+         && G.StepPerPxlX == Stat.StepPerPxlX && G.StepPerPxlY == Stat.StepPerPxlY
+         && G.DegreePerStepX == Stat.DegreePerStepX && G.DegreePerStepY == Stat.DegreePerStepY )
+    {
+        return;
+    }
+
+    G           = Stat;
+    mWidth      = Width;
+    mHeight     = Height;
+    mCalib      = HorizontalCalib;
+    bConfigured = true;
+
+    // Offsets are transferred as unsigned, though they may be negative.
+    auto const OfstX = (int32_t)Stat.OfstX;
+    auto const OfstY = (int32_t)Stat.OfstY;
+
+    // Odd rows are captured in reverse direction, which results in shift of
+    // the column by calibration value.
+    for ( int Parity = 0; Parity < 2; Parity++ )
+    {
+        auto& S = mColSin[Parity];
+        auto& C = mColCos[Parity];
+        S.resize( Width );
+        C.resize( Width );
+
+        auto const Shift = Parity ? -HorizontalCalib : 0;
+        for ( int j = 0; j < Width; j++ )
+        {
+            auto const Step  = OfstX + ( j + Shift ) * (int)Stat.StepPerPxlX;
+            auto const Theta = Step * Stat.DegreePerStepX * DTOR;
+            S[j]             = sinf( Theta );
+            C[j]             = cosf( Theta );
+        }
+    }
+
+    mRowSin.resize( Height );
+    mRowCos.resize( Height );
+    for ( int i = 0; i < Height; i++ )
+    {
+        auto const Step = OfstY + i * (int)Stat.StepPerPxlY;
+        auto const Phi  = Step * Stat.DegreePerStepY * DTOR;
+        mRowSin[i]      = sinf( Phi );
+        mRowCos[i]      = cosf( Phi );
+    }
+}
+
+void FPointCloudBuilder::convertRows(
+  FScanImageDesc const& Image,
+  FPointCloud&          Out,
+  int                   RowBegin,
+  int                   RowEnd ) const noexcept
+{
+    constexpr float QTOF = 1.0f / Q9_22_ONE_INT;
+    constexpr float ATOF = 1.0f / UQ12_4_ONE_INT;
+    auto const      W    = mWidth;
+
+    for ( int i = RowBegin; i < RowEnd; i++ )
+    {
+        auto const  Ofst = (size_t)i * W;
+        auto const* Src  = Image.CData() + Ofst;
+        auto const* Sn   = mColSin[i & 1].data();
+        auto const* Cs   = mColCos[i & 1].data();
+        float const Sp   = mRowSin[i];
+        float const Cp   = mRowCos[i];
+
+        float* __restrict X = Out.X.data() + Ofst;
+        float* __restrict Y = Out.Y.data() + Ofst;
+        float* __restrict Z = Out.Z.data() + Ofst;
+        float* __restrict A = Out.Amp.data() + Ofst;
+
+        // Branchless loop over contiguous arrays; compilers vectorize this.
+        for ( int j = 0; j < W; j++ )
+        {
+            float const R  = Src[j].Distance * QTOF;
+            float const Rc = R * Cp;
+            X[j]           = Rc * Sn[j];
+            Y[j]           = R * Sp;
+            Z[j]           = Rc * Cs[j];
+            A[j]           = Src[j].AMP * ATOF;
+        }
+    }
+}
+
+//! Removes points whose distance is out of range, keeping the order.
+static void CompactInvalid( FPointCloud& Out, FPointCloudParam const& Param )
+{
+    auto const MinSq = Param.MinDistance * Param.MinDistance;
+    auto const MaxSq = Param.MaxDistance * Param.MaxDistance;
+    size_t     Head  = 0;
+
+    for ( size_t i = 0, n = Out.Size(); i < n; i++ )
+    {
+        auto const x = Out.X[i], y = Out.Y[i], z = Out.Z[i];
+        auto const D = x * x + y * y + z * z;
+        if ( D < MinSq || D > MaxSq )
+            continue;
+
+        Out.X[Head]   = x;
+        Out.Y[Head]   = y;
+        Out.Z[Head]   = z;
+        Out.Amp[Head] = Out.Amp[i];
+        ++Head;
+    }
+
+    Out.Resize( Head );
+}
+
+bool FPointCloudBuilder::Build(
+  FScanImageDesc const&   Image,
+  FDeviceStat const&      Stat,
+  FPointCloud&            Out,
+  FPointCloudParam const& Param )
+{
+    if ( Image.CData() == nullptr || Image.Width <= 0 || Image.Height <= 0 )
+        return false;
+    if ( Stat.SizeX != (uint32_t)Image.Width || Stat.SizeY != (uint32_t)Image.Height )
+        return false;
+
+    Configure( Stat, Image.Width, Image.Height, Param.HorizontalCalib );
+    Out.Resize( (size_t)Image.Width * Image.Height );
+
+    // Split rows into bands on the pool for large frames.
+    auto const NumThreads = Param.NumThreads ? Param.NumThreads : mPool->NumThreads();
+    auto const Height     = (size_t)Image.Height;
+    auto const MinRow     = max<size_t>( 1, Param.MinRowsPerTask );
+    auto const NumBands   = max<size_t>( 1, min( NumThreads, ( Height + MinRow - 1 ) / MinRow ) );
+
+    if ( NumBands == 1 )
+    {
+        convertRows( Image, Out, 0, (int)Height );
+    }
+    else
+    {
+        mPool->ParallelFor( 0, NumBands, 1, [&]( size_t Begin, size_t End ) {
+            for ( auto b = Begin; b < End; b++ )
+                convertRows( Image, Out, int( Height * b / NumBands ), int( Height * ( b + 1 ) / NumBands ) );
+        } );
+    }
+
+    if ( Param.bSkipInvalid )
+        CompactInvalid( Out, Param );
+
+    return true;
+}
+
+void FPointCloudBuilder::BuildPoints(
+  FPointSample const*     Samples,
+  size_t                  NumSamples,
+  FPointCloud&            Out,
+  FPointCloudParam const& Param )
+{
+    constexpr float QTOF = 1.0f / Q9_22_ONE_INT;
+    constexpr float ATOF = 1.0f / UQ12_4_ONE_INT;
+
+    Out.Resize( NumSamples );
+    for ( size_t i = 0; i < NumSamples; i++ )
+    {
+        auto const& S     = Samples[i];
+        float const R     = S.V.Distance * QTOF;
+        float const Theta = S.AngleX * DTOR;
+        float const Phi   = S.AngleY * DTOR;
+        float const Rc    = R * cosf( Phi );
+
+        Out.X[i]   = Rc * sinf( Theta );
+        Out.Y[i]   = R * sinf( Phi );
+        Out.Z[i]   = Rc * cosf( Theta );
+        Out.Amp[i] = S.V.AMP * ATOF;
+    }
+
+    if ( Param.bSkipInvalid )
+        CompactInvalid( Out, Param );
+}
+
+size_t FPointCloudBuilder::PairPointRequests(
+  FPointData const*          Data,
+  size_t                     NumData,
+  FPointReq const*           Reqs,
+  size_t                     NumReqs,
+  FDeviceStat const&         Stat,
+  std::vector<FPointSample>& Out )
+{
+    unordered_map<uint32_t, FPointReq const*> Lookup;
+    Lookup.reserve( NumReqs );
+    for ( size_t i = 0; i < NumReqs; i++ )
+        Lookup[Reqs[i].ID] = Reqs + i;
+
+    Out.clear();
+    Out.reserve( NumData );
+    for ( size_t i = 0; i < NumData; i++ )
+    {
+        auto It = Lookup.find( Data[i].ID );
+        if ( It == Lookup.end() )
+            continue;
+
+        auto& S  = Out.emplace_back();
+        S.V      = Data[i].V;
+        S.AngleX = It->second->X * Stat.DegreePerStepX;
+        S.AngleY = It->second->Y * Stat.DegreePerStepY;
+    }
+
+    return Out.size();
+}
+
+bool scanlib::PointCloudWriteTo(
+  std::ostream&     Strm,
+  FPointCloud const& Cloud,
+  EPointCloudFormat Format )
+{
+    enum
+    {
+        CHUNK_SIZE = 1 << 16
+    };
+    char       Chunk[CHUNK_SIZE];
+    size_t     Fill = 0;
+    auto const N    = Cloud.Size();
+
+    auto Flush = [&]() {
+        Strm.write( Chunk, Fill );
+        Fill = 0;
+    };
+
+    switch ( Format )
+    {
+    case EPointCloudFormat::PLY_BINARY:
+    {
+        Strm << "ply\n"
+                "format binary_little_endian 1.0\n"
+                "comment generated by scanlib\n"
+             << "element vertex " << N << "\n"
+             << "property float x\n"
+                "property float y\n"
+                "property float z\n"
+                "property float intensity\n"
+                "end_header\n";
+
+        // Interleave SoA arrays into vertex records.
+        constexpr size_t RECORD = sizeof( float ) * 4;
+        for ( size_t i = 0; i < N; i++ )
+        {
+            if ( Fill + RECORD > CHUNK_SIZE )
+                Flush();
+
+            float const Rec[] = { Cloud.X[i], Cloud.Y[i], Cloud.Z[i], Cloud.Amp[i] };
+            memcpy( Chunk + Fill, Rec, RECORD );
+            Fill += RECORD;
+        }
+    }
+    break;
+
+    case EPointCloudFormat::XYZ:
+    {
+        // Largest float printed with %.5f takes 46 characters, with sign.
+        enum
+        {
+            MAX_LINE = 192
+        };
+        for ( size_t i = 0; i < N; i++ )
+        {
+            if ( Fill + MAX_LINE > CHUNK_SIZE )
+                Flush();
+
+            auto const Len = snprintf(
+              Chunk + Fill,
+              MAX_LINE,
+              "%.5f %.5f %.5f %.2f\n",
+              Cloud.X[i],
+              Cloud.Y[i],
+              Cloud.Z[i],
+              Cloud.Amp[i] );
+            if ( Len < 0 )
+                return false;
+
+            // Truncated line never advances past what has been written.
+            Fill += min<size_t>( Len, MAX_LINE - 1 );
+        }
+    }
+    break;
+
+    default:
+        return false;
+    }
+
+    Flush();
+    return Strm.good();
+}
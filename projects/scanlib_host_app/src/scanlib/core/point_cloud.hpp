@@ -0,0 +1,125 @@
+//! Point cloud generation from scanned frames.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Converts the spherical measurements of the scanner into cartesian points.
+//! Motor X axis is treated as yaw(theta), Y axis as pitch(phi), then
+//!
+//!     x = r * cos(phi) * sin(theta)
+//!     y = r * sin(phi)
+//!     z = r * cos(phi) * cos(theta)
+//!
+//! Angles of each column/row are fixed for a frame, thus sine/cosine values are
+//! precomputed into per-column and per-row tables and the inner loop reduces to
+//! a few multiplications over contiguous arrays.
+#pragma once
+#include <iosfwd>
+#include <vector>
+#include "../common/scanner_protocol.h"
+#include "scanner_protocol_handler.hpp"
+
+class FThreadPool;
+
+//! Point cloud in structure-of-arrays layout.
+//! Unit of coordinates is meter.
+struct FPointCloud
+{
+    std::vector<float> X;
+    std::vector<float> Y;
+    std::vector<float> Z;
+    std::vector<float> Amp;
+
+    size_t Size() const noexcept { return X.size(); }
+    void   Resize( size_t NumPoints );
+    void   Clear() noexcept;
+};
+
+//! Point mode sample. Received data paired with its requested angle.
+struct FPointSample
+{
+    FPxlData V;      //!< Received value
+    float    AngleX; //!< Requested yaw angle in degree
+    float    AngleY; //!< Requested pitch angle in degree
+};
+
+//! Point cloud conversion options
+struct FPointCloudParam
+{
+    bool   bSkipInvalid    = true;   //!< Discard points out of distance range
+    float  MinDistance     = 1e-3f;  //!< Minimum valid distance in meter
+    float  MaxDistance     = 256.f;  //!< Maximum valid distance in meter
+    int    HorizontalCalib = 0;      //!< Odd row shift in pixels. Same as viewer's.
+    size_t NumThreads      = 0;      //!< Row bands to split into. 0 for pool size.
+    size_t MinRowsPerTask  = 32;     //!< Frames smaller than this run inline.
+};
+
+//! Converts scanned frames into point clouds.
+//! Keeps trig tables of the latest geometry, thus reusing single instance for
+//! consecutive frames of same configuration avoids recalculation.
+class FPointCloudBuilder
+{
+public:
+    //! @param      Pool: Pool to run on. nullptr for shared pool.
+    explicit FPointCloudBuilder( FThreadPool* Pool = nullptr ) noexcept;
+
+    //! @brief      Rebuild trig tables if geometry of given stat differs from
+    //!             the cached one.
+    void Configure( FDeviceStat const& Stat, int Width, int Height, int HorizontalCalib = 0 );
+
+    //! @brief      Convert frame into point cloud.
+    //! @returns    false if image is empty or its size mismatches with stat.
+    bool Build(
+      FScanImageDesc const&   Image,
+      FDeviceStat const&      Stat,
+      FPointCloud&            Out,
+      FPointCloudParam const& Param = {} );
+
+    //! @brief      Convert point mode samples into point cloud.
+    static void BuildPoints(
+      FPointSample const*     Samples,
+      size_t                  NumSamples,
+      FPointCloud&            Out,
+      FPointCloudParam const& Param = {} );
+
+    //! @brief      Pair received point data with their requests by ID.
+    //!             Requests are given in motor steps, as they're sent to device.
+    //! @returns    Number of paired samples.
+    static size_t PairPointRequests(
+      FPointData const*          Data,
+      size_t                     NumData,
+      FPointReq const*           Reqs,
+      size_t                     NumReqs,
+      FDeviceStat const&         Stat,
+      std::vector<FPointSample>& Out );
+
+private:
+    void convertRows( FScanImageDesc const& Image, FPointCloud& Out, int RowBegin, int RowEnd ) const noexcept;
+
+private:
+    FThreadPool*       mPool        = {};
+    FDeviceStat        mGeometry    = {};
+    int                mWidth       = 0;
+    int                mHeight      = 0;
+    int                mCalib       = 0;
+    bool               bConfigured  = false;
+    std::vector<float> mColSin[2]   = {}; //!< [even, odd] row column tables
+    std::vector<float> mColCos[2]   = {};
+    std::vector<float> mRowSin      = {};
+    std::vector<float> mRowCos      = {};
+};
+
+namespace scanlib {
+enum class EPointCloudFormat
+{
+    PLY_BINARY, //!< Binary little endian PLY, x y z intensity
+    XYZ,        //!< ASCII 'x y z amp' per line
+};
+
+//! @brief      Stream point cloud into given stream.
+//!             Data is staged through fixed size chunk, thus no additional
+//!             allocation occurs for large clouds.
+//! @returns    false if stream went bad during write.
+bool PointCloudWriteTo( std::ostream& Strm, FPointCloud const& Cloud, EPointCloudFormat Format );
+} // namespace scanlib
@@ -0,0 +1,318 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "sample_path.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include "../utility/thread_pool.hpp"
+#include "../utility/trace.hpp"
+
+using namespace std;
+
+double FMotionModel::AxisTime( double Steps, double MaxSpeed, double Accel ) noexcept
+{
+    Steps = abs( Steps );
+    if ( Steps <= 0 )
+        return 0;
+    if ( Accel <= 0 )
+        return Steps / MaxSpeed;
+
+    // Triangular profile if it never reaches the top speed.
+    if ( Steps < MaxSpeed * MaxSpeed / Accel )
+        return 2.0 * sqrt( Steps / Accel );
+    return Steps / MaxSpeed + MaxSpeed / Accel;
+}
+
+double FMotionModel::MoveTime( float dx, float dy ) const noexcept
+{
+    return max( AxisTime( dx, MaxSpeed[0], Accel[0] ), AxisTime( dy, MaxSpeed[1], Accel[1] ) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Tour of nodes; node 0 is the start point and never moves.
+struct FSamplePathPlanner::FTour
+{
+    vector<uint32_t> Node;
+    vector<uint32_t> Pos;
+    double           Cost = 0;
+
+    void UpdatePos( size_t Begin, size_t End )
+    {
+        for ( auto i = Begin; i < End; i++ )
+            Pos[Node[i]] = uint32_t( i );
+    }
+};
+
+FSamplePathPlanner::FSamplePathPlanner( FThreadPool* Pool ) noexcept
+    : mPool( Pool ? Pool : &FThreadPool::Shared() )
+{
+}
+
+void FSamplePathPlanner::buildCandidates( int NumCandidates )
+{
+    auto const NumNodes = mX.size();
+    mNumCandidates      = int( min<size_t>( NumCandidates, NumNodes - 1 ) );
+    mCandidates.assign( NumNodes * mNumCandidates, 0 );
+
+    // Sweep outward in X order; X axis time alone bounds the move time, thus
+    // the sweep stops as soon as it can't beat the farthest candidate found.
+    vector<uint32_t> ByX( NumNodes );
+    vector<uint32_t> RankX( NumNodes );
+    iota( ByX.begin(), ByX.end(), 0 );
+    sort( ByX.begin(), ByX.end(), [&]( auto a, auto b ) { return mX[a] < mX[b]; } );
+    for ( size_t i = 0; i < NumNodes; i++ )
+        RankX[ByX[i]] = uint32_t( i );
+
+    auto const& M = mMotion;
+    mPool->ParallelFor( 0, NumNodes, 64, [&]( size_t Begin, size_t End ) {
+        vector<pair<double, uint32_t>> Best;
+        for ( auto n = Begin; n < End; n++ )
+        {
+            Best.clear();
+            auto const Visit = [&]( uint32_t m ) {
+                auto const Cost = M.MoveTime( mX[m] - mX[n], mY[m] - mY[n] );
+                if ( Best.size() < size_t( mNumCandidates ) )
+                {
+                    Best.emplace_back( Cost, m );
+                    push_heap( Best.begin(), Best.end() );
+                }
+                else if ( Cost < Best.front().first )
+                {
+                    pop_heap( Best.begin(), Best.end() );
+                    Best.back() = { Cost, m };
+                    push_heap( Best.begin(), Best.end() );
+                }
+            };
+            auto const Bound = [&]( uint32_t m ) {
+                return Best.size() == size_t( mNumCandidates )
+                       && FMotionModel::AxisTime( mX[m] - mX[n], M.MaxSpeed[0], M.Accel[0] ) >= Best.front().first;
+            };
+
+            auto const r = RankX[n];
+            for ( size_t lo = r, hi = r + 1; lo > 0 || hi < NumNodes; )
+            {
+                bool bLo = lo > 0 && !Bound( ByX[lo - 1] );
+                bool bHi = hi < NumNodes && !Bound( ByX[hi] );
+                if ( !bLo && !bHi )
+                    break;
+                if ( bLo )
+                    Visit( ByX[--lo] );
+                if ( bHi )
+                    Visit( ByX[hi++] );
+            }
+
+            sort_heap( Best.begin(), Best.end() );
+            auto Dst = &mCandidates[n * mNumCandidates];
+            for ( int k = 0; k < mNumCandidates; k++ )
+                Dst[k] = Best[k].second;
+        }
+    } );
+}
+
+double FSamplePathPlanner::Plan(
+  FSamplePathParam const& Param,
+  float const*            X,
+  float const*            Y,
+  size_t                  NumPoints,
+  float                   StartX,
+  float                   StartY,
+  vector<uint32_t>&       Order )
+{
+    SCANLIB_TRACE_SCOPE( "plan path" );
+    Order.resize( NumPoints );
+    iota( Order.begin(), Order.end(), 0 );
+    mMotion = Param.Motion;
+    if ( NumPoints < 2 )
+        return PathTime( mMotion, X, Y, Order.data(), NumPoints, StartX, StartY );
+
+    using clock_type    = chrono::steady_clock;
+    auto const Deadline = clock_type::now() + chrono::microseconds( int64_t( Param.TimeBudgetMs * 1e3 ) );
+
+    auto const NumNodes = NumPoints + 1;
+    mX.resize( NumNodes );
+    mY.resize( NumNodes );
+    mX[0] = StartX, mY[0] = StartY;
+    copy( X, X + NumPoints, mX.begin() + 1 );
+    copy( Y, Y + NumPoints, mY.begin() + 1 );
+    buildCandidates( max( 1, Param.NumCandidates ) );
+
+    auto const& M    = mMotion;
+    auto const  Cost = [&]( uint32_t a, uint32_t b ) { return M.MoveTime( mX[b] - mX[a], mY[b] - mY[a] ); };
+    auto const  K    = mNumCandidates;
+    auto const  Last = NumNodes - 1;
+
+    auto NumStarts = Param.NumStarts > 0 ? size_t( Param.NumStarts ) : max<size_t>( 1, mPool->NumThreads() );
+    vector<FTour> Tours( NumStarts );
+
+    mPool->ParallelFor( 0, NumStarts, 1, [&]( size_t Begin, size_t End ) {
+        for ( auto s = Begin; s < End; s++ )
+        {
+            auto& T = Tours[s];
+            T.Node.resize( NumNodes );
+            T.Pos.resize( NumNodes );
+            mt19937 Rand( static_cast<uint32_t>( s ) );
+
+            // Nearest neighbour seed. Tours other than the first sometimes take
+            // the second nearest, to give local search different basins.
+            vector<char> bVisited( NumNodes, 0 );
+            uint32_t     Cur = 0;
+            bVisited[0]      = 1;
+            T.Node[0]        = 0;
+            for ( size_t i = 1; i < NumNodes; i++ )
+            {
+                uint32_t Pick[2] = { UINT32_MAX, UINT32_MAX };
+                int      NumPick = 0;
+                auto     Cand    = &mCandidates[Cur * K];
+                for ( int k = 0; k < K && NumPick < 2; k++ )
+                    if ( !bVisited[Cand[k]] )
+                        Pick[NumPick++] = Cand[k];
+
+                if ( NumPick == 0 )
+                {
+                    double BestCost = numeric_limits<double>::max();
+                    for ( uint32_t m = 1; m < NumNodes; m++ )
+                        if ( !bVisited[m] )
+                            if ( auto c = Cost( Cur, m ); c < BestCost )
+                                BestCost = c, Pick[0] = m;
+                    NumPick = 1;
+                }
+
+                Cur = s > 0 && NumPick == 2 && Rand() % 4 == 0 ? Pick[1] : Pick[0];
+                bVisited[Cur] = 1;
+                T.Node[i]     = Cur;
+            }
+            T.UpdatePos( 0, NumNodes );
+
+            // Local search
+            auto const Edge = [&]( size_t i ) { return i < Last ? Cost( T.Node[i], T.Node[i + 1] ) : 0.0; };
+
+            // Reverses [i, j]. Cost is symmetric, so only two edges change.
+            auto const TwoOpt = [&]( size_t i, size_t j ) {
+                if ( i < 1 || j <= i || j > Last )
+                    return false;
+                auto const a = T.Node[i - 1], b = T.Node[i], c = T.Node[j];
+                auto const Before = Cost( a, b ) + Edge( j );
+                auto const After  = Cost( a, c ) + ( j < Last ? Cost( b, T.Node[j + 1] ) : 0.0 );
+                if ( After >= Before - 1e-9 )
+                    return false;
+
+                reverse( T.Node.begin() + i, T.Node.begin() + j + 1 );
+                T.UpdatePos( i, j + 1 );
+                return true;
+            };
+
+            // Moves [i, i + L) right after position k, reversed if that is cheaper.
+            auto const OrOpt = [&]( size_t i, size_t L, size_t k ) {
+                auto const j = i + L - 1;
+                if ( i < 1 || j > Last || ( k + 1 >= i && k <= j ) )
+                    return false;
+
+                auto const p = T.Node[i - 1], s1 = T.Node[i], s2 = T.Node[j];
+                auto const Removed = Cost( p, s1 ) + Edge( j ) - ( j < Last ? Cost( p, T.Node[j + 1] ) : 0.0 );
+                auto const c       = T.Node[k];
+                auto const bEnd    = k == Last;
+                auto const Gap     = bEnd ? 0.0 : Cost( c, T.Node[k + 1] );
+                auto const Fwd     = Cost( c, s1 ) + ( bEnd ? 0.0 : Cost( s2, T.Node[k + 1] ) ) - Gap;
+                auto const Rev     = Cost( c, s2 ) + ( bEnd ? 0.0 : Cost( s1, T.Node[k + 1] ) ) - Gap;
+                auto const bFlip   = Rev < Fwd;
+                if ( min( Fwd, Rev ) >= Removed - 1e-9 )
+                    return false;
+
+                auto const Base = T.Node.begin();
+                if ( bFlip )
+                    reverse( Base + i, Base + j + 1 );
+                if ( k < i )
+                {
+                    rotate( Base + k + 1, Base + i, Base + j + 1 );
+                    T.UpdatePos( k + 1, j + 1 );
+                }
+                else
+                {
+                    rotate( Base + i, Base + j + 1, Base + k + 1 );
+                    T.UpdatePos( i, k + 1 );
+                }
+                return true;
+            };
+
+            for ( bool bImproved = true; bImproved; )
+            {
+                bImproved = false;
+                for ( uint32_t n = 0; n < NumNodes; n++ )
+                {
+                    if ( ( n & 63 ) == 0 && clock_type::now() > Deadline )
+                        goto DONE;
+
+                    auto Cand = &mCandidates[n * K];
+                    for ( int k = 0; k < K; k++ )
+                    {
+                        size_t p = T.Pos[n], q = T.Pos[Cand[k]];
+                        if ( p > q )
+                            swap( p, q );
+
+                        // New edge (Node[p], Node[q]) by either reversal.
+                        if ( TwoOpt( p + 1, q ) || TwoOpt( p, q - 1 ) )
+                        {
+                            bImproved = true;
+                            break;
+                        }
+                    }
+
+                    // Move a short segment starting at n next to its candidates.
+                    for ( size_t L = 1; L <= 3; L++ )
+                    {
+                        bool         bMoved = false;
+                        size_t const i      = T.Pos[n];
+                        for ( int k = 0; k < K && !bMoved; k++ )
+                        {
+                            size_t const q = T.Pos[Cand[k]];
+                            bMoved         = OrOpt( i, L, q ) || ( q > 0 && OrOpt( i, L, q - 1 ) );
+                        }
+                        if ( bMoved )
+                        {
+                            bImproved = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        DONE:;
+
+            T.Cost = 0;
+            for ( size_t i = 0; i < Last; i++ )
+                T.Cost += Edge( i );
+        }
+    } );
+
+    auto& Best = *min_element( Tours.begin(), Tours.end(), []( auto& a, auto& b ) { return a.Cost < b.Cost; } );
+    for ( size_t i = 0; i < NumPoints; i++ )
+        Order[i] = Best.Node[i + 1] - 1;
+
+    return Best.Cost + NumPoints * double( mMotion.DwellSec );
+}
+
+double FSamplePathPlanner::PathTime(
+  FMotionModel const& Motion,
+  float const*        X,
+  float const*        Y,
+  uint32_t const*     Order,
+  size_t              NumPoints,
+  float               StartX,
+  float               StartY ) noexcept
+{
+    double Sum = 0;
+    float  px = StartX, py = StartY;
+    for ( size_t i = 0; i < NumPoints; i++ )
+    {
+        auto const n = Order[i];
+        Sum += Motion.MoveTime( X[n] - px, Y[n] - py ) + Motion.DwellSec;
+        px = X[n], py = Y[n];
+    }
+    return Sum;
+}
@@ -0,0 +1,82 @@
+//! Sampling order planner for point capture mode.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Point sampling time is dominated by motor travel, and the two axes differ
+//! a lot in acceleration. Travel between points is costed with trapezoidal
+//! velocity profile per axis; axes move together, thus the slower one decides.
+//!
+//! Tour begins at the current head position and ends anywhere. Each worker
+//! builds a nearest neighbour tour (randomized on all but the first), then
+//! improves it with 2-opt and Or-opt moves restricted to candidate lists
+//! until no move helps or the time budget runs out. The best tour wins.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class FThreadPool;
+
+struct FMotionModel
+{
+    float MaxSpeed[2] = { 52400.f, 52400.f };   //!< X, Y steps per second
+    float Accel[2]    = { 32400.f, 544800.f };  //!< X, Y steps per second^2
+    float DwellSec    = 0.006f;                 //!< Time spent on each sample
+
+    //! @brief      Travel time of single axis.
+    static double AxisTime( double Steps, double MaxSpeed, double Accel ) noexcept;
+
+    //! @brief      Travel time between two points, excluding dwell.
+    double MoveTime( float dx, float dy ) const noexcept;
+};
+
+struct FSamplePathParam
+{
+    FMotionModel Motion;
+    double       TimeBudgetMs  = 50.0; //!< Wall time allowed for improvement
+    int          NumCandidates = 10;   //!< Nearest neighbours considered per point
+    int          NumStarts     = 0;    //!< Tours built in parallel. 0 for pool size
+};
+
+class FSamplePathPlanner
+{
+public:
+    //! @param      Pool: Pool to run on. nullptr for shared pool.
+    explicit FSamplePathPlanner( FThreadPool* Pool = nullptr ) noexcept;
+
+    //! @brief      Order points for minimum predicted sampling time.
+    //! @param      X, Y: Point coordinates in motor steps.
+    //! @param      Order: Indices of points in visiting order.
+    //! @returns    Predicted sampling time in seconds, including dwell.
+    double Plan(
+      FSamplePathParam const& Param,
+      float const*            X,
+      float const*            Y,
+      size_t                  NumPoints,
+      float                   StartX,
+      float                   StartY,
+      std::vector<uint32_t>&  Order );
+
+    //! @brief      Predicted sampling time of given order.
+    static double PathTime(
+      FMotionModel const& Motion,
+      float const*        X,
+      float const*        Y,
+      uint32_t const*     Order,
+      size_t              NumPoints,
+      float               StartX,
+      float               StartY ) noexcept;
+
+private:
+    struct FTour;
+    void buildCandidates( int NumCandidates );
+
+private:
+    FThreadPool*          mPool = {};
+    FMotionModel          mMotion;
+    std::vector<float>    mX, mY;     //!< Start point at index 0, then points
+    std::vector<uint32_t> mCandidates; //!< NumCandidates per node
+    int                   mNumCandidates = 0;
+};
@@ -0,0 +1,99 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "scan_histogram.hpp"
+#include <algorithm>
+
+using namespace std;
+
+FScanHistogram::FScanHistogram( float MaxDistance, int NumDistanceBins )
+    : mDistance( max( 1, NumDistanceBins ) )
+    , mAmplitude( AMPLITUDE_BINS )
+    , mMaxDistance( MaxDistance > 0.f ? MaxDistance : 1.f )
+{
+    mBinScale = mDistance.size() / ( mMaxDistance * Q9_22_ONE_INT );
+}
+
+void FScanHistogram::Reset() noexcept
+{
+    fill( mDistance.begin(), mDistance.end(), 0 );
+    fill( mAmplitude.begin(), mAmplitude.end(), 0 );
+    mNumValid = 0;
+}
+
+int FScanHistogram::distanceBin( q9_22_t Distance ) const noexcept
+{
+    return min( int( Distance * mBinScale ), int( mDistance.size() ) - 1 );
+}
+
+void FScanHistogram::Add( FPxlData const* Pixels, size_t Count ) noexcept
+{
+    for ( size_t i = 0; i < Count; i++ )
+    {
+        auto const V = Pixels[i];
+        if ( V.Distance <= 0 )
+            continue;
+
+        mDistance[distanceBin( V.Distance )]++;
+        mAmplitude[V.AMP >> 4]++;
+        mNumValid++;
+    }
+    mGeneration += Count;
+}
+
+void FScanHistogram::Remove( FPxlData const* Pixels, size_t Count ) noexcept
+{
+    for ( size_t i = 0; i < Count; i++ )
+    {
+        auto const V = Pixels[i];
+        if ( V.Distance <= 0 )
+            continue;
+
+        // Removing pixels never added is caller's mistake; keep counts sane.
+        auto& D = mDistance[distanceBin( V.Distance )];
+        auto& A = mAmplitude[V.AMP >> 4];
+        if ( D == 0 || A == 0 || mNumValid == 0 )
+            continue;
+
+        D--;
+        A--;
+        mNumValid--;
+    }
+}
+
+void FScanHistogram::Build( FPxlData const* Pixels, size_t Count ) noexcept
+{
+    Reset();
+    Add( Pixels, Count );
+}
+
+static float Percentile( vector<uint32_t> const& Bins, size_t Total, double P, float BinWidth )
+{
+    if ( Total == 0 )
+        return 0.f;
+
+    // Interpolated linearly inside the bin holding the target sample.
+    auto const Target = clamp( P, 0.0, 1.0 ) * Total;
+    double     Acc    = 0;
+    for ( size_t i = 0; i < Bins.size(); i++ )
+    {
+        if ( Bins[i] && Acc + Bins[i] >= Target )
+            return float( ( i + ( Target - Acc ) / Bins[i] ) * BinWidth );
+        Acc += Bins[i];
+    }
+
+    return Bins.size() * BinWidth;
+}
+
+float FScanHistogram::DistancePercentile( double P ) const noexcept
+{
+    return Percentile( mDistance, mNumValid, P, DistanceBinWidth() );
+}
+
+float FScanHistogram::AmplitudePercentile( double P ) const noexcept
+{
+    return Percentile( mAmplitude, mNumValid, P, 1.f );
+}
@@ -0,0 +1,64 @@
+//! Incremental histogram of distance and amplitude.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Counts are kept in fixed bins, so that pixels can be added and removed as
+//! lines arrive or get overwritten, and percentiles are found in O(bins)
+//! without touching the frame again. Only valid(positive distance) pixels are
+//! counted, for both channels.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "../common/scanner_protocol.h"
+
+class FScanHistogram
+{
+public:
+    enum
+    {
+        DEFAULT_DISTANCE_BINS = 8192,
+        AMPLITUDE_BINS        = 4096, //!< One per integer step of UQ12.4
+    };
+
+public:
+    //! @param      MaxDistance: Distance of the last bin in meter. Farther
+    //!             samples are counted into the last bin.
+    explicit FScanHistogram( float MaxDistance = 512.f, int NumDistanceBins = DEFAULT_DISTANCE_BINS );
+
+    void Reset() noexcept;
+    void Add( FPxlData const* Pixels, size_t Count ) noexcept;
+    void Remove( FPxlData const* Pixels, size_t Count ) noexcept;
+
+    //! @brief      Reset, then add all pixels of a frame.
+    void Build( FPxlData const* Pixels, size_t Count ) noexcept;
+
+    size_t NumValid() const noexcept { return mNumValid; }
+
+    //! @brief      Increases on every pixel added. Lets consumers skip
+    //!             recomputation until enough has changed.
+    uint64_t Generation() const noexcept { return mGeneration; }
+
+    //! @brief      Distance below which the given ratio of samples lie.
+    //! @param      P: Ratio in [0, 1]
+    //! @returns    Distance in meter. 0 if there's no sample.
+    float DistancePercentile( double P ) const noexcept;
+
+    //! @brief      Same as above, in integer units of amplitude.
+    float AmplitudePercentile( double P ) const noexcept;
+
+    float DistanceBinWidth() const noexcept { return mMaxDistance / mDistance.size(); }
+
+private:
+    int distanceBin( q9_22_t Distance ) const noexcept;
+
+private:
+    std::vector<uint32_t> mDistance;
+    std::vector<uint32_t> mAmplitude;
+    float                 mMaxDistance;
+    float                 mBinScale; //!< Q9.22 distance to bin index
+    size_t                mNumValid   = 0;
+    uint64_t              mGeneration = 0;
+};
@@ -0,0 +1,271 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "scan_pyramid.hpp"
+#include <algorithm>
+#include <assert.h>
+#include <iostream>
+#include <string.h>
+
+using namespace std;
+
+#pragma pack( push, 2 )
+typedef struct
+{
+    char     dptp[4]; // Must be 'dptp'
+    uint32_t CHUNK_SIZE;
+    uint32_t WIDTH;
+    uint32_t HEIGHT;
+    uint32_t TILE_SIZE;
+    uint32_t NUM_LEVELS; // Number of stored levels, excluding level 0
+} FPyramidChunkHeader;
+
+typedef struct
+{
+    uint32_t WIDTH;
+    uint32_t HEIGHT;
+} FPyramidLevelHeader;
+#pragma pack( pop )
+
+static inline int DivCeil( int a, int b ) { return ( a + b - 1 ) / b; }
+
+void FScanPyramid::Reset( int Width, int Height, int TileSize )
+{
+    mWidth    = max( 0, Width );
+    mHeight   = max( 0, Height );
+    mTileSize = max( 1, TileSize );
+    mLevels.clear();
+    mBaseGeneration = generation_array( (size_t)DivCeil( mWidth, mTileSize ) * DivCeil( mHeight, mTileSize ) );
+
+    for ( int w = mWidth, h = mHeight; w > mTileSize || h > mTileSize; )
+    {
+        w = DivCeil( w, 2 );
+        h = DivCeil( h, 2 );
+
+        auto& L  = mLevels.emplace_back();
+        L.Width  = w;
+        L.Height = h;
+        L.Data.assign( (size_t)w * h, FPxlData{} );
+        L.Generation = generation_array( (size_t)DivCeil( w, mTileSize ) * DivCeil( h, mTileSize ) );
+    }
+}
+
+void FScanPyramid::Build( FPxlData const* Base, int Width, int Height, int TileSize )
+{
+    Reset( Width, Height, TileSize );
+    Attach( Base );
+
+    for ( int Level = 1; Level < NumLevels(); Level++ )
+    {
+        auto const W = LevelWidth( Level );
+        for ( int Row = 0, H = LevelHeight( Level ); Row < H; Row++ )
+            reduceSpan( Level, Row, 0, W );
+    }
+}
+
+void FScanPyramid::UpdateLine( FLineDesc const& Line )
+{
+    if ( mBase == nullptr || Empty() || Line.NumPxls == 0 )
+        return;
+
+    int Row      = (int)Line.LineIdx;
+    int ColBegin = (int)Line.OfstX;
+    int ColEnd   = min<int>( mWidth, ColBegin + (int)Line.NumPxls );
+    if ( Row >= mHeight || ColBegin >= ColEnd )
+        return;
+
+    touchTiles( 0, Row, ColBegin, ColEnd );
+
+    // Propagate to ancestors. Span of the parent is the ceiling of halves.
+    for ( int Level = 1; Level < NumLevels(); Level++ )
+    {
+        Row >>= 1;
+        ColBegin >>= 1;
+        ColEnd = DivCeil( ColEnd, 2 );
+        reduceSpan( Level, Row, ColBegin, ColEnd );
+        touchTiles( Level, Row, ColBegin, ColEnd );
+    }
+}
+
+void FScanPyramid::reduceSpan( int Level, int Row, int ColBegin, int ColEnd ) noexcept
+{
+    assert( Level >= 1 && Level < NumLevels() );
+    auto&       Dst  = mLevels[Level - 1];
+    auto const* Src  = LevelData( Level - 1 );
+    auto const  SrcW = LevelWidth( Level - 1 );
+    auto const  SrcH = LevelHeight( Level - 1 );
+
+    auto const  Y0   = Row * 2;
+    auto const  NumY = min( 2, SrcH - Y0 );
+    auto*       Out  = Dst.Data.data() + (size_t)Row * Dst.Width;
+
+    for ( int c = ColBegin; c < ColEnd; c++ )
+    {
+        auto const X0   = c * 2;
+        auto const NumX = min( 2, SrcW - X0 );
+
+        int64_t  SumDist  = 0;
+        uint32_t SumAmp   = 0;
+        int      NumValid = 0;
+        for ( int y = 0; y < NumY; y++ )
+        {
+            auto const* Head = Src + (size_t)( Y0 + y ) * SrcW + X0;
+            for ( int x = 0; x < NumX; x++ )
+            {
+                auto const V = Head[x];
+                SumAmp += V.AMP;
+                if ( V.Distance > 0 )
+                {
+                    SumDist += V.Distance;
+                    ++NumValid;
+                }
+            }
+        }
+
+        auto& O    = Out[c];
+        O.Distance = NumValid ? q9_22_t( SumDist / NumValid ) : 0;
+        O.AMP      = uq12_4_t( SumAmp / ( NumX * NumY ) );
+    }
+}
+
+void FScanPyramid::touchTiles( int Level, int Row, int ColBegin, int ColEnd ) noexcept
+{
+    auto& Gen = Level == 0 ? mBaseGeneration : mLevels[Level - 1].Generation;
+    auto  NTX = NumTilesX( Level );
+    auto  TY  = Row / mTileSize;
+
+    for ( int TX = ColBegin / mTileSize, TEnd = DivCeil( ColEnd, mTileSize ); TX < TEnd; TX++ )
+        Gen[(size_t)TY * NTX + TX].fetch_add( 1, memory_order_release );
+}
+
+int FScanPyramid::LevelWidth( int Level ) const noexcept
+{
+    return Level == 0 ? mWidth : mLevels[Level - 1].Width;
+}
+
+int FScanPyramid::LevelHeight( int Level ) const noexcept
+{
+    return Level == 0 ? mHeight : mLevels[Level - 1].Height;
+}
+
+int FScanPyramid::NumTilesX( int Level ) const noexcept
+{
+    return DivCeil( LevelWidth( Level ), mTileSize );
+}
+
+int FScanPyramid::NumTilesY( int Level ) const noexcept
+{
+    return DivCeil( LevelHeight( Level ), mTileSize );
+}
+
+FPxlData const* FScanPyramid::LevelData( int Level ) const noexcept
+{
+    return Level == 0 ? mBase : mLevels[Level - 1].Data.data();
+}
+
+bool FScanPyramid::GetTile( int Level, int TX, int TY, FTileView& Out ) const noexcept
+{
+    if ( Level < 0 || Level >= NumLevels() || TX < 0 || TY < 0
+         || TX >= NumTilesX( Level ) || TY >= NumTilesY( Level ) )
+    {
+        return false;
+    }
+
+    auto const W = LevelWidth( Level );
+    auto const H = LevelHeight( Level );
+    auto const X = TX * mTileSize;
+    auto const Y = TY * mTileSize;
+
+    Out.Data   = LevelData( Level ) + (size_t)Y * W + X;
+    Out.Stride = W;
+    Out.Width  = min( mTileSize, W - X );
+    Out.Height = min( mTileSize, H - Y );
+    return Out.Data != nullptr;
+}
+
+int FScanPyramid::SelectLevel( double Scale ) const noexcept
+{
+    int Level = 0;
+    for ( ; Level + 1 < NumLevels() && Scale <= 0.5; Scale *= 2.0 )
+        ++Level;
+    return Level;
+}
+
+uint32_t FScanPyramid::TileGeneration( int Level, int TX, int TY ) const noexcept
+{
+    auto& Gen = Level == 0 ? mBaseGeneration : mLevels[Level - 1].Generation;
+    return Gen[(size_t)TY * NumTilesX( Level ) + TX].load( memory_order_acquire );
+}
+
+template <typename Writer_>
+void FScanPyramid::writeChunk( Writer_&& Write ) const
+{
+    FPyramidChunkHeader h;
+    memcpy( h.dptp, SCAN_PYRAMID_CHUNK_HEADER, 4 );
+    h.WIDTH      = mWidth;
+    h.HEIGHT     = mHeight;
+    h.TILE_SIZE  = mTileSize;
+    h.NUM_LEVELS = (uint32_t)mLevels.size();
+    h.CHUNK_SIZE = sizeof( h ) - 8;
+    for ( auto& L : mLevels )
+        h.CHUNK_SIZE += uint32_t( sizeof( FPyramidLevelHeader ) + L.Data.size() * sizeof( FPxlData ) );
+
+    Write( &h, sizeof h );
+    for ( auto& L : mLevels )
+    {
+        FPyramidLevelHeader lh = { (uint32_t)L.Width, (uint32_t)L.Height };
+        Write( &lh, sizeof lh );
+        Write( L.Data.data(), L.Data.size() * sizeof( FPxlData ) );
+    }
+}
+
+bool FScanPyramid::WriteTo( std::ostream& Strm ) const
+{
+    writeChunk( [&Strm]( void const* Data, size_t Len ) {
+        Strm.write( (char const*)Data, Len );
+    } );
+    return Strm.good();
+}
+
+bool FScanPyramid::WriteTo( FILE* Strm ) const
+{
+    bool bOk = true;
+    writeChunk( [&]( void const* Data, size_t Len ) {
+        bOk = bOk && fwrite( Data, 1, Len, Strm ) == Len;
+    } );
+    return bOk;
+}
+
+bool FScanPyramid::ReadFrom( std::istream& Strm )
+{
+    FPyramidChunkHeader h;
+    if ( Strm.read( (char*)&h, sizeof h ).gcount() != sizeof h )
+        return false;
+    if ( memcmp( h.dptp, SCAN_PYRAMID_CHUNK_HEADER, 4 ) )
+        return false;
+
+    Reset( (int)h.WIDTH, (int)h.HEIGHT, (int)h.TILE_SIZE );
+    if ( h.NUM_LEVELS != mLevels.size() )
+    {
+        Reset( 0, 0 );
+        return false;
+    }
+
+    for ( auto& L : mLevels )
+    {
+        FPyramidLevelHeader lh;
+        auto const          Bytes = (streamsize)( L.Data.size() * sizeof( FPxlData ) );
+        if ( Strm.read( (char*)&lh, sizeof lh ).gcount() != sizeof lh
+             || lh.WIDTH != (uint32_t)L.Width || lh.HEIGHT != (uint32_t)L.Height
+             || Strm.read( (char*)L.Data.data(), Bytes ).gcount() != Bytes )
+        {
+            Reset( 0, 0 );
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,120 @@
+//! Tiled multi-resolution pyramid of scanned frame.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Level 0 is the scanned image itself, which is not owned by the pyramid.
+//! Each higher level halves the size of the previous one using 2x2 reduction;
+//! distance is averaged over valid(positive) children only, so that missing
+//! samples don't darken the preview. Levels are built until the whole image
+//! fits into single tile.
+//!
+//! Pyramid can be updated incrementally per received line, which touches only
+//! the ancestors of the line; O(NumPxls) for each line in total. Updates may
+//! run while another thread reads tiles; see TileGeneration().
+#pragma once
+#include <atomic>
+#include <iosfwd>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "../common/scanner_protocol.h"
+
+#define SCAN_PYRAMID_CHUNK_HEADER "dptp"
+
+class FScanPyramid
+{
+public:
+    enum
+    {
+        DEFAULT_TILE_SIZE = 64
+    };
+
+    //! Tile descriptor. Points into level data directly; no copy occurs.
+    struct FTileView
+    {
+        FPxlData const* Data   = {}; //!< First pixel of tile
+        int             Stride = {}; //!< Row stride in pixels
+        int             Width  = {}; //!< Valid width of this tile
+        int             Height = {}; //!< Valid height of this tile
+    };
+
+public:
+    //! @brief      Reset dimension. All levels are cleared to zero.
+    void Reset( int Width, int Height, int TileSize = DEFAULT_TILE_SIZE );
+
+    //! @brief      Attach base image. Must be called whenever the base buffer
+    //!             is relocated.
+    void Attach( FPxlData const* Base ) noexcept { mBase = Base; }
+
+    //! @brief      Build all levels from base image at once.
+    void Build( FPxlData const* Base, int Width, int Height, int TileSize = DEFAULT_TILE_SIZE );
+
+    //! @brief      Update ancestors of the given line. Base must contain the
+    //!             line's data already.
+    void UpdateLine( FLineDesc const& Line );
+
+    bool Empty() const noexcept { return mWidth == 0 || mHeight == 0; }
+    int  NumLevels() const noexcept { return (int)mLevels.size() + 1; }
+    int  TileSize() const noexcept { return mTileSize; }
+    int  LevelWidth( int Level ) const noexcept;
+    int  LevelHeight( int Level ) const noexcept;
+    int  NumTilesX( int Level ) const noexcept;
+    int  NumTilesY( int Level ) const noexcept;
+
+    //! @brief      Returns data of the level. Level 0 returns attached base.
+    FPxlData const* LevelData( int Level ) const noexcept;
+
+    //! @brief      Get view of a tile.
+    //! @returns    false if tile index is out of range.
+    bool GetTile( int Level, int TX, int TY, FTileView& Out ) const noexcept;
+
+    //! @brief      Select the coarsest level which still keeps at least one
+    //!             source pixel per screen pixel.
+    //! @param      Scale: Screen pixels per level 0 pixel.
+    int SelectLevel( double Scale ) const noexcept;
+
+    //! @brief      Modification counter of the tile. Viewers can compare this
+    //!             with cached value to fetch only updated tiles.
+    //!             It's bumped after the pixels of the tile are written, thus
+    //!             a reader which finds the same value before and after
+    //!             reading a tile has seen every update counted up to it.
+    //!             Otherwise the tile should be read again later.
+    uint32_t TileGeneration( int Level, int TX, int TY ) const noexcept;
+
+    //! @brief      Write pyramid as a chunk. Intended to be appended right
+    //!             after the dpta chunk; readers unaware of it simply ignore
+    //!             the tail.
+    bool WriteTo( std::ostream& Strm ) const;
+    bool WriteTo( FILE* Strm ) const;
+
+    //! @brief      Read pyramid chunk. Base image must be attached separately.
+    //! @returns    false if there is no pyramid chunk at current position.
+    bool ReadFrom( std::istream& Strm );
+
+private:
+    using generation_array = std::vector<std::atomic<uint32_t>>;
+
+    struct FLevel
+    {
+        int                   Width  = 0;
+        int                   Height = 0;
+        std::vector<FPxlData> Data;
+        generation_array      Generation; //!< Per tile
+    };
+
+    void reduceSpan( int Level, int Row, int ColBegin, int ColEnd ) noexcept;
+    void touchTiles( int Level, int Row, int ColBegin, int ColEnd ) noexcept;
+
+    template <typename Writer_>
+    void writeChunk( Writer_&& Write ) const;
+
+private:
+    FPxlData const*       mBase     = {};
+    int                   mWidth    = 0;
+    int                   mHeight   = 0;
+    int                   mTileSize = DEFAULT_TILE_SIZE;
+    std::vector<FLevel>   mLevels;         //!< Index 0 is level 1.
+    generation_array      mBaseGeneration; //!< Tile generation of level 0
+};
@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <future>
 #include <stdarg.h>
+#include <string.h>
 #include <thread>
 #include "../common/scanner_protocol.h"
 #include "scanner_protocol_handler.hpp"
@@ -162,12 +163,14 @@ void FScannerProtocolHandler::procedureThread(
             break;
         }
 
-        //! On lost connection.
+        //! On lost connection. Point requests in flight are never answered.
         bIsConnected = false;
+        resetPointRequests( 0 );
     }
 
 RETRY_EXHAUSTED:;
     bIsConnected = false;
+    resetPointRequests( 0 );
 }
 
 static inline bool cmpflt( float a, float b, float tolerance = 1e-7f )
@@ -439,17 +442,59 @@ void FScannerProtocolHandler::OnBinaryData( char const* data, size_t len )
               uint32_t( ActualReceive ) );
         }
         mStatCache = mStat.load();
+        auto const NumImagePxls = (size_t)mStatCache.SizeX * mStatCache.SizeY;
+        auto const LineOfst     = (size_t)desc.LineIdx * mStatCache.SizeX + desc.OfstX;
+        if ( bBuildHistogram )
+        {
+            // Pixels being overwritten leave the histogram first
+            if ( mImage.size() != NumImagePxls )
+            {
+                mHistogram.Reset();
+                atomic_store( &mHistogramSnapshot, shared_ptr<FScanHistogram const>{} );
+            }
+            else if ( LineOfst + desc.NumPxls <= mImage.size() )
+                mHistogram.Remove( mImage.data() + LineOfst, desc.NumPxls );
+        }
         StoreLineData(
           mImage,
           mStatCache.SizeX,
           mStatCache.SizeY,
           desc,
           reinterpret_cast<FPxlData const*>( p ) );
+        if ( bBuildHistogram && LineOfst + desc.NumPxls <= mImage.size() )
+        {
+            mHistogram.Add( mImage.data() + LineOfst, desc.NumPxls );
+
+            // Percentiles barely move line by line; copy it only once a
+            // sizable portion of the frame has been updated.
+            auto const Snapshot = atomic_load( &mHistogramSnapshot );
+            if ( Snapshot == nullptr
+                 || mHistogram.Generation() - Snapshot->Generation() >= max<uint64_t>( 4096, mHistogram.NumValid() / 64 ) )
+            {
+                atomic_store( &mHistogramSnapshot, make_shared<FScanHistogram const>( mHistogram ) );
+            }
+        }
+        if ( bBuildPyramid )
+        {
+            // Viewers may still hold the old one; never resize nor re-attach
+            // it in place. Image buffer only moves along with its size.
+            if ( mPyramid == nullptr
+                 || mPyramid->LevelData( 0 ) != mImage.data()
+                 || mPyramid->LevelWidth( 0 ) != (int)mStatCache.SizeX
+                 || mPyramid->LevelHeight( 0 ) != (int)mStatCache.SizeY )
+            {
+                auto Pyramid = make_shared<FScanPyramid>();
+                Pyramid->Reset( mStatCache.SizeX, mStatCache.SizeY );
+                Pyramid->Attach( mImage.data() );
+                atomic_store( &mPyramid, std::move( Pyramid ) );
+            }
+            mPyramid->UpdateLine( desc );
+        }
         if ( OnReceiveLine )
         {
-            FScanImageDesc desc;
-            GetScanningImage( desc );
-            OnReceiveLine( desc );
+            FScanImageDesc image;
+            GetScanningImage( image );
+            OnReceiveLine( image, desc );
         }
         SendString( "capture report" );
     }
@@ -458,7 +503,15 @@ void FScannerProtocolHandler::OnBinaryData( char const* data, size_t len )
     case ECommand::RSP_PIXEL_DATA:
     case ECommand::RSP_DONE:
         swap( mImage, mCompleteImage );
+        if ( bBuildHistogram )
+        {
+            atomic_store( &mCompleteHistogram, make_shared<FScanHistogram const>( mHistogram ) );
+            atomic_store( &mHistogramSnapshot, shared_ptr<FScanHistogram const>{} );
+        }
+        // Buffers are swapped, not moved; pyramid still points at its pixels.
+        atomic_store( &mCompletePyramid, atomic_exchange( &mPyramid, shared_ptr<FScanPyramid>{} ) );
         mImage.clear();
+        mHistogram.Reset();
         mCompleteImageStat = mStatCache;
         bRequestingCapture = false;
         // Callback call async
@@ -473,10 +526,30 @@ void FScannerProtocolHandler::OnBinaryData( char const* data, size_t len )
         break;
 
     case ECommand::RSP_POINT:
+    {
         auto Data = *ptr_cast<const FPointData>( p )++;
-        OnPointRecv ? OnPointRecv( Data ) : (void)0;
-        mNumAvailablePointRequest++;
-        break;
+
+        // Callback runs before the slot frees, thus waiters see its effects.
+        // It's called under the lock, so that replacing it waits for a call
+        // in progress.
+        {
+            lock_guard<mutex> lck( mPointWait.mtx );
+            auto&             Req = mPointWait.arg;
+            Req.OnAnswer ? Req.OnAnswer( Data ) : (void)0;
+            Req.NumAvailable = min( Req.NumAvailable + 1, Req.NumMax );
+            Req.LastAnswer        = steady_clock::now();
+
+            if ( auto it = Req.Promises.find( Data.ID ); it != Req.Promises.end() )
+            {
+                it->second.front().set_value( Data );
+                it->second.pop_front();
+                if ( it->second.empty() )
+                    Req.Promises.erase( it );
+            }
+        }
+        mPointWait.cv.notify_all();
+    }
+    break;
 
     default:
         break;
@@ -672,20 +745,166 @@ FScanImageDesc::~FScanImageDesc() noexcept
     }
 }
 
+bool FScannerProtocolHandler::sendPointRequest(
+  uint32_t RequestID,
+  int16_t  xs,
+  int16_t  ys ) noexcept
+{
+    char buf[256];
+    sprintf( buf, "capture point-queue %d %d %d", RequestID, xs, ys );
+    if ( SendString( buf ) )
+    {
+        return true;
+    }
+
+    // Request never reached the device; give the slot back.
+    {
+        lock_guard<mutex> lck( mPointWait.mtx );
+        auto&             Req = mPointWait.arg;
+        Req.NumAvailable      = min( Req.NumAvailable + 1, Req.NumMax );
+    }
+    mPointWait.cv.notify_all();
+    return false;
+}
+
+template <typename Pred_>
+bool FScannerProtocolHandler::waitPoint(
+  unique_lock<mutex>& lck,
+  milliseconds        Timeout,
+  Pred_&&             Pred )
+{
+    // Timeout runs from the latest answer, or from the call if none came
+    // since. Answers push the deadline back.
+    auto const Generation = mPointWait.arg.Generation;
+    auto       Deadline   = steady_clock::now() + Timeout;
+    bool       bExpired   = false;
+    for ( ;; )
+    {
+        // Requests dropped on disconnect or reset are never answered, though
+        // their slots are free again; checked before the predicate.
+        if ( bIsConnected == false || bShutdown || mPointWait.arg.Generation != Generation )
+        {
+            return false;
+        }
+        if ( Pred() )
+        {
+            return true;
+        }
+        if ( bExpired )
+        {
+            return false;
+        }
+        if ( mPointWait.cv.wait_until( lck, Deadline ) == cv_status::timeout )
+        {
+            auto const Next = mPointWait.arg.LastAnswer + Timeout;
+            bExpired        = Next <= steady_clock::now();
+            Deadline        = Next;
+        }
+    }
+}
+
 bool FScannerProtocolHandler::QueuePoint(
   uint32_t RequestID,
   int16_t  xs,
   int16_t  ys ) noexcept
 {
-    if ( mNumAvailablePointRequest == 0 )
     {
-        return false;
+        lock_guard<mutex> lck( mPointWait.mtx );
+        if ( mPointWait.arg.NumAvailable == 0 )
+        {
+            return false;
+        }
+        mPointWait.arg.NumAvailable--;
     }
 
-    mNumAvailablePointRequest--;
-    char buf[256];
-    sprintf( buf, "capture point-queue %d %d %d", RequestID, xs, ys );
-    SendString( buf );
+    return sendPointRequest( RequestID, xs, ys );
+}
+
+bool FScannerProtocolHandler::QueuePoint(
+  uint32_t     RequestID,
+  int16_t      xs,
+  int16_t      ys,
+  milliseconds Timeout ) noexcept
+{
+    {
+        unique_lock<mutex> lck( mPointWait.mtx );
+        auto&              Req = mPointWait.arg;
+        if ( waitPoint( lck, Timeout, [&]() { return Req.NumAvailable > 0; } ) == false )
+        {
+            return false;
+        }
+        Req.NumAvailable--;
+    }
+
+    return sendPointRequest( RequestID, xs, ys );
+}
+
+future<FPointData> FScannerProtocolHandler::QueuePointAsync(
+  uint32_t     RequestID,
+  int16_t      xs,
+  int16_t      ys,
+  milliseconds Timeout )
+{
+    future<FPointData> Future;
+    {
+        unique_lock<mutex> lck( mPointWait.mtx );
+        auto&              Req = mPointWait.arg;
+        if ( waitPoint( lck, Timeout, [&]() { return Req.NumAvailable > 0; } ) == false )
+        {
+            return {};
+        }
+        Req.NumAvailable--;
+
+        // Registered before sending, as the answer may arrive right after.
+        auto& Queue = Req.Promises[RequestID];
+        Queue.emplace_back();
+        Future = Queue.back().get_future();
+    }
+
+    if ( sendPointRequest( RequestID, xs, ys ) == false )
+    {
+        lock_guard<mutex> lck( mPointWait.mtx );
+        auto&             Promises = mPointWait.arg.Promises;
+        if ( auto it = Promises.find( RequestID ); it != Promises.end() && !it->second.empty() )
+        {
+            it->second.pop_back();
+            if ( it->second.empty() )
+                Promises.erase( it );
+        }
+        return {};
+    }
+    return Future;
+}
+
+bool FScannerProtocolHandler::WaitPointRequests( milliseconds Timeout ) noexcept
+{
+    unique_lock<mutex> lck( mPointWait.mtx );
+    auto&              Req = mPointWait.arg;
+    return waitPoint( lck, Timeout, [&]() { return Req.NumAvailable >= Req.NumMax; } );
+}
+
+void FScannerProtocolHandler::resetPointRequests( size_t NumMax )
+{
+    // Dropping promises breaks them, which wakes their futures.
+    {
+        lock_guard<mutex> lck( mPointWait.mtx );
+        auto&             Req = mPointWait.arg;
+        Req.NumAvailable      = NumMax;
+        Req.NumMax            = NumMax;
+        Req.LastAnswer        = steady_clock::now();
+        Req.Generation++;
+        Req.Promises.clear();
+    }
+    mPointWait.cv.notify_all();
+}
+
+void FScannerProtocolHandler::SetPointCallback( std::function<void( FPointData const& )> Callback )
+{
+    // Previous one is destroyed outside the lock; it may own anything.
+    {
+        lock_guard<mutex> lck( mPointWait.mtx );
+        swap( mPointWait.arg.OnAnswer, Callback );
+    }
 }
 
 bool FScannerProtocolHandler::QueuePointAngular(
@@ -701,7 +920,8 @@ bool FScannerProtocolHandler::QueuePointAngular(
 
 size_t FScannerProtocolHandler::GetPendingPointRequestCount() const noexcept
 {
-    return mNumMaxPointRequest - mNumAvailablePointRequest;
+    lock_guard<mutex> lck( mPointWait.mtx );
+    return mPointWait.arg.NumMax - mPointWait.arg.NumAvailable;
 }
 
 bool FScannerProtocolHandler::InitPointMode() noexcept
@@ -713,8 +933,7 @@ bool FScannerProtocolHandler::InitPointMode() noexcept
     mStatCache = mStat.load();
     constexpr decltype( mStatCache.NumMaxPointRequest ) MAX_VALUE = 30;
     auto Max = std::min( MAX_VALUE, mStatCache.NumMaxPointRequest );
-    mNumAvailablePointRequest = Max;
-    mNumMaxPointRequest       = Max;
+    resetPointRequests( Max );
 
     print( "info: initialize point capture process; Max req %d\n", Max );
     return bWasIdle;
@@ -1,13 +1,18 @@
 #pragma once
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <future>
 #include <memory>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 #include "../common/scanner_protocol.h"
 #include "communication_handler.hpp"
+#include "scan_histogram.hpp"
+#include "scan_pyramid.hpp"
 
 /**
  * @brief Defines procedure parameters
@@ -65,12 +70,13 @@ private:
 class FScannerProtocolHandler : public ICommunicationHandlerBase
 {
 public:
-    std::function<void( FScanImageDesc const& )> OnFinishScan;
-    std::function<void( FScanImageDesc const& )> OnReceiveLine;
-    std::function<void( const FDeviceStat& )>    OnReport;
-    std::function<void( char const* )>           Logger;
-    std::function<void( FPointData const& )>     OnPointRecv;
-    bool                                         bSuppressDeviceLog = false;
+    std::function<void( FScanImageDesc const& )>                   OnFinishScan;
+    std::function<void( FScanImageDesc const&, FLineDesc const& )> OnReceiveLine; //!< Image and the line just stored
+    std::function<void( const FDeviceStat& )>                      OnReport;
+    std::function<void( char const* )>                             Logger;
+    bool                                                           bSuppressDeviceLog = false;
+    bool                                                           bBuildPyramid      = false; //!< Build tiled pyramid as lines arrive
+    bool                                                           bBuildHistogram    = false; //!< Keep distance/amplitude histogram as lines arrive
 
 public:
     using PortOpenFunctionType = std::function<std::unique_ptr<std::streambuf>(
@@ -91,7 +97,8 @@ public:
         ACTIVATE_OK              = 0,
         ACTIVATE_INVALID_COM     = -1,
         ACTIVATE_ALREADY_RUNNING = -2,
-    } Activate( PortOpenFunctionType ComOpener, FCommunicationProcedureInitStruct const& params, bool bAsync = true ) noexcept;
+    };
+    ActivateResult Activate( PortOpenFunctionType ComOpener, FCommunicationProcedureInitStruct const& params, bool bAsync = true ) noexcept;
 
     //! @brief      Check if connection is alive
     bool IsConnected() const noexcept;
@@ -116,6 +123,33 @@ public:
     //!             Returns false if there is no operation.
     bool GetScanningImage( FScanImageDesc& out ) const noexcept;
 
+    //! @brief      Get pyramid of complete/scanning image.
+    //!             Returns nullptr if bBuildPyramid is not set. A pyramid
+    //!             once returned is never resized nor freed under the caller;
+    //!             new scan or new size replaces it with another instance.
+    //!             Tiles of scanning one keep changing; see TileGeneration().
+    std::shared_ptr<FScanPyramid const> GetCompletePyramid() const noexcept
+    {
+        return std::atomic_load( &mCompletePyramid );
+    }
+    std::shared_ptr<FScanPyramid const> GetScanningPyramid() const noexcept
+    {
+        return std::atomic_load( &mPyramid );
+    }
+
+    //! @brief      Get histogram of complete/scanning image.
+    //!             Returns nullptr if bBuildHistogram is not set. Returned
+    //!             one is a snapshot which never changes; the scanning one is
+    //!             republished once enough lines have arrived.
+    std::shared_ptr<FScanHistogram const> GetCompleteHistogram() const noexcept
+    {
+        return bBuildHistogram ? std::atomic_load( &mCompleteHistogram ) : nullptr;
+    }
+    std::shared_ptr<FScanHistogram const> GetScanningHistogram() const noexcept
+    {
+        return bBuildHistogram ? std::atomic_load( &mHistogramSnapshot ) : nullptr;
+    }
+
     //! @brief      Required Capture parameters for function BeginCapture();
     struct CaptureParam
     {
@@ -207,9 +241,42 @@ public:
     bool InitPointMode() noexcept;
 
     //! @brief      Queue point capture.
+    //! @returns    false if no request slot is available for now.
     bool
     QueuePoint( uint32_t RequestID, int16_t xs, int16_t ys ) noexcept;
 
+    //! @brief      Queue point capture, blocking until a request slot frees.
+    //! @param      Timeout: Gives up once no request has been answered for
+    //!             this long.
+    //! @returns    false on timeout, lost connection or failed send.
+    bool QueuePoint(
+      uint32_t                  RequestID,
+      int16_t                   xs,
+      int16_t                   ys,
+      std::chrono::milliseconds Timeout ) noexcept;
+
+    //! @brief      Queue point capture as QueuePoint() with timeout, and get
+    //!             future of its answer.
+    //! @returns    Invalid future on failure. Promise is broken if the answer
+    //!             never comes; point mode restarted or connection lost.
+    std::future<FPointData> QueuePointAsync(
+      uint32_t                  RequestID,
+      int16_t                   xs,
+      int16_t                   ys,
+      std::chrono::milliseconds Timeout );
+
+    //! @brief      Block until every queued point request is answered.
+    //! @param      Timeout: Gives up once no request has been answered for
+    //!             this long.
+    //! @returns    false on timeout or lost connection.
+    bool WaitPointRequests( std::chrono::milliseconds Timeout ) noexcept;
+
+    //! @brief      Set callback of point answers. It runs on the receiving
+    //!             thread with point requests locked, thus must not queue nor
+    //!             wait for points. Once this returns, previous callback is
+    //!             never called again.
+    void SetPointCallback( std::function<void( FPointData const& )> Callback );
+
     //! @brief      Queue point capture in angular base
     bool QueuePointAngular(
       uint32_t RequestID,
@@ -229,16 +296,32 @@ private:
       FCommunicationProcedureInitStruct params ) noexcept;
     bool requestReport( bool bSync, size_t TimeoutMs );
     void configureCapture( CaptureParam const& arg, bool bForce );
+    bool sendPointRequest( uint32_t RequestID, int16_t xs, int16_t ys ) noexcept;
+    void resetPointRequests( size_t NumMax );
+
+    template <typename Pred_>
+    bool waitPoint( std::unique_lock<std::mutex>& lck, std::chrono::milliseconds Timeout, Pred_&& Pred );
 
 private:
     template <typename arg_>
     struct LockArg
     {
         std::condition_variable cv;
-        std::mutex              mtx;
+        mutable std::mutex      mtx;
         arg_                    arg;
     };
 
+    struct PointRequests
+    {
+        size_t                                   NumAvailable = 0;
+        size_t                                   NumMax       = 0;
+        uint32_t                                 Generation   = 0; //!< Bumped when requests in flight are dropped
+        std::chrono::steady_clock::time_point    LastAnswer;
+        std::function<void( FPointData const& )> OnAnswer; //!< Called under the lock
+        //! Of requests queued through QueuePointAsync(), by ID in order
+        std::unordered_map<uint32_t, std::deque<std::promise<FPointData>>> Promises;
+    };
+
 private:
     //! Background process reference.
     std::future<void> mBackgroundProcess = {};
@@ -253,6 +336,14 @@ private:
     std::vector<FPxlData>    mImage;
     //! Complete image that finished scanning.
     std::vector<FPxlData> mCompleteImage;
+    //! Multi-resolution pyramids of the images above.
+    std::shared_ptr<FScanPyramid> mPyramid;
+    std::shared_ptr<FScanPyramid> mCompletePyramid;
+    //! Histogram of scanning image. Touched by receiving thread only; others
+    //! read snapshots of it, accessed atomically.
+    FScanHistogram                        mHistogram;
+    std::shared_ptr<FScanHistogram const> mHistogramSnapshot;
+    std::shared_ptr<FScanHistogram const> mCompleteHistogram;
     //! For waiting report update ...
     LockArg<std::atomic_bool> mReportWait;
     //! Connection flag ...
@@ -261,7 +352,6 @@ private:
     std::atomic_bool bShutdown = false;
     //! To discard previous requests
     std::atomic_bool bRequestingCapture = false;
-    //! To count available point request
-    std::atomic<size_t> mNumAvailablePointRequest;
-    std::atomic<size_t> mNumMaxPointRequest;
+    //! To count available point request, and wait for answers
+    LockArg<PointRequests> mPointWait;
 };
\ No newline at end of file
@@ -5,9 +5,11 @@
 //!
 //! @details
 #pragma once
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "../common/scanner_protocol.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -18,43 +20,76 @@ extern "C" {
 #pragma pack( push, 2 )
 typedef struct ScanDataPixel
 {
-    long           Q9_22_DEPTH;
-    unsigned short UQ_12_4_AMP;
+    int32_t  Q9_22_DEPTH;
+    uint16_t UQ_12_4_AMP;
 } ScanDataPixelType;
 
 typedef struct ScanDataHeader
 {
-    char          dpta[4]; // Must be 'dpta'
-    unsigned long CHUNK_SIZE;
-    unsigned long DATA_SIZE;
-    unsigned long ELEMENT_SIZE;
-    unsigned long NUM_PIXELS;
-    unsigned long WIDTH;
-    unsigned long HEIGHT;
-    float         ASPECT_RATIO;
+    char     dpta[4]; // Must be 'dpta'
+    uint32_t CHUNK_SIZE;
+    uint32_t DATA_SIZE;
+    uint32_t ELEMENT_SIZE;
+    uint32_t NUM_PIXELS;
+    uint32_t WIDTH;
+    uint32_t HEIGHT;
+    float    ASPECT_RATIO;
 } ScanDataHeaderType;
 #pragma pack( pop )
 
+static inline void ScanDataMakeHeader( ScanDataHeaderType* h, unsigned long width, unsigned long height, float aspect )
+{
+    h->dpta[0] = 'd';
+    h->dpta[1] = 'p';
+    h->dpta[2] = 't';
+    h->dpta[3] = 'a';
+
+    h->ELEMENT_SIZE = sizeof( ScanDataPixelType );
+    h->NUM_PIXELS   = (uint32_t)( width * height );
+    h->WIDTH        = (uint32_t)width;
+    h->HEIGHT       = (uint32_t)height;
+    h->DATA_SIZE    = h->NUM_PIXELS * h->ELEMENT_SIZE;
+    h->CHUNK_SIZE   = h->DATA_SIZE + sizeof( ScanDataHeaderType ) - 8;
+    h->ASPECT_RATIO = aspect;
+}
+
 static inline void ScanDataWriteTo( FILE* out_strm, void const* pixel, unsigned long width, unsigned long height, float aspect )
 {
     ScanDataHeaderType h;
-    h.dpta[0] = 'd';
-    h.dpta[1] = 'p';
-    h.dpta[2] = 't';
-    h.dpta[3] = 'a';
-
-    h.ELEMENT_SIZE = sizeof( ScanDataPixelType );
-    h.NUM_PIXELS   = width * height;
-    h.WIDTH        = width;
-    h.HEIGHT       = height;
-    h.DATA_SIZE    = h.NUM_PIXELS * h.ELEMENT_SIZE;
-    h.CHUNK_SIZE   = h.DATA_SIZE + sizeof( ScanDataHeaderType ) - 8;
-    h.ASPECT_RATIO = aspect;
+    ScanDataMakeHeader( &h, width, height, aspect );
 
     fwrite( &h, 1, sizeof( h ), out_strm );
     fwrite( pixel, h.ELEMENT_SIZE, h.NUM_PIXELS, out_strm );
 }
 
+//! Parses scan data placed in memory, e.g. mapped file. No copy occurs;
+//! outPixels points into given memory.
+static inline bool ScanDataParse( void const* mem, size_t len, ScanDataPixelType const** outPixels, ScanDataHeaderType* outDesc )
+{
+    if ( len < sizeof( ScanDataHeaderType ) )
+    {
+        return false;
+    }
+
+    memcpy( outDesc, mem, sizeof( ScanDataHeaderType ) );
+    if ( memcmp( outDesc, SCAN_DATA_FORMAT_HEADER, 4 ) )
+    {
+        return false;
+    }
+
+    // Reject broken headers before trusting sizes.
+    if ( outDesc->ELEMENT_SIZE != sizeof( ScanDataPixelType )
+         || outDesc->NUM_PIXELS != outDesc->WIDTH * outDesc->HEIGHT
+         || outDesc->DATA_SIZE != outDesc->NUM_PIXELS * outDesc->ELEMENT_SIZE
+         || len - sizeof( ScanDataHeaderType ) < outDesc->DATA_SIZE )
+    {
+        return false;
+    }
+
+    *outPixels = (ScanDataPixelType const*)( (char const*)mem + sizeof( ScanDataHeaderType ) );
+    return true;
+}
+
 static inline bool ScanDataReadFrom( FILE* in_strm, ScanDataPixelType** outPixels, ScanDataHeaderType* outDesc )
 {
     if ( fread( outDesc, sizeof( ScanDataHeaderType ), 1, in_strm ) != 1 )
@@ -87,8 +122,11 @@ static inline bool ScanDataReadFrom( FILE* in_strm, ScanDataPixelType** outPixel
 }
 #include <iostream>
 
+static_assert( sizeof( ScanDataHeaderType ) == 32, "dpta header layout must not depend on platform" );
+static_assert( sizeof( ScanDataPixelType ) == sizeof( FPxlData ), "dpta pixel must match FPxlData" );
+
 namespace scanlib {
-static bool ScanDataReadFrom( std::istream& strm, ScanDataPixelType** outPixels, ScanDataHeaderType* outDesc )
+static inline bool ScanDataReadFrom( std::istream& strm, ScanDataPixelType** outPixels, ScanDataHeaderType* outDesc )
 {
     if ( strm.read( (char*)outDesc, sizeof( ScanDataHeaderType ) ).gcount() != sizeof( ScanDataHeaderType ) )
     {
@@ -118,18 +156,7 @@ static bool ScanDataReadFrom( std::istream& strm, ScanDataPixelType** outPixels,
 static inline void ScanDataWriteTo( std::ostream& out_strm, void const* pixel, unsigned long width, unsigned long height, float aspect )
 {
     ScanDataHeaderType h;
-    h.dpta[0] = 'd';
-    h.dpta[1] = 'p';
-    h.dpta[2] = 't';
-    h.dpta[3] = 'a';
-
-    h.ELEMENT_SIZE = sizeof( ScanDataPixelType );
-    h.NUM_PIXELS   = width * height;
-    h.WIDTH        = width;
-    h.HEIGHT       = height;
-    h.DATA_SIZE    = h.NUM_PIXELS * h.ELEMENT_SIZE;
-    h.CHUNK_SIZE   = h.DATA_SIZE + sizeof( ScanDataHeaderType ) - 8;
-    h.ASPECT_RATIO = aspect;
+    ScanDataMakeHeader( &h, width, height, aspect );
 
     out_strm.write( (const char*)&h, sizeof( h ) );
     out_strm.write( (const char*)pixel, h.ELEMENT_SIZE * h.NUM_PIXELS );
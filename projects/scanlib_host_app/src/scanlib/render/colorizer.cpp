@@ -0,0 +1,240 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "colorizer.hpp"
+#include <algorithm>
+#include <array>
+
+using namespace std;
+
+static uint32_t MakeArgb( unsigned r, unsigned g, unsigned b )
+{
+    return 0xff000000u | ( min( r, 255u ) << 16 ) | ( min( g, 255u ) << 8 ) | min( b, 255u );
+}
+
+//! Same as nana::color::from_hsl(), which the viewer has been using.
+static double RgbFromHue( double v1, double v2, double h )
+{
+    if ( h < 0.0 )
+        h += 1.0;
+    else if ( h > 1.0 )
+        h -= 1.0;
+
+    if ( 6.0 * h < 1.0 )
+        return v1 + ( v2 - v1 ) * 6.0 * h;
+    if ( 2.0 * h < 1.0 )
+        return v2;
+    if ( 3.0 * h < 2.0 )
+        return v1 + ( v2 - v1 ) * ( ( 2.0 / 3.0 ) - h ) * 6.0;
+    return v1;
+}
+
+static uint32_t FromHsl( double Hue, double S, double L )
+{
+    if ( S == 0.0 )
+    {
+        auto v = unsigned( L * 255.0 );
+        return MakeArgb( v, v, v );
+    }
+
+    double v2 = L < 0.5 ? L * ( 1.0 + S ) : ( L + S ) - ( S * L );
+    double v1 = 2.0 * L - v2;
+    Hue /= 360.0;
+    return MakeArgb(
+      unsigned( 255.0 * RgbFromHue( v1, v2, Hue + 0.33333 ) ),
+      unsigned( 255.0 * RgbFromHue( v1, v2, Hue ) ),
+      unsigned( 255.0 * RgbFromHue( v1, v2, Hue - 0.33333 ) ) );
+}
+
+uint32_t FColorizer::MapColor( EColorMappingMode Mode, float H ) noexcept
+{
+    H = clamp( H, 0.f, 1.f );
+    switch ( Mode )
+    {
+    case EColorMappingMode::WTOK:
+    {
+        auto ratio = H * 3.f;
+        auto b     = unsigned( clamp( 255.f * ( 1.f - ratio ), 0.f, 255.5f ) );
+        auto g     = unsigned( clamp( 255.f * ( 1.f - ratio / 2.f ), 0.f, 255.5f ) );
+        auto r     = unsigned( clamp( 255.f * ( 1.f - ratio / 3.f ), 0.f, 255.5f ) );
+        return MakeArgb( r, g, b );
+    }
+
+    case EColorMappingMode::RAINBOW:
+    {
+        auto ratio = H * 3.f;
+        auto h     = clamp( 1.f - ratio / 2.f, 0.f, 1.f );
+        auto s     = clamp( 1.f - ratio / 3.f, 0.f, 1.f );
+        auto l     = clamp( 1.f - ratio / 3.f, 0.f, 1.f );
+        return FromHsl( ( h * 360.f ) - 240.f, s, l );
+    }
+
+    case EColorMappingMode::BGR:
+    {
+        float ratio = 2 * H;
+        auto  b     = unsigned( max( 0.f, 255.f * ( 1.f - ratio ) ) );
+        auto  r     = unsigned( max( 0.f, 255.f * ( ratio - 1.f ) ) );
+        auto  g     = 255u - b - r;
+        return MakeArgb( r, g, b );
+    }
+
+    case EColorMappingMode::GREYSCALE:
+    default:
+    {
+        auto v = unsigned( ( 1.0f - H ) * 255 );
+        return MakeArgb( v, v, v );
+    }
+    }
+}
+
+namespace {
+using FLut = array<uint32_t, FColorizer::LUT_SIZE>;
+
+template <EColorMappingMode Mode_>
+FLut const& BakedLut()
+{
+    // Magic statics; built once on first use from any thread.
+    static FLut const Lut = []() {
+        FLut L;
+        for ( int i = 0; i < FColorizer::LUT_SIZE; i++ )
+            L[i] = FColorizer::MapColor( Mode_, i / float( FColorizer::LUT_SIZE - 1 ) );
+        return L;
+    }();
+    return Lut;
+}
+
+enum
+{
+    CHUNK = 256 //!< Pixels per index pass; index buffer stays on stack.
+};
+
+template <EColorSource Source_>
+void IndexPass( FPxlData const* __restrict Src, uint16_t* __restrict Idx, int Count, float Scale, float Bias )
+{
+    for ( int i = 0; i < Count; i++ )
+    {
+        float v;
+        if constexpr ( Source_ == EColorSource::AMPLITUDE )
+            v = float( Src[i].AMP ) * Scale + Bias;
+        else
+            v = float( Src[i].Distance ) * Scale + Bias;
+
+        v      = v < 0.f ? 0.f : v;
+        v      = v > float( FColorizer::LUT_SIZE - 1 ) ? float( FColorizer::LUT_SIZE - 1 ) : v;
+        Idx[i] = uint16_t( v );
+    }
+}
+
+void LookupPass( uint16_t const* __restrict Idx, uint32_t const* __restrict Lut, uint32_t* __restrict Dst, int Count )
+{
+    for ( int i = 0; i < Count; i++ )
+        Dst[i] = Lut[Idx[i]];
+}
+
+template <EColorSource Source_>
+void Colorize( FPxlData const* Src, int Count, uint32_t* Dst, uint32_t const* Lut, float Scale, float Bias )
+{
+    uint16_t Idx[CHUNK];
+    for ( int Ofst = 0; Ofst < Count; Ofst += CHUNK )
+    {
+        auto const N = min<int>( CHUNK, Count - Ofst );
+        IndexPass<Source_>( Src + Ofst, Idx, N, Scale, Bias );
+        LookupPass( Idx, Lut, Dst + Ofst, N );
+    }
+}
+} // namespace
+
+uint32_t const* FColorizer::GetLut( EColorMappingMode Mode ) noexcept
+{
+    switch ( Mode )
+    {
+    case EColorMappingMode::BGR: return BakedLut<EColorMappingMode::BGR>().data();
+    case EColorMappingMode::WTOK: return BakedLut<EColorMappingMode::WTOK>().data();
+    case EColorMappingMode::RAINBOW: return BakedLut<EColorMappingMode::RAINBOW>().data();
+    case EColorMappingMode::GREYSCALE:
+    default: return BakedLut<EColorMappingMode::GREYSCALE>().data();
+    }
+}
+
+void FColorizer::Configure( FColorizeParam const& Param ) noexcept
+{
+    mParam = Param;
+    mLut   = GetLut( Param.Mode );
+
+    // index = (d / 2^22 - Min) / (Max - Min) * 4095, rounded
+    auto const Range = Param.MaxDistance - Param.MinDistance;
+    auto const Unit  = Range != 0.f ? ( LUT_SIZE - 1 ) / Range : 0.f;
+    mScale           = Unit / Q9_22_ONE_INT;
+    mBias            = -Param.MinDistance * Unit + 0.5f;
+
+    // Not rounded; default range maps integer part of amplitude to the index.
+    auto const AmpRange = Param.MaxAmplitude - Param.MinAmplitude;
+    auto const AmpUnit  = AmpRange != 0.f ? ( LUT_SIZE - 1 ) / AmpRange : 0.f;
+    mAmpScale           = AmpUnit / UQ12_4_ONE_INT;
+    mAmpBias            = -Param.MinAmplitude * AmpUnit;
+}
+
+void FColorizer::colorize( FPxlData const* Src, int Count, uint32_t* Dst ) const noexcept
+{
+    if ( Count <= 0 )
+        return;
+
+    if ( mParam.Source == EColorSource::AMPLITUDE )
+        Colorize<EColorSource::AMPLITUDE>( Src, Count, Dst, mLut, mAmpScale, mAmpBias );
+    else
+        Colorize<EColorSource::DISTANCE>( Src, Count, Dst, mLut, mScale, mBias );
+}
+
+void FColorizer::RenderSpan(
+  FPxlData const* SrcRow,
+  int             Width,
+  int             Row,
+  int             ColBegin,
+  int             ColEnd,
+  uint32_t*       DstRow ) const noexcept
+{
+    ColBegin = max( 0, ColBegin );
+    ColEnd   = min( Width, ColEnd );
+    if ( ColBegin >= ColEnd )
+        return;
+
+    auto const c = ( Row & 1 ) ? mParam.HorizontalCalib : 0;
+    if ( c == 0 )
+    {
+        colorize( SrcRow + ColBegin, ColEnd - ColBegin, DstRow + ColBegin );
+        return;
+    }
+
+    // Odd rows are captured in reverse direction; source x is drawn at x + c.
+    auto const SBegin = max( ColBegin, -c );
+    auto const SEnd   = min( ColEnd, Width - c );
+    if ( SBegin < SEnd )
+        colorize( SrcRow + SBegin, SEnd - SBegin, DstRow + SBegin + c );
+
+    // Pixels uncovered by the shift keep the unshifted value.
+    auto const GBegin = max( ColBegin, c > 0 ? 0 : Width + c );
+    auto const GEnd   = min( ColEnd, c > 0 ? c : Width );
+    if ( GBegin < GEnd )
+        colorize( SrcRow + GBegin, GEnd - GBegin, DstRow + GBegin );
+}
+
+void FColorizer::RenderRows(
+  FPxlData const* Src,
+  int             Width,
+  int             RowBegin,
+  int             RowEnd,
+  uint32_t*       Dst,
+  size_t          DstStride ) const noexcept
+{
+    DstStride = DstStride ? DstStride : Width;
+    for ( int i = RowBegin; i < RowEnd; i++ )
+        RenderSpan( Src + (size_t)i * Width, Width, i, 0, Width, Dst + i * DstStride );
+}
+
+void FColorizer::Render( FPxlData const* Src, int Width, int Height, uint32_t* Dst, size_t DstStride ) const noexcept
+{
+    RenderRows( Src, Width, 0, Height, Dst, DstStride );
+}
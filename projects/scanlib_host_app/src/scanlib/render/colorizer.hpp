@@ -0,0 +1,96 @@
+//! Depth/amplitude colorizer based on lookup tables.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Each color mode is baked once into a 4096 entry ARGB table. Rendering a row
+//! reduces to two passes over small chunks:
+//!
+//!   1. Pixel values -> palette indices. Both amplitude(UQ12.4) and
+//!      distance(Q9.22) are scaled from their range into [0, 4095]; with the
+//!      default amplitude range, integer part of amplitude is the index.
+//!   2. Palette indices -> colors, by table lookup.
+//!
+//! Both passes are plain loops over contiguous arrays without calls, which
+//! compilers vectorize. Kernels are instantiated per source channel, thus
+//! there's no per-pixel dispatch.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "../common/scanner_protocol.h"
+
+enum class EColorMappingMode
+{
+    NONE,
+    BGR,
+    GREYSCALE,
+    WTOK,
+    RAINBOW,
+};
+
+enum class EColorSource
+{
+    DISTANCE,
+    AMPLITUDE,
+};
+
+struct FColorizeParam
+{
+    EColorMappingMode Mode            = EColorMappingMode::GREYSCALE;
+    EColorSource      Source          = EColorSource::DISTANCE;
+    float             MinDistance     = 0.f;  //!< Distance of first palette entry in meter
+    float             MaxDistance     = 10.f; //!< Distance of last palette entry in meter
+    int               HorizontalCalib = 0;    //!< Odd row shift in pixels
+    float             MinAmplitude    = 0.f;    //!< Amplitude of first palette entry, in integer units
+    float             MaxAmplitude    = 4095.f; //!< Amplitude of last palette entry, in integer units
+};
+
+class FColorizer
+{
+public:
+    enum
+    {
+        LUT_SIZE = 4096
+    };
+
+public:
+    FColorizer() noexcept { Configure( {} ); }
+    explicit FColorizer( FColorizeParam const& Param ) noexcept { Configure( Param ); }
+
+    void                  Configure( FColorizeParam const& Param ) noexcept;
+    FColorizeParam const& Param() const noexcept { return mParam; }
+
+    //! @brief      Colorize whole image.
+    //! @param      DstStride: Row pitch of Dst in pixels. 0 for Width.
+    void Render( FPxlData const* Src, int Width, int Height, uint32_t* Dst, size_t DstStride = 0 ) const noexcept;
+
+    //! @brief      Colorize rows [RowBegin, RowEnd). Dst points to the first
+    //!             pixel of row 0, as in Render().
+    void RenderRows( FPxlData const* Src, int Width, int RowBegin, int RowEnd, uint32_t* Dst, size_t DstStride = 0 ) const noexcept;
+
+    //! @brief      Colorize pixels [ColBegin, ColEnd) of a source row.
+    //!             Calibration shift is applied; destination pixels affected by
+    //!             the span are updated only.
+    //! @param      SrcRow: First pixel of the source row
+    //! @param      DstRow: First pixel of the destination row
+    void RenderSpan( FPxlData const* SrcRow, int Width, int Row, int ColBegin, int ColEnd, uint32_t* DstRow ) const noexcept;
+
+    //! @brief      Palette of given mode. Entry i corresponds to i / 4095.
+    static uint32_t const* GetLut( EColorMappingMode Mode ) noexcept;
+
+    //! @brief      Evaluates palette directly. Reference of the lookup tables.
+    //! @param      H: Normalized value. Clamped into [0, 1].
+    static uint32_t MapColor( EColorMappingMode Mode, float H ) noexcept;
+
+private:
+    void colorize( FPxlData const* Src, int Count, uint32_t* Dst ) const noexcept;
+
+private:
+    FColorizeParam  mParam = {};
+    uint32_t const* mLut   = {};
+    float           mScale    = 0.f; //!< Q9.22 distance to palette index
+    float           mBias     = 0.f;
+    float           mAmpScale = 0.f; //!< UQ12.4 amplitude to palette index
+    float           mAmpBias  = 0.f;
+};
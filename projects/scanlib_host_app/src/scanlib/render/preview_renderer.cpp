@@ -0,0 +1,179 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "preview_renderer.hpp"
+#include <algorithm>
+#include <string.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define SCANLIB_PREVIEW_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+//! Per byte average rounding up; same as pavgb.
+static uint32_t AvgBytes( uint32_t a, uint32_t b )
+{
+    return ( a | b ) - ( ( ( a ^ b ) & 0xfefefefeu ) >> 1 );
+}
+
+//! Per byte a + (b - a) * f / 256
+static uint32_t LerpBytes( uint32_t a, uint32_t b, uint32_t f )
+{
+    auto const g  = 256 - f;
+    auto const rb = ( ( ( a & 0xff00ffu ) * g + ( b & 0xff00ffu ) * f ) >> 8 ) & 0xff00ffu;
+    auto const ag = ( ( ( a >> 8 ) & 0xff00ffu ) * g + ( ( b >> 8 ) & 0xff00ffu ) * f ) & 0xff00ff00u;
+    return rb | ag;
+}
+
+static uint32_t ToOrder( uint32_t Argb, EPixelOrder Order )
+{
+    if ( Order == EPixelOrder::ARGB )
+        return Argb;
+
+    // RGBA bytes are 0xAABBGGRR on little endian; swap R and B.
+    return ( Argb & 0xff00ff00u ) | ( ( Argb >> 16 ) & 0xffu ) | ( ( Argb & 0xffu ) << 16 );
+}
+
+void FPreviewRenderer::Halve( uint32_t const* Src, int Width, int Height, uint32_t* Dst ) noexcept
+{
+    int const W = Width / 2;
+    int const H = Height / 2;
+    for ( int y = 0; y < H; y++ )
+    {
+        auto const r0 = Src + (size_t)y * 2 * Width;
+        auto const r1 = r0 + Width;
+        auto const d  = Dst + (size_t)y * W;
+        int        x  = 0;
+
+#ifdef SCANLIB_PREVIEW_SSE2
+        for ( ; x + 4 <= W; x += 4 )
+        {
+            auto const a0 = _mm_loadu_si128( (__m128i const*)( r0 + 2 * x ) );
+            auto const a1 = _mm_loadu_si128( (__m128i const*)( r0 + 2 * x + 4 ) );
+            auto const b0 = _mm_loadu_si128( (__m128i const*)( r1 + 2 * x ) );
+            auto const b1 = _mm_loadu_si128( (__m128i const*)( r1 + 2 * x + 4 ) );
+            auto const v0 = _mm_castsi128_ps( _mm_avg_epu8( a0, b0 ) );
+            auto const v1 = _mm_castsi128_ps( _mm_avg_epu8( a1, b1 ) );
+
+            // Split even and odd columns, then average them.
+            auto const ev = _mm_castps_si128( _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+            auto const od = _mm_castps_si128( _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+            _mm_storeu_si128( (__m128i*)( d + x ), _mm_avg_epu8( ev, od ) );
+        }
+#endif
+        for ( ; x < W; x++ )
+        {
+            auto const ev = AvgBytes( r0[2 * x], r1[2 * x] );
+            auto const od = AvgBytes( r0[2 * x + 1], r1[2 * x + 1] );
+            d[x]          = AvgBytes( ev, od );
+        }
+    }
+}
+
+void FPreviewRenderer::FitSize( int Width, int Height, float AspectRatio, int MaxEdge, int& OutWidth, int& OutHeight ) noexcept
+{
+    OutWidth = OutHeight = 0;
+    if ( Width <= 0 || Height <= 0 || MaxEdge <= 0 )
+        return;
+
+    auto const Aspect = AspectRatio > 0.f ? AspectRatio : float( Width ) / Height;
+    auto const Edge   = min( MaxEdge, max( Width, Height ) );
+    if ( Aspect >= 1.f )
+    {
+        OutWidth  = Edge;
+        OutHeight = max( 1, int( Edge / Aspect + 0.5f ) );
+    }
+    else
+    {
+        OutHeight = Edge;
+        OutWidth  = max( 1, int( Edge * Aspect + 0.5f ) );
+    }
+}
+
+bool FPreviewRenderer::Render(
+  FColorizer const& Colorizer,
+  FPxlData const*   Src,
+  int               Width,
+  int               Height,
+  void*             Dst,
+  int               DstWidth,
+  int               DstHeight,
+  size_t            DstStride,
+  EPixelOrder       Order )
+{
+    if ( Src == nullptr || Dst == nullptr || Width <= 0 || Height <= 0 || DstWidth <= 0 || DstHeight <= 0 )
+        return false;
+
+    DstStride = DstStride ? DstStride : DstWidth * sizeof( uint32_t );
+    auto const DstRow = [&]( int y ) {
+        return reinterpret_cast<uint32_t*>( static_cast<uint8_t*>( Dst ) + y * DstStride );
+    };
+
+    int Cur = 0;
+    mBuf[Cur].resize( (size_t)Width * Height );
+    Colorizer.Render( Src, Width, Height, mBuf[Cur].data() );
+
+    // Box filter averages every source pixel; bilinear alone would skip most
+    // of them on large reduction.
+    int W = Width, H = Height;
+    while ( W / 2 >= DstWidth && H / 2 >= DstHeight )
+    {
+        mBuf[!Cur].resize( (size_t)( W / 2 ) * ( H / 2 ) );
+        Halve( mBuf[Cur].data(), W, H, mBuf[!Cur].data() );
+        Cur = !Cur;
+        W /= 2;
+        H /= 2;
+    }
+
+    auto const Img = mBuf[Cur].data();
+    if ( W == DstWidth && H == DstHeight )
+    {
+        for ( int y = 0; y < H; y++ )
+        {
+            auto const s = Img + (size_t)y * W;
+            auto const d = DstRow( y );
+            if ( Order == EPixelOrder::ARGB )
+                memcpy( d, s, W * sizeof( uint32_t ) );
+            else
+                for ( int x = 0; x < W; x++ )
+                    d[x] = ToOrder( s[x], Order );
+        }
+        return true;
+    }
+
+    // Pixel centers are aligned; weights are in 1/256 units.
+    auto const Tap = []( int i, int SrcLen, int DstLen, int& i0, int& i1, uint32_t& f ) {
+        auto const s = max( 0.f, ( i + 0.5f ) * SrcLen / DstLen - 0.5f );
+        i0           = min( int( s ), SrcLen - 1 );
+        i1           = min( i0 + 1, SrcLen - 1 );
+        f            = uint32_t( ( s - i0 ) * 256.f + 0.5f );
+    };
+
+    mTaps.resize( DstWidth );
+    for ( int x = 0; x < DstWidth; x++ )
+        Tap( x, W, DstWidth, mTaps[x].i0, mTaps[x].i1, mTaps[x].f );
+
+    for ( int y = 0; y < DstHeight; y++ )
+    {
+        int      y0, y1;
+        uint32_t fy;
+        Tap( y, H, DstHeight, y0, y1, fy );
+
+        auto const r0 = Img + (size_t)y0 * W;
+        auto const r1 = Img + (size_t)y1 * W;
+        auto const d  = DstRow( y );
+        for ( int x = 0; x < DstWidth; x++ )
+        {
+            auto const& t = mTaps[x];
+            auto const  a = LerpBytes( r0[t.i0], r0[t.i1], t.f );
+            auto const  b = LerpBytes( r1[t.i0], r1[t.i1], t.f );
+            d[x]          = ToOrder( LerpBytes( a, b, fy ), Order );
+        }
+    }
+    return true;
+}
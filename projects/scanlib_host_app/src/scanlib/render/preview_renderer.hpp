@@ -0,0 +1,64 @@
+//! Headless preview renderer into caller-provided RGBA buffers.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Colorizes a frame with FColorizer, then resamples it into output of any
+//! size. Downscaling first halves the image repeatedly with 2x2 box filter,
+//! which runs 4 pixels per instruction on SSE2, until it is within 2x of the
+//! output; bilinear filter covers the rest and any upscaling. Nothing depends
+//! on GUI, thus previews can be made on servers as well.
+//!
+//! Working buffers are kept between calls; use an instance per thread.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "colorizer.hpp"
+
+enum class EPixelOrder
+{
+    ARGB, //!< 0xAARRGGBB words, i.e. B, G, R, A bytes on little endian
+    RGBA, //!< R, G, B, A bytes
+};
+
+class FPreviewRenderer
+{
+public:
+    //! @brief      Render Src into DstWidth x DstHeight pixels of Dst.
+    //! @param      DstStride: Row pitch of Dst in bytes. 0 for tightly
+    //!             packed rows.
+    //! @returns    false if either of sizes is empty.
+    bool Render(
+      FColorizer const& Colorizer,
+      FPxlData const*   Src,
+      int               Width,
+      int               Height,
+      void*             Dst,
+      int               DstWidth,
+      int               DstHeight,
+      size_t            DstStride = 0,
+      EPixelOrder       Order     = EPixelOrder::RGBA );
+
+    //! @brief      Output size whose longer edge is MaxEdge, keeping aspect
+    //!             ratio(width / height). Image isn't scaled up.
+    //! @param      AspectRatio: 0 or less to use Width / Height.
+    static void FitSize( int Width, int Height, float AspectRatio, int MaxEdge, int& OutWidth, int& OutHeight ) noexcept;
+
+    //! @brief      2x2 box filter. Output is Width/2 x Height/2; odd row and
+    //!             column are dropped.
+    static void Halve( uint32_t const* Src, int Width, int Height, uint32_t* Dst ) noexcept;
+
+private:
+    //! Horizontal filter taps, shared by every output row.
+    struct FTap
+    {
+        int      i0, i1;
+        uint32_t f;
+    };
+
+private:
+    std::vector<uint32_t> mBuf[2];
+    std::vector<FTap>     mTaps;
+};
@@ -0,0 +1,121 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "tile_renderer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include "../utility/thread_pool.hpp"
+
+using namespace std;
+
+void FTileRenderer::FAlignedDelete::operator()( uint32_t* p ) const noexcept
+{
+    ::operator delete[]( p, align_val_t( BUFFER_ALIGN ) );
+}
+
+FTileRenderer::FTileRenderer( FThreadPool* Pool ) noexcept
+    : mPool( Pool ? Pool : &FThreadPool::Shared() )
+{
+}
+
+bool FTileRenderer::Reserve( int Width, int Height )
+{
+    auto const Required = (size_t)max( 0, Width ) * max( 0, Height );
+    if ( Required <= mCapacity )
+        return false;
+
+    // Grow by half again to avoid reallocation on every line of growing scan.
+    auto const NewCapacity = max( Required, mCapacity + mCapacity / 2 );
+    auto const p           = ::operator new[]( NewCapacity * sizeof( uint32_t ), align_val_t( BUFFER_ALIGN ) );
+    mBuffer.reset( static_cast<uint32_t*>( p ) );
+    mCapacity = NewCapacity;
+    return true;
+}
+
+void FTileRenderer::TileSize( int Width, int& TileW, int& TileH ) noexcept
+{
+    // Whole rows if possible; rows are contiguous and so are the tiles.
+    TileW = Width;
+    if ( Width > TILE_PIXELS / 4 )
+        TileW = ( TILE_PIXELS / 4 + TILE_ALIGN - 1 ) / TILE_ALIGN * TILE_ALIGN;
+
+    TileH = max( 1, TILE_PIXELS / max( 1, TileW ) );
+}
+
+void FTileRenderer::Render( FColorizer const& Colorizer, FPxlData const* Src, int Width, int Height )
+{
+    auto const Begin = chrono::steady_clock::now();
+    if ( Src == nullptr || Width <= 0 || Height <= 0 )
+    {
+        mLastRenderMs = 0.0;
+        return;
+    }
+
+    Reserve( Width, Height );
+
+    int TileW, TileH;
+    TileSize( Width, TileW, TileH );
+    auto const NumTilesX = ( Width + TileW - 1 ) / TileW;
+    auto const NumTilesY = ( Height + TileH - 1 ) / TileH;
+    auto const Dst       = mBuffer.get();
+
+    mPool->ParallelFor( 0, (size_t)NumTilesX * NumTilesY, 1, [&]( size_t TileBegin, size_t TileEnd ) {
+        for ( auto Tile = TileBegin; Tile < TileEnd; Tile++ )
+        {
+            int const Col0 = int( Tile % NumTilesX ) * TileW;
+            int const Row0 = int( Tile / NumTilesX ) * TileH;
+            int const Col1 = min( Width, Col0 + TileW );
+            int const Row1 = min( Height, Row0 + TileH );
+
+            for ( int i = Row0; i < Row1; i++ )
+            {
+                auto const Ofst = (size_t)i * Width;
+                Colorizer.RenderSpan( Src + Ofst, Width, i, Col0, Col1, Dst + Ofst );
+            }
+        }
+    } );
+
+    mLastRenderMs = chrono::duration<double, milli>( chrono::steady_clock::now() - Begin ).count();
+}
+
+void FTileRenderer::RenderTiles(
+  FColorizer const& Colorizer,
+  FPxlData const*   Src,
+  int               Width,
+  int               Height,
+  int               TileSize,
+  uint32_t const*   Tiles,
+  size_t            NumTiles )
+{
+    auto const Begin = chrono::steady_clock::now();
+    if ( Src == nullptr || Width <= 0 || Height <= 0 || TileSize <= 0 || NumTiles == 0 )
+    {
+        mLastRenderMs = 0.0;
+        return;
+    }
+
+    auto const NumTilesX = ( Width + TileSize - 1 ) / TileSize;
+    auto const Dst       = mBuffer.get();
+
+    mPool->ParallelFor( 0, NumTiles, 1, [&]( size_t TileBegin, size_t TileEnd ) {
+        for ( auto i = TileBegin; i < TileEnd; i++ )
+        {
+            int const Col0 = int( Tiles[i] % NumTilesX ) * TileSize;
+            int const Row0 = int( Tiles[i] / NumTilesX ) * TileSize;
+            int const Col1 = min( Width, Col0 + TileSize );
+            int const Row1 = min( Height, Row0 + TileSize );
+
+            for ( int r = Row0; r < Row1; r++ )
+            {
+                auto const Ofst = (size_t)r * Width;
+                Colorizer.RenderSpan( Src + Ofst, Width, r, Col0, Col1, Dst + Ofst );
+            }
+        }
+    } );
+
+    mLastRenderMs = chrono::duration<double, milli>( chrono::steady_clock::now() - Begin ).count();
+}
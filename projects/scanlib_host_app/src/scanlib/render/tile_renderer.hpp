@@ -0,0 +1,79 @@
+//! Parallel tiled colorizing into reusable frame buffer.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Image is split into tiles which fit into L2 along with their source
+//! pixels(6 + 4 bytes per pixel), then tiles are colorized on a thread pool.
+//! Tile width is a multiple of cache line, so that neighbouring tiles rarely
+//! share a line of destination.
+//!
+//! Frame buffer is cache line aligned and only grows; rendering a frame of the
+//! same or smaller size never allocates.
+#pragma once
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include "colorizer.hpp"
+
+class FThreadPool;
+
+class FTileRenderer
+{
+public:
+    enum
+    {
+        TILE_PIXELS  = 16384, //!< ~160kB of source and destination per tile
+        TILE_ALIGN   = 16,    //!< Tile width granularity in pixels; 64 bytes
+        BUFFER_ALIGN = 64,
+    };
+
+public:
+    //! @param      Pool: Pool to run tiles on. nullptr for shared pool.
+    explicit FTileRenderer( FThreadPool* Pool = nullptr ) noexcept;
+
+    //! @brief      Make frame buffer hold at least Width x Height pixels.
+    //! @returns    true if the buffer has been reallocated, which discards
+    //!             previous contents.
+    bool Reserve( int Width, int Height );
+
+    //! @brief      Colorize whole image into frame buffer on the pool.
+    //!             Frame buffer is reserved as required; row pitch is Width.
+    void Render( FColorizer const& Colorizer, FPxlData const* Src, int Width, int Height );
+
+    //! @brief      Colorize listed square tiles only, e.g. visible ones of a
+    //!             pyramid level. Frame buffer must be reserved already; row
+    //!             pitch is Width, as in Render().
+    //! @param      Tiles: Tile indices in row-major order of TileSize tiles.
+    void RenderTiles(
+      FColorizer const& Colorizer,
+      FPxlData const*   Src,
+      int               Width,
+      int               Height,
+      int               TileSize,
+      uint32_t const*   Tiles,
+      size_t            NumTiles );
+
+    uint32_t*       Buffer() noexcept { return mBuffer.get(); }
+    uint32_t const* Buffer() const noexcept { return mBuffer.get(); }
+    size_t          Capacity() const noexcept { return mCapacity; }
+
+    //! @brief      Wall time of last Render() call in milliseconds.
+    double LastRenderMs() const noexcept { return mLastRenderMs; }
+
+    //! @brief      Decide tile size for given image width.
+    static void TileSize( int Width, int& TileW, int& TileH ) noexcept;
+
+private:
+    struct FAlignedDelete
+    {
+        void operator()( uint32_t* p ) const noexcept;
+    };
+
+private:
+    FThreadPool*                                mPool         = {};
+    std::unique_ptr<uint32_t[], FAlignedDelete> mBuffer       = {};
+    size_t                                      mCapacity     = 0;
+    double                                      mLastRenderMs = 0.0;
+};
@@ -0,0 +1,155 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "angular_projection.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define SCANLIB_PROJECTION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+static constexpr double DTOR = 3.14159265358979323846 / 180.0;
+
+bool FAngularProjectionParam::operator==( FAngularProjectionParam const& o ) const noexcept
+{
+    for ( int i = 0; i < 2; i++ )
+    {
+        if ( Fov[i] != o.Fov[i] || SensorOffset[i] != o.SensorOffset[i] || AngleOffset[i] != o.AngleOffset[i]
+             || DegreePerStep[i] != o.DegreePerStep[i] )
+        {
+            return false;
+        }
+    }
+    return ReferenceDistance == o.ReferenceDistance;
+}
+
+float FAngularProjection::evaluate( int Axis, float u ) const noexcept
+{
+    auto const& P   = mParam;
+    double      Tan = 2.0 * tan( P.Fov[Axis] * DTOR * 0.5 ) * ( u - 0.5 );
+    if ( P.ReferenceDistance > 0.f )
+    {
+        Tan -= P.SensorOffset[Axis] / P.ReferenceDistance;
+    }
+    return float( ( atan( Tan ) / DTOR + P.AngleOffset[Axis] ) / P.DegreePerStep[Axis] );
+}
+
+bool FAngularProjection::Configure( FAngularProjectionParam const& Param, int Width, int Height )
+{
+    if ( !mTable[0].empty() && Param == mParam && Width == mSize[0] && Height == mSize[1] )
+    {
+        return false;
+    }
+
+    mParam   = Param;
+    mSize[0] = Width;
+    mSize[1] = Height;
+    for ( int Axis = 0; Axis < 2; Axis++ )
+    {
+        auto& Table = mTable[Axis];
+        Table.resize( TABLE_SIZE + 2 );
+        for ( int i = 0; i <= TABLE_SIZE; i++ )
+        {
+            Table[i] = evaluate( Axis, float( i ) / TABLE_SIZE );
+        }
+        Table[TABLE_SIZE + 1] = Table[TABLE_SIZE];
+
+        // Angle changes by 2 tan(fov/2) / (1 + c^2) radians over u at the
+        // center, where c is the parallax term.
+        auto const c        = Param.ReferenceDistance > 0.f ? double( Param.SensorOffset[Axis] ) / Param.ReferenceDistance : 0.0;
+        auto const Slope    = 2.0 * tan( Param.Fov[Axis] * DTOR * 0.5 ) / ( 1.0 + c * c );
+        mStepPerPixel[Axis] = float( Slope / DTOR / Param.DegreePerStep[Axis] / max( 1, mSize[Axis] ) );
+    }
+    return true;
+}
+
+void FAngularProjection::Evaluate( float X, float Y, float& StepX, float& StepY ) const noexcept
+{
+    StepX = evaluate( 0, X / max( 1, mSize[0] ) );
+    StepY = evaluate( 1, Y / max( 1, mSize[1] ) );
+}
+
+void FAngularProjection::Project(
+  FSamplePoint const* Points,
+  size_t              NumPoints,
+  float*              StepX,
+  float*              StepY,
+  FPointReq*          Reqs ) const noexcept
+{
+    // Pixel to table coordinate, clamped into table
+    float const  Scale[2] = { float( TABLE_SIZE ) / max( 1, mSize[0] ), float( TABLE_SIZE ) / max( 1, mSize[1] ) };
+    float const* TX       = mTable[0].data();
+    float const* TY       = mTable[1].data();
+    auto const   lookup   = [&]( float const* T, float s ) {
+        float const t = min( max( s, 0.f ), float( TABLE_SIZE ) );
+        int const   i = int( t );
+        return T[i] + ( T[i + 1] - T[i] ) * ( t - i );
+    };
+
+    size_t i = 0;
+#ifdef SCANLIB_PROJECTION_SSE2
+    // Coordinates are gathered out of points and tables four at a time;
+    // clamping, interpolation and rounding run on vectors. Rounded steps
+    // saturate into int16.
+    auto const vSx  = _mm_set1_ps( Scale[0] );
+    auto const vSy  = _mm_set1_ps( Scale[1] );
+    auto const vMax = _mm_set1_ps( float( TABLE_SIZE ) );
+    auto const vMin = _mm_setzero_ps();
+    for ( ; i + 4 <= NumPoints; i += 4 )
+    {
+        auto const* p  = Points + i;
+        auto const  tx = _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_setr_ps( p[0].X, p[1].X, p[2].X, p[3].X ), vSx ), vMin ), vMax );
+        auto const  ty = _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_setr_ps( p[0].Y, p[1].Y, p[2].Y, p[3].Y ), vSy ), vMin ), vMax );
+        auto const  ix = _mm_cvttps_epi32( tx );
+        auto const  iy = _mm_cvttps_epi32( ty );
+        auto const  fx = _mm_sub_ps( tx, _mm_cvtepi32_ps( ix ) );
+        auto const  fy = _mm_sub_ps( ty, _mm_cvtepi32_ps( iy ) );
+
+        alignas( 16 ) int32_t Ix[4], Iy[4];
+        _mm_store_si128( (__m128i*)Ix, ix );
+        _mm_store_si128( (__m128i*)Iy, iy );
+        auto const x0 = _mm_setr_ps( TX[Ix[0]], TX[Ix[1]], TX[Ix[2]], TX[Ix[3]] );
+        auto const x1 = _mm_setr_ps( TX[Ix[0] + 1], TX[Ix[1] + 1], TX[Ix[2] + 1], TX[Ix[3] + 1] );
+        auto const y0 = _mm_setr_ps( TY[Iy[0]], TY[Iy[1]], TY[Iy[2]], TY[Iy[3]] );
+        auto const y1 = _mm_setr_ps( TY[Iy[0] + 1], TY[Iy[1] + 1], TY[Iy[2] + 1], TY[Iy[3] + 1] );
+        auto const sx = _mm_add_ps( x0, _mm_mul_ps( _mm_sub_ps( x1, x0 ), fx ) );
+        auto const sy = _mm_add_ps( y0, _mm_mul_ps( _mm_sub_ps( y1, y0 ), fy ) );
+
+        if ( StepX )
+            _mm_storeu_ps( StepX + i, sx );
+        if ( StepY )
+            _mm_storeu_ps( StepY + i, sy );
+        if ( Reqs )
+        {
+            alignas( 16 ) int16_t Packed[8];
+            _mm_store_si128( (__m128i*)Packed, _mm_packs_epi32( _mm_cvtps_epi32( sx ), _mm_cvtps_epi32( sy ) ) );
+            for ( int k = 0; k < 4; k++ )
+            {
+                Reqs[i + k] = { Packed[k], Packed[k + 4], uint32_t( i + k ) };
+            }
+        }
+    }
+#endif
+
+    for ( ; i < NumPoints; i++ )
+    {
+        auto const sx = lookup( TX, Points[i].X * Scale[0] );
+        auto const sy = lookup( TY, Points[i].Y * Scale[1] );
+        if ( StepX )
+            StepX[i] = sx;
+        if ( StepY )
+            StepY[i] = sy;
+        if ( Reqs )
+        {
+            auto const round16 = []( float v ) { return int16_t( lrintf( min( max( v, -32768.f ), 32767.f ) ) ); };
+            Reqs[i]            = { round16( sx ), round16( sy ), uint32_t( i ) };
+        }
+    }
+}
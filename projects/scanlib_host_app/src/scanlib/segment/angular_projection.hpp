@@ -0,0 +1,77 @@
+//! Maps camera pixel coordinates to motor steps of the depth sensor.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Camera is modelled as a pinhole; the sensor turns around a point offset
+//! from the camera center. A pixel at normalized coordinate u (0~1 across the
+//! frame) is seen by the camera at tan(a) = 2 tan(fov/2) (u - 0.5). The
+//! sensor aims at where that ray meets a plane at the reference distance D,
+//! thus tan(b) = tan(a) - offset / D. Calibrated mount angle is added last.
+//! Without reference distance, the offset is ignored.
+//!
+//! Both axes are separable, thus each axis keeps a table of motor steps over
+//! normalized coordinate, interpolated linearly. Tables are rebuilt only when
+//! configuration or frame size changes.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "../common/scanner_protocol.h"
+#include "sample_allocator.hpp"
+
+struct FAngularProjectionParam
+{
+    float Fov[2]             = { 78.f, 49.f };         //!< Camera field of view, degrees
+    float SensorOffset[2]    = { 15e-3f, 15e-3f };     //!< Sensor pivot from camera center, meters
+    float ReferenceDistance  = 0.f;                    //!< Meters parallax is corrected at. 0 to ignore
+    float AngleOffset[2]     = { 0.f, 0.f };           //!< Calibrated mount angle, degrees
+    float DegreePerStep[2]   = { 0.1125f, 0.1125f };   //!< Motor resolution
+
+    bool operator==( FAngularProjectionParam const& o ) const noexcept;
+    bool operator!=( FAngularProjectionParam const& o ) const noexcept { return !( *this == o ); }
+};
+
+class FAngularProjection
+{
+public:
+    enum
+    {
+        TABLE_SIZE = 1024 //!< Intervals over normalized coordinate
+    };
+
+public:
+    //! @brief      Rebuild tables if anything changed.
+    //! @returns    true if tables were rebuilt.
+    bool Configure( FAngularProjectionParam const& Param, int Width, int Height );
+
+    //! @brief      Motor steps per pixel around the image center.
+    float StepPerPixel( int Axis ) const noexcept { return mStepPerPixel[Axis]; }
+
+    //! @brief      Motor step of a pixel coordinate, evaluated without tables.
+    void Evaluate( float X, float Y, float& StepX, float& StepY ) const noexcept;
+
+    //! @brief      Convert points at once.
+    //! @param      StepX, StepY: Continuous motor steps, for path planning.
+    //!             Either may be nullptr.
+    //! @param      Reqs: Point requests of rounded steps, ID as the index of
+    //!             point. May be nullptr.
+    void Project(
+      FSamplePoint const* Points,
+      size_t              NumPoints,
+      float*              StepX,
+      float*              StepY,
+      FPointReq*          Reqs ) const noexcept;
+
+    FAngularProjectionParam const& Param() const noexcept { return mParam; }
+
+private:
+    float evaluate( int Axis, float u ) const noexcept;
+
+private:
+    FAngularProjectionParam mParam;
+    int                     mSize[2]         = {};
+    float                   mStepPerPixel[2] = {};
+    std::vector<float>      mTable[2]; //!< TABLE_SIZE + 2 steps; last one pads interpolation
+};
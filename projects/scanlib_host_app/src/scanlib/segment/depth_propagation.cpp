@@ -0,0 +1,137 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "depth_propagation.hpp"
+#include <algorithm>
+#include <cmath>
+#include "../utility/thread_pool.hpp"
+#include "../utility/trace.hpp"
+
+using namespace std;
+
+namespace
+{
+// Pulls every node slightly toward the initial guess, which keeps the system
+// positive definite even on components without any sample.
+constexpr float Anchor = 1e-6f;
+
+double Dot( vector<float> const& a, vector<float> const& b )
+{
+    double Sum = 0;
+    for ( size_t i = 0; i < a.size(); i++ )
+        Sum += double( a[i] ) * b[i];
+    return Sum;
+}
+} // namespace
+
+FDepthPropagator::FDepthPropagator( FThreadPool* Pool ) noexcept
+    : mPool( Pool ? Pool : &FThreadPool::Shared() )
+{
+}
+
+void FDepthPropagator::multiply( FSuperpixelGraph const& Graph, float const* In, float* Out )
+{
+    auto const& Offsets = Graph.Offsets();
+    auto const& Edges   = Graph.Edges();
+    mPool->ParallelFor( 0, Graph.NumNodes(), 1024, [&]( size_t Begin, size_t End ) {
+        for ( auto i = Begin; i < End; i++ )
+        {
+            float Sum = mDiag[i] * In[i];
+            for ( auto k = Offsets[i]; k < Offsets[i + 1]; k++ )
+                Sum -= mWeights[k] * In[Edges[k].To];
+            Out[i] = Sum;
+        }
+    } );
+}
+
+int FDepthPropagator::Solve(
+  FDepthPropagationParam const& Param,
+  FSuperpixelGraph const&       Graph,
+  FSuperpixelStat const*        Stats,
+  FDepthSample const*           Samples,
+  uint32_t const*               Segments,
+  float*                        Depth )
+{
+    SCANLIB_TRACE_SCOPE( "propagate depth" );
+    auto const  N       = Graph.NumNodes();
+    auto const& Offsets = Graph.Offsets();
+    auto const& Edges   = Graph.Edges();
+    if ( none_of( Samples, Samples + N, []( auto& s ) { return s.Confidence > 0; } ) )
+        return -1;
+
+    // Boundary length is taken relative to mean superpixel spacing, so that
+    // weights don't depend on resolution.
+    double Area = 0;
+    for ( size_t i = 0; i < N; i++ )
+        Area += Stats[i].NumPixels;
+    auto const InvSpacing = 1.f / max( 1.f, sqrtf( float( Area / N ) ) );
+    auto const InvSigma2  = 1.f / ( 2.f * Param.ColorSigma * Param.ColorSigma );
+
+    mWeights.resize( Edges.size() );
+    mDiag.resize( N );
+    mRhs.resize( N );
+    mPool->ParallelFor( 0, N, 1024, [&]( size_t Begin, size_t End ) {
+        for ( auto i = Begin; i < End; i++ )
+        {
+            auto const c   = max( 0.f, Samples[i].Confidence );
+            float      Sum = 0;
+            for ( auto k = Offsets[i]; k < Offsets[i + 1]; k++ )
+            {
+                auto const& a  = Stats[i].Mean;
+                auto const& b  = Stats[Edges[k].To].Mean;
+                auto const  d2 = ( a[0] - b[0] ) * ( a[0] - b[0] ) + ( a[1] - b[1] ) * ( a[1] - b[1] ) + ( a[2] - b[2] ) * ( a[2] - b[2] );
+                mWeights[k]    = Param.Smoothness * Edges[k].Length * InvSpacing * expf( -d2 * InvSigma2 );
+                if ( Segments && Segments[i] != Segments[Edges[k].To] )
+                    mWeights[k] *= Param.CrossSegment;
+                Sum += mWeights[k];
+            }
+
+            mDiag[i] = c + Sum + Anchor;
+            mRhs[i]  = c * Samples[i].Range + Anchor * Depth[i];
+        }
+    } );
+
+    // Preconditioned conjugate gradient
+    mResidual.resize( N );
+    mPrecond.resize( N );
+    mDirection.resize( N );
+    mProduct.resize( N );
+
+    multiply( Graph, Depth, mProduct.data() );
+    for ( size_t i = 0; i < N; i++ )
+    {
+        mResidual[i]  = mRhs[i] - mProduct[i];
+        mPrecond[i]   = mResidual[i] / mDiag[i];
+        mDirection[i] = mPrecond[i];
+    }
+
+    auto const Limit = double( Param.Tolerance ) * Param.Tolerance * max( 1e-30, Dot( mRhs, mRhs ) );
+    auto       rz    = Dot( mResidual, mPrecond );
+    int        Iter  = 0;
+    for ( ; Iter < Param.MaxIterations && Dot( mResidual, mResidual ) > Limit; Iter++ )
+    {
+        multiply( Graph, mDirection.data(), mProduct.data() );
+        auto const pAp = Dot( mDirection, mProduct );
+        if ( !( pAp > 0 ) )
+            break;
+
+        auto const Alpha = float( rz / pAp );
+        for ( size_t i = 0; i < N; i++ )
+        {
+            Depth[i] += Alpha * mDirection[i];
+            mResidual[i] -= Alpha * mProduct[i];
+            mPrecond[i] = mResidual[i] / mDiag[i];
+        }
+
+        auto const rzNext = Dot( mResidual, mPrecond );
+        auto const Beta   = float( rzNext / rz );
+        rz                = rzNext;
+        for ( size_t i = 0; i < N; i++ )
+            mDirection[i] = mPrecond[i] + Beta * mDirection[i];
+    }
+
+    return Iter;
+}
@@ -0,0 +1,68 @@
+//! Edge aware depth propagation over the superpixel graph.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Depth x of superpixels minimizes
+//!     sum_i c_i (x_i - s_i)^2 + lambda * sum_ij w_ij (x_i - x_j)^2,
+//! where s_i is the sample of superpixel i with confidence c_i, and w_ij grows
+//! with the boundary length of adjacent superpixels and falls with their color
+//! distance. Depth flows freely between superpixels alike in color, and hardly
+//! across color edges. If superpixels are segmented, edges between segments
+//! are weakened further.
+//!
+//! The normal equation (C + lambda * L) x = C s is solved by conjugate gradient
+//! with Jacobi preconditioner, starting from the given depth; the previous
+//! frame is a good guess and cuts iterations down.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "sample_cache.hpp"
+#include "superpixel_graph.hpp"
+#include "superpixel_stats.hpp"
+
+class FThreadPool;
+
+struct FDepthPropagationParam
+{
+    float Smoothness    = 0.05f; //!< lambda; relative to confidence of a sample
+    float ColorSigma    = 12.f;  //!< Color distance scale of edge weights, 8 bit units
+    float CrossSegment  = 0.2f;  //!< Scale of edge weights between segments
+    int   MaxIterations = 200;
+    float Tolerance     = 1e-4f; //!< Residual relative to the right hand side
+};
+
+class FDepthPropagator
+{
+public:
+    //! @param      Pool: Pool to run on. nullptr for shared pool.
+    explicit FDepthPropagator( FThreadPool* Pool = nullptr ) noexcept;
+
+    //! @brief      Propagate samples over the graph.
+    //! @param      Stats: Statistics of the labels the graph was built on.
+    //! @param      Samples: Per superpixel. Confidence of zero or less marks
+    //!             superpixels without sample.
+    //! @param      Segments: Segment of each superpixel. nullptr if not
+    //!             segmented.
+    //! @param      Depth: Initial guess on input; solution on output. Nodes
+    //!             not connected to any sample are smoothed out of the guess.
+    //! @returns    Number of iterations taken. Negative if there is no sample.
+    int Solve(
+      FDepthPropagationParam const& Param,
+      FSuperpixelGraph const&       Graph,
+      FSuperpixelStat const*        Stats,
+      FDepthSample const*           Samples,
+      uint32_t const*               Segments,
+      float*                        Depth );
+
+private:
+    void multiply( FSuperpixelGraph const& Graph, float const* In, float* Out );
+
+private:
+    FThreadPool*       mPool = {};
+    std::vector<float> mWeights; //!< lambda * w_ij, along graph edges
+    std::vector<float> mDiag;
+    std::vector<float> mRhs, mResidual, mPrecond, mDirection, mProduct;
+};
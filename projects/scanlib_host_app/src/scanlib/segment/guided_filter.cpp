@@ -0,0 +1,241 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "guided_filter.hpp"
+#include <algorithm>
+#include <cmath>
+#include "../utility/thread_pool.hpp"
+#include "../utility/trace.hpp"
+
+using namespace std;
+
+namespace
+{
+// Layout of a moment cell: w, wI[3], wp, wII[6], wIp[3]
+constexpr int NumStat = 14;
+constexpr int NumCoef = 5; // a[3] * v, b * v, v
+} // namespace
+
+FGuidedDepthFilter::FGuidedDepthFilter( FThreadPool* Pool ) noexcept
+    : mPool( Pool ? Pool : &FThreadPool::Shared() )
+{
+}
+
+void FGuidedDepthFilter::boxSum( float* Data, int Channels, int Width, int Height, int Radius )
+{
+    auto const K      = size_t( Channels );
+    auto const RowLen = size_t( Width ) * K;
+    mTemp.resize( RowLen * Height );
+
+    // Horizontal running sums. Accumulates in double, since the window slides
+    // over a whole row.
+    mPool->ParallelFor( 0, Height, 16, [&]( size_t Begin, size_t End ) {
+        double Acc[NumStat];
+        for ( auto y = Begin; y < End; y++ )
+        {
+            auto const Src = Data + y * RowLen;
+            auto const Dst = mTemp.data() + y * RowLen;
+
+            fill_n( Acc, K, 0.0 );
+            for ( int x = 0; x <= min( Radius, Width - 1 ); x++ )
+                for ( size_t k = 0; k < K; k++ )
+                    Acc[k] += Src[x * K + k];
+
+            for ( int x = 0; x < Width; x++ )
+            {
+                for ( size_t k = 0; k < K; k++ )
+                    Dst[x * K + k] = float( Acc[k] );
+                if ( x + Radius + 1 < Width )
+                    for ( size_t k = 0; k < K; k++ )
+                        Acc[k] += Src[( x + Radius + 1 ) * K + k];
+                if ( x - Radius >= 0 )
+                    for ( size_t k = 0; k < K; k++ )
+                        Acc[k] -= Src[( x - Radius ) * K + k];
+            }
+        }
+    } );
+
+    // Vertical running sums over row bands. Each band primes its own window,
+    // which costs Radius rows once per band.
+    auto const Grain = size_t( max( 32, 2 * Radius ) );
+    mPool->ParallelFor( 0, Height, Grain, [&]( size_t Begin, size_t End ) {
+        vector<double> Acc( RowLen, 0.0 );
+        auto const     Row = [&]( int y ) { return mTemp.data() + y * RowLen; };
+
+        for ( int y = max( 0, int( Begin ) - Radius ); y <= min( int( Begin ) + Radius, Height - 1 ); y++ )
+        {
+            auto const Src = Row( y );
+            for ( size_t i = 0; i < RowLen; i++ )
+                Acc[i] += Src[i];
+        }
+
+        for ( int y = int( Begin ); y < int( End ); y++ )
+        {
+            auto const Dst = Data + y * RowLen;
+            for ( size_t i = 0; i < RowLen; i++ )
+                Dst[i] = float( Acc[i] );
+
+            if ( y + Radius + 1 < Height )
+            {
+                auto const Src = Row( y + Radius + 1 );
+                for ( size_t i = 0; i < RowLen; i++ )
+                    Acc[i] += Src[i];
+            }
+            if ( y - Radius >= 0 )
+            {
+                auto const Src = Row( y - Radius );
+                for ( size_t i = 0; i < RowLen; i++ )
+                    Acc[i] -= Src[i];
+            }
+        }
+    } );
+}
+
+void FGuidedDepthFilter::Filter(
+  FGuidedFilterParam const& Param,
+  uint8_t const*            Guide,
+  int                       GuideChannels,
+  size_t                    GuideStride,
+  float const*              Depth,
+  size_t                    DepthStride,
+  float const*              Weight,
+  size_t                    WeightStride,
+  int                       Width,
+  int                       Height,
+  float*                    Out,
+  size_t                    OutStride )
+{
+    SCANLIB_TRACE_SCOPE( "guided filter" );
+    if ( Width <= 0 || Height <= 0 )
+        return;
+
+    GuideStride  = GuideStride ? GuideStride : size_t( Width ) * GuideChannels;
+    DepthStride  = DepthStride ? DepthStride : Width;
+    WeightStride = WeightStride ? WeightStride : Width;
+    OutStride    = OutStride ? OutStride : Width;
+
+    auto const S  = max( 1, Param.Subsample );
+    auto const Lw = ( Width + S - 1 ) / S;
+    auto const Lh = ( Height + S - 1 ) / S;
+    auto const R  = max( 1, int( lroundf( float( Param.Radius ) / S ) ) );
+
+    // Weighted moments of each block of the subsampled grid. Summing blocks
+    // here is a part of the box sum; it doesn't need to be averaged.
+    mStats.assign( size_t( Lw ) * Lh * NumStat, 0.f );
+    mPool->ParallelFor( 0, Lh, 8, [&]( size_t Begin, size_t End ) {
+        for ( auto by = Begin; by < End; by++ )
+        {
+            for ( int y = int( by ) * S; y < min( Height, int( by + 1 ) * S ); y++ )
+            {
+                auto const GuideRow  = Guide + y * GuideStride;
+                auto const DepthRow  = Depth + y * DepthStride;
+                auto const WeightRow = Weight ? Weight + y * WeightStride : nullptr;
+                for ( int x = 0; x < Width; x++ )
+                {
+                    auto const p = DepthRow[x];
+                    auto const w = p > 0 ? ( WeightRow ? WeightRow[x] : 1.f ) : 0.f;
+                    if ( !( w > 0 ) )
+                        continue;
+
+                    auto const c  = GuideRow + x * GuideChannels;
+                    float const I[] = { c[0] * ( 1.f / 255 ), c[1] * ( 1.f / 255 ), c[2] * ( 1.f / 255 ) };
+                    auto const Dst = &mStats[( by * Lw + x / S ) * NumStat];
+                    Dst[0] += w;
+                    Dst[1] += w * I[0], Dst[2] += w * I[1], Dst[3] += w * I[2];
+                    Dst[4] += w * p;
+                    Dst[5] += w * I[0] * I[0], Dst[6] += w * I[0] * I[1], Dst[7] += w * I[0] * I[2];
+                    Dst[8] += w * I[1] * I[1], Dst[9] += w * I[1] * I[2], Dst[10] += w * I[2] * I[2];
+                    Dst[11] += w * I[0] * p, Dst[12] += w * I[1] * p, Dst[13] += w * I[2] * p;
+                }
+            }
+        }
+    } );
+    boxSum( mStats.data(), NumStat, Lw, Lh, R );
+
+    // Solve each window; a = (Var(I) + eps)^-1 Cov(I, p), b = E(p) - a E(I).
+    // Windows without any sample are left out of the average.
+    mCoefs.assign( size_t( Lw ) * Lh * NumCoef, 0.f );
+    mPool->ParallelFor( 0, size_t( Lw ) * Lh, 1024, [&]( size_t Begin, size_t End ) {
+        for ( auto i = Begin; i < End; i++ )
+        {
+            auto const s = &mStats[i * NumStat];
+            auto const c = &mCoefs[i * NumCoef];
+            if ( !( s[0] > 1e-6f ) )
+                continue;
+
+            double const n   = 1.0 / s[0];
+            double const m[] = { s[1] * n, s[2] * n, s[3] * n };
+            double const mp  = s[4] * n;
+            double const e   = Param.Epsilon;
+
+            double const v00 = s[5] * n - m[0] * m[0] + e, v01 = s[6] * n - m[0] * m[1], v02 = s[7] * n - m[0] * m[2];
+            double const v11 = s[8] * n - m[1] * m[1] + e, v12 = s[9] * n - m[1] * m[2];
+            double const v22 = s[10] * n - m[2] * m[2] + e;
+            double const cp[] = { s[11] * n - m[0] * mp, s[12] * n - m[1] * mp, s[13] * n - m[2] * mp };
+
+            // Inverse of symmetric 3x3 by cofactors
+            double const c00 = v11 * v22 - v12 * v12, c01 = v02 * v12 - v01 * v22, c02 = v01 * v12 - v02 * v11;
+            double const c11 = v00 * v22 - v02 * v02, c12 = v01 * v02 - v00 * v12;
+            double const c22 = v00 * v11 - v01 * v01;
+            double const Det = v00 * c00 + v01 * c01 + v02 * c02;
+            if ( !( fabs( Det ) > 1e-18 ) )
+                continue;
+
+            double const a[] = {
+                ( c00 * cp[0] + c01 * cp[1] + c02 * cp[2] ) / Det,
+                ( c01 * cp[0] + c11 * cp[1] + c12 * cp[2] ) / Det,
+                ( c02 * cp[0] + c12 * cp[1] + c22 * cp[2] ) / Det,
+            };
+            c[0] = float( a[0] ), c[1] = float( a[1] ), c[2] = float( a[2] );
+            c[3] = float( mp - a[0] * m[0] - a[1] * m[1] - a[2] * m[2] );
+            c[4] = 1.f;
+        }
+    } );
+    boxSum( mCoefs.data(), NumCoef, Lw, Lh, R );
+
+    // Interpolate coefficient sums to full resolution, then normalize them by
+    // the number of windows that had samples.
+    mPool->ParallelFor( 0, Height, 16, [&]( size_t Begin, size_t End ) {
+        for ( auto y = Begin; y < End; y++ )
+        {
+            auto const fy = max( 0.f, ( y + 0.5f ) / S - 0.5f );
+            auto const y0 = min( int( fy ), Lh - 1 );
+            auto const y1 = min( y0 + 1, Lh - 1 );
+            auto const ty = min( 1.f, fy - y0 );
+
+            auto const GuideRow = Guide + y * GuideStride;
+            auto const OutRow   = Out + y * OutStride;
+            for ( int x = 0; x < Width; x++ )
+            {
+                auto const fx = max( 0.f, ( x + 0.5f ) / S - 0.5f );
+                auto const x0 = min( int( fx ), Lw - 1 );
+                auto const x1 = min( x0 + 1, Lw - 1 );
+                auto const tx = min( 1.f, fx - x0 );
+
+                auto const c00 = &mCoefs[( y0 * Lw + x0 ) * NumCoef], c01 = &mCoefs[( y0 * Lw + x1 ) * NumCoef];
+                auto const c10 = &mCoefs[( y1 * Lw + x0 ) * NumCoef], c11 = &mCoefs[( y1 * Lw + x1 ) * NumCoef];
+
+                float Coef[NumCoef];
+                for ( int k = 0; k < NumCoef; k++ )
+                {
+                    auto const Top = c00[k] + ( c01[k] - c00[k] ) * tx;
+                    auto const Bot = c10[k] + ( c11[k] - c10[k] ) * tx;
+                    Coef[k]        = Top + ( Bot - Top ) * ty;
+                }
+
+                if ( !( Coef[4] > 1e-6f ) )
+                {
+                    OutRow[x] = 0;
+                    continue;
+                }
+
+                auto const c = GuideRow + x * GuideChannels;
+                auto const q = Coef[0] * c[0] * ( 1.f / 255 ) + Coef[1] * c[1] * ( 1.f / 255 ) + Coef[2] * c[2] * ( 1.f / 255 ) + Coef[3];
+                OutRow[x]    = max( 0.f, q / Coef[4] );
+            }
+        }
+    } );
+}
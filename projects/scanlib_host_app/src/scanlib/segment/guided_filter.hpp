@@ -0,0 +1,70 @@
+//! Color guided depth completion.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Depth is modelled as an affine function of the color guide in every window,
+//! fitted by weighted least squares, and the coefficients of overlapping
+//! windows are averaged; thus depth edges follow color edges, and nothing is
+//! blurred across them. Only box sums are involved, each costing constant time
+//! per pixel regardless of radius.
+//!
+//! Coefficients are fitted on the image subsampled by FGuidedFilterParam::
+//! Subsample and interpolated back, as they vary slowly; only the final affine
+//! transform runs on full resolution.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class FThreadPool;
+
+struct FGuidedFilterParam
+{
+    int   Radius    = 16;    //!< Window radius in full resolution pixels
+    float Epsilon   = 1e-3f; //!< Regularization, on guide scaled to [0, 1]
+    int   Subsample = 4;     //!< 1 to fit coefficients on full resolution
+};
+
+class FGuidedDepthFilter
+{
+public:
+    //! @param      Pool: Pool to run on. nullptr for shared pool.
+    explicit FGuidedDepthFilter( FThreadPool* Pool = nullptr ) noexcept;
+
+    //! @brief      Fill and smooth depth map along the guide.
+    //! @param      Guide: 8 bit image of 3 or 4 channels. Only the first 3
+    //!             channels are used.
+    //! @param      GuideStride: Row pitch of Guide in bytes. 0 for tightly
+    //!             packed.
+    //! @param      Depth: Depth map to complete. Pixels of zero or less are
+    //!             taken as not sampled.
+    //! @param      Weight: Confidence of each depth pixel. nullptr to weigh
+    //!             sampled pixels equally.
+    //! @param      Out: May alias Depth. Pixels out of reach of any sample are
+    //!             set to zero.
+    //! @note       Strides of float maps are in elements, 0 for Width.
+    void Filter(
+      FGuidedFilterParam const& Param,
+      uint8_t const*            Guide,
+      int                       GuideChannels,
+      size_t                    GuideStride,
+      float const*              Depth,
+      size_t                    DepthStride,
+      float const*              Weight,
+      size_t                    WeightStride,
+      int                       Width,
+      int                       Height,
+      float*                    Out,
+      size_t                    OutStride );
+
+private:
+    void boxSum( float* Data, int Channels, int Width, int Height, int Radius );
+
+private:
+    FThreadPool*       mPool = {};
+    std::vector<float> mStats; //!< Weighted moments of guide and depth
+    std::vector<float> mCoefs; //!< Affine coefficients of each window
+    std::vector<float> mTemp;
+};
@@ -0,0 +1,123 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "label_convert.hpp"
+#include <algorithm>
+#include <cmath>
+#include "../utility/thread_pool.hpp"
+#include "../utility/trace.hpp"
+
+using namespace std;
+
+FLabelDepthConverter::FLabelDepthConverter( FThreadPool* Pool ) noexcept
+    : mPool( Pool ? Pool : &FThreadPool::Shared() )
+{
+}
+
+void FLabelDepthConverter::acquire( pixel_buffer_type& Buffer )
+{
+    if ( Buffer == nullptr || Buffer.use_count() > 1 )
+        Buffer = make_shared<vector<ScanDataPixelType>>();
+    Buffer->resize( size_t( mWidth ) * mHeight );
+}
+
+void FLabelDepthConverter::Fill(
+  int32_t const*      Labels,
+  size_t              LabelStride,
+  int                 Width,
+  int                 Height,
+  FDepthSample const* Samples,
+  FSamplePoint const* Points,
+  uint32_t const*     PointOffsets,
+  FDepthSample const* PointSamples )
+{
+    SCANLIB_TRACE_SCOPE( "fill depth" );
+    mWidth      = max( 0, Width );
+    mHeight     = max( 0, Height );
+    LabelStride = LabelStride ? LabelStride : Width;
+    mDepth.resize( size_t( mWidth ) * mHeight );
+    mWeight.resize( size_t( mWidth ) * mHeight );
+
+    mPool->ParallelFor( 0, mHeight, 16, [&]( size_t Begin, size_t End ) {
+        for ( auto y = Begin; y < End; y++ )
+        {
+            auto const LabelRow  = Labels + y * LabelStride;
+            auto const DepthRow  = mDepth.data() + y * mWidth;
+            auto const WeightRow = mWeight.data() + y * mWidth;
+            for ( int x = 0; x < mWidth; x++ )
+            {
+                auto const l = LabelRow[x];
+                DepthRow[x]  = Samples[l].Range;
+                WeightRow[x] = Samples[l].Confidence;
+                if ( Points == nullptr || PointOffsets[l + 1] - PointOffsets[l] < 2 )
+                    continue;
+
+                float Nearest = INFINITY;
+                for ( auto k = PointOffsets[l]; k < PointOffsets[l + 1]; k++ )
+                {
+                    auto const dx = Points[k].X - x, dy = Points[k].Y - y;
+                    if ( auto d = dx * dx + dy * dy; d < Nearest && PointSamples[k].Confidence > 0 )
+                        Nearest = d, DepthRow[x] = PointSamples[k].Range;
+                }
+            }
+        }
+    } );
+}
+
+void FLabelDepthConverter::Convert(
+  int32_t const*      Labels,
+  size_t              LabelStride,
+  FDepthSample const* Samples,
+  float const*        Filtered,
+  size_t              FilteredStride,
+  bool                bContour )
+{
+    SCANLIB_TRACE_SCOPE( "convert depth" );
+    LabelStride    = LabelStride ? LabelStride : mWidth;
+    FilteredStride = FilteredStride ? FilteredStride : mWidth;
+    acquire( mRaw );
+    acquire( mFiltered );
+    if ( bContour )
+        mContour.resize( size_t( mWidth ) * mHeight );
+    else
+        mContour.clear();
+
+    auto const W = mWidth, H = mHeight;
+    mPool->ParallelFor( 0, H, 16, [&]( size_t Begin, size_t End ) {
+        for ( auto y = Begin; y < End; y++ )
+        {
+            auto const LabelRow    = Labels + y * LabelStride;
+            auto const DepthRow    = mDepth.data() + y * W;
+            auto const FilteredRow = Filtered + y * FilteredStride;
+            auto const RawOut      = mRaw->data() + y * W;
+            auto const FilteredOut = mFiltered->data() + y * W;
+            for ( int x = 0; x < W; x++ )
+            {
+                auto const Amp             = uq12_4_t( min( 65535.f, max( 0.f, Samples[LabelRow[x]].Amp * UQ12_4_ONE_INT ) ) );
+                RawOut[x].Q9_22_DEPTH      = q9_22_t( DepthRow[x] * Q9_22_ONE_INT );
+                RawOut[x].UQ_12_4_AMP      = Amp;
+                FilteredOut[x].Q9_22_DEPTH = q9_22_t( FilteredRow[x] * Q9_22_ONE_INT );
+                FilteredOut[x].UQ_12_4_AMP = Amp;
+            }
+
+            if ( !bContour )
+                continue;
+
+            // Pixel is on contour if any of 4 neighbours is of another label
+            auto const Up      = y > 0 ? LabelRow - LabelStride : LabelRow;
+            auto const Down    = y + 1 < size_t( H ) ? LabelRow + LabelStride : LabelRow;
+            auto const Contour = mContour.data() + y * W;
+            for ( int x = 0; x < W; x++ )
+            {
+                auto const l     = LabelRow[x];
+                bool const bEdge = Up[x] != l || Down[x] != l
+                                   || ( x > 0 && LabelRow[x - 1] != l )
+                                   || ( x + 1 < W && LabelRow[x + 1] != l );
+                Contour[x] = bEdge ? 255 : 0;
+            }
+        }
+    } );
+}
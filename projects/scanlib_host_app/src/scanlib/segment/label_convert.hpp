@@ -0,0 +1,90 @@
+//! Conversion of superpixel samples to depth maps and dpta pixels.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! A frame takes two passes over its labels: Fill paints superpixel samples
+//! into a depth and a confidence map for completion, and Convert encodes the
+//! filled and the completed depth to dpta pixels, marking superpixel contour
+//! on the way. Both run over row bands, and buffers are kept across frames.
+//!
+//! dpta buffers are shared, as files are written after the frame moves on; a
+//! buffer is reused only when nothing else holds it any more.
+#pragma once
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "../core/scanner_utils.h"
+#include "sample_allocator.hpp"
+#include "sample_cache.hpp"
+
+class FThreadPool;
+
+class FLabelDepthConverter
+{
+public:
+    using pixel_buffer_type = std::shared_ptr<std::vector<ScanDataPixelType>>;
+
+public:
+    //! @param      Pool: Pool to run on. nullptr for shared pool.
+    explicit FLabelDepthConverter( FThreadPool* Pool = nullptr ) noexcept;
+
+    //! @brief      Paint each pixel with depth and confidence of its superpixel.
+    //! @param      LabelStride: Row pitch of Labels in elements. 0 for Width.
+    //! @param      Samples: Per superpixel.
+    //! @param      Points: Sample points grouped by superpixel. Pixels of a
+    //!             superpixel with more than one point take the nearest
+    //!             valid one. nullptr to use Samples only.
+    //! @param      PointOffsets: Points of superpixel i are [PointOffsets[i],
+    //!             PointOffsets[i + 1]).
+    //! @param      PointSamples: Per point.
+    void Fill(
+      int32_t const*      Labels,
+      size_t              LabelStride,
+      int                 Width,
+      int                 Height,
+      FDepthSample const* Samples,
+      FSamplePoint const* Points       = nullptr,
+      uint32_t const*     PointOffsets = nullptr,
+      FDepthSample const* PointSamples = nullptr );
+
+    //! @brief      Encode depth of the last Fill and the completed depth to dpta
+    //!             pixels. Amplitude is of the superpixel.
+    //! @param      Filtered: Completed depth map of the same size.
+    //! @param      FilteredStride: Row pitch of Filtered in elements. 0 for
+    //!             Width.
+    //! @param      bContour: Marks boundary of superpixels on Contour().
+    void Convert(
+      int32_t const*      Labels,
+      size_t              LabelStride,
+      FDepthSample const* Samples,
+      float const*        Filtered,
+      size_t              FilteredStride,
+      bool                bContour );
+
+    int Width() const noexcept { return mWidth; }
+    int Height() const noexcept { return mHeight; }
+
+    //! @brief      Outputs of Fill, tightly packed.
+    float const* Depth() const noexcept { return mDepth.data(); }
+    float const* Weight() const noexcept { return mWeight.data(); }
+
+    //! @brief      Outputs of Convert.
+    pixel_buffer_type const&    Raw() const noexcept { return mRaw; }
+    pixel_buffer_type const&    Filtered() const noexcept { return mFiltered; }
+    std::vector<uint8_t> const& Contour() const noexcept { return mContour; } //!< 255 on boundary
+
+private:
+    void acquire( pixel_buffer_type& Buffer );
+
+private:
+    FThreadPool*         mPool = {};
+    int                  mWidth = 0, mHeight = 0;
+    std::vector<float>   mDepth;
+    std::vector<float>   mWeight;
+    pixel_buffer_type    mRaw;
+    pixel_buffer_type    mFiltered;
+    std::vector<uint8_t> mContour;
+};
@@ -0,0 +1,213 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "sample_allocator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include "../utility/thread_pool.hpp"
+#include "../utility/trace.hpp"
+
+using namespace std;
+
+FSampleAllocator::FSampleAllocator( FThreadPool* Pool ) noexcept
+    : mPool( Pool ? Pool : &FThreadPool::Shared() )
+{
+}
+
+double FSampleAllocator::Allocate(
+  FSampleAllocParam const& Param,
+  FSuperpixelStat const*   Stats,
+  size_t                   NumStats,
+  int32_t const*           Labels,
+  size_t                   LabelStride,
+  int                      Width,
+  int                      Height,
+  float const*             Depth,
+  size_t                   DepthStride,
+  FDepthSample const*      Priors,
+  uint8_t const*           Boundary,
+  vector<FSamplePoint>&    Out )
+{
+    SCANLIB_TRACE_SCOPE( "allocate samples" );
+    Out.clear();
+    mCounts.assign( NumStats, 0 );
+    mOffsets.assign( NumStats + 1, 0 );
+    if ( NumStats == 0 || Width <= 0 || Height <= 0 )
+        return 0;
+
+    LabelStride         = LabelStride ? LabelStride : Width;
+    DepthStride         = DepthStride ? DepthStride : Width;
+    auto const MaxPer   = max( 1, Param.MaxPerSuperpixel );
+    auto const Prior    = [&]( size_t i ) { return Priors ? max( 0.f, Priors[i].Confidence ) : 0.f; };
+
+    // Weights
+    mWeights.resize( NumStats );
+    mPool->ParallelFor( 0, NumStats, 256, [&]( size_t Begin, size_t End ) {
+        for ( auto i = Begin; i < End; i++ )
+        {
+            auto const& s = Stats[i];
+            if ( s.NumPixels == 0 )
+            {
+                mWeights[i] = 0;
+                continue;
+            }
+
+            auto const Deviation = sqrtf( ( s.Variance[0] + s.Variance[1] + s.Variance[2] ) / 3.f );
+            float      Disc      = 0;
+            if ( Depth )
+            {
+                // Relative depth spread over the box, one pixel outside of it
+                // so that neighbours are seen.
+                int const Xs[] = { max( 0, s.MinX - 1 ), ( s.MinX + s.MaxX ) / 2, min( Width - 1, s.MaxX + 1 ) };
+                int const Ys[] = { max( 0, s.MinY - 1 ), ( s.MinY + s.MaxY ) / 2, min( Height - 1, s.MaxY + 1 ) };
+                float     Lo = INFINITY, Hi = 0;
+                for ( auto y : Ys )
+                {
+                    for ( auto x : Xs )
+                    {
+                        auto const d = Depth[y * DepthStride + x];
+                        if ( d > 0 )
+                            Lo = min( Lo, d ), Hi = max( Hi, d );
+                    }
+                }
+                Disc = Hi > Lo ? ( Hi - Lo ) / Hi : 0.f;
+            }
+
+            mWeights[i] = s.NumPixels
+                          * ( 1.f + Param.VarianceWeight * Deviation / 16.f )
+                          * ( 1.f + Param.DiscontinuityWeight * Disc )
+                          * ( Boundary && Boundary[i] ? 1.f + Param.BoundaryWeight : 1.f );
+        }
+    } );
+
+    // Cost of a sample; moving d pixels diagonally, then waiting for sensor.
+    auto const Cost = [&]( float d ) {
+        d *= 0.7071068f;
+        return Param.Motion.DwellSec + Param.Motion.MoveTime( d * Param.StepPerPixel[0], d * Param.StepPerPixel[1] );
+    };
+    auto const Spacing = sqrtf( float( Width ) * Height / NumStats );
+    auto const CostOf  = [&]( size_t i, int k ) {
+        return k == 0 ? Cost( Spacing ) : Cost( sqrtf( float( Stats[i].NumPixels ) / ( k + 1 ) ) );
+    };
+
+    // Error of superpixel with k samples is w / k. Without any, it is the
+    // penalty, lessened by the confidence of reused sample if there is one.
+    auto const Error = [&]( size_t i, int k ) {
+        auto const c = Prior( i );
+        return mWeights[i] * ( k ? 1.f / k : Param.UnsampledPenalty * ( 1.f - c ) + c );
+    };
+    auto const Gain = [&]( size_t i, int k ) { return Error( i, k ) - Error( i, k + 1 ); };
+
+    double Used = 0;
+    if ( Param.TimeBudget <= 0 )
+    {
+        for ( size_t i = 0; i < NumStats; i++ )
+        {
+            if ( Stats[i].NumPixels && Prior( i ) <= 0 )
+            {
+                mCounts[i] = 1;
+                Used += CostOf( i, 0 );
+            }
+        }
+    }
+    else
+    {
+        using item_type = pair<double, pair<uint32_t, int>>;
+        vector<item_type> Heap;
+        Heap.reserve( NumStats );
+        for ( size_t i = 0; i < NumStats; i++ )
+            if ( mWeights[i] > 0 && Gain( i, 0 ) > 0 )
+                Heap.push_back( { Gain( i, 0 ) / CostOf( i, 0 ), { uint32_t( i ), 0 } } );
+
+        priority_queue<item_type> Queue( less<item_type>(), std::move( Heap ) );
+        while ( !Queue.empty() )
+        {
+            auto const [i, k] = Queue.top().second;
+            Queue.pop();
+
+            auto const c = CostOf( i, k );
+            if ( Used + c > Param.TimeBudget )
+                continue;
+
+            Used += c;
+            mCounts[i] = k + 1;
+            if ( k + 1 < MaxPer )
+                Queue.push( { Gain( i, k + 1 ) / CostOf( i, k + 1 ), { i, k + 1 } } );
+        }
+    }
+
+    for ( size_t i = 0; i < NumStats; i++ )
+        mOffsets[i + 1] = mOffsets[i] + mCounts[i];
+    Out.resize( mOffsets[NumStats] );
+
+    // Place points. A single sample goes to the centroid; more are spread
+    // over grid points inside the superpixel, farthest first.
+    mPool->ParallelFor( 0, NumStats, 256, [&]( size_t Begin, size_t End ) {
+        vector<FSamplePoint> Cand;
+        vector<float>        Dist;
+        for ( auto i = Begin; i < End; i++ )
+        {
+            auto const  k   = int( mCounts[i] );
+            auto const& s   = Stats[i];
+            auto const  Dst = &Out[mOffsets[i]];
+            if ( k == 0 )
+                continue;
+
+            Cand.assign( 1, { s.CenterX, s.CenterY, uint32_t( i ) } );
+            if ( k > 1 )
+            {
+                auto const G  = int( ceilf( sqrtf( 4.f * k ) ) );
+                auto const Bw = float( s.MaxX - s.MinX + 1 ) / G;
+                auto const Bh = float( s.MaxY - s.MinY + 1 ) / G;
+                for ( int gy = 0; gy < G; gy++ )
+                {
+                    for ( int gx = 0; gx < G; gx++ )
+                    {
+                        auto const x = s.MinX + ( gx + 0.5f ) * Bw;
+                        auto const y = s.MinY + ( gy + 0.5f ) * Bh;
+                        if ( Labels[int( y ) * LabelStride + int( x )] == int32_t( i ) )
+                            Cand.push_back( { x, y, uint32_t( i ) } );
+                    }
+                }
+            }
+
+            // Farthest point sampling, starting from the centroid.
+            Dist.assign( Cand.size(), INFINITY );
+            size_t Next = 0;
+            int    n    = 0;
+            for ( ; n < k && n < int( Cand.size() ); n++ )
+            {
+                auto const p = Dst[n] = Cand[Next];
+                float Far = -1;
+                for ( size_t c = 0; c < Cand.size(); c++ )
+                {
+                    auto const dx = Cand[c].X - p.X, dy = Cand[c].Y - p.Y;
+                    Dist[c]       = min( Dist[c], dx * dx + dy * dy );
+                    if ( Dist[c] > Far )
+                        Far = Dist[c], Next = c;
+                }
+            }
+
+            // Fewer grid points than samples; mark rest as unused.
+            for ( ; n < k; n++ )
+                Dst[n].Label = UINT32_MAX;
+        }
+    } );
+
+    // Drop unused slots
+    if ( any_of( Out.begin(), Out.end(), []( auto& p ) { return p.Label == UINT32_MAX; } ) )
+    {
+        Out.erase( remove_if( Out.begin(), Out.end(), []( auto& p ) { return p.Label == UINT32_MAX; } ), Out.end() );
+        fill( mOffsets.begin(), mOffsets.end(), 0 );
+        for ( auto& p : Out )
+            mOffsets[p.Label + 1]++;
+        for ( size_t i = 0; i < NumStats; i++ )
+            mOffsets[i + 1] += mOffsets[i];
+    }
+
+    return Used;
+}
@@ -0,0 +1,88 @@
+//! Distributes depth samples over superpixels within a time budget.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Depth error of a superpixel is modelled as its weight over number of
+//! samples, or a penalty times the weight if it has none. The weight grows
+//! with area, color deviation, the depth discontinuity the previous frame
+//! showed around it, and lying on a segment boundary, where depth is likely to
+//! break as well; a sample reused from earlier frames lowers the penalty
+//! by its confidence. Each sample costs the sensor delay plus the motor
+//! travel to reach it, which is shorter for samples packed into the same
+//! superpixel.
+//!
+//! Samples are handed out greedily by error reduction per second until the
+//! budget runs out. Multiple samples of a superpixel are spread over its
+//! pixels by farthest point sampling.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "../core/sample_path.hpp"
+#include "sample_cache.hpp"
+#include "superpixel_stats.hpp"
+
+class FThreadPool;
+
+struct FSampleAllocParam
+{
+    FMotionModel Motion;
+    float        StepPerPixel[2] = { 1.f, 1.f }; //!< Motor steps per pixel, X and Y
+
+    double TimeBudget          = 0;   //!< Seconds. 0 for one sample per superpixel in need
+    int    MaxPerSuperpixel    = 4;   //!< Upper bound of samples in a superpixel
+    float  VarianceWeight      = 1.f; //!< Per 16 levels of color deviation
+    float  DiscontinuityWeight = 4.f; //!< Per relative depth change
+    float  BoundaryWeight      = 1.f; //!< Of superpixels on a segment boundary
+    float  UnsampledPenalty    = 4.f; //!< Error of no sample, over one sample
+};
+
+struct FSamplePoint
+{
+    float    X, Y;  //!< In pixels
+    uint32_t Label; //!< Superpixel the point belongs to
+};
+
+class FSampleAllocator
+{
+public:
+    //! @param      Pool: Pool to run on. nullptr for shared pool.
+    explicit FSampleAllocator( FThreadPool* Pool = nullptr ) noexcept;
+
+    //! @brief      Choose sample points of a frame.
+    //! @param      Labels: Superpixel labels the statistics were taken from.
+    //! @param      LabelStride: Row pitch of Labels in elements. 0 for Width.
+    //! @param      Depth: Depth map of the previous frame in the same
+    //!             resolution. nullptr if not available.
+    //! @param      DepthStride: Row pitch of Depth in elements. 0 for Width.
+    //! @param      Priors: Samples reused from earlier frames, per superpixel.
+    //!             nullptr if none.
+    //! @param      Boundary: Nonzero for superpixels on a segment boundary.
+    //!             nullptr if not segmented.
+    //! @param      Out: Points grouped by label in ascending order.
+    //! @returns    Predicted sampling time in seconds.
+    double Allocate(
+      FSampleAllocParam const&   Param,
+      FSuperpixelStat const*     Stats,
+      size_t                     NumStats,
+      int32_t const*             Labels,
+      size_t                     LabelStride,
+      int                        Width,
+      int                        Height,
+      float const*               Depth,
+      size_t                     DepthStride,
+      FDepthSample const*        Priors,
+      uint8_t const*             Boundary,
+      std::vector<FSamplePoint>& Out );
+
+    //! @brief      Points of label i are Out[Offsets()[i], Offsets()[i + 1]).
+    std::vector<uint32_t> const& Offsets() const noexcept { return mOffsets; }
+
+private:
+    FThreadPool*          mPool = {};
+    std::vector<float>    mWeights;
+    std::vector<uint32_t> mCounts;
+    std::vector<uint32_t> mOffsets;
+};
@@ -0,0 +1,189 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "sample_cache.hpp"
+#include <algorithm>
+#include <cmath>
+#include "../utility/thread_pool.hpp"
+#include "../utility/trace.hpp"
+
+using namespace std;
+
+FSampleCache::FSampleCache( FThreadPool* Pool ) noexcept
+    : mPool( Pool ? Pool : &FThreadPool::Shared() )
+{
+}
+
+void FSampleCache::Reset() noexcept
+{
+    lock_guard<mutex> lk( mLock );
+    clear();
+}
+
+size_t FSampleCache::Size() const noexcept
+{
+    lock_guard<mutex> lk( mLock );
+    return mEntries.size();
+}
+
+void FSampleCache::clear() noexcept
+{
+    mEntries.clear();
+    mCellBegin.clear();
+    mCellItems.clear();
+    mGridW = mGridH = 0;
+}
+
+size_t FSampleCache::Lookup(
+  FSampleCacheParam const& Param,
+  FSuperpixelStat const*   Stats,
+  size_t                   NumStats,
+  int                      Width,
+  int                      Height,
+  vector<FDepthSample>&    Samples,
+  vector<uint32_t>&        ToMeasure )
+{
+    SCANLIB_TRACE_SCOPE( "lookup samples" );
+    Samples.assign( NumStats, {} );
+    ToMeasure.clear();
+
+    lock_guard<mutex> lk( mLock );
+
+    bool const bUsable = Param.MaxAge > 0 && !mEntries.empty() && Width == mWidth && Height == mHeight;
+    if ( bUsable )
+    {
+        auto const Spacing   = sqrtf( float( Width ) * Height / max<size_t>( 1, NumStats ) );
+        auto const MaxShift  = Param.MaxCenterShift * Spacing;
+        auto const MaxShift2 = MaxShift * MaxShift;
+        auto const MaxColor2 = Param.MaxColorDistance * Param.MaxColorDistance;
+        auto const Reach     = int( ceilf( MaxShift / mCellSize ) );
+
+        mPool->ParallelFor( 0, NumStats, 256, [&]( size_t Begin, size_t End ) {
+            for ( auto i = Begin; i < End; i++ )
+            {
+                auto const& s = Stats[i];
+                if ( s.NumPixels == 0 )
+                    continue;
+
+                auto const cx        = int( s.CenterX / mCellSize );
+                auto const cy        = int( s.CenterY / mCellSize );
+                float      Best      = 2.f;
+                float      HitColor2 = 0;
+                FEntry*    Hit       = nullptr;
+
+                for ( int y = max( 0, cy - Reach ); y <= min( mGridH - 1, cy + Reach ); y++ )
+                {
+                    for ( int x = max( 0, cx - Reach ); x <= min( mGridW - 1, cx + Reach ); x++ )
+                    {
+                        auto const Cell = y * mGridW + x;
+                        for ( auto k = mCellBegin[Cell]; k < mCellBegin[Cell + 1]; k++ )
+                        {
+                            auto&      e  = mEntries[mCellItems[k]];
+                            auto const dx = e.Stat.CenterX - s.CenterX;
+                            auto const dy = e.Stat.CenterY - s.CenterY;
+                            auto const d2 = dx * dx + dy * dy;
+                            if ( d2 > MaxShift2 )
+                                continue;
+
+                            float c2 = 0;
+                            for ( int c = 0; c < 3; c++ )
+                            {
+                                auto const dc = e.Stat.Mean[c] - s.Mean[c];
+                                c2 += dc * dc;
+                            }
+                            if ( c2 > MaxColor2 )
+                                continue;
+
+                            auto const Ratio = float( max( e.Stat.NumPixels, s.NumPixels ) ) / min( e.Stat.NumPixels, s.NumPixels );
+                            if ( Ratio > Param.MaxSizeRatio )
+                                continue;
+
+                            // Both terms are within [0, 1]; favor the nearest in both.
+                            auto const Cost = d2 / MaxShift2 + c2 / MaxColor2;
+                            if ( Cost < Best )
+                                Best = Cost, HitColor2 = c2, Hit = &e;
+                        }
+                    }
+                }
+
+                if ( Hit == nullptr )
+                    continue;
+
+                // Limits spread over [MaxAge / 2, MaxAge], so that refreshes
+                // of a static scene spread over frames.
+                auto const Limit = Param.MaxAge - int( Hit->Sample.Stagger % ( Param.MaxAge / 2 + 1 ) );
+                if ( Hit->Sample.Age + 1 > Limit )
+                    continue;
+
+                // Confidence drops with age, and further with color change.
+                auto& Out      = Samples[i];
+                Out            = Hit->Sample;
+                Out.Age        = uint16_t( Hit->Sample.Age + 1 );
+                Out.Confidence = Hit->Sample.Confidence * Param.ConfidenceDecay
+                                 * ( 1.f - 0.5f * sqrtf( HitColor2 / MaxColor2 ) );
+            }
+        } );
+    }
+
+    size_t NumReused = 0;
+    for ( size_t i = 0; i < NumStats; i++ )
+    {
+        if ( Samples[i].Confidence > 0 )
+            NumReused++;
+        else
+            ToMeasure.push_back( uint32_t( i ) );
+    }
+    return NumReused;
+}
+
+void FSampleCache::Store(
+  FSuperpixelStat const* Stats,
+  FDepthSample const*    Samples,
+  size_t                 NumStats,
+  int                    Width,
+  int                    Height )
+{
+    lock_guard<mutex> lk( mLock );
+    clear();
+    mWidth  = Width;
+    mHeight = Height;
+    if ( NumStats == 0 || Width <= 0 || Height <= 0 )
+        return;
+
+    mEntries.reserve( NumStats );
+    for ( size_t i = 0; i < NumStats; i++ )
+    {
+        if ( Stats[i].NumPixels == 0 || !( Samples[i].Confidence > 0 ) )
+            continue;
+
+        // Fresh samples get a new stagger; golden ratio hashing keeps
+        // neighbours apart.
+        auto& e = mEntries.emplace_back( FEntry{ Stats[i], Samples[i] } );
+        if ( e.Sample.Age == 0 || e.Sample.Stagger == UINT32_MAX )
+            e.Sample.Stagger = ( mNumMeasured++ * 2654435761u ) >> 16;
+    }
+
+    // Bucket entries by centroid, on cells of about mean superpixel spacing.
+    mCellSize = max( 1.f, sqrtf( float( Width ) * Height / NumStats ) );
+    mGridW    = int( Width / mCellSize ) + 1;
+    mGridH    = int( Height / mCellSize ) + 1;
+    mCellBegin.assign( size_t( mGridW ) * mGridH + 1, 0 );
+    mCellItems.resize( mEntries.size() );
+
+    auto const CellOf = [&]( FEntry const& e ) {
+        auto x = min( mGridW - 1, max( 0, int( e.Stat.CenterX / mCellSize ) ) );
+        auto y = min( mGridH - 1, max( 0, int( e.Stat.CenterY / mCellSize ) ) );
+        return y * mGridW + x;
+    };
+    for ( auto& e : mEntries )
+        mCellBegin[CellOf( e ) + 1]++;
+    for ( size_t i = 1; i < mCellBegin.size(); i++ )
+        mCellBegin[i] += mCellBegin[i - 1];
+
+    vector<uint32_t> Fill( mCellBegin.begin(), mCellBegin.end() - 1 );
+    for ( size_t k = 0; k < mEntries.size(); k++ )
+        mCellItems[Fill[CellOf( mEntries[k] )]++] = uint32_t( k );
+}
@@ -0,0 +1,96 @@
+//! Frame to frame reuse of superpixel depth samples.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Each superpixel of a new frame is matched to the superpixel of the
+//! previous frame whose centroid is near and whose mean color and size are
+//! alike. A matched superpixel inherits its depth sample, one frame older and
+//! a little less confident; the rest are left to be measured.
+//!
+//! Samples are reused up to a staggered age limit, thus a static scene is
+//! refreshed a few superpixels per frame rather than all at once.
+//!
+//! Lookup and store may run on different threads; a frame can be looked up
+//! while the one before is still being measured, and then matches against the
+//! latest frame stored.
+#pragma once
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "superpixel_stats.hpp"
+
+class FThreadPool;
+
+struct FDepthSample
+{
+    float    Range      = 0;
+    float    Amp        = 0;
+    uint16_t Age        = 0;          //!< Frames since measured
+    float    Confidence = 0;          //!< 1 if just measured, 0 if not available
+    uint32_t Stagger    = UINT32_MAX; //!< Of age limit; set by cache, kept while reused
+};
+
+struct FSampleCacheParam
+{
+    float MaxCenterShift   = 0.5f;  //!< Relative to mean superpixel spacing
+    float MaxColorDistance = 12.f;  //!< Euclidean, in 8 bit color units
+    float MaxSizeRatio     = 1.5f;  //!< Larger area over smaller one
+    int   MaxAge           = 8;     //!< 0 disables reuse
+    float ConfidenceDecay  = 0.85f; //!< Per frame of reuse
+};
+
+class FSampleCache
+{
+public:
+    //! @param      Pool: Pool to run on. nullptr for shared pool.
+    explicit FSampleCache( FThreadPool* Pool = nullptr ) noexcept;
+
+    //! @brief      Match superpixels of a new frame against the cache.
+    //! @param      Samples: Resized to NumStats. Reused samples are filled;
+    //!             the others have zero confidence.
+    //! @param      ToMeasure: Indices of superpixels to measure, ascending.
+    //! @returns    Number of reused samples.
+    size_t Lookup(
+      FSampleCacheParam const&   Param,
+      FSuperpixelStat const*     Stats,
+      size_t                     NumStats,
+      int                        Width,
+      int                        Height,
+      std::vector<FDepthSample>& Samples,
+      std::vector<uint32_t>&     ToMeasure );
+
+    //! @brief      Replace cache with the frame just completed. Samples with
+    //!             zero confidence are not kept.
+    void Store(
+      FSuperpixelStat const* Stats,
+      FDepthSample const*    Samples,
+      size_t                 NumStats,
+      int                    Width,
+      int                    Height );
+
+    void   Reset() noexcept;
+    size_t Size() const noexcept;
+
+private:
+    struct FEntry
+    {
+        FSuperpixelStat Stat;
+        FDepthSample    Sample;
+    };
+
+    void clear() noexcept;
+
+private:
+    FThreadPool*          mPool = {};
+    mutable std::mutex    mLock;
+    std::vector<FEntry>   mEntries;
+    std::vector<uint32_t> mCellBegin; //!< Grid of entries, by centroid
+    std::vector<uint32_t> mCellItems;
+    float                 mCellSize = 1;
+    int                   mGridW = 0, mGridH = 0;
+    int                   mWidth = 0, mHeight = 0;
+    uint32_t              mNumMeasured = 0;
+};
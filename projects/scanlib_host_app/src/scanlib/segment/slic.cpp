@@ -0,0 +1,459 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "slic.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "../utility/thread_pool.hpp"
+#include "../utility/trace.hpp"
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define SCANLIB_SLIC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+//! Color conversion tables; sRGB gamma and the cube root of CIE Lab.
+namespace {
+struct FLabTable
+{
+    enum
+    {
+        CBRT_STEPS = 4096
+    };
+
+    float Linear[256];
+    float Cbrt[CBRT_STEPS + 2];
+
+    FLabTable()
+    {
+        for ( int i = 0; i < 256; i++ )
+        {
+            auto v    = i / 255.0;
+            Linear[i] = float( v <= 0.04045 ? v / 12.92 : pow( ( v + 0.055 ) / 1.055, 2.4 ) );
+        }
+        for ( int i = 0; i <= CBRT_STEPS + 1; i++ )
+        {
+            auto t  = double( i ) / CBRT_STEPS;
+            Cbrt[i] = float( t > 0.008856 ? cbrt( t ) : 7.787 * t + 16.0 / 116.0 );
+        }
+    }
+
+    //! t in [0, 1]; interpolated between entries.
+    float F( float t ) const noexcept
+    {
+        t       = min( max( t, 0.f ), 1.f ) * CBRT_STEPS;
+        int   i = int( t );
+        float f = t - i;
+        return Cbrt[i] + ( Cbrt[i + 1] - Cbrt[i] ) * f;
+    }
+
+    static FLabTable const& Get()
+    {
+        static FLabTable const Table;
+        return Table;
+    }
+};
+} // namespace
+
+FSlicSegmenter::FSlicSegmenter( FThreadPool* Pool ) noexcept
+    : mPool( Pool ? Pool : &FThreadPool::Shared() )
+{
+}
+
+void FSlicSegmenter::toLab( uint8_t const* Pixels, int Channels, size_t Stride )
+{
+    auto const& T = FLabTable::Get();
+    auto const  W = mWidth;
+
+    mPool->ParallelFor( 0, mHeight, 16, [&]( size_t Begin, size_t End ) {
+        for ( auto y = Begin; y < End; y++ )
+        {
+            auto const Src = Pixels + y * Stride;
+            auto const L   = mPlane[0].data() + y * W;
+            auto const A   = mPlane[1].data() + y * W;
+            auto const B   = mPlane[2].data() + y * W;
+
+            if ( Channels == 1 )
+            {
+                for ( int x = 0; x < W; x++ )
+                {
+                    L[x] = 116.f * T.F( T.Linear[Src[x]] ) - 16.f;
+                    A[x] = B[x] = 0.f;
+                }
+                continue;
+            }
+
+            for ( int x = 0; x < W; x++ )
+            {
+                auto const p  = Src + x * Channels;
+                auto const b  = T.Linear[p[0]];
+                auto const g  = T.Linear[p[1]];
+                auto const r  = T.Linear[p[2]];
+                auto const fx = T.F( ( 0.412453f * r + 0.357580f * g + 0.180423f * b ) * ( 1.f / 0.950456f ) );
+                auto const fy = T.F( 0.212671f * r + 0.715160f * g + 0.072169f * b );
+                auto const fz = T.F( ( 0.019334f * r + 0.119193f * g + 0.950227f * b ) * ( 1.f / 1.088754f ) );
+                L[x]          = 116.f * fy - 16.f;
+                A[x]          = 500.f * ( fx - fy );
+                B[x]          = 200.f * ( fy - fz );
+            }
+        }
+    } );
+}
+
+void FSlicSegmenter::placeSeeds( FSlicParam const& Param )
+{
+    auto const W = mWidth;
+    auto const H = mHeight;
+    auto const N = (size_t)W * H;
+    auto const K = (size_t)clamp<int64_t>( Param.NumSuperpixels, 1, N );
+    auto const S = sqrt( double( N ) / K );
+
+    mGridX = max( 1, int( W / S + 0.5 ) );
+    mGridY = max( 1, int( H / S + 0.5 ) );
+    mCellW = float( W ) / mGridX;
+    mCellH = float( H ) / mGridY;
+
+    mColBegin.resize( mGridX + 1 );
+    for ( int g = 0; g < mGridX; g++ )
+        mColBegin[g] = min( W, int( ceil( g * mCellW ) ) );
+    mColBegin[mGridX] = W;
+
+    // Normalized as D = dc^2 / m^2 + ds^2 / S^2
+    auto const Compactness = Param.bSlicZero ? 10.f : max( Param.Compactness, 1e-3f );
+    mSpatialWeight         = 1.f / ( mCellW * mCellH );
+
+    // Seed is moved to the lowest gradient of its 3x3 neighbourhood, so that
+    // it doesn't start on an edge.
+    auto const Gradient = [&]( int x, int y ) {
+        auto const i  = (size_t)y * W + x;
+        float      g  = 0;
+        for ( auto& P : mPlane )
+        {
+            auto const dx = P[i + 1] - P[i - 1];
+            auto const dy = P[i + W] - P[i - W];
+            g += dx * dx + dy * dy;
+        }
+        return g;
+    };
+
+    mClusters.resize( (size_t)mGridX * mGridY );
+    for ( int gy = 0; gy < mGridY; gy++ )
+    {
+        for ( int gx = 0; gx < mGridX; gx++ )
+        {
+            int cx = min( W - 1, int( ( gx + 0.5f ) * mCellW ) );
+            int cy = min( H - 1, int( ( gy + 0.5f ) * mCellH ) );
+            if ( W >= 3 && H >= 3 )
+            {
+                int   bx = cx, by = cy;
+                float bg = FLT_MAX;
+                for ( int y = max( 1, cy - 1 ); y <= min( H - 2, cy + 1 ); y++ )
+                {
+                    for ( int x = max( 1, cx - 1 ); x <= min( W - 2, cx + 1 ); x++ )
+                    {
+                        if ( auto g = Gradient( x, y ); g < bg )
+                        {
+                            bg = g;
+                            bx = x;
+                            by = y;
+                        }
+                    }
+                }
+                cx = bx;
+                cy = by;
+            }
+
+            auto const i = (size_t)cy * W + cx;
+            auto&      c = mClusters[(size_t)gy * mGridX + gx];
+            c.L           = mPlane[0][i];
+            c.A           = mPlane[1][i];
+            c.B           = mPlane[2][i];
+            c.X           = float( cx );
+            c.Y           = float( cy );
+            c.ColorWeight = 1.f / ( Compactness * Compactness );
+        }
+    }
+}
+
+void FSlicSegmenter::assignRows( int RowBegin, int RowEnd, FAccum* Accum )
+{
+    auto const W  = mWidth;
+    auto const Sw = mSpatialWeight;
+
+    for ( int y = RowBegin; y < RowEnd; y++ )
+    {
+        auto const Ofst = (size_t)y * W;
+        auto const L    = mPlane[0].data() + Ofst;
+        auto const A    = mPlane[1].data() + Ofst;
+        auto const B    = mPlane[2].data() + Ofst;
+        auto const Best = mBest.data() + Ofst;
+        auto const Lab  = mLabel.data() + Ofst;
+        auto const gy   = min( mGridY - 1, int( y / mCellH ) );
+
+        fill( Best, Best + W, FLT_MAX );
+        for ( int gx = 0; gx < mGridX; gx++ )
+        {
+            int const x0 = mColBegin[gx];
+            int const x1 = mColBegin[gx + 1];
+
+            for ( int ny = max( 0, gy - 1 ); ny <= min( mGridY - 1, gy + 1 ); ny++ )
+            {
+                for ( int nx = max( 0, gx - 1 ); nx <= min( mGridX - 1, gx + 1 ); nx++ )
+                {
+                    int32_t const k  = ny * mGridX + nx;
+                    auto const    c  = mClusters[k];
+                    auto const    dy = float( y ) - c.Y;
+                    auto const    Dy = dy * dy * Sw;
+
+                    // Branchless; vectorized over the pixels of the cell.
+                    int x = x0;
+#ifdef SCANLIB_SLIC_SSE2
+                    auto const vL  = _mm_set1_ps( c.L );
+                    auto const vA  = _mm_set1_ps( c.A );
+                    auto const vB  = _mm_set1_ps( c.B );
+                    auto const vX  = _mm_set1_ps( c.X );
+                    auto const vCw = _mm_set1_ps( c.ColorWeight );
+                    auto const vSw = _mm_set1_ps( Sw );
+                    auto const vDy = _mm_set1_ps( Dy );
+                    auto const vK  = _mm_set1_epi32( k );
+                    auto       vx  = _mm_setr_ps( float( x ), float( x + 1 ), float( x + 2 ), float( x + 3 ) );
+                    for ( ; x + 4 <= x1; x += 4 )
+                    {
+                        auto const dl = _mm_sub_ps( _mm_loadu_ps( L + x ), vL );
+                        auto const da = _mm_sub_ps( _mm_loadu_ps( A + x ), vA );
+                        auto const db = _mm_sub_ps( _mm_loadu_ps( B + x ), vB );
+                        auto const dx = _mm_sub_ps( vx, vX );
+                        auto const Dc = _mm_add_ps( _mm_add_ps( _mm_mul_ps( dl, dl ), _mm_mul_ps( da, da ) ), _mm_mul_ps( db, db ) );
+                        auto const Ds = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( dx, dx ), vSw ), vDy );
+                        auto const D  = _mm_add_ps( _mm_mul_ps( Dc, vCw ), Ds );
+                        auto const Bs = _mm_loadu_ps( Best + x );
+                        auto const m  = _mm_castps_si128( _mm_cmplt_ps( D, Bs ) );
+                        auto const Lb = _mm_loadu_si128( (__m128i const*)( Lab + x ) );
+                        _mm_storeu_ps( Best + x, _mm_min_ps( D, Bs ) );
+                        _mm_storeu_si128( (__m128i*)( Lab + x ), _mm_or_si128( _mm_and_si128( m, vK ), _mm_andnot_si128( m, Lb ) ) );
+                        vx = _mm_add_ps( vx, _mm_set1_ps( 4.f ) );
+                    }
+#endif
+                    for ( ; x < x1; x++ )
+                    {
+                        auto const dl = L[x] - c.L;
+                        auto const da = A[x] - c.A;
+                        auto const db = B[x] - c.B;
+                        auto const dx = float( x ) - c.X;
+                        auto const D  = ( dl * dl + da * da + db * db ) * c.ColorWeight + dx * dx * Sw + Dy;
+                        auto const b  = D < Best[x];
+                        Best[x]       = b ? D : Best[x];
+                        Lab[x]        = b ? k : Lab[x];
+                    }
+                }
+            }
+        }
+
+        for ( int x = 0; x < W; x++ )
+        {
+            auto&      a  = Accum[Lab[x]];
+            auto const c  = mClusters[Lab[x]];
+            auto const dl = L[x] - c.L;
+            auto const da = A[x] - c.A;
+            auto const db = B[x] - c.B;
+            a.L += L[x];
+            a.A += A[x];
+            a.B += B[x];
+            a.X += x;
+            a.Y += y;
+            a.MaxColor = max( a.MaxColor, dl * dl + da * da + db * db );
+            a.Count++;
+        }
+    }
+}
+
+int FSlicSegmenter::enforceConnectivity( int32_t* Out, int MinSize )
+{
+    static int const dx4[] = { -1, 0, 1, 0 };
+    static int const dy4[] = { 0, -1, 0, 1 };
+
+    auto const W = mWidth;
+    auto const H = mHeight;
+    fill( Out, Out + (size_t)W * H, -1 );
+
+    int32_t NumLabels = 0;
+    for ( int y = 0; y < H; y++ )
+    {
+        for ( int x = 0; x < W; x++ )
+        {
+            auto const i = (size_t)y * W + x;
+            if ( Out[i] >= 0 )
+                continue;
+
+            // Small fragment is merged into the segment found before it.
+            int32_t Adjacent = -1;
+            for ( int n = 0; n < 4; n++ )
+            {
+                int const ax = x + dx4[n], ay = y + dy4[n];
+                if ( ax >= 0 && ax < W && ay >= 0 && ay < H && Out[(size_t)ay * W + ax] >= 0 )
+                    Adjacent = Out[(size_t)ay * W + ax];
+            }
+
+            auto const Src = mLabel[i];
+            mStack.clear();
+            mStack.push_back( int( i ) );
+            Out[i] = NumLabels;
+            for ( size_t Head = 0; Head < mStack.size(); Head++ )
+            {
+                int const px = mStack[Head] % W;
+                int const py = mStack[Head] / W;
+                for ( int n = 0; n < 4; n++ )
+                {
+                    int const ax = px + dx4[n], ay = py + dy4[n];
+                    if ( ax < 0 || ax >= W || ay < 0 || ay >= H )
+                        continue;
+
+                    auto const j = (size_t)ay * W + ax;
+                    if ( Out[j] < 0 && mLabel[j] == Src )
+                    {
+                        Out[j] = NumLabels;
+                        mStack.push_back( int( j ) );
+                    }
+                }
+            }
+
+            if ( (int)mStack.size() < MinSize && Adjacent >= 0 )
+            {
+                for ( auto j : mStack )
+                    Out[j] = Adjacent;
+                continue;
+            }
+            NumLabels++;
+        }
+    }
+    return NumLabels;
+}
+
+int FSlicSegmenter::Segment(
+  FSlicParam const& Param,
+  uint8_t const*    Pixels,
+  int               Width,
+  int               Height,
+  int               Channels,
+  size_t            Stride,
+  int32_t*          Labels )
+{
+    SCANLIB_TRACE_SCOPE( "slic" );
+    if ( Pixels == nullptr || Labels == nullptr || Width <= 0 || Height <= 0 )
+        return 0;
+    if ( Channels != 1 && Channels != 3 && Channels != 4 )
+        return 0;
+
+    auto const N = (size_t)Width * Height;
+    mWidth       = Width;
+    mHeight      = Height;
+    for ( auto& P : mPlane )
+        P.resize( N );
+    mBest.resize( N );
+    mLabel.resize( N );
+
+    toLab( Pixels, Channels, Stride ? Stride : (size_t)Width * Channels );
+    placeSeeds( Param );
+
+    // Bands are a few times more than workers to balance load.
+    auto const K        = mClusters.size();
+    auto const Grain    = max<size_t>( 8, Height / ( 4 * max<size_t>( 1, mPool->NumThreads() ) ) );
+    auto const NumBands = ( Height + Grain - 1 ) / Grain;
+    mAccum.resize( NumBands * K );
+
+    for ( int Iter = 0; Iter < max( 1, Param.NumIterations ); Iter++ )
+    {
+        fill( mAccum.begin(), mAccum.end(), FAccum{} );
+        mPool->ParallelFor( 0, Height, Grain, [&]( size_t Begin, size_t End ) {
+            assignRows( int( Begin ), int( End ), mAccum.data() + Begin / Grain * K );
+        } );
+
+        mPool->ParallelFor( 0, K, 256, [&]( size_t Begin, size_t End ) {
+            for ( auto k = Begin; k < End; k++ )
+            {
+                FAccum Sum = {};
+                for ( size_t b = 0; b < NumBands; b++ )
+                {
+                    auto& a = mAccum[b * K + k];
+                    Sum.L += a.L;
+                    Sum.A += a.A;
+                    Sum.B += a.B;
+                    Sum.X += a.X;
+                    Sum.Y += a.Y;
+                    Sum.Count += a.Count;
+                    Sum.MaxColor = max( Sum.MaxColor, a.MaxColor );
+                }
+
+                // Cluster without pixel stays where it was.
+                auto& c = mClusters[k];
+                if ( Sum.Count == 0 )
+                    continue;
+
+                auto const Inv = 1.0 / Sum.Count;
+                c.L            = float( Sum.L * Inv );
+                c.A            = float( Sum.A * Inv );
+                c.B            = float( Sum.B * Inv );
+                c.X            = float( Sum.X * Inv );
+                c.Y            = float( Sum.Y * Inv );
+                if ( Param.bSlicZero )
+                    c.ColorWeight = 1.f / max( Sum.MaxColor, 1.f );
+            }
+        } );
+    }
+
+    return enforceConnectivity( Labels, int( N / K / 4 ) );
+}
+
+float SuperpixelBoundaryRecall( int32_t const* Labels, uint8_t const* Boundary, int Width, int Height, int Tolerance )
+{
+    auto const W = Width;
+    auto const H = Height;
+    auto const N = (size_t)W * H;
+
+    // Boundary of segmentation, dilated by tolerance in both axes.
+    vector<uint8_t> Edge( N ), Tmp( N );
+    for ( int y = 0; y < H; y++ )
+    {
+        for ( int x = 0; x < W; x++ )
+        {
+            auto const i = (size_t)y * W + x;
+            Edge[i]      = ( x + 1 < W && Labels[i] != Labels[i + 1] ) || ( y + 1 < H && Labels[i] != Labels[i + W] );
+        }
+    }
+    for ( int y = 0; y < H; y++ )
+    {
+        for ( int x = 0; x < W; x++ )
+        {
+            uint8_t v = 0;
+            for ( int t = max( 0, x - Tolerance ); t <= min( W - 1, x + Tolerance ) && !v; t++ )
+                v = Edge[(size_t)y * W + t];
+            Tmp[(size_t)y * W + x] = v;
+        }
+    }
+    for ( int y = 0; y < H; y++ )
+    {
+        for ( int x = 0; x < W; x++ )
+        {
+            uint8_t v = 0;
+            for ( int t = max( 0, y - Tolerance ); t <= min( H - 1, y + Tolerance ) && !v; t++ )
+                v = Tmp[(size_t)t * W + x];
+            Edge[(size_t)y * W + x] = v;
+        }
+    }
+
+    size_t NumTruth = 0, NumHit = 0;
+    for ( size_t i = 0; i < N; i++ )
+    {
+        if ( Boundary[i] == 0 )
+            continue;
+        NumTruth++;
+        NumHit += Edge[i];
+    }
+    return NumTruth ? float( NumHit ) / NumTruth : 1.f;
+}
@@ -0,0 +1,97 @@
+//! Multithreaded SLIC superpixel segmentation on CPU.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Same formulation as gSLIC, which the CUDA backend of imseg uses: every
+//! cluster keeps the grid cell it was seeded in, and a pixel only compares
+//! against the clusters of its own and 8 neighbouring cells. Pixels never
+//! compete for a cluster, thus rows are processed in parallel without locks,
+//! and the inner loop runs over contiguous planar Lab arrays against a single
+//! cluster, which compilers vectorize.
+//!
+//! Cluster statistics are accumulated in the same pass as assignment, per
+//! band of rows, then reduced. SLIC-zero(SLICO) replaces the fixed
+//! compactness with the largest color distance each cluster had on the
+//! previous iteration.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class FThreadPool;
+
+struct FSlicParam
+{
+    int   NumSuperpixels = 3000;
+    float Compactness    = 10.f; //!< Weight of spatial distance; ignored by SLIC-zero
+    int   NumIterations  = 10;
+    bool  bSlicZero      = false; //!< Adapt color weight per cluster
+};
+
+class FSlicSegmenter
+{
+public:
+    //! @param      Pool: Pool to run on. nullptr for shared pool.
+    explicit FSlicSegmenter( FThreadPool* Pool = nullptr ) noexcept;
+
+    //! @brief      Segment an 8 bit image into superpixels.
+    //! @param      Channels: 1 for grayscale, 3 for BGR, 4 for BGRA. Alpha is
+    //!             ignored.
+    //! @param      Stride: Row pitch in bytes. 0 for tightly packed rows.
+    //! @param      Labels: Width x Height output. Labels are contiguous from 0
+    //!             and every superpixel is 4-connected.
+    //! @returns    Number of superpixels. 0 if arguments are invalid.
+    int Segment(
+      FSlicParam const& Param,
+      uint8_t const*    Pixels,
+      int               Width,
+      int               Height,
+      int               Channels,
+      size_t            Stride,
+      int32_t*          Labels );
+
+private:
+    struct FCluster
+    {
+        float L, A, B, X, Y;
+        float ColorWeight; //!< 1 / squared color normalizer
+    };
+
+    //! Per band sums of assigned pixels
+    struct FAccum
+    {
+        double L, A, B, X, Y;
+        float  MaxColor;
+        int    Count;
+    };
+
+    void toLab( uint8_t const* Pixels, int Channels, size_t Stride );
+    void placeSeeds( FSlicParam const& Param );
+    void assignRows( int RowBegin, int RowEnd, FAccum* Accum );
+    int  enforceConnectivity( int32_t* Labels, int MinSize );
+
+private:
+    FThreadPool* mPool   = {};
+    int          mWidth  = 0;
+    int          mHeight = 0;
+
+    std::vector<float>    mPlane[3]; //!< L, a, b
+    std::vector<float>    mBest;     //!< Distance to assigned cluster
+    std::vector<int32_t>  mLabel;
+    std::vector<FCluster> mClusters;
+    std::vector<FAccum>   mAccum; //!< NumBands x NumClusters
+
+    int              mGridX = 0, mGridY = 0;
+    float            mCellW = 0, mCellH = 0;
+    float            mSpatialWeight = 0;
+    std::vector<int> mColBegin; //!< First pixel column of each grid column, plus end
+    std::vector<int> mStack;
+};
+
+//! @brief      Ratio of ground truth boundary pixels with a superpixel boundary
+//!             within Tolerance pixels(chessboard distance).
+//! @param      Boundary: Width x Height, nonzero on ground truth boundary.
+//! @returns    1 if there's no ground truth boundary.
+float SuperpixelBoundaryRecall( int32_t const* Labels, uint8_t const* Boundary, int Width, int Height, int Tolerance = 2 );
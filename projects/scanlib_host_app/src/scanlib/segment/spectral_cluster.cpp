@@ -0,0 +1,613 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "spectral_cluster.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include "../utility/thread_pool.hpp"
+#include "../utility/trace.hpp"
+
+using namespace std;
+
+namespace
+{
+//! Eigen decomposition of small dense symmetric matrix by cyclic Jacobi
+//! rotations. A is destroyed; its diagonal ends up with the eigenvalues, and
+//! the columns of V with the eigenvectors.
+void JacobiEigen( vector<double>& A, vector<double>& V, int m )
+{
+    V.assign( size_t( m ) * m, 0.0 );
+    for ( int i = 0; i < m; i++ )
+        V[i * m + i] = 1.0;
+
+    double Norm = 0;
+    for ( auto a : A )
+        Norm += a * a;
+
+    for ( int Sweep = 0; Sweep < 64; Sweep++ )
+    {
+        double Off = 0;
+        for ( int p = 0; p < m; p++ )
+            for ( int q = p + 1; q < m; q++ )
+                Off += A[p * m + q] * A[p * m + q];
+        if ( Off <= 1e-24 * Norm )
+            break;
+
+        for ( int p = 0; p < m; p++ )
+        {
+            for ( int q = p + 1; q < m; q++ )
+            {
+                auto const apq = A[p * m + q];
+                if ( apq == 0 )
+                    continue;
+
+                auto const Theta = ( A[q * m + q] - A[p * m + p] ) / ( 2.0 * apq );
+                auto const t     = ( Theta >= 0 ? 1.0 : -1.0 ) / ( fabs( Theta ) + sqrt( Theta * Theta + 1.0 ) );
+                auto const c     = 1.0 / sqrt( t * t + 1.0 );
+                auto const s     = t * c;
+                for ( int k = 0; k < m; k++ )
+                {
+                    auto const akp = A[k * m + p], akq = A[k * m + q];
+                    A[k * m + p]   = c * akp - s * akq;
+                    A[k * m + q]   = s * akp + c * akq;
+                }
+                for ( int k = 0; k < m; k++ )
+                {
+                    auto const apk = A[p * m + k], aqk = A[q * m + k];
+                    A[p * m + k]   = c * apk - s * aqk;
+                    A[q * m + k]   = s * apk + c * aqk;
+                }
+                for ( int k = 0; k < m; k++ )
+                {
+                    auto const vkp = V[k * m + p], vkq = V[k * m + q];
+                    V[k * m + p]   = c * vkp - s * vkq;
+                    V[k * m + q]   = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+} // namespace
+
+FSpectralClusterer::FSpectralClusterer( FThreadPool* Pool ) noexcept
+    : mPool( Pool ? Pool : &FThreadPool::Shared() )
+{
+}
+
+void FSpectralClusterer::apply( float const* In, float* Out, float Alpha, float Beta, float Gamma )
+{
+    // Out = Alpha A In + Beta In + Gamma Out, where A = I + D^-1/2 W D^-1/2.
+    // A is shifted so that its spectrum lies in [0, 2], and the eigenvectors
+    // wanted are of the largest eigenvalues.
+    auto const& Offsets = mGraph->Offsets();
+    auto const& Edges   = mGraph->Edges();
+    auto const  B       = size_t( mB );
+    mPool->ParallelFor( 0, mN, 256, [&]( size_t Begin, size_t End ) {
+        float Sum[MAX_BLOCK];
+        for ( auto i = Begin; i < End; i++ )
+        {
+            auto const* x = In + i * B;
+            for ( size_t c = 0; c < B; c++ )
+                Sum[c] = 0;
+            for ( auto k = Offsets[i]; k < Offsets[i + 1]; k++ )
+            {
+                auto const  w = mWeights[k];
+                auto const* y = In + Edges[k].To * B;
+                for ( size_t c = 0; c < B; c++ )
+                    Sum[c] += w * y[c];
+            }
+
+            auto* o = Out + i * B;
+            for ( size_t c = 0; c < B; c++ )
+                o[c] = Alpha * Sum[c] + ( Alpha + Beta ) * x[c] + ( Gamma != 0 ? Gamma * o[c] : 0.f );
+        }
+    } );
+}
+
+void FSpectralClusterer::multiply( float* X, float const* M )
+{
+    // X M in place, where M is B x B
+    auto const B = size_t( mB );
+    mPool->ParallelFor( 0, mN, 256, [&]( size_t Begin, size_t End ) {
+        float y[MAX_BLOCK];
+        for ( auto i = Begin; i < End; i++ )
+        {
+            auto* x = X + i * B;
+            fill( y, y + B, 0.f );
+            for ( size_t r = 0; r < B; r++ )
+            {
+                auto const* m = M + r * B;
+                for ( size_t c = 0; c < B; c++ )
+                    y[c] += x[r] * m[c];
+            }
+            copy( y, y + B, x );
+        }
+    } );
+}
+
+void FSpectralClusterer::gram( float const* X, float const* Y )
+{
+    // X^T Y. Row chunks sum up in float, then chunks in double.
+    auto const B         = size_t( mB );
+    auto const NumChunks = ( mN + GRAM_CHUNK - 1 ) / GRAM_CHUNK;
+    mPartials.assign( NumChunks * B * B, 0.f );
+    mPool->ParallelFor( 0, NumChunks, 1, [&]( size_t Begin, size_t End ) {
+        for ( auto k = Begin; k < End; k++ )
+        {
+            auto* g = mPartials.data() + k * B * B;
+            for ( auto i = k * GRAM_CHUNK; i < min( mN, ( k + 1 ) * GRAM_CHUNK ); i++ )
+            {
+                auto const* x = X + i * B;
+                auto const* y = Y + i * B;
+                for ( size_t a = 0; a < B; a++ )
+                    for ( size_t b = 0; b < B; b++ )
+                        g[a * B + b] += x[a] * y[b];
+            }
+        }
+    } );
+
+    mGram.assign( B * B, 0.0 );
+    for ( size_t k = 0; k < NumChunks; k++ )
+        for ( size_t e = 0; e < B * B; e++ )
+            mGram[e] += mPartials[k * B * B + e];
+}
+
+size_t FSpectralClusterer::orthonormalize( float* Basis )
+{
+    // Cholesky QR, twice over; rows are touched in order, unlike Gram-Schmidt
+    // on columns. Stops at the first column found dependent on the ones before.
+    auto const B = size_t( mB );
+    for ( int Pass = 0; Pass < 2; Pass++ )
+    {
+        gram( Basis, Basis );
+
+        // Upper triangular R of Gram = R^T R, in place
+        auto& R = mGram;
+        for ( size_t c = 0; c < B; c++ )
+        {
+            auto const Original = R[c * B + c];
+            for ( size_t r = 0; r < c; r++ )
+                R[c * B + c] -= R[r * B + c] * R[r * B + c];
+            if ( !( R[c * B + c] > 1e-8 * Original ) || R[c * B + c] < 1e-24 )
+                return c;
+
+            R[c * B + c] = sqrt( R[c * B + c] );
+            for ( size_t d = c + 1; d < B; d++ )
+            {
+                for ( size_t r = 0; r < c; r++ )
+                    R[c * B + d] -= R[r * B + c] * R[r * B + d];
+                R[c * B + d] /= R[c * B + c];
+            }
+        }
+
+        // X R^-1; inverse of R by back substitution, then product row by row
+        auto& Inv = mRotation;
+        Inv.assign( B * B, 0.f );
+        for ( size_t c = 0; c < B; c++ )
+        {
+            for ( size_t r = c + 1; r-- > 0; )
+            {
+                double v = r == c ? 1.0 : 0.0;
+                for ( size_t k = r + 1; k <= c; k++ )
+                    v -= R[r * B + k] * Inv[k * B + c];
+                Inv[r * B + c] = float( v / R[r * B + r] );
+            }
+        }
+        multiply( Basis, Inv.data() );
+    }
+    return B;
+}
+
+void FSpectralClusterer::rayleighRitz()
+{
+    // Project A onto span of X, then rotate X, AX onto the Ritz vectors in
+    // descending order of Ritz values.
+    auto const B = size_t( mB );
+    apply( mX.data(), mAX.data(), 1.f, 0.f, 0.f );
+
+    gram( mX.data(), mAX.data() );
+    for ( size_t a = 0; a < B; a++ )
+        for ( size_t b = 0; b < a; b++ )
+            mGram[a * B + b] = mGram[b * B + a] = 0.5 * ( mGram[a * B + b] + mGram[b * B + a] );
+    JacobiEigen( mGram, mVectors, int( B ) );
+
+    size_t Order[MAX_BLOCK];
+    iota( Order, Order + B, size_t( 0 ) );
+    sort( Order, Order + B, [&]( size_t a, size_t b ) { return mGram[a * B + a] > mGram[b * B + b]; } );
+    mLambda.resize( B );
+    for ( size_t c = 0; c < B; c++ )
+        mLambda[c] = float( mGram[Order[c] * B + Order[c]] );
+
+    mRotation.resize( B * B );
+    for ( size_t r = 0; r < B; r++ )
+        for ( size_t c = 0; c < B; c++ )
+            mRotation[r * B + c] = float( mVectors[r * B + Order[c]] );
+
+    multiply( mX.data(), mRotation.data() );
+    multiply( mAX.data(), mRotation.data() );
+}
+
+void FSpectralClusterer::mapPrevious( FSuperpixelStat const* Stats, float Spacing )
+{
+    mMatch.assign( mN, -1 );
+    if ( mPrevCenters.empty() || mPrevB != mB || mPrevK != mK )
+        return;
+
+    auto const MaxDist2 = Spacing * Spacing;
+    mPool->ParallelFor( 0, mN, 256, [&]( size_t Begin, size_t End ) {
+        for ( auto i = Begin; i < End; i++ )
+        {
+            auto const& s = Stats[i];
+            if ( s.NumPixels == 0 )
+                continue;
+
+            int const cx   = min( mPrevCols - 1, int( s.CenterX / mPrevCell ) );
+            int const cy   = min( mPrevRows - 1, int( s.CenterY / mPrevCell ) );
+            float     Best = MaxDist2;
+            for ( int y = max( 0, cy - 1 ); y <= min( mPrevRows - 1, cy + 1 ); y++ )
+            {
+                for ( int x = max( 0, cx - 1 ); x <= min( mPrevCols - 1, cx + 1 ); x++ )
+                {
+                    auto const Cell = size_t( y ) * mPrevCols + x;
+                    for ( auto k = mPrevCellOffsets[Cell]; k < mPrevCellOffsets[Cell + 1]; k++ )
+                    {
+                        auto const j  = mPrevCellItems[k];
+                        auto const dx = mPrevCenters[j * 2] - s.CenterX;
+                        auto const dy = mPrevCenters[j * 2 + 1] - s.CenterY;
+                        if ( auto const d2 = dx * dx + dy * dy; d2 < Best )
+                            Best = d2, mMatch[i] = int32_t( j );
+                    }
+                }
+            }
+        }
+    } );
+}
+
+void FSpectralClusterer::keepPrevious( FSuperpixelStat const* Stats, float Spacing, int Width, int Height )
+{
+    mPrevK    = mK;
+    mPrevB    = mB;
+    mPrevCell = max( 1.f, Spacing );
+    mPrevCols = max( 1, int( ceilf( Width / mPrevCell ) ) );
+    mPrevRows = max( 1, int( ceilf( Height / mPrevCell ) ) );
+    mPrevX.assign( mX.begin(), mX.begin() + mN * mB );
+    mPrevSegments = mSegments;
+    mPrevCenters.resize( mN * 2 );
+
+    // Counting sort of superpixels into cells by centroid
+    auto const CellOf = [&]( size_t i ) {
+        int const x = min( mPrevCols - 1, max( 0, int( Stats[i].CenterX / mPrevCell ) ) );
+        int const y = min( mPrevRows - 1, max( 0, int( Stats[i].CenterY / mPrevCell ) ) );
+        return size_t( y ) * mPrevCols + x;
+    };
+    mPrevCellOffsets.assign( size_t( mPrevCols ) * mPrevRows + 1, 0 );
+    for ( size_t i = 0; i < mN; i++ )
+    {
+        mPrevCenters[i * 2]     = Stats[i].CenterX;
+        mPrevCenters[i * 2 + 1] = Stats[i].CenterY;
+        if ( Stats[i].NumPixels )
+            mPrevCellOffsets[CellOf( i ) + 1]++;
+    }
+    partial_sum( mPrevCellOffsets.begin(), mPrevCellOffsets.end(), mPrevCellOffsets.begin() );
+
+    mPrevCellItems.resize( mPrevCellOffsets.back() );
+    vector<uint32_t> Fill( mPrevCellOffsets.begin(), mPrevCellOffsets.end() - 1 );
+    for ( size_t i = 0; i < mN; i++ )
+    {
+        if ( Stats[i].NumPixels )
+            mPrevCellItems[Fill[CellOf( i )]++] = uint32_t( i );
+    }
+}
+
+void FSpectralClusterer::kmeans( FSpectralClusterParam const& Param, FSuperpixelStat const* Stats, time_point Deadline )
+{
+    auto const K = size_t( mK );
+
+    // Leading K columns of the embedding, rows normalized.
+    auto*           Y     = mY.data();
+    vector<uint8_t> Valid( mN );
+    for ( size_t i = 0; i < mN; i++ )
+    {
+        auto const* x    = mX.data() + i * mB;
+        double      Norm = 0;
+        for ( size_t c = 0; c < K; c++ )
+            Norm += double( x[c] ) * x[c];
+        Valid[i] = Stats[i].NumPixels > 0 && Norm > 1e-24;
+
+        auto const Inv = Valid[i] ? float( 1.0 / sqrt( Norm ) ) : 0.f;
+        for ( size_t c = 0; c < K; c++ )
+            Y[i * K + c] = x[c] * Inv;
+    }
+
+    auto const Dist2 = [&]( size_t i, size_t k ) {
+        float Sum = 0;
+        for ( size_t c = 0; c < K; c++ )
+        {
+            auto const d = Y[i * K + c] - mCenters[k * K + c];
+            Sum += d * d;
+        }
+        return Sum;
+    };
+
+    // Seed from the segments of matching superpixels of the previous frame
+    mCenters.assign( K * K, 0.f );
+    vector<uint32_t> Counts( K, 0 );
+    for ( size_t i = 0; i < mN; i++ )
+    {
+        if ( Valid[i] && mMatch[i] >= 0 )
+        {
+            auto const k = mPrevSegments[mMatch[i]];
+            for ( size_t c = 0; c < K; c++ )
+                mCenters[k * K + c] += Y[i * K + c];
+            Counts[k]++;
+        }
+    }
+
+    // Clusters left empty are seeded by k-means++. Fixed seed keeps results
+    // repeatable.
+    mt19937          Rng( 0x5eed );
+    vector<double>   Nearest( mN, 0.0 );
+    vector<uint32_t> Seeded;
+    for ( size_t k = 0; k < K; k++ )
+    {
+        if ( Counts[k] )
+        {
+            for ( size_t c = 0; c < K; c++ )
+                mCenters[k * K + c] /= Counts[k];
+            Seeded.push_back( uint32_t( k ) );
+        }
+    }
+    for ( size_t k = 0; k < K; k++ )
+    {
+        if ( Counts[k] )
+            continue;
+
+        double Total = 0;
+        for ( size_t i = 0; i < mN; i++ )
+        {
+            double Best = Valid[i] ? ( Seeded.empty() ? 1.0 : INFINITY ) : 0.0;
+            for ( auto s : Seeded )
+                Best = min( Best, double( Dist2( i, s ) ) );
+            Nearest[i] = Best;
+            Total += Best;
+        }
+        if ( !( Total > 0 ) )
+            break;
+
+        auto   Pick = uniform_real_distribution<double>( 0, Total )( Rng );
+        size_t i    = 0;
+        for ( ; i + 1 < mN && ( Pick -= Nearest[i] ) > 0; i++ )
+        {
+        }
+        copy( Y + i * K, Y + ( i + 1 ) * K, mCenters.begin() + k * K );
+        Seeded.push_back( uint32_t( k ) );
+    }
+
+    // Lloyd iterations; assignment in parallel, centers on this thread.
+    for ( int Round = 0; Round < max( 1, Param.MaxKMeansRounds ); Round++ )
+    {
+        atomic<size_t> NumChanged { 0 };
+        mPool->ParallelFor( 0, mN, 256, [&]( size_t Begin, size_t End ) {
+            size_t Changed = 0;
+            for ( auto i = Begin; i < End; i++ )
+            {
+                if ( !Valid[i] )
+                    continue;
+
+                uint32_t Best  = 0;
+                float    BestD = Dist2( i, 0 );
+                for ( size_t k = 1; k < K; k++ )
+                {
+                    if ( auto const d = Dist2( i, k ); d < BestD )
+                        BestD = d, Best = uint32_t( k );
+                }
+                Changed += mSegments[i] != Best;
+                mSegments[i] = Best;
+            }
+            NumChanged += Changed;
+        } );
+
+        if ( ( Round && NumChanged == 0 ) || chrono::steady_clock::now() > Deadline )
+            break;
+
+        vector<double> Sums( K * K, 0.0 );
+        Counts.assign( K, 0 );
+        for ( size_t i = 0; i < mN; i++ )
+        {
+            if ( !Valid[i] )
+                continue;
+            auto const k = mSegments[i];
+            for ( size_t c = 0; c < K; c++ )
+                Sums[k * K + c] += Y[i * K + c];
+            Counts[k]++;
+        }
+        for ( size_t k = 0; k < K; k++ )
+        {
+            if ( Counts[k] )
+            {
+                for ( size_t c = 0; c < K; c++ )
+                    mCenters[k * K + c] = float( Sums[k * K + c] / Counts[k] );
+            }
+        }
+    }
+}
+
+int FSpectralClusterer::Cluster(
+  FSpectralClusterParam const& Param,
+  FSuperpixelGraph const&      Graph,
+  FSuperpixelStat const*       Stats,
+  float const*                 Depth,
+  int                          Width,
+  int                          Height )
+{
+    SCANLIB_TRACE_SCOPE( "spectral cluster" );
+    using clock     = chrono::steady_clock;
+    auto const Now  = clock::now();
+    auto const Span = chrono::duration_cast<clock::duration>( chrono::duration<double, milli>( Param.TimeBudgetMs ) );
+
+    mGraph = &Graph;
+    mN     = Graph.NumNodes();
+    mSegments.assign( mN, 0 );
+    mBoundary.assign( mN, 0 );
+    if ( mN == 0 )
+        return -1;
+
+    auto const  N       = mN;
+    auto const  K       = mK = int( min<size_t>( min( max( 1, Param.NumClusters ), MAX_BLOCK - 2 ), N ) );
+    auto const  B       = size_t( mB = int( min<size_t>( MAX_BLOCK, min<size_t>( N, K + max( 2, K / 2 ) ) ) ) );
+    auto const& Offsets = Graph.Offsets();
+    auto const& Edges   = Graph.Edges();
+
+    // Affinity, normalized by degree of both ends
+    double Area     = 0;
+    size_t NumValid = 0;
+    for ( size_t i = 0; i < N; i++ )
+        Area += Stats[i].NumPixels, NumValid += Stats[i].NumPixels > 0;
+    auto const Spacing    = max( 1.f, sqrtf( float( Area / max<size_t>( 1, NumValid ) ) ) );
+    auto const InvSpacing = 1.f / Spacing;
+    auto const InvColor   = 1.f / ( 2.f * Param.ColorSigma * Param.ColorSigma );
+    auto const InvPos     = 1.f / ( 2.f * Param.PositionSigma * Param.PositionSigma * Spacing * Spacing );
+    auto const InvDepth   = 1.f / ( 2.f * Param.DepthSigma * Param.DepthSigma );
+
+    mWeights.resize( Edges.size() );
+    mScale.resize( N );
+    mPool->ParallelFor( 0, N, 256, [&]( size_t Begin, size_t End ) {
+        for ( auto i = Begin; i < End; i++ )
+        {
+            auto const& a   = Stats[i];
+            double      Sum = 0;
+            for ( auto k = Offsets[i]; k < Offsets[i + 1]; k++ )
+            {
+                auto const j  = Edges[k].To;
+                auto const& b = Stats[j];
+                auto const dc = ( a.Mean[0] - b.Mean[0] ) * ( a.Mean[0] - b.Mean[0] )
+                                + ( a.Mean[1] - b.Mean[1] ) * ( a.Mean[1] - b.Mean[1] )
+                                + ( a.Mean[2] - b.Mean[2] ) * ( a.Mean[2] - b.Mean[2] );
+                auto const dp = ( a.CenterX - b.CenterX ) * ( a.CenterX - b.CenterX )
+                                + ( a.CenterY - b.CenterY ) * ( a.CenterY - b.CenterY );
+                float dd = 0;
+                if ( Depth && Depth[i] > 0 && Depth[j] > 0 )
+                {
+                    dd = ( Depth[i] - Depth[j] ) / max( Depth[i], Depth[j] );
+                }
+
+                mWeights[k] = Edges[k].Length * InvSpacing * expf( -dc * InvColor - dp * InvPos - dd * dd * InvDepth );
+                Sum += mWeights[k];
+            }
+            mScale[i] = Sum > 0 ? float( 1.0 / sqrt( Sum ) ) : 0.f;
+        }
+    } );
+    mPool->ParallelFor( 0, N, 256, [&]( size_t Begin, size_t End ) {
+        for ( auto i = Begin; i < End; i++ )
+            for ( auto k = Offsets[i]; k < Offsets[i + 1]; k++ )
+                mWeights[k] *= mScale[i] * mScale[Edges[k].To];
+    } );
+
+    // Initial guess; rows carried over from the previous frame, random for the
+    // rest. Leading vector is known to be D^1/2 1 on a fresh start.
+    mapPrevious( Stats, Spacing );
+    mX.resize( N * B );
+    mAX.resize( N * B );
+    mY.resize( N * B );
+    mt19937                    Rng( 0x5eed );
+    normal_distribution<float> Noise( 0.f, 1.f / sqrtf( float( N ) ) );
+    {
+        bool const bWarm = any_of( mMatch.begin(), mMatch.end(), []( auto m ) { return m >= 0; } );
+        for ( size_t i = 0; i < N; i++ )
+        {
+            auto* x = mX.data() + i * B;
+            if ( mMatch[i] >= 0 )
+            {
+                copy_n( mPrevX.data() + size_t( mMatch[i] ) * B, B, x );
+                continue;
+            }
+
+            for ( size_t c = 0; c < B; c++ )
+                x[c] = Noise( Rng );
+            if ( !bWarm && mScale[i] > 0 )
+                x[0] = 1.f / mScale[i];
+        }
+    }
+
+    // Columns lost on orthonormalization are refilled with noise.
+    auto const Orthonormalize = [&]() {
+        for ( int Try = 0; Try < 3; Try++ )
+        {
+            auto const Kept = orthonormalize( mX.data() );
+            if ( Kept == B )
+                break;
+            for ( size_t i = 0; i < N; i++ )
+                for ( size_t c = Kept; c < B; c++ )
+                    mX[i * B + c] = Noise( Rng );
+        }
+    };
+    Orthonormalize();
+    rayleighRitz();
+
+    int Iter = 0;
+    for ( ; Iter < Param.MaxIterations; Iter++ )
+    {
+        double Worst = 0;
+        for ( int c = 0; c < K; c++ )
+        {
+            double Norm = 0;
+            for ( size_t i = 0; i < N; i++ )
+            {
+                auto const r = mAX[i * B + c] - mLambda[c] * mX[i * B + c];
+                Norm += double( r ) * r;
+            }
+            Worst = max( Worst, sqrt( Norm ) );
+        }
+        if ( Worst <= Param.Tolerance || clock::now() - Now > Span * 6 / 10 )
+            break;
+
+        // Chebyshev filter of the block; [0, a] is damped, where a is the
+        // smallest Ritz value of the block, and the rest amplified. AX is the
+        // first step already. Each step is scaled by the ratio of successive
+        // polynomial values at the top of the spectrum, which keeps the block
+        // around unit magnitude; unscaled, it grows by T(t) of hundreds per
+        // step for small a, and its Gram overflows float.
+        auto const a   = min( 1.99f, max( 0.01f, mLambda[B - 1] ) );
+        auto const e   = a * 0.5f, c = a * 0.5f;
+        auto const Top = ( 2.f - c ) / e;
+        auto       Rho = 1.f / Top;
+        auto*      Y0  = mX.data();
+        auto*      Y1  = mY.data();
+        for ( size_t i = 0; i < N * B; i++ )
+            Y1[i] = Rho * ( mAX[i] - c * mX[i] ) / e;
+        for ( int d = 1; d < Param.FilterDegree; d++ )
+        {
+            auto const Next = 1.f / ( 2.f * Top - Rho );
+            apply( Y1, Y0, 2.f * Next / e, -2.f * Next * c / e, -Next * Rho );
+            swap( Y0, Y1 );
+            Rho = Next;
+        }
+        if ( Y1 != mX.data() )
+            mX.swap( mY );
+
+        Orthonormalize();
+        rayleighRitz();
+    }
+
+    kmeans( Param, Stats, Now + Span );
+
+    mPool->ParallelFor( 0, N, 256, [&]( size_t Begin, size_t End ) {
+        for ( auto i = Begin; i < End; i++ )
+            for ( auto k = Offsets[i]; k < Offsets[i + 1]; k++ )
+                if ( mSegments[Edges[k].To] != mSegments[i] )
+                {
+                    mBoundary[i] = 1;
+                    break;
+                }
+    } );
+
+    keepPrevious( Stats, Spacing, Width, Height );
+    return Iter;
+}
@@ -0,0 +1,119 @@
+//! Spectral clustering of superpixels over their adjacency graph.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Adjacent superpixels are tied by an affinity that grows with their boundary
+//! length and falls with color distance, centroid distance and, if known,
+//! relative depth difference. Superpixels are embedded by the leading
+//! eigenvectors of the normalized affinity D^-1/2 W D^-1/2, then grouped by
+//! k-means on the unit normalized rows of the embedding.
+//!
+//! Eigenvectors are found by Chebyshev filtered subspace iteration. A block a
+//! few vectors larger than wanted goes through a Chebyshev polynomial of the
+//! shifted matrix, which damps the part of the spectrum below the smallest
+//! Ritz value of the block, then Rayleigh-Ritz. Spectrum bounds of the
+//! normalized affinity are known, thus no estimation is needed; sparse
+//! products dominate, and dense work stays small.
+//!
+//! Embedding and segments of the previous frame are carried over by centroid
+//! position as the initial guess of both the eigen solver and k-means, which
+//! keeps iterations low and segment IDs mostly stable between frames. Both
+//! stop early once the time budget runs out.
+#pragma once
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "superpixel_graph.hpp"
+#include "superpixel_stats.hpp"
+
+class FThreadPool;
+
+struct FSpectralClusterParam
+{
+    int    NumClusters     = 8;     //!< Also the dimension of the embedding
+    float  ColorSigma      = 16.f;  //!< Color distance scale, 8 bit units
+    float  PositionSigma   = 1.5f;  //!< Centroid distance scale, in superpixel spacings
+    float  DepthSigma      = 0.1f;  //!< Relative depth difference scale
+    int    MaxIterations   = 30;    //!< Of the eigen solver
+    int    FilterDegree    = 8;     //!< Matrix products per eigen solver iteration
+    float  Tolerance       = 1e-3f; //!< Residual norm of each eigenvector
+    int    MaxKMeansRounds = 20;
+    double TimeBudgetMs    = 20.0;  //!< Wall time allowed for a frame
+};
+
+class FSpectralClusterer
+{
+public:
+    //! @param      Pool: Pool to run on. nullptr for shared pool.
+    explicit FSpectralClusterer( FThreadPool* Pool = nullptr ) noexcept;
+
+    //! @brief      Cluster superpixels of a frame.
+    //! @param      Stats: Statistics of the labels the graph was built on.
+    //! @param      Depth: Prior depth per superpixel; 0 or less if unknown.
+    //!             nullptr if there is none.
+    //! @param      Width, Height: Size of the label image.
+    //! @returns    Number of eigen solver iterations. Negative if the graph
+    //!             is empty.
+    int Cluster(
+      FSpectralClusterParam const& Param,
+      FSuperpixelGraph const&      Graph,
+      FSuperpixelStat const*       Stats,
+      float const*                 Depth,
+      int                          Width,
+      int                          Height );
+
+    enum
+    {
+        MAX_BLOCK  = 32, //!< Vectors iterated at once; clusters plus guard vectors
+        GRAM_CHUNK = 256
+    };
+
+    //! @brief      Segment of each superpixel, in [0, NumClusters).
+    std::vector<uint32_t> const& Segments() const noexcept { return mSegments; }
+
+    //! @brief      1 for superpixels adjacent to another segment.
+    std::vector<uint8_t> const& Boundary() const noexcept { return mBoundary; }
+
+    //! @brief      Forget the previous frame.
+    void Reset() noexcept { mPrevCenters.clear(); }
+
+private:
+    using time_point = std::chrono::steady_clock::time_point;
+
+    void   apply( float const* In, float* Out, float Alpha, float Beta, float Gamma );
+    void   multiply( float* X, float const* M );
+    void   gram( float const* X, float const* Y );
+    size_t orthonormalize( float* Basis );
+    void   rayleighRitz();
+    void   kmeans( FSpectralClusterParam const& Param, FSuperpixelStat const* Stats, time_point Deadline );
+    void   mapPrevious( FSuperpixelStat const* Stats, float Spacing );
+    void   keepPrevious( FSuperpixelStat const* Stats, float Spacing, int Width, int Height );
+
+private:
+    FThreadPool*             mPool = {};
+    FSuperpixelGraph const*  mGraph = {};
+    size_t                   mN = 0;
+    int                      mK = 0, mB = 0;
+    std::vector<float>       mWeights; //!< Normalized affinity along graph edges
+    std::vector<float>       mScale;   //!< D^-1/2
+    std::vector<float>       mX, mAX, mY; //!< N x B, row major
+    std::vector<float>       mLambda; //!< Ritz values
+    std::vector<double>      mGram, mVectors;
+    std::vector<float>       mPartials; //!< Of Gram matrix, per row chunk
+    std::vector<float>       mRotation; //!< B x B, applied to blocks from the right
+    std::vector<float>       mCenters;
+    std::vector<uint32_t>    mSegments;
+    std::vector<uint8_t>     mBoundary;
+    std::vector<int32_t>     mMatch; //!< Previous superpixel of each, or -1
+
+    // Previous frame, looked up by centroid through a grid of cells
+    std::vector<float>    mPrevCenters; //!< X, Y pairs
+    std::vector<float>    mPrevX;
+    std::vector<uint32_t> mPrevSegments;
+    std::vector<uint32_t> mPrevCellOffsets, mPrevCellItems;
+    int                   mPrevK = 0, mPrevB = 0, mPrevCols = 0, mPrevRows = 0;
+    float                 mPrevCell = 1.f;
+};
@@ -0,0 +1,118 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "superpixel_graph.hpp"
+#include <algorithm>
+#include "../utility/thread_pool.hpp"
+#include "../utility/trace.hpp"
+
+using namespace std;
+
+FSuperpixelGraph::FSuperpixelGraph( FThreadPool* Pool ) noexcept
+    : mPool( Pool ? Pool : &FThreadPool::Shared() )
+{
+}
+
+size_t FSuperpixelGraph::Build(
+  int32_t const* Labels,
+  size_t         LabelStride,
+  int            Width,
+  int            Height,
+  size_t         NumLabels )
+{
+    SCANLIB_TRACE_SCOPE( "superpixel graph" );
+    mOffsets.assign( NumLabels + 1, 0 );
+    mEdges.clear();
+    if ( NumLabels == 0 || Width <= 0 || Height <= 0 )
+        return 0;
+
+    LabelStride = LabelStride ? LabelStride : Width;
+
+    // Each band looks at the right and lower neighbour of its pixels; the row
+    // below a band is only read.
+    auto const NumBands = min<size_t>( Height, max<size_t>( 1, mPool->NumThreads() * 4 ) );
+    mBands.resize( NumBands );
+    mPool->ParallelFor( 0, NumBands, 1, [&]( size_t Begin, size_t End ) {
+        for ( auto b = Begin; b < End; b++ )
+        {
+            auto& Pairs = mBands[b];
+            Pairs.clear();
+
+            auto const Push = [&]( int32_t l0, int32_t l1 ) {
+                if ( l0 == l1 || uint32_t( l0 ) >= NumLabels || uint32_t( l1 ) >= NumLabels )
+                    return;
+                if ( l0 > l1 )
+                    swap( l0, l1 );
+
+                // Boundaries run along rows; consecutive duplicates are common.
+                auto const Key = uint64_t( l0 ) << 32 | uint32_t( l1 );
+                if ( !Pairs.empty() && Pairs.back().first == Key )
+                    Pairs.back().second++;
+                else
+                    Pairs.emplace_back( Key, 1 );
+            };
+
+            auto const y0 = int( Height * b / NumBands ), y1 = int( Height * ( b + 1 ) / NumBands );
+            for ( int y = y0; y < y1; y++ )
+            {
+                auto const Row  = Labels + y * LabelStride;
+                auto const Next = y + 1 < Height ? Row + LabelStride : nullptr;
+                for ( int x = 0; x < Width; x++ )
+                {
+                    if ( x + 1 < Width )
+                        Push( Row[x], Row[x + 1] );
+                    if ( Next )
+                        Push( Row[x], Next[x] );
+                }
+            }
+
+            sort( Pairs.begin(), Pairs.end() );
+        }
+    } );
+
+    // Merge bands, summing counts of the same pair
+    vector<pair_type> Merged;
+    {
+        size_t Total = 0;
+        for ( auto& Band : mBands )
+            Total += Band.size();
+        Merged.reserve( Total );
+        for ( auto& Band : mBands )
+            Merged.insert( Merged.end(), Band.begin(), Band.end() );
+    }
+    sort( Merged.begin(), Merged.end() );
+
+    size_t NumUnique = 0;
+    for ( size_t i = 0; i < Merged.size(); i++ )
+    {
+        if ( NumUnique && Merged[NumUnique - 1].first == Merged[i].first )
+            Merged[NumUnique - 1].second += Merged[i].second;
+        else
+            Merged[NumUnique++] = Merged[i];
+    }
+    Merged.resize( NumUnique );
+
+    // Compressed rows. Pairs are sorted by smaller label, thus every node
+    // receives its smaller neighbours before larger ones; lists stay sorted.
+    for ( auto& [Key, Count] : Merged )
+    {
+        mOffsets[( Key >> 32 ) + 1]++;
+        mOffsets[uint32_t( Key ) + 1]++;
+    }
+    for ( size_t i = 0; i < NumLabels; i++ )
+        mOffsets[i + 1] += mOffsets[i];
+
+    mEdges.resize( mOffsets[NumLabels] );
+    vector<uint32_t> Fill( mOffsets.begin(), mOffsets.end() - 1 );
+    for ( auto& [Key, Count] : Merged )
+    {
+        auto const l0 = uint32_t( Key >> 32 ), l1 = uint32_t( Key );
+        mEdges[Fill[l0]++] = { l1, Count };
+        mEdges[Fill[l1]++] = { l0, Count };
+    }
+
+    return NumUnique;
+}
@@ -0,0 +1,59 @@
+//! Region adjacency graph of superpixels.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Two superpixels are adjacent if any of their pixels touch horizontally or
+//! vertically. Each row band collects the label pairs it sees, run length
+//! encoded along rows, and the pairs of all bands are merged into a compressed
+//! sparse row table; the number of touching pixel pairs is kept as boundary
+//! length of the edge.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+class FThreadPool;
+
+struct FSuperpixelEdge
+{
+    uint32_t To;
+    uint32_t Length; //!< Number of touching pixel pairs
+};
+
+class FSuperpixelGraph
+{
+public:
+    //! @param      Pool: Pool to run on. nullptr for shared pool.
+    explicit FSuperpixelGraph( FThreadPool* Pool = nullptr ) noexcept;
+
+    //! @brief      Build graph of a label image.
+    //! @param      LabelStride: Row pitch of Labels in elements. 0 for Width.
+    //! @param      NumLabels: Largest label + 1. Labels out of [0, NumLabels)
+    //!             are ignored.
+    //! @returns    Number of undirected edges.
+    size_t Build(
+      int32_t const* Labels,
+      size_t         LabelStride,
+      int            Width,
+      int            Height,
+      size_t         NumLabels );
+
+    size_t NumNodes() const noexcept { return mOffsets.empty() ? 0 : mOffsets.size() - 1; }
+
+    //! @brief      Neighbours of node i are Edges()[Offsets()[i], Offsets()[i + 1]),
+    //!             ascending. Every edge is listed from both of its ends.
+    std::vector<uint32_t> const&        Offsets() const noexcept { return mOffsets; }
+    std::vector<FSuperpixelEdge> const& Edges() const noexcept { return mEdges; }
+
+private:
+    using pair_type = std::pair<uint64_t, uint32_t>; //!< Packed label pair, count
+
+private:
+    FThreadPool*                        mPool = {};
+    std::vector<std::vector<pair_type>> mBands;
+    std::vector<uint32_t>               mOffsets;
+    std::vector<FSuperpixelEdge>        mEdges;
+};
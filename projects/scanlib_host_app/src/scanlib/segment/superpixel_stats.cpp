@@ -0,0 +1,129 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "superpixel_stats.hpp"
+#include <algorithm>
+#include <climits>
+#include "../utility/thread_pool.hpp"
+#include "../utility/trace.hpp"
+
+using namespace std;
+
+FSuperpixelStats::FSuperpixelStats( FThreadPool* Pool ) noexcept
+    : mPool( Pool ? Pool : &FThreadPool::Shared() )
+{
+}
+
+int FSuperpixelStats::Compute(
+  int32_t const* Labels,
+  size_t         LabelStride,
+  int            Width,
+  int            Height,
+  uint8_t const* Pixels,
+  int            Channels,
+  size_t         Stride )
+{
+    SCANLIB_TRACE_SCOPE( "superpixel stats" );
+    mStats.clear();
+    if ( Labels == nullptr || Width <= 0 || Height <= 0 )
+        return 0;
+
+    LabelStride              = LabelStride ? LabelStride : Width;
+    Stride                   = Stride ? Stride : (size_t)Width * Channels;
+    auto const NumColor      = Pixels ? min( Channels, 3 ) : 0;
+    auto const Grain         = max<size_t>( 8, Height / ( 4 * max<size_t>( 1, mPool->NumThreads() ) ) );
+    auto const NumBands      = ( Height + Grain - 1 ) / Grain;
+    static FAccum const Zero = { 0, 0, {}, {}, 0, INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+
+    // Band tables keep their capacity between frames.
+    mBands.resize( NumBands );
+    for ( auto& Band : mBands )
+        Band.clear();
+
+    mPool->ParallelFor( 0, Height, Grain, [&]( size_t Begin, size_t End ) {
+        auto& Band = mBands[Begin / Grain];
+        for ( int y = int( Begin ); y < int( End ); y++ )
+        {
+            auto const Row = Labels + y * LabelStride;
+            auto const Px  = Pixels ? Pixels + y * Stride : nullptr;
+            for ( int x = 0; x < Width; x++ )
+            {
+                auto const k = Row[x];
+                if ( k < 0 )
+                    continue;
+                if ( (size_t)k >= Band.size() )
+                    Band.resize( k + 1, Zero );
+
+                auto& a = Band[k];
+                a.X += x;
+                a.Y += y;
+                a.Count++;
+                a.MinX = min( a.MinX, x );
+                a.MaxX = max( a.MaxX, x );
+                a.MinY = min( a.MinY, y );
+                a.MaxY = max( a.MaxY, y );
+                for ( int c = 0; c < NumColor; c++ )
+                {
+                    double const v = Px[x * Channels + c];
+                    a.Sum[c] += v;
+                    a.SumSq[c] += v * v;
+                }
+            }
+        }
+    } );
+
+    size_t NumLabels = 0;
+    for ( auto& Band : mBands )
+        NumLabels = max( NumLabels, Band.size() );
+    mStats.resize( NumLabels );
+
+    mPool->ParallelFor( 0, NumLabels, 256, [&]( size_t Begin, size_t End ) {
+        for ( auto k = Begin; k < End; k++ )
+        {
+            auto Sum = Zero;
+            for ( auto& Band : mBands )
+            {
+                if ( k >= Band.size() )
+                    continue;
+
+                auto& a = Band[k];
+                Sum.X += a.X;
+                Sum.Y += a.Y;
+                Sum.Count += a.Count;
+                Sum.MinX = min( Sum.MinX, a.MinX );
+                Sum.MaxX = max( Sum.MaxX, a.MaxX );
+                Sum.MinY = min( Sum.MinY, a.MinY );
+                Sum.MaxY = max( Sum.MaxY, a.MaxY );
+                for ( int c = 0; c < 3; c++ )
+                {
+                    Sum.Sum[c] += a.Sum[c];
+                    Sum.SumSq[c] += a.SumSq[c];
+                }
+            }
+
+            auto& s = mStats[k];
+            if ( Sum.Count == 0 )
+                continue;
+
+            auto const Inv = 1.0 / Sum.Count;
+            s.CenterX      = float( Sum.X * Inv );
+            s.CenterY      = float( Sum.Y * Inv );
+            s.NumPixels    = int( Sum.Count );
+            s.MinX         = Sum.MinX;
+            s.MinY         = Sum.MinY;
+            s.MaxX         = Sum.MaxX;
+            s.MaxY         = Sum.MaxY;
+            for ( int c = 0; c < 3; c++ )
+            {
+                auto const Mean = Sum.Sum[c] * Inv;
+                s.Mean[c]       = float( Mean );
+                s.Variance[c]   = float( max( 0.0, Sum.SumSq[c] * Inv - Mean * Mean ) );
+            }
+        }
+    } );
+
+    return int( NumLabels );
+}
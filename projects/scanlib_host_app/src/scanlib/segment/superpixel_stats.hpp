@@ -0,0 +1,71 @@
+//! Per-superpixel statistics in a single parallel sweep.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Rows are split into bands, each band accumulates into its own table, and
+//! the tables are reduced per label afterwards. Tables grow as larger labels
+//! appear, thus the number of labels is found by the same sweep; no separate
+//! pass is needed to count them.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class FThreadPool;
+
+struct FSuperpixelStat
+{
+    float CenterX   = 0; //!< Centroid in pixels
+    float CenterY   = 0;
+    int   NumPixels = 0; //!< 0 if the label doesn't appear
+
+    int MinX = 0, MinY = 0; //!< Bounding box, inclusive
+    int MaxX = 0, MaxY = 0;
+
+    float Mean[3]     = {}; //!< Per channel, in channel order of the image
+    float Variance[3] = {};
+};
+
+class FSuperpixelStats
+{
+public:
+    //! @param      Pool: Pool to run on. nullptr for shared pool.
+    explicit FSuperpixelStats( FThreadPool* Pool = nullptr ) noexcept;
+
+    //! @brief      Gather statistics of every label.
+    //! @param      LabelStride: Row pitch of Labels in elements. 0 for Width.
+    //! @param      Pixels: 8 bit image of 1 to 4 channels. Only the first 3
+    //!             channels are measured. nullptr to skip color statistics.
+    //! @param      Stride: Row pitch of Pixels in bytes. 0 for tightly packed.
+    //! @returns    Number of labels, i.e. largest label + 1. Negative labels
+    //!             are ignored.
+    int Compute(
+      int32_t const* Labels,
+      size_t         LabelStride,
+      int            Width,
+      int            Height,
+      uint8_t const* Pixels   = nullptr,
+      int            Channels = 0,
+      size_t         Stride   = 0 );
+
+    size_t                 Size() const noexcept { return mStats.size(); }
+    FSuperpixelStat const& operator[]( size_t i ) const noexcept { return mStats[i]; }
+
+    std::vector<FSuperpixelStat> const& Stats() const noexcept { return mStats; }
+
+private:
+    struct FAccum
+    {
+        double   X, Y;
+        double   Sum[3], SumSq[3];
+        uint32_t Count;
+        int      MinX, MinY, MaxX, MaxY;
+    };
+
+private:
+    FThreadPool*                     mPool = {};
+    std::vector<std::vector<FAccum>> mBands;
+    std::vector<FSuperpixelStat>     mStats;
+};
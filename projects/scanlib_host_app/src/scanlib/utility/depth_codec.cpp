@@ -0,0 +1,176 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "depth_codec.hpp"
+#include <algorithm>
+#include <string.h>
+
+using namespace std;
+
+namespace {
+constexpr char   MAGIC[4]    = { 'd', 'p', 'z', '1' };
+constexpr size_t HEADER_SIZE = 16;
+
+template <typename Ty_>
+Ty_ ReadU32( uint8_t const* p )
+{
+    uint32_t v;
+    memcpy( &v, p, 4 );
+    return Ty_( v );
+}
+
+void WriteU32( uint8_t* p, uint32_t v )
+{
+    memcpy( p, &v, 4 );
+}
+
+//! Median edge detector; picks a, b or gradient a + b - c.
+template <typename Ty_>
+Ty_ Predict( Ty_ a, Ty_ b, Ty_ c )
+{
+    if ( c >= max( a, b ) )
+        return min( a, b );
+    if ( c <= min( a, b ) )
+        return max( a, b );
+    return Ty_( a + b - c );
+}
+
+//! Signed/unsigned pair of each plane. Residuals wrap around in unsigned type.
+template <typename Ty_>
+struct TPlane;
+
+template <>
+struct TPlane<int32_t>
+{
+    using unsigned_type = uint32_t;
+    static int32_t  Get( FPxlData const& p ) { return p.Distance; }
+    static void     Set( FPxlData& p, uint32_t v ) { p.Distance = int32_t( v ); }
+    static uint32_t ZigZag( uint32_t r ) { return ( r << 1 ) ^ uint32_t( int32_t( r ) >> 31 ); }
+    static uint32_t UnZigZag( uint32_t z ) { return ( z >> 1 ) ^ ( 0u - ( z & 1 ) ); }
+};
+
+template <>
+struct TPlane<uint16_t>
+{
+    using unsigned_type = uint16_t;
+    static uint16_t Get( FPxlData const& p ) { return p.AMP; }
+    static void     Set( FPxlData& p, uint16_t v ) { p.AMP = v; }
+    static uint16_t ZigZag( uint16_t r ) { return uint16_t( ( r << 1 ) ^ uint16_t( int16_t( r ) >> 15 ) ); }
+    static uint16_t UnZigZag( uint16_t z ) { return uint16_t( ( z >> 1 ) ^ ( 0u - ( z & 1 ) ) ); }
+};
+
+//! Calls Fn( Index, Prediction ) for each pixel in order. Prediction only
+//! refers to pixels before Index, thus decoder can fill the plane in place.
+template <typename Ty_, typename Fn_>
+void ForEachPredicted( FPxlData const* Px, int Width, int Height, Fn_&& Fn )
+{
+    using P = TPlane<Ty_>;
+    for ( int y = 0; y < Height; y++ )
+    {
+        auto const Row = Px + (size_t)y * Width;
+        auto const Up  = y ? Row - Width : Row;
+        for ( int x = 0; x < Width; x++ )
+        {
+            Ty_ Pred;
+            if ( y == 0 )
+                Pred = x ? P::Get( Row[x - 1] ) : Ty_( 0 );
+            else if ( x == 0 )
+                Pred = P::Get( Up[0] );
+            else
+                Pred = Predict( P::Get( Row[x - 1] ), P::Get( Up[x] ), P::Get( Up[x - 1] ) );
+
+            Fn( (size_t)y * Width + x, Pred );
+        }
+    }
+}
+
+template <typename Ty_>
+void EncodePlane( vector<uint8_t>& Out, FPxlData const* Px, int Width, int Height )
+{
+    using P = TPlane<Ty_>;
+    using U = typename P::unsigned_type;
+
+    ForEachPredicted<Ty_>( Px, Width, Height, [&]( size_t i, Ty_ Pred ) {
+        U z = P::ZigZag( U( U( P::Get( Px[i] ) ) - U( Pred ) ) );
+        while ( z >= 0x80 )
+        {
+            Out.push_back( uint8_t( z | 0x80 ) );
+            z >>= 7;
+        }
+        Out.push_back( uint8_t( z ) );
+    } );
+}
+
+template <typename Ty_>
+bool DecodePlane( uint8_t const* Begin, uint8_t const* End, FPxlData* Px, int Width, int Height )
+{
+    using P = TPlane<Ty_>;
+    using U = typename P::unsigned_type;
+
+    bool bOk = true;
+    ForEachPredicted<Ty_>( Px, Width, Height, [&]( size_t i, Ty_ Pred ) {
+        U z = 0;
+        for ( int Shift = 0;; Shift += 7 )
+        {
+            if ( Begin == End || Shift >= int( sizeof( U ) * 8 ) )
+            {
+                bOk = false;
+                return;
+            }
+            auto const b = *Begin++;
+            z |= U( U( b & 0x7f ) << Shift );
+            if ( ( b & 0x80 ) == 0 )
+                break;
+        }
+        P::Set( Px[i], U( U( Pred ) + P::UnZigZag( z ) ) );
+    } );
+
+    return bOk && Begin == End;
+}
+} // namespace
+
+void scanlib::DepthEncode( std::vector<uint8_t>& Out, FPxlData const* Pixels, int Width, int Height )
+{
+    Out.clear();
+    Out.reserve( HEADER_SIZE + (size_t)Width * Height * 3 );
+    Out.resize( HEADER_SIZE );
+    memcpy( Out.data(), MAGIC, 4 );
+    WriteU32( Out.data() + 4, Width );
+    WriteU32( Out.data() + 8, Height );
+
+    EncodePlane<int32_t>( Out, Pixels, Width, Height );
+    WriteU32( Out.data() + 12, uint32_t( Out.size() - HEADER_SIZE ) );
+    EncodePlane<uint16_t>( Out, Pixels, Width, Height );
+}
+
+bool scanlib::DepthPeek( void const* Data, size_t Size, int* Width, int* Height ) noexcept
+{
+    auto p = static_cast<uint8_t const*>( Data );
+    if ( Size < HEADER_SIZE || memcmp( p, MAGIC, 4 ) != 0 )
+        return false;
+
+    auto const W = ReadU32<int>( p + 4 );
+    auto const H = ReadU32<int>( p + 8 );
+    if ( W < 0 || H < 0 || ReadU32<size_t>( p + 12 ) > Size - HEADER_SIZE )
+        return false;
+
+    *Width  = W;
+    *Height = H;
+    return true;
+}
+
+bool scanlib::DepthDecode( void const* Data, size_t Size, FPxlData* Out ) noexcept
+{
+    int W, H;
+    if ( !DepthPeek( Data, Size, &W, &H ) )
+        return false;
+
+    auto const p          = static_cast<uint8_t const*>( Data );
+    auto const PlaneBegin = p + HEADER_SIZE;
+    auto const PlaneSplit = PlaneBegin + ReadU32<size_t>( p + 12 );
+    return DecodePlane<int32_t>( PlaneBegin, PlaneSplit, Out, W, H )
+           && DecodePlane<uint16_t>( PlaneSplit, p + Size, Out, W, H );
+}
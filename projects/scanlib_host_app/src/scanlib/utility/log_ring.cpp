@@ -0,0 +1,142 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "log_ring.hpp"
+#include <algorithm>
+#include <string.h>
+
+using namespace std;
+
+FLogRing::FLogRing( size_t NumSlots )
+{
+    size_t N = 1;
+    while ( N < NumSlots )
+        N <<= 1;
+
+    mSlots = make_unique<FSlot[]>( N );
+    mMask  = N - 1;
+    for ( size_t i = 0; i < N; i++ )
+        mSlots[i].Seq.store( i, memory_order_relaxed );
+}
+
+bool FLogRing::Push( char const* Str ) noexcept
+{
+    return Push( Str, strlen( Str ) );
+}
+
+bool FLogRing::Push( char const* Str, size_t Len ) noexcept
+{
+    if ( Len == 0 )
+        return true;
+
+    // Text longer than whole ring can never fit
+    auto const NumRequired = min( ( Len + SLOT_PAYLOAD - 1 ) / SLOT_PAYLOAD, mMask + 1 );
+    Len                    = min<size_t>( Len, NumRequired * SLOT_PAYLOAD );
+
+    auto Pos = mHead.load( memory_order_relaxed );
+    for ( ;; )
+    {
+        // Every slot to claim must have been drained on the previous lap.
+        bool bRetry = false;
+        for ( size_t i = 0; i < NumRequired; i++ )
+        {
+            auto const Seq  = mSlots[( Pos + i ) & mMask].Seq.load( memory_order_acquire );
+            auto const Diff = (intptr_t)( Seq - ( Pos + i ) );
+            if ( Diff < 0 )
+            {
+                mNumDropped.fetch_add( 1, memory_order_relaxed );
+                return false;
+            }
+            if ( Diff > 0 )
+            {
+                bRetry = true;
+                break;
+            }
+        }
+
+        if ( bRetry )
+            Pos = mHead.load( memory_order_relaxed );
+        else if ( mHead.compare_exchange_weak( Pos, Pos + NumRequired, memory_order_relaxed ) )
+            break;
+    }
+
+    for ( size_t i = 0; i < NumRequired; i++ )
+    {
+        auto&      Slot = mSlots[( Pos + i ) & mMask];
+        auto const N    = min<size_t>( Len, SLOT_PAYLOAD );
+        memcpy( Slot.Data, Str, N );
+        Slot.Len = (uint32_t)N;
+        Str += N;
+        Len -= N;
+
+        Slot.Seq.store( Pos + i + 1, memory_order_release );
+    }
+
+    return true;
+}
+
+size_t FLogRing::Drain( std::string& Out, size_t MaxBytes )
+{
+    size_t NumBytes = 0;
+    while ( NumBytes < MaxBytes )
+    {
+        auto& Slot = mSlots[mTail & mMask];
+        if ( Slot.Seq.load( memory_order_acquire ) != mTail + 1 )
+            break;
+
+        Out.append( Slot.Data, Slot.Len );
+        NumBytes += Slot.Len;
+
+        // Hand the slot over to the producers of next lap.
+        Slot.Seq.store( mTail + mMask + 1, memory_order_release );
+        mTail++;
+    }
+
+    return NumBytes;
+}
+
+size_t FLogHistory::Append( std::string_view Text )
+{
+    size_t NumCompleted = 0;
+    for ( size_t Newline; ( Newline = Text.find( '\n' ) ) != string_view::npos; )
+    {
+        mPartial.append( Text.data(), Newline );
+        Text.remove_prefix( Newline + 1 );
+
+        mNumBytes += mPartial.size();
+        mLines.emplace_back( std::move( mPartial ) );
+        mPartial.clear();
+        NumCompleted++;
+    }
+    mPartial.append( Text.data(), Text.size() );
+
+    while ( mLines.size() > 1 && ( mLines.size() > mMaxLines || mNumBytes > mMaxBytes ) )
+    {
+        mNumBytes -= mLines.front().size();
+        mLines.pop_front();
+    }
+
+    return min( NumCompleted, mLines.size() );
+}
+
+void FLogHistory::Clear() noexcept
+{
+    mLines.clear();
+    mPartial.clear();
+    mNumBytes = 0;
+}
+
+size_t FLogHistory::FindLast( std::string_view Needle, size_t Before, std::string_view Filter ) const noexcept
+{
+    for ( size_t i = min( Before, mLines.size() ); i-- > 0; )
+    {
+        string_view Line = mLines[i];
+        if ( Matches( Line, Filter ) && Line.find( Needle ) != string_view::npos )
+            return i;
+    }
+
+    return mLines.size();
+}
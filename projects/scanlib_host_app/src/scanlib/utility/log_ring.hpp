@@ -0,0 +1,109 @@
+//! Lock-free log ring and bounded line history for console views.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! FLogRing is a bounded multi-producer, single-consumer queue of text made of
+//! fixed size slots, each of which carries its own sequence number. Producers
+//! claim consecutive slots with a single CAS and never block nor allocate;
+//! text that doesn't fit is dropped and counted. The consumer drains
+//! published slots in order, usually from a GUI timer.
+//!
+//! FLogHistory keeps the drained text as lines, bounded by both number of
+//! lines and bytes, so that views can be filtered or searched line by line
+//! without copying the whole text.
+#pragma once
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+class FLogRing
+{
+public:
+    enum
+    {
+        SLOT_SIZE    = 128,
+        SLOT_PAYLOAD = SLOT_SIZE - 16,
+    };
+
+public:
+    //! @param      NumSlots: Rounded up to power of two. Capacity in bytes is
+    //!             NumSlots * SLOT_PAYLOAD.
+    explicit FLogRing( size_t NumSlots = 4096 );
+
+    //! @brief      Append text. Safe to call from any thread.
+    //! @returns    false if the ring is full; text is dropped.
+    bool Push( char const* Str, size_t Len ) noexcept;
+    bool Push( char const* Str ) noexcept;
+
+    //! @brief      Move published text into Out, in order of push. Must be
+    //!             called from single consumer.
+    //! @param      MaxBytes: Stops once this many bytes have been appended.
+    //! @returns    Number of bytes appended.
+    size_t Drain( std::string& Out, size_t MaxBytes = SIZE_MAX );
+
+    //! @brief      Number of pushes dropped due to full ring.
+    size_t NumDropped() const noexcept { return mNumDropped; }
+    size_t NumSlots() const noexcept { return mMask + 1; }
+
+private:
+    struct alignas( 64 ) FSlot
+    {
+        std::atomic_size_t Seq;
+        uint32_t           Len;
+        char               Data[SLOT_PAYLOAD];
+    };
+    static_assert( sizeof( FSlot ) == SLOT_SIZE );
+
+private:
+    std::unique_ptr<FSlot[]> mSlots;
+    size_t                   mMask = 0;
+
+    alignas( 64 ) std::atomic_size_t mHead = 0; //!< Next slot to claim
+    alignas( 64 ) size_t mTail             = 0; //!< Next slot to drain; consumer only
+    std::atomic_size_t mNumDropped         = 0;
+};
+
+class FLogHistory
+{
+public:
+    FLogHistory( size_t MaxLines = 4096, size_t MaxBytes = 1 << 20 ) noexcept
+        : mMaxLines( MaxLines )
+        , mMaxBytes( MaxBytes )
+    {
+    }
+
+    //! @brief      Append text. Lines are stored once terminated by newline;
+    //!             oldest ones are discarded to keep the bounds.
+    //! @returns    Number of lines completed by this call.
+    size_t Append( std::string_view Text );
+
+    void Clear() noexcept;
+
+    //! @brief      Lines from oldest. Newline is not included.
+    size_t             NumLines() const noexcept { return mLines.size(); }
+    std::string const& Line( size_t Index ) const noexcept { return mLines[Index]; }
+
+    //! @brief      Finds last line containing Needle, before line Before.
+    //! @param      Filter: Lines not containing Filter are skipped.
+    //! @returns    Index of the line, or NumLines() if not found.
+    size_t FindLast( std::string_view Needle, size_t Before, std::string_view Filter = {} ) const noexcept;
+
+    //! @brief      Whether line passes given filter. Empty filter passes all.
+    static bool Matches( std::string_view Line, std::string_view Filter ) noexcept
+    {
+        return Filter.empty() || Line.find( Filter ) != std::string_view::npos;
+    }
+
+private:
+    std::deque<std::string> mLines;
+    std::string             mPartial;
+    size_t                  mNumBytes = 0;
+    size_t                  mMaxLines;
+    size_t                  mMaxBytes;
+};
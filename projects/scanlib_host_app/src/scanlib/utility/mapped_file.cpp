@@ -0,0 +1,150 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "mapped_file.hpp"
+#include <stdio.h>
+#include <utility>
+
+#if defined( _WIN32 )
+#    include <Windows.h>
+#elif defined( __unix__ ) || defined( __APPLE__ )
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#    define SCANLIB_POSIX_MMAP
+#endif
+
+using namespace std;
+
+FMappedFile::FMappedFile( FMappedFile&& Other ) noexcept
+{
+    *this = std::move( Other );
+}
+
+FMappedFile& FMappedFile::operator=( FMappedFile&& Other ) noexcept
+{
+    if ( this != &Other )
+    {
+        Close();
+        mData     = exchange( Other.mData, nullptr );
+        mSize     = exchange( Other.mSize, 0 );
+        bMapped   = exchange( Other.bMapped, false );
+        mHandle   = exchange( Other.mHandle, nullptr );
+        mFallback = std::move( Other.mFallback );
+    }
+    return *this;
+}
+
+//! Reads whole file into buffer.
+static bool ReadWhole( char const* Path, vector<char>& Out )
+{
+    FILE* fp = fopen( Path, "rb" );
+    if ( fp == nullptr )
+        return false;
+
+    fseek( fp, 0, SEEK_END );
+    auto Size = ftell( fp );
+    fseek( fp, 0, SEEK_SET );
+
+    bool bOk = Size >= 0;
+    if ( bOk )
+    {
+        Out.resize( (size_t)Size );
+        bOk = fread( Out.data(), 1, Out.size(), fp ) == Out.size();
+    }
+
+    fclose( fp );
+    return bOk;
+}
+
+bool FMappedFile::Open( char const* Path )
+{
+    Close();
+
+#if defined( SCANLIB_POSIX_MMAP )
+    int fd = open( Path, O_RDONLY );
+    if ( fd < 0 )
+        return false;
+
+    struct stat st;
+    if ( fstat( fd, &st ) == 0 && st.st_size > 0 )
+    {
+        auto p = mmap( nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( p != MAP_FAILED )
+        {
+            // Files are mostly consumed front to back.
+            madvise( p, (size_t)st.st_size, MADV_SEQUENTIAL );
+            mData   = p;
+            mSize   = (size_t)st.st_size;
+            bMapped = true;
+        }
+    }
+
+    close( fd );
+    if ( bMapped )
+        return true;
+#elif defined( _WIN32 )
+    auto hFile = CreateFileA( Path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    if ( hFile == INVALID_HANDLE_VALUE )
+        return false;
+
+    LARGE_INTEGER Size;
+    if ( GetFileSizeEx( hFile, &Size ) && Size.QuadPart > 0 )
+    {
+        auto hMap = CreateFileMappingA( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+        if ( hMap )
+        {
+            mData = MapViewOfFile( hMap, FILE_MAP_READ, 0, 0, 0 );
+            if ( mData )
+            {
+                mSize   = (size_t)Size.QuadPart;
+                mHandle = hMap;
+                bMapped = true;
+            }
+            else
+            {
+                CloseHandle( hMap );
+            }
+        }
+    }
+
+    CloseHandle( hFile );
+    if ( bMapped )
+        return true;
+#endif
+
+    // Empty files can't be mapped; those and unsupported platforms go here.
+    if ( !ReadWhole( Path, mFallback ) || mFallback.empty() )
+    {
+        mFallback.clear();
+        return false;
+    }
+
+    mData = mFallback.data();
+    mSize = mFallback.size();
+    return true;
+}
+
+void FMappedFile::Close() noexcept
+{
+    if ( bMapped )
+    {
+#if defined( SCANLIB_POSIX_MMAP )
+        munmap( const_cast<void*>( mData ), mSize );
+#elif defined( _WIN32 )
+        UnmapViewOfFile( mData );
+        CloseHandle( (HANDLE)mHandle );
+#endif
+    }
+
+    mData   = nullptr;
+    mSize   = 0;
+    bMapped = false;
+    mHandle = nullptr;
+    mFallback.clear();
+    mFallback.shrink_to_fit();
+}
@@ -0,0 +1,42 @@
+//! Read-only memory mapped file.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Maps whole file into memory. Falls back to reading the file into heap
+//! buffer where mapping is unavailable, thus callers don't need to care about
+//! the platform.
+#pragma once
+#include <stddef.h>
+#include <vector>
+
+class FMappedFile
+{
+public:
+    FMappedFile() = default;
+    ~FMappedFile() { Close(); }
+
+    FMappedFile( FMappedFile&& Other ) noexcept;
+    FMappedFile& operator=( FMappedFile&& Other ) noexcept;
+    FMappedFile( FMappedFile const& ) = delete;
+    FMappedFile& operator=( FMappedFile const& ) = delete;
+
+    //! @brief      Open file. Previously opened file is closed.
+    //! @returns    false if file could not be opened or read.
+    bool Open( char const* Path );
+
+    //! @brief      Release mapping.
+    void Close() noexcept;
+
+    bool        IsOpen() const noexcept { return mData != nullptr; }
+    void const* Data() const noexcept { return mData; }
+    size_t      Size() const noexcept { return mSize; }
+
+private:
+    void const*       mData    = {};
+    size_t            mSize    = 0;
+    bool              bMapped  = false;
+    void*             mHandle  = {}; //!< Mapping handle on win32
+    std::vector<char> mFallback;
+};
@@ -0,0 +1,66 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "pipeline.hpp"
+#include <chrono>
+#include <stdio.h>
+#include "trace.hpp"
+
+using namespace std;
+
+FPipelineStage::FPipelineStage( char const* Name ) noexcept
+    : mName( Name )
+    , mState( int( EStageState::Starved ) )
+    , mStateBegin( now() )
+{
+}
+
+int64_t FPipelineStage::now() noexcept
+{
+    return chrono::duration_cast<chrono::nanoseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+void FPipelineStage::Enter( EStageState State ) noexcept
+{
+    auto const Now = now();
+    if ( mState == int( EStageState::Busy ) && FTracer::Enabled() )
+        FTracer::Span( mName, mStateBegin, Now, double( mNumItems ) );
+
+    mNanoseconds[mState] += Now - mStateBegin;
+    mStateBegin = Now;
+    mState      = int( State );
+
+    if ( State == EStageState::Busy )
+        mNumItems++;
+}
+
+FStageOccupancy FPipelineStage::Snapshot() const noexcept
+{
+    FStageOccupancy Out;
+    for ( int i = 0; i < 3; i++ )
+        Out.Seconds[i] = mNanoseconds[i] * 1e-9;
+
+    Out.Seconds[mState] += ( now() - mStateBegin ) * 1e-9;
+    Out.NumItems = mNumItems;
+    return Out;
+}
+
+string FPipelineStage::Format() const
+{
+    auto const S = Snapshot();
+    char       Buf[160];
+    snprintf(
+      Buf,
+      sizeof Buf,
+      "%s: busy %.0f%% starved %.0f%% blocked %.0f%%, %llu items, %.1f ms/item",
+      mName,
+      S.Ratio( EStageState::Busy ) * 100,
+      S.Ratio( EStageState::Starved ) * 100,
+      S.Ratio( EStageState::Blocked ) * 100,
+      (unsigned long long)S.NumItems,
+      S.NumItems ? S.Seconds[int( EStageState::Busy )] * 1e3 / S.NumItems : 0.0 );
+    return Buf;
+}
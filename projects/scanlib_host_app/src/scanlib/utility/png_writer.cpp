@@ -0,0 +1,226 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "png_writer.hpp"
+#include <algorithm>
+#include <array>
+#include <string.h>
+
+using namespace std;
+
+static constexpr array<uint32_t, 256> MakeCrcTable()
+{
+    array<uint32_t, 256> T = {};
+    for ( uint32_t n = 0; n < 256; n++ )
+    {
+        uint32_t c = n;
+        for ( int k = 0; k < 8; k++ )
+            c = c & 1 ? 0xedb88320u ^ ( c >> 1 ) : c >> 1;
+        T[n] = c;
+    }
+    return T;
+}
+
+static constexpr auto CRC_TABLE = MakeCrcTable();
+
+static uint32_t Crc32( uint8_t const* p, size_t n, uint32_t crc = 0 )
+{
+    crc = ~crc;
+    for ( size_t i = 0; i < n; i++ )
+        crc = CRC_TABLE[( crc ^ p[i] ) & 0xff] ^ ( crc >> 8 );
+    return ~crc;
+}
+
+static void PutU32BE( vector<uint8_t>& Out, uint32_t v )
+{
+    uint8_t b[] = { uint8_t( v >> 24 ), uint8_t( v >> 16 ), uint8_t( v >> 8 ), uint8_t( v ) };
+    Out.insert( Out.end(), b, b + 4 );
+}
+
+//! Appends chunk whose data is already placed at Out[Begin + 8 ...].
+static void FinishChunk( vector<uint8_t>& Out, size_t Begin )
+{
+    auto const Len = uint32_t( Out.size() - Begin - 8 );
+    Out[Begin + 0] = uint8_t( Len >> 24 );
+    Out[Begin + 1] = uint8_t( Len >> 16 );
+    Out[Begin + 2] = uint8_t( Len >> 8 );
+    Out[Begin + 3] = uint8_t( Len );
+
+    // CRC covers type and data
+    PutU32BE( Out, Crc32( Out.data() + Begin + 4, Len + 4 ) );
+}
+
+static size_t BeginChunk( vector<uint8_t>& Out, char const* Type )
+{
+    auto Begin = Out.size();
+    Out.resize( Begin + 4 );
+    Out.insert( Out.end(), Type, Type + 4 );
+    return Begin;
+}
+
+namespace {
+//! Writes zlib stream of stored deflate blocks.
+struct FStoredDeflate
+{
+    enum
+    {
+        MAX_BLOCK = 65535
+    };
+
+    vector<uint8_t>& Out;
+    size_t           Remaining;
+    size_t           BlockLeft = 0;
+    uint32_t         A         = 1;
+    uint32_t         B         = 0;
+
+    FStoredDeflate( vector<uint8_t>& o, size_t Total ) : Out( o ), Remaining( Total )
+    {
+        Out.push_back( 0x78 ); // CM = 8, CINFO = 7
+        Out.push_back( 0x01 ); // No compression, FCHECK
+
+        // Stream must contain at least one final block.
+        if ( Total == 0 )
+            putBlockHeader( true, 0 );
+    }
+
+    void Write( uint8_t const* p, size_t n )
+    {
+        adler( p, n );
+        while ( n )
+        {
+            if ( BlockLeft == 0 )
+            {
+                BlockLeft = min<size_t>( MAX_BLOCK, Remaining );
+                putBlockHeader( Remaining == BlockLeft, uint16_t( BlockLeft ) );
+            }
+
+            auto const Step = min( n, BlockLeft );
+            Out.insert( Out.end(), p, p + Step );
+            p += Step, n -= Step;
+            BlockLeft -= Step, Remaining -= Step;
+        }
+    }
+
+    void Finish() { PutU32BE( Out, ( B << 16 ) | A ); }
+
+private:
+    void putBlockHeader( bool bFinal, uint16_t Len )
+    {
+        uint16_t const NLen  = ~Len;
+        uint8_t const  Hdr[] = { uint8_t( bFinal ), uint8_t( Len ), uint8_t( Len >> 8 ), uint8_t( NLen ), uint8_t( NLen >> 8 ) };
+        Out.insert( Out.end(), Hdr, Hdr + 5 );
+    }
+
+    void adler( uint8_t const* p, size_t n )
+    {
+        // Largest n such that 255n(n+1)/2 + (n+1)(BASE-1) fits in 32 bits
+        constexpr size_t   NMAX = 5552;
+        constexpr uint32_t BASE = 65521;
+        while ( n )
+        {
+            auto const Step = min( n, NMAX );
+            for ( size_t i = 0; i < Step; i++ )
+            {
+                A += p[i];
+                B += A;
+            }
+            A %= BASE, B %= BASE;
+            p += Step, n -= Step;
+        }
+    }
+};
+} // namespace
+
+void scanlib::PngEncode(
+  std::vector<uint8_t>& Out,
+  void const*           Pixels,
+  int                   Width,
+  int                   Height,
+  EPngFormat            Format,
+  size_t                Stride )
+{
+    uint8_t BitDepth, ColorType, Channels, BytesPerChannel = 1;
+    switch ( Format )
+    {
+    case EPngFormat::GRAY8: BitDepth = 8, ColorType = 0, Channels = 1; break;
+    case EPngFormat::GRAY16: BitDepth = 16, ColorType = 0, Channels = 1, BytesPerChannel = 2; break;
+    case EPngFormat::RGB8: BitDepth = 8, ColorType = 2, Channels = 3; break;
+    case EPngFormat::RGBA8:
+    case EPngFormat::BGRA8:
+    default: BitDepth = 8, ColorType = 6, Channels = 4; break;
+    }
+
+    auto const RowBytes = (size_t)Width * Channels * BytesPerChannel;
+    Stride              = Stride ? Stride : RowBytes;
+
+    // Stored blocks add 5 bytes per 64k; reserve once.
+    auto const RawSize = ( RowBytes + 1 ) * Height;
+    Out.clear();
+    Out.reserve( RawSize + RawSize / FStoredDeflate::MAX_BLOCK * 5 + 128 );
+
+    static uint8_t const SIGNATURE[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    Out.insert( Out.end(), SIGNATURE, SIGNATURE + 8 );
+
+    auto Chunk = BeginChunk( Out, "IHDR" );
+    PutU32BE( Out, Width );
+    PutU32BE( Out, Height );
+    uint8_t const Ihdr[] = { BitDepth, ColorType, 0, 0, 0 };
+    Out.insert( Out.end(), Ihdr, Ihdr + 5 );
+    FinishChunk( Out, Chunk );
+
+    Chunk = BeginChunk( Out, "IDAT" );
+    {
+        FStoredDeflate  Z( Out, RawSize );
+        vector<uint8_t> Row;
+        bool const      bSwizzle = Format == EPngFormat::GRAY16 || Format == EPngFormat::BGRA8;
+        if ( bSwizzle )
+            Row.resize( RowBytes );
+
+        for ( int y = 0; y < Height; y++ )
+        {
+            auto const*   Src    = (uint8_t const*)Pixels + y * Stride;
+            uint8_t const Filter = 0;
+            Z.Write( &Filter, 1 );
+
+            if ( Format == EPngFormat::GRAY16 )
+            {
+                auto const* S = (uint16_t const*)Src;
+                for ( int x = 0; x < Width; x++ )
+                {
+                    Row[x * 2 + 0] = uint8_t( S[x] >> 8 );
+                    Row[x * 2 + 1] = uint8_t( S[x] );
+                }
+            }
+            else if ( Format == EPngFormat::BGRA8 )
+            {
+                for ( int x = 0; x < Width; x++ )
+                {
+                    Row[x * 4 + 0] = Src[x * 4 + 2];
+                    Row[x * 4 + 1] = Src[x * 4 + 1];
+                    Row[x * 4 + 2] = Src[x * 4 + 0];
+                    Row[x * 4 + 3] = Src[x * 4 + 3];
+                }
+            }
+
+            Z.Write( bSwizzle ? Row.data() : Src, RowBytes );
+        }
+        Z.Finish();
+    }
+    FinishChunk( Out, Chunk );
+
+    Chunk = BeginChunk( Out, "IEND" );
+    FinishChunk( Out, Chunk );
+}
+
+bool scanlib::PngWriteFile( char const* Path, std::vector<uint8_t> const& Encoded )
+{
+    FILE* fp = fopen( Path, "wb" );
+    if ( fp == nullptr )
+        return false;
+
+    bool bOk = fwrite( Encoded.data(), 1, Encoded.size(), fp ) == Encoded.size();
+    return fclose( fp ) == 0 && bOk;
+}
@@ -0,0 +1,41 @@
+//! Minimal PNG encoder.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Emits image data as stored(uncompressed) deflate blocks. Output is valid PNG
+//! readable by any decoder, and encoding reduces to a copy plus checksums,
+//! which keeps batch conversion I/O bound without an external zlib.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+namespace scanlib {
+enum class EPngFormat
+{
+    GRAY8,  //!< 1 byte per pixel
+    GRAY16, //!< Native endian uint16_t per pixel
+    RGB8,   //!< R, G, B bytes
+    RGBA8,  //!< R, G, B, A bytes
+    BGRA8,  //!< B, G, R, A bytes; e.g. little endian ARGB words
+};
+
+//! @brief      Encode image into PNG stream.
+//! @param      Out: Encoded stream. Cleared first; reuse across calls to avoid
+//!             reallocation.
+//! @param      Stride: Row pitch in bytes. 0 for tightly packed rows.
+void PngEncode(
+  std::vector<uint8_t>& Out,
+  void const*           Pixels,
+  int                   Width,
+  int                   Height,
+  EPngFormat            Format,
+  size_t                Stride = 0 );
+
+//! @brief      Write encoded buffer into file.
+//! @returns    false if file could not be written.
+bool PngWriteFile( char const* Path, std::vector<uint8_t> const& Encoded );
+} // namespace scanlib
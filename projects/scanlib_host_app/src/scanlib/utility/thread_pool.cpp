@@ -0,0 +1,196 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "thread_pool.hpp"
+#include <algorithm>
+#include "trace.hpp"
+
+using namespace std;
+
+//! Identifies the pool and queue of the worker running on current thread.
+static thread_local FThreadPool* tOwnerPool  = nullptr;
+static thread_local size_t       tOwnerIndex = 0;
+
+FThreadPool::FThreadPool( size_t NumThreads )
+{
+    NumThreads = NumThreads ? NumThreads : thread::hardware_concurrency();
+    NumThreads = max<size_t>( 1, NumThreads );
+
+    mQueues.reserve( NumThreads );
+    for ( size_t i = 0; i < NumThreads; i++ )
+        mQueues.emplace_back( make_unique<FWorkerQueue>() );
+
+    mThreads.reserve( NumThreads );
+    for ( size_t i = 0; i < NumThreads; i++ )
+        mThreads.emplace_back( &FThreadPool::workerThread, this, i );
+}
+
+FThreadPool::~FThreadPool()
+{
+    {
+        lock_guard<mutex> lk( mWaitLock );
+        bShutdown = true;
+    }
+    mWakeCv.notify_all();
+
+    for ( auto& Thread : mThreads )
+        Thread.join();
+}
+
+FThreadPool& FThreadPool::Shared()
+{
+    static FThreadPool Pool;
+    return Pool;
+}
+
+void FThreadPool::Enqueue( FTask Task )
+{
+    auto Index = tOwnerPool == this ? tOwnerIndex : mNextQueue++ % mQueues.size();
+    {
+        auto&             Q = *mQueues[Index];
+        lock_guard<mutex> lk( Q.Lock );
+        Q.Tasks.emplace_back( std::move( Task ) );
+    }
+
+    mNumPending++;
+    {
+        // Sleeping workers check pending count under this lock.
+        lock_guard<mutex> lk( mWaitLock );
+    }
+    mWakeCv.notify_one();
+}
+
+bool FThreadPool::tryPop( size_t Index, FTask& Out )
+{
+    auto&             Q = *mQueues[Index];
+    lock_guard<mutex> lk( Q.Lock );
+    if ( Q.Tasks.empty() )
+        return false;
+
+    Out = std::move( Q.Tasks.back() );
+    Q.Tasks.pop_back();
+    return true;
+}
+
+bool FThreadPool::trySteal( size_t Index, FTask& Out )
+{
+    auto const N = mQueues.size();
+    for ( size_t i = 1; i < N; i++ )
+    {
+        auto&              Q = *mQueues[( Index + i ) % N];
+        unique_lock<mutex> lk( Q.Lock, try_to_lock );
+        if ( !lk.owns_lock() || Q.Tasks.empty() )
+            continue;
+
+        Out = std::move( Q.Tasks.front() );
+        Q.Tasks.pop_front();
+        return true;
+    }
+
+    return false;
+}
+
+void FThreadPool::notifyIfIdle()
+{
+    if ( mNumActive == 0 && mNumPending == 0 )
+    {
+        lock_guard<mutex> lk( mWaitLock );
+        mIdleCv.notify_all();
+    }
+}
+
+void FThreadPool::workerThread( size_t Index ) noexcept
+{
+    tOwnerPool  = this;
+    tOwnerIndex = Index;
+    FTracer::NameThread( "pool" );
+
+    for ( FTask Task;; )
+    {
+        // Counted as active before popping, so that WaitIdle() never observes
+        // a task that is neither pending nor active.
+        mNumActive++;
+        if ( tryPop( Index, Task ) || trySteal( Index, Task ) )
+        {
+            mNumPending--;
+            {
+                SCANLIB_TRACE_SCOPE( "task" );
+                Task();
+            }
+            Task = nullptr;
+            mNumActive--;
+            notifyIfIdle();
+            continue;
+        }
+        mNumActive--;
+        notifyIfIdle();
+
+        unique_lock<mutex> lk( mWaitLock );
+        mWakeCv.wait( lk, [this]() { return bShutdown || mNumPending > 0; } );
+        if ( bShutdown && mNumPending == 0 )
+            return;
+    }
+}
+
+void FThreadPool::ParallelFor(
+  size_t                                        Begin,
+  size_t                                        End,
+  size_t                                        Grain,
+  std::function<void( size_t, size_t )> const& Fn )
+{
+    if ( Begin >= End )
+        return;
+
+    Grain                = max<size_t>( 1, Grain );
+    auto const NumChunks = ( End - Begin + Grain - 1 ) / Grain;
+    if ( NumChunks == 1 )
+    {
+        Fn( Begin, End );
+        return;
+    }
+
+    // Helpers may start after the caller has returned; state is shared.
+    struct FState
+    {
+        atomic_size_t      Next = 0;
+        atomic_size_t      Done = 0;
+        mutex              Lock;
+        condition_variable Cv;
+        function<void()>   Run;
+    };
+    auto State = make_shared<FState>();
+
+    State->Run = [S = State.get(), &Fn, Begin, End, Grain, NumChunks]() {
+        for ( size_t i; ( i = S->Next++ ) < NumChunks; )
+        {
+            auto ChunkBegin = Begin + i * Grain;
+            Fn( ChunkBegin, min( End, ChunkBegin + Grain ) );
+
+            if ( ++S->Done == NumChunks )
+            {
+                lock_guard<mutex> lk( S->Lock );
+                S->Cv.notify_all();
+            }
+        }
+    };
+
+    auto NumHelpers = min( NumChunks - 1, mThreads.size() );
+    for ( size_t i = 0; i < NumHelpers; i++ )
+    {
+        Enqueue( [State]() { State->Run(); } );
+    }
+
+    State->Run();
+
+    unique_lock<mutex> lk( State->Lock );
+    State->Cv.wait( lk, [&]() { return State->Done == NumChunks; } );
+}
+
+void FThreadPool::WaitIdle()
+{
+    unique_lock<mutex> lk( mWaitLock );
+    mIdleCv.wait( lk, [this]() { return mNumActive == 0 && mNumPending == 0; } );
+}
@@ -0,0 +1,88 @@
+//! Work-stealing thread pool.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Each worker owns a task queue. Tasks enqueued from a worker go to its own
+//! queue, others are distributed round-robin. An idle worker pops from the
+//! back of its own queue first, then steals from the front of the others, so
+//! uneven task sizes (e.g. files of different resolution) still keep every
+//! worker busy.
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class FThreadPool
+{
+public:
+    using FTask = std::function<void()>;
+
+public:
+    //! @param      NumThreads: 0 to use hardware concurrency.
+    explicit FThreadPool( size_t NumThreads = 0 );
+    ~FThreadPool();
+
+    FThreadPool( FThreadPool const& ) = delete;
+    FThreadPool& operator=( FThreadPool const& ) = delete;
+
+    //! @brief      Queue a task. Tasks must not throw.
+    void Enqueue( FTask Task );
+
+    //! @brief      Queue a task and get future of its result.
+    template <typename Fn_>
+    auto Submit( Fn_&& Fn ) -> std::future<std::invoke_result_t<Fn_>>
+    {
+        using result_type = std::invoke_result_t<Fn_>;
+        auto Task         = std::make_shared<std::packaged_task<result_type()>>( std::forward<Fn_>( Fn ) );
+        auto Future       = Task->get_future();
+        Enqueue( [Task]() { ( *Task )(); } );
+        return Future;
+    }
+
+    //! @brief      Splits [Begin, End) into chunks of Grain and runs them on
+    //!             the pool. Calling thread takes part in the work, thus it is
+    //!             safe to call this from a worker.
+    void ParallelFor( size_t Begin, size_t End, size_t Grain, std::function<void( size_t, size_t )> const& Fn );
+
+    //! @brief      Block until all queued tasks are done.
+    void WaitIdle();
+
+    size_t NumThreads() const noexcept { return mThreads.size(); }
+
+    //! @brief      Process-wide pool sized to hardware concurrency.
+    static FThreadPool& Shared();
+
+private:
+    struct FWorkerQueue
+    {
+        std::mutex        Lock;
+        std::deque<FTask> Tasks;
+    };
+
+    void workerThread( size_t Index ) noexcept;
+    bool tryPop( size_t Index, FTask& Out );
+    bool trySteal( size_t Index, FTask& Out );
+    void notifyIfIdle();
+
+private:
+    std::vector<std::unique_ptr<FWorkerQueue>> mQueues;
+    std::vector<std::thread>                   mThreads;
+
+    std::atomic_size_t mNumPending = 0; //!< Queued, not started
+    std::atomic_size_t mNumActive  = 0; //!< Workers holding or looking for a task
+    std::atomic_size_t mNextQueue  = 0;
+
+    std::mutex              mWaitLock;
+    std::condition_variable mWakeCv;
+    std::condition_variable mIdleCv;
+    bool                    bShutdown = false;
+};
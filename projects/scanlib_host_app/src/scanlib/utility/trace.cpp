@@ -0,0 +1,253 @@
+//! @brief
+//! @file
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+using namespace std;
+
+//! Single producer, single consumer ring of a thread.
+class FTraceBuffer
+{
+public:
+    enum
+    {
+        CAPACITY = 1 << 13
+    };
+
+    explicit FTraceBuffer( uint32_t Index )
+        : mEvents( make_unique<FTraceEvent[]>( CAPACITY ) )
+        , mIndex( Index )
+    {
+    }
+
+    void Push( FTraceEvent const& Event ) noexcept
+    {
+        auto const Head = mHead.load( memory_order_relaxed );
+        if ( Head - mTail.load( memory_order_acquire ) >= CAPACITY )
+        {
+            mNumDropped.fetch_add( 1, memory_order_relaxed );
+            return;
+        }
+
+        mEvents[Head & ( CAPACITY - 1 )] = Event;
+        mHead.store( Head + 1, memory_order_release );
+    }
+
+    template <typename Fn_>
+    size_t Drain( Fn_&& Visit )
+    {
+        auto const Tail = mTail.load( memory_order_relaxed );
+        auto const Head = mHead.load( memory_order_acquire );
+        for ( auto i = Tail; i != Head; i++ )
+            Visit( mEvents[i & ( CAPACITY - 1 )] );
+
+        mTail.store( Head, memory_order_release );
+        return Head - Tail;
+    }
+
+    uint32_t Index() const noexcept { return mIndex; }
+    size_t   NumDropped() const noexcept { return mNumDropped.load( memory_order_relaxed ); }
+
+    string Name; //!< Guarded by registry lock
+
+private:
+    unique_ptr<FTraceEvent[]> mEvents;
+    uint32_t                  mIndex;
+
+    alignas( 64 ) atomic_size_t mHead = 0;
+    alignas( 64 ) atomic_size_t mTail = 0;
+    atomic_size_t mNumDropped         = 0;
+};
+
+atomic_bool FTracer::sEnabled = false;
+
+FTracer::FRegistry& FTracer::registry()
+{
+    static FRegistry Registry;
+    return Registry;
+}
+
+int64_t FTracer::Now() noexcept
+{
+    return chrono::duration_cast<chrono::nanoseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static thread_local FTraceBuffer* tBuffer = nullptr;
+static thread_local char const*   tName   = nullptr;
+
+FTraceBuffer* FTracer::local()
+{
+    // Registry shares the buffer, thus events outlive threads that exited
+    // before collection.
+    if ( tBuffer == nullptr )
+    {
+        auto&             R = registry();
+        lock_guard<mutex> lk( R.Lock );
+        R.Buffers.push_back( make_shared<FTraceBuffer>( uint32_t( R.Buffers.size() ) ) );
+        tBuffer = R.Buffers.back().get();
+        if ( tName )
+            tBuffer->Name = tName;
+    }
+    return tBuffer;
+}
+
+void FTracer::record( FTraceEvent const& Event ) noexcept
+{
+    // Ring of a thread is allocated on its first event.
+    try
+    {
+        local()->Push( Event );
+    }
+    catch ( ... )
+    {
+    }
+}
+
+void FTracer::NameThread( char const* Name )
+{
+    // Threads that never record don't get a ring for their name.
+    tName = Name;
+    if ( tBuffer )
+    {
+        lock_guard<mutex> lk( registry().Lock );
+        tBuffer->Name = Name;
+    }
+}
+
+void FTracer::Span( char const* Name, int64_t Begin, int64_t End, double Arg ) noexcept
+{
+    record( { Name, Begin, End - Begin, Arg, 0, ETraceEvent::Span } );
+}
+
+void FTracer::Counter( char const* Name, double Value ) noexcept
+{
+    if ( Enabled() )
+        record( { Name, Now(), 0, Value, 0, ETraceEvent::Counter } );
+}
+
+void FTracer::Instant( char const* Name ) noexcept
+{
+    if ( Enabled() )
+        record( { Name, Now(), 0, NAN, 0, ETraceEvent::Instant } );
+}
+
+size_t FTracer::NumDropped() noexcept
+{
+    auto&             R = registry();
+    lock_guard<mutex> lk( R.Lock );
+
+    size_t Num = 0;
+    for ( auto& Buffer : R.Buffers )
+        Num += Buffer->NumDropped();
+    return Num;
+}
+
+size_t FTraceCollector::Collect()
+{
+    // Buffers are never removed, thus a copy of the list is safe to drain
+    // without the lock.
+    vector<shared_ptr<FTraceBuffer>> Buffers;
+    {
+        auto&             R = FTracer::registry();
+        lock_guard<mutex> lk( R.Lock );
+        Buffers = R.Buffers;
+
+        mThreadNames.resize( Buffers.size() );
+        for ( auto& Buffer : Buffers )
+            mThreadNames[Buffer->Index()] = Buffer->Name;
+    }
+
+    size_t Num = 0;
+    for ( auto& Buffer : Buffers )
+    {
+        auto const Thread = Buffer->Index();
+        Num += Buffer->Drain( [&]( FTraceEvent const& Event ) {
+            mEvents.push_back( Event );
+            mEvents.back().Thread = Thread;
+        } );
+    }
+    return Num;
+}
+
+void FTraceCollector::Trim( int64_t Before )
+{
+    auto const End = remove_if( mEvents.begin(), mEvents.end(), [Before]( FTraceEvent const& e ) {
+        return e.Begin + e.Duration < Before;
+    } );
+    mEvents.erase( End, mEvents.end() );
+}
+
+//! Names are expected plain; quotes and backslashes are escaped anyway.
+static void AppendEscaped( string& Out, char const* Str )
+{
+    for ( ; *Str; Str++ )
+    {
+        if ( *Str == '"' || *Str == '\\' )
+            Out += '\\';
+        if ( (unsigned char)*Str >= 0x20 )
+            Out += *Str;
+    }
+}
+
+size_t FTraceCollector::Export( int64_t Begin, int64_t End, string& Json ) const
+{
+    // Timestamps are microseconds from the beginning of the range.
+    char   Buf[160];
+    size_t Num = 0;
+    Json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    for ( size_t i = 0; i < mThreadNames.size(); i++ )
+    {
+        if ( mThreadNames[i].empty() )
+            continue;
+        snprintf( Buf, sizeof Buf, "{\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"name\":\"thread_name\",\"args\":{\"name\":\"", i );
+        Json += Num++ ? "," : "";
+        Json += Buf;
+        AppendEscaped( Json, mThreadNames[i].c_str() );
+        Json += "\"}}";
+    }
+
+    for ( auto const& e : mEvents )
+    {
+        if ( e.Begin > End || e.Begin + e.Duration < Begin )
+            continue;
+
+        auto const ts = ( e.Begin - Begin ) * 1e-3;
+        Json += Num++ ? ",{\"name\":\"" : "{\"name\":\"";
+        AppendEscaped( Json, e.Name );
+
+        switch ( e.Type )
+        {
+            case ETraceEvent::Span:
+                snprintf( Buf, sizeof Buf, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", e.Thread, ts, e.Duration * 1e-3 );
+                Json += Buf;
+                if ( isfinite( e.Value ) )
+                {
+                    snprintf( Buf, sizeof Buf, ",\"args\":{\"value\":%.17g}", e.Value );
+                    Json += Buf;
+                }
+                break;
+
+            case ETraceEvent::Counter:
+                snprintf( Buf, sizeof Buf, "\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.17g}", e.Thread, ts, isfinite( e.Value ) ? e.Value : 0.0 );
+                Json += Buf;
+                break;
+
+            case ETraceEvent::Instant:
+                snprintf( Buf, sizeof Buf, "\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f", e.Thread, ts );
+                Json += Buf;
+                break;
+        }
+        Json += '}';
+    }
+
+    Json += "]}\n";
+    return Num;
+}
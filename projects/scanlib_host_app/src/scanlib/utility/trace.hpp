@@ -0,0 +1,133 @@
+//! Scoped spans and counters recorded per thread, exported as Chrome trace.
+//!
+//! @author Seungwoo Kang (ki6080@gmail.com)
+//! @copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//! Every thread records into a ring of its own, which it alone writes and a
+//! single collector reads; recording never blocks, allocates, nor shares a
+//! cache line with other threads once the ring exists. Full rings drop events
+//! and count them. While tracing is disabled, a span costs one relaxed load.
+//!
+//! Names are not copied, thus must be string literals or otherwise outlive
+//! the export of their events.
+//!
+//! FTraceCollector drains the rings into a window of events, from which
+//! any time range can be written as Chrome trace JSON; chrome://tracing and
+//! Perfetto UI both open it.
+#pragma once
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum class ETraceEvent : uint8_t
+{
+    Span,    //!< Duration on a thread
+    Counter, //!< Value sampled at a time
+    Instant,
+};
+
+struct FTraceEvent
+{
+    char const* Name;
+    int64_t     Begin;    //!< Nanoseconds of steady clock
+    int64_t     Duration; //!< Nanoseconds; 0 unless span
+    double      Value;    //!< Of counter, or argument of span; NaN if none
+    uint32_t    Thread;   //!< Set by collector
+    ETraceEvent Type;
+};
+
+class FTraceBuffer;
+
+class FTracer
+{
+public:
+    static bool Enabled() noexcept { return sEnabled.load( std::memory_order_relaxed ); }
+    static void Enable( bool bEnable ) noexcept { sEnabled.store( bEnable, std::memory_order_relaxed ); }
+
+    static int64_t Now() noexcept;
+
+    //! @brief      Name calling thread in exported traces. Name must outlive
+    //!             the thread.
+    static void NameThread( char const* Name );
+
+    static void Span( char const* Name, int64_t Begin, int64_t End, double Arg ) noexcept;
+    static void Counter( char const* Name, double Value ) noexcept;
+    static void Instant( char const* Name ) noexcept;
+
+    //! @brief      Events dropped on full rings so far.
+    static size_t NumDropped() noexcept;
+
+private:
+    friend class FTraceCollector;
+    static FTraceBuffer* local();
+    static void          record( FTraceEvent const& Event ) noexcept;
+
+    struct FRegistry
+    {
+        std::mutex                                 Lock;
+        std::vector<std::shared_ptr<FTraceBuffer>> Buffers;
+    };
+    static FRegistry& registry();
+
+private:
+    static std::atomic_bool sEnabled;
+};
+
+//! @brief      Records a span from construction to destruction. Whether
+//!             tracing is enabled is decided at construction.
+class FTraceScope
+{
+public:
+    explicit FTraceScope( char const* Name, double Arg = std::numeric_limits<double>::quiet_NaN() ) noexcept
+        : mName( Name )
+        , mArg( Arg )
+        , mBegin( FTracer::Enabled() ? FTracer::Now() : -1 )
+    {
+    }
+
+    ~FTraceScope()
+    {
+        if ( mBegin >= 0 )
+            FTracer::Span( mName, mBegin, FTracer::Now(), mArg );
+    }
+
+    FTraceScope( FTraceScope const& ) = delete;
+    FTraceScope& operator=( FTraceScope const& ) = delete;
+
+private:
+    char const* mName;
+    double      mArg;
+    int64_t     mBegin;
+};
+
+#define SCANLIB_TRACE_CONCAT_( a, b ) a##b
+#define SCANLIB_TRACE_CONCAT( a, b )  SCANLIB_TRACE_CONCAT_( a, b )
+#define SCANLIB_TRACE_SCOPE( ... )    FTraceScope SCANLIB_TRACE_CONCAT( _trace_scope_, __LINE__ )( __VA_ARGS__ )
+
+class FTraceCollector
+{
+public:
+    //! @brief      Move events recorded so far from every thread into the
+    //!             window. Must be called from single collector.
+    //! @returns    Number of events collected.
+    size_t Collect();
+
+    //! @brief      Write events overlapping [Begin, End] as Chrome trace JSON.
+    //! @returns    Number of events written.
+    size_t Export( int64_t Begin, int64_t End, std::string& Json ) const;
+
+    //! @brief      Forget events that ended before given time.
+    void Trim( int64_t Before );
+
+    size_t NumEvents() const noexcept { return mEvents.size(); }
+
+private:
+    std::vector<FTraceEvent> mEvents;
+    std::vector<std::string> mThreadNames; //!< By thread index
+};